@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/*
+ * Host check of the fixed point aggregates in src/aggregate.c.
+ *
+ *   cc -O2 -Isrc -o aggregate_check scripts/aggregate_check.c src/aggregate.c -lm
+ *   ./aggregate_check
+ *
+ * Series shaped like the sensor manager channels, in thousandths, are
+ * aggregated one by one and as panes merged into a sliding window, and
+ * compared against a double precision two pass reference. Prints the
+ * largest mean and standard deviation error in thousandths, the time per
+ * sample, in TSC cycles on x86 and ns elsewhere, and the uplink bytes of a
+ * summary against sending the raw series. Exits non-zero if an error is
+ * more than one thousandth or min/max differ.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "aggregate.h"
+
+#define SAMPLES  4096
+#define PANES    4
+
+/* Uplink bytes, as sensor_agg.c and a raw series of timestamp (u32) and value (s32) would take. */
+#define SUMMARY_BYTES   (7 + 16)
+#define RAW_SAMPLE_BYTES 8
+
+struct series {
+	const char *name;
+	double base;
+	double noise;
+	double drift;
+};
+
+static const struct series series[] = {
+	{ "temperature", 23500, 50, 2000 },
+	{ "humidity", 41000, 300, 5000 },
+	{ "pressure", 101325, 20, 300 },
+	{ "gas", 52000000, 4000000, 20000000 },
+	{ "light", 1200000, 80000, 600000 },
+	{ "negative", -15000, 900, -3000 },
+	{ "constant", 700, 0, 0 },
+};
+
+static int32_t values[SAMPLES];
+
+static uint64_t now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+#endif
+}
+
+static double noise(void)
+{
+	/* Roughly normal, the sum of uniforms. */
+	double v = 0;
+
+	for (int i = 0; i < 6; i++) {
+		v += (double)rand() / RAND_MAX;
+	}
+	return (v - 3) / sqrt(0.5);
+}
+
+static void reference(const int32_t *v, size_t n, double *mean, double *stddev, int32_t *min,
+		      int32_t *max)
+{
+	double sum = 0;
+	double sq = 0;
+
+	*min = INT32_MAX;
+	*max = INT32_MIN;
+	for (size_t i = 0; i < n; i++) {
+		sum += v[i];
+		*min = (v[i] < *min) ? v[i] : *min;
+		*max = (v[i] > *max) ? v[i] : *max;
+	}
+	*mean = sum / n;
+	for (size_t i = 0; i < n; i++) {
+		sq += (v[i] - *mean) * (v[i] - *mean);
+	}
+	*stddev = sqrt(sq / n);
+}
+
+static bool compare(const char *what, const struct aggregate *agg, const int32_t *v, size_t n)
+{
+	double mean;
+	double stddev;
+	int32_t min;
+	int32_t max;
+	double mean_err;
+	double stddev_err;
+
+	reference(v, n, &mean, &stddev, &min, &max);
+	mean_err = fabs(aggregate_mean(agg) - mean);
+	stddev_err = fabs(aggregate_stddev(agg) - stddev);
+
+	printf("  %-8s mean %.0f err %.2f, stddev %.1f err %.2f\n", what, mean, mean_err, stddev,
+	       stddev_err);
+
+	return (agg->count == n) && (agg->min == min) && (agg->max == max) &&
+	       (mean_err <= 1) && (stddev_err <= 1);
+}
+
+int main(void)
+{
+	bool ok = true;
+
+	srand(1);
+
+	for (size_t s = 0; s < sizeof(series) / sizeof(series[0]); s++) {
+		struct aggregate whole;
+		struct aggregate pane[PANES];
+		struct aggregate window;
+		uint64_t start;
+		uint64_t elapsed;
+
+		for (size_t i = 0; i < SAMPLES; i++) {
+			values[i] = (int32_t)lround(series[s].base +
+						    (series[s].drift * i) / SAMPLES +
+						    series[s].noise * noise());
+		}
+
+		aggregate_reset(&whole);
+		start = now();
+		for (size_t i = 0; i < SAMPLES; i++) {
+			aggregate_add(&whole, values[i]);
+		}
+		elapsed = now() - start;
+
+		/* The sliding window of sensor_agg.c, panes of equal length merged. */
+		for (size_t p = 0; p < PANES; p++) {
+			aggregate_reset(&pane[p]);
+			for (size_t i = 0; i < SAMPLES / PANES; i++) {
+				aggregate_add(&pane[p], values[(p * (SAMPLES / PANES)) + i]);
+			}
+		}
+		aggregate_reset(&window);
+		for (size_t p = 0; p < PANES; p++) {
+			aggregate_merge(&window, &pane[p]);
+		}
+
+		printf("%s: %.1f %s per sample\n", series[s].name, (double)elapsed / SAMPLES,
+#if defined(__x86_64__) || defined(__i386__)
+		       "TSC cycles"
+#else
+		       "ns"
+#endif
+		       );
+		ok &= compare("whole", &whole, values, SAMPLES);
+		ok &= compare("panes", &window, values, SAMPLES);
+		ok &= compare("pane", &pane[PANES - 1], &values[SAMPLES - (SAMPLES / PANES)],
+			      SAMPLES / PANES);
+	}
+
+	printf("uplink: %d bytes per value and window instead of %d per sample, "
+	       "%d of %d bytes saved for 90 samples per window\n", SUMMARY_BYTES,
+	       RAW_SAMPLE_BYTES, (90 * RAW_SAMPLE_BYTES) - SUMMARY_BYTES, 90 * RAW_SAMPLE_BYTES);
+	printf("%s\n", ok ? "PASS" : "FAIL");
+
+	return ok ? 0 : 1;
+}
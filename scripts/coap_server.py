@@ -0,0 +1,297 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Local CoAP server for the uplink with CONFIG_UDP_COAP.
+
+Accepts POSTs to the uplink path, reassembling Block1 requests, answers
+confirmable ones and drops duplicates by message ID, repeating the answer
+to a CON. The datagrams are decoded as in src/uplink.h to count their
+records. With --response-size the answers carry that much payload, served
+block-wise (Block2) when it is larger than the block size asked for, and
+--drop loses some messages to exercise retransmission.
+
+Every --interval seconds and at the end it prints the messages per second
+both ways and the bytes on the wire per record, including IPv4 and UDP
+headers, next to what the same datagrams take as plain UDP.
+
+Example, on qemu_x86 at 192.0.2.1, with the host at 192.0.2.2:
+
+    west build -b qemu_x86 -- -DOVERLAY_CONFIG=overlay-coap.conf \
+        -DCONFIG_UDP_SERVER_ADDRESS_STATIC=\"192.0.2.2\"
+    coap_server.py --listen 192.0.2.2:5683 --drop 0.1
+"""
+
+import argparse
+import random
+import socket
+import struct
+import time
+
+CON, NON, ACK, RST = range(4)
+POST = 2
+CHANGED = (2 << 5) | 4
+CONTINUE = (2 << 5) | 31
+NOT_FOUND = (4 << 5) | 4
+INCOMPLETE = (4 << 5) | 8
+
+URI_PATH = 11
+BLOCK2 = 23
+BLOCK1 = 27
+
+IP_UDP_OVERHEAD = 28
+UPLINK_HEADER_SIZE = 4
+
+# EXCHANGE_LIFETIME of RFC 7252, how long message IDs are remembered.
+EXCHANGE_LIFETIME = 247
+
+
+def parse(data):
+    """Type, code, message ID, token, options as (number, value) and payload."""
+    if len(data) < 4 or data[0] >> 6 != 1:
+        raise ValueError('not CoAP')
+    mtype = (data[0] >> 4) & 3
+    tkl = data[0] & 0xf
+    code = data[1]
+    mid = struct.unpack_from('>H', data, 2)[0]
+    token = bytes(data[4:4 + tkl])
+    pos = 4 + tkl
+    number = 0
+    options = []
+    payload = b''
+    while pos < len(data):
+        if data[pos] == 0xff:
+            payload = bytes(data[pos + 1:])
+            break
+        delta, length = data[pos] >> 4, data[pos] & 0xf
+        pos += 1
+        values = []
+        for v in (delta, length):
+            if v == 13:
+                v = 13 + data[pos]
+                pos += 1
+            elif v == 14:
+                v = 269 + struct.unpack_from('>H', data, pos)[0]
+                pos += 2
+            elif v == 15:
+                raise ValueError('bad option')
+            values.append(v)
+        number += values[0]
+        options.append((number, bytes(data[pos:pos + values[1]])))
+        pos += values[1]
+    return mtype, code, mid, token, options, payload
+
+
+def build(mtype, code, mid, token, options=(), payload=b''):
+    out = bytearray([0x40 | (mtype << 4) | len(token), code]) + struct.pack('>H', mid) + token
+    last = 0
+    for number, value in sorted(options):
+        delta = number - last
+        last = number
+        head = bytearray([0])
+        for shift, v in ((4, delta), (0, len(value))):
+            if v >= 269:
+                head[0] |= 14 << shift
+                head += struct.pack('>H', v - 269)
+            elif v >= 13:
+                head[0] |= 13 << shift
+                head.append(v - 13)
+            else:
+                head[0] |= v << shift
+        out += head + value
+    if payload:
+        out += b'\xff' + payload
+    return bytes(out)
+
+
+def uint_option(value):
+    return value.to_bytes((value.bit_length() + 7) // 8, 'big')
+
+
+def block(options, number):
+    for n, value in options:
+        if n == number:
+            v = int.from_bytes(value, 'big')
+            return v >> 4, bool(v & 8), 16 << (v & 7)
+    return None
+
+
+def records(datagram):
+    count = 0
+    pos = UPLINK_HEADER_SIZE
+    while pos + 2 <= len(datagram):
+        pos += 2 + datagram[pos + 1]
+        count += 1
+    return count
+
+
+class Stats:
+
+    def __init__(self):
+        self.start = time.monotonic()
+        self.rx = self.tx = 0
+        self.rx_bytes = self.tx_bytes = 0
+        self.datagrams = self.records = self.udp_bytes = 0
+        self.duplicates = self.dropped = self.blocks1 = self.blocks2 = 0
+
+    def report(self):
+        elapsed = max(time.monotonic() - self.start, 1e-3)
+        print(f'{elapsed:.0f} s: {self.rx / elapsed:.2f} messages/s in, '
+              f'{self.tx / elapsed:.2f} out, {self.datagrams} datagrams of '
+              f'{self.records} records, {self.duplicates} duplicates, '
+              f'{self.dropped} dropped, {self.blocks1} request and '
+              f'{self.blocks2} response blocks')
+        if self.records:
+            print(f'  bytes per record: CoAP {self.rx_bytes / self.records:.1f} up, '
+                  f'{(self.rx_bytes + self.tx_bytes) / self.records:.1f} both ways, '
+                  f'plain UDP {self.udp_bytes / self.records:.1f}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--listen', default='0.0.0.0:5683', metavar='HOST:PORT',
+                        help='address to listen on')
+    parser.add_argument('--path', default='u', help='Uri-Path of the uplink')
+    parser.add_argument('--response-size', type=int, default=0, metavar='BYTES',
+                        help='payload of the answers')
+    parser.add_argument('--drop', type=float, default=0, metavar='FRACTION',
+                        help='messages to lose, either way')
+    parser.add_argument('--interval', type=float, default=60,
+                        help='seconds between reports')
+    parser.add_argument('-t', '--time', type=float,
+                        help='seconds to run, until Ctrl-C if not given')
+    parser.add_argument('-v', '--verbose', action='store_true',
+                        help='print every datagram')
+    args = parser.parse_args()
+
+    host, _, port = args.listen.rpartition(':')
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((host, int(port)))
+    sock.settimeout(0.5)
+
+    stats = Stats()
+    # (address, message ID) to the time and the answer sent, if any.
+    seen = {}
+    # (address, token) to the request reassembled so far.
+    partial = {}
+    response = bytes(i & 0xff for i in range(args.response_size))
+    rng = random.Random(1)
+    next_report = time.monotonic() + args.interval
+    end = time.monotonic() + args.time if args.time else None
+
+    def send(data, addr):
+        if rng.random() < args.drop:
+            stats.dropped += 1
+            return
+        stats.tx += 1
+        stats.tx_bytes += len(data) + IP_UDP_OVERHEAD
+        sock.sendto(data, addr)
+
+    def answer(mtype, mid, token, code, options=(), payload=b''):
+        if mtype == CON:
+            return build(ACK, code, mid, token, options, payload)
+        return build(NON, code, rng.randrange(0x10000), token, options, payload)
+
+    try:
+        while end is None or time.monotonic() < end:
+            if time.monotonic() >= next_report:
+                stats.report()
+                next_report += args.interval
+            try:
+                data, addr = sock.recvfrom(2048)
+            except socket.timeout:
+                continue
+            if rng.random() < args.drop:
+                stats.dropped += 1
+                continue
+            stats.rx += 1
+            stats.rx_bytes += len(data) + IP_UDP_OVERHEAD
+            try:
+                mtype, code, mid, token, options, payload = parse(data)
+            except (ValueError, IndexError, struct.error):
+                continue
+
+            now = time.monotonic()
+            for key in [k for k, (t, _) in seen.items() if now - t > EXCHANGE_LIFETIME]:
+                del seen[key]
+            if (addr, mid) in seen:
+                stats.duplicates += 1
+                if seen[addr, mid][1] is not None:
+                    send(seen[addr, mid][1], addr)
+                continue
+            seen[addr, mid] = (now, None)
+            if mtype in (ACK, RST) or code == 0:
+                continue
+
+            path = '/'.join(v.decode(errors='replace') for n, v in options if n == URI_PATH)
+            if code != POST or path != args.path:
+                reply = answer(mtype, mid, token, NOT_FOUND)
+                seen[addr, mid] = (now, reply)
+                send(reply, addr)
+                continue
+
+            b1 = block(options, BLOCK1)
+            b2 = block(options, BLOCK2)
+            reply_options = []
+            complete = None
+            if b2 is not None and b2[0] > 0:
+                # A later block of the answer, the request was complete before.
+                stats.blocks2 += 1
+            elif b1 is None:
+                complete = payload
+            else:
+                num, more, size = b1
+                got = partial.get((addr, token), b'')
+                if num * size != len(got):
+                    reply = answer(mtype, mid, token, INCOMPLETE)
+                    seen[addr, mid] = (now, reply)
+                    send(reply, addr)
+                    partial.pop((addr, token), None)
+                    continue
+                stats.blocks1 += num > 0
+                got += payload
+                reply_options.append((BLOCK1, uint_option((num << 4) | (8 if more else 0) |
+                                                          (b1[2].bit_length() - 5))))
+                if more:
+                    partial[addr, token] = got
+                    if mtype == CON:
+                        reply = answer(mtype, mid, token, CONTINUE, reply_options)
+                        seen[addr, mid] = (now, reply)
+                        send(reply, addr)
+                    continue
+                partial.pop((addr, token), None)
+                complete = got
+
+            if complete is not None:
+                stats.datagrams += 1
+                stats.records += records(complete)
+                stats.udp_bytes += len(complete) + IP_UDP_OVERHEAD
+                if args.verbose:
+                    print(f'{addr[0]}:{addr[1]} {"CON" if mtype == CON else "NON"} '
+                          f'seq {struct.unpack_from("<H", complete, 2)[0]}, '
+                          f'{records(complete)} records, {len(complete)} bytes')
+
+            if mtype == NON and not response:
+                continue
+            body = response
+            size = b2[2] if b2 is not None else (b1[2] if b1 is not None else 1024)
+            num = b2[0] if b2 is not None else 0
+            if len(response) > size:
+                body = response[num * size:(num + 1) * size]
+                more = (num + 1) * size < len(response)
+                reply_options.append((BLOCK2, uint_option((num << 4) | (8 if more else 0) |
+                                                          (size.bit_length() - 5))))
+            reply = answer(mtype, mid, token, CHANGED, reply_options, body)
+            seen[addr, mid] = (now, reply)
+            send(reply, addr)
+    except KeyboardInterrupt:
+        pass
+
+    stats.report()
+
+
+if __name__ == '__main__':
+    main()
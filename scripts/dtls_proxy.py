@@ -0,0 +1,252 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Relay the DTLS uplink to a server and measure the cost of its handshakes.
+
+Sits between the device and a DTLS server, forwarding datagrams both ways
+and reading the plaintext DTLS record headers. For every handshake it
+prints whether it was full or resumed (a resumed one has no
+ServerHelloDone), its bytes on the wire including IPv4 and UDP headers,
+its flights and round trips, and whether a Connection ID was agreed. At
+the end it reports the handshake bytes and round trips per upload, the
+application data datagrams from the device.
+
+Example, on qemu_x86 built with overlay-dtls-qemu.conf, the device at
+192.0.2.1 sending to 192.0.2.2:2469, and an echo server on port 4433:
+
+    openssl s_server -dtls1_2 -nocert -psk 000102030405060708090a0b0c0d0e0f \\
+        -psk_identity thingy91 -accept 4433
+    dtls_proxy.py --listen 192.0.2.2:2469 --server 127.0.0.1:4433
+
+openssl does not do Connection IDs, the ssl_server2 program of mbedTLS
+does with dtls=1 cid=1 psk=... psk_identity=thingy91.
+"""
+
+import argparse
+import select
+import socket
+import struct
+import sys
+import time
+
+RECORD = struct.Struct('>BHHIHH')
+RECORD_SIZE = RECORD.size
+HANDSHAKE = struct.Struct('>B3sH3s3s')
+
+CHANGE_CIPHER_SPEC = 20
+ALERT = 21
+HANDSHAKE_TYPE = 22
+APPLICATION_DATA = 23
+TLS12_CID = 25
+
+CLIENT_HELLO = 1
+SERVER_HELLO = 2
+SERVER_HELLO_DONE = 14
+
+# RFC 9146, the drafts before it used 53.
+EXT_CONNECTION_ID = (54, 53)
+
+IP_UDP_OVERHEAD = 28
+
+
+def u24(b):
+    return int.from_bytes(b, 'big')
+
+
+def hello_cid(body, server):
+    """The Connection ID a hello asks the peer to send, or None."""
+    try:
+        pos = 2 + 32
+        pos += 1 + body[pos]
+        if server:
+            pos += 3
+        else:
+            pos += 1 + body[pos]
+            pos += 2 + int.from_bytes(body[pos:pos + 2], 'big')
+            pos += 1 + body[pos]
+        end = pos + 2 + int.from_bytes(body[pos:pos + 2], 'big')
+        pos += 2
+        while pos + 4 <= end:
+            ext, length = struct.unpack_from('>HH', body, pos)
+            if ext in EXT_CONNECTION_ID:
+                return bytes(body[pos + 5:pos + 5 + body[pos + 4]])
+            pos += 4 + length
+    except IndexError:
+        pass
+    return None
+
+
+class Session:
+    """One device, by its address."""
+
+    def __init__(self, addr, upstream):
+        self.addr = addr
+        self.upstream = upstream
+        # The Connection IDs in the records each way, once agreed.
+        self.cid_to_server = None
+        self.cid_to_client = None
+        self.offered = None
+        self.handshake = None
+        self.handshakes = []
+        self.uploads = 0
+        self.upload_bytes = 0
+
+    def records(self, datagram, from_client):
+        pos = 0
+        while pos + RECORD_SIZE <= len(datagram):
+            ctype, _, epoch, _, _, length = RECORD.unpack_from(datagram, pos)
+            header = RECORD_SIZE
+            if ctype == TLS12_CID:
+                cid = self.cid_to_server if from_client else self.cid_to_client
+                header += len(cid or b'')
+                length = int.from_bytes(datagram[pos + header - 2:pos + header], 'big')
+            yield ctype, epoch, datagram[pos + header:pos + header + length]
+            pos += header + length
+
+    def datagram(self, data, from_client):
+        upload = False
+        for ctype, epoch, body in self.records(data, from_client):
+            if ctype == HANDSHAKE_TYPE and epoch == 0:
+                self.handshake_message(body, from_client)
+            elif ctype in (APPLICATION_DATA, TLS12_CID) and from_client:
+                upload = True
+            elif ctype == ALERT and epoch == 0:
+                print(f'{self.addr[0]}:{self.addr[1]} alert in the clear')
+
+        if self.handshake is not None and not upload:
+            self.handshake_datagram(len(data), from_client)
+        elif upload:
+            self.handshake_done()
+            self.uploads += 1
+            self.upload_bytes += len(data) + IP_UDP_OVERHEAD
+
+    def handshake_message(self, body, from_client):
+        if len(body) < HANDSHAKE.size:
+            return
+        msg_type, _, _, offset, _ = HANDSHAKE.unpack_from(body)
+        payload = body[HANDSHAKE.size:]
+        if msg_type == CLIENT_HELLO and u24(offset) == 0:
+            # The second hello after a HelloVerifyRequest is the same handshake.
+            if self.handshake is None or self.handshake['server_flights'] > 1:
+                self.handshake_done()
+                self.handshake = {'start': time.monotonic(), 'bytes': 0, 'datagrams': 0,
+                                  'client_flights': 0, 'server_flights': 0,
+                                  'full': False, 'from_client': None}
+            self.offered = hello_cid(payload, False)
+        elif msg_type == SERVER_HELLO and u24(offset) == 0:
+            server_cid = hello_cid(payload, True)
+            if server_cid is not None and self.offered is not None:
+                self.cid_to_server = server_cid
+                self.cid_to_client = self.offered
+            else:
+                self.cid_to_server = self.cid_to_client = None
+        elif msg_type == SERVER_HELLO_DONE and self.handshake is not None:
+            self.handshake['full'] = True
+
+    def handshake_datagram(self, length, from_client):
+        h = self.handshake
+        h['bytes'] += length + IP_UDP_OVERHEAD
+        h['datagrams'] += 1
+        if h['from_client'] != from_client:
+            h['from_client'] = from_client
+            h['client_flights' if from_client else 'server_flights'] += 1
+
+    def handshake_done(self):
+        h = self.handshake
+        self.handshake = None
+        if h is None or h['bytes'] == 0:
+            return
+        h['ms'] = (time.monotonic() - h['start']) * 1000
+        # Every flight of the server answers one of the device.
+        h['round_trips'] = h['server_flights']
+        h['cid'] = self.cid_to_server is not None
+        self.handshakes.append(h)
+        print(f'{self.addr[0]}:{self.addr[1]} {"full" if h["full"] else "resumed"} handshake: '
+              f'{h["bytes"]} bytes in {h["datagrams"]} datagrams, '
+              f'{h["client_flights"] + h["server_flights"]} flights, '
+              f'{h["round_trips"]} round trips, {h["ms"]:.0f} ms'
+              f'{", connection ID" if h["cid"] else ""}')
+
+
+def address(text):
+    host, _, port = text.rpartition(':')
+    return host, int(port)
+
+
+def report(sessions):
+    """Per address, and over all of them as a new socket is a new address."""
+    for s in sessions.values():
+        s.handshake_done()
+
+    groups = [(f'{s.addr[0]}:{s.addr[1]}', [s]) for s in sessions.values()]
+    if len(sessions) > 1:
+        groups.append(('all', list(sessions.values())))
+
+    for name, group in groups:
+        handshakes = [h for s in group for h in s.handshakes]
+        full = [h for h in handshakes if h['full']]
+        uploads = sum(s.uploads for s in group)
+        upload_bytes = sum(s.upload_bytes for s in group)
+        print(f'{name}: {uploads} uploads of {upload_bytes} bytes, '
+              f'{len(full)} full and {len(handshakes) - len(full)} resumed handshakes')
+        if uploads:
+            print(f'  per upload: {sum(h["bytes"] for h in handshakes) / uploads:.1f} '
+                  f'handshake bytes, {sum(h["round_trips"] for h in handshakes) / uploads:.2f} '
+                  f'round trips, {upload_bytes / uploads:.1f} data bytes')
+        if full:
+            print(f'  a full handshake on every upload: '
+                  f'{sum(h["bytes"] for h in full) / len(full):.1f} bytes, '
+                  f'{sum(h["round_trips"] for h in full) / len(full):.2f} round trips')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--listen', type=address, default=('0.0.0.0', 2469),
+                        metavar='HOST:PORT', help='address the device sends to')
+    parser.add_argument('--server', type=address, required=True, metavar='HOST:PORT',
+                        help='DTLS server')
+    parser.add_argument('-t', '--time', type=float,
+                        help='seconds to run, until Ctrl-C if not given')
+    args = parser.parse_args()
+
+    listen = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    listen.bind(args.listen)
+    sessions = {}
+    upstreams = {}
+    end = time.monotonic() + args.time if args.time else None
+
+    try:
+        while end is None or time.monotonic() < end:
+            ready, _, _ = select.select([listen] + list(upstreams), [], [], 0.5)
+            for sock in ready:
+                if sock is listen:
+                    data, addr = listen.recvfrom(65535)
+                    session = sessions.get(addr)
+                    if session is None:
+                        upstream = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+                        upstream.connect(args.server)
+                        session = sessions[addr] = Session(addr, upstream)
+                        upstreams[upstream] = session
+                    session.datagram(data, True)
+                    session.upstream.send(data)
+                else:
+                    session = upstreams[sock]
+                    try:
+                        data = sock.recv(65535)
+                    except ConnectionRefusedError:
+                        print('server not reachable', file=sys.stderr)
+                        continue
+                    session.datagram(data, False)
+                    listen.sendto(data, session.addr)
+    except KeyboardInterrupt:
+        pass
+
+    report(sessions)
+
+
+if __name__ == '__main__':
+    main()
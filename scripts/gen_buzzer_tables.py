@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Generate the pulse width and note period tables of ui_buzzer.
+
+The pulse width curve of the buzzer used to be computed with several
+divisions on every retune. It is tabulated here as a fixed point fraction of
+the period per intensity, so the driver only does a lookup and a multiply.
+
+Run with --verify to compare the tables against the original formula for
+every period the driver can see and every intensity.
+"""
+
+import argparse
+import sys
+from fractions import Fraction
+
+INTENSITY_MAX = 100
+FREQUENCY_MAX = 10000
+USEC_PER_SEC = 1000000
+
+# Affects curvature of pulse width graph
+CURVE_CONST = 50
+
+# Must match UI_BUZZER_PULSE_FRAC_SHIFT in src/ui/ui_buzzer_tables.h
+FRAC_SHIFT = 24
+
+# C0..B7, note index = octave * 12 + semitone above C, A4 = 57 = 440 Hz
+NOTE_NUM = 96
+NOTE_A4 = 57
+
+
+def c_div(a, b):
+    """Integer division truncating towards zero, as C does."""
+    q = abs(a) // abs(b)
+    return q if (a >= 0) == (b >= 0) else -q
+
+
+def formula_pulse_width(period, intensity):
+    """calculate_pulse_width() as it was written in ui_buzzer.c."""
+    divisor = CURVE_CONST + c_div((2 - CURVE_CONST) * intensity, INTENSITY_MAX)
+    offset = c_div(period * (INTENSITY_MAX - intensity),
+                   CURVE_CONST * INTENSITY_MAX)
+    return c_div(period, divisor) - offset
+
+
+def pulse_fraction(intensity):
+    divisor = CURVE_CONST + c_div((2 - CURVE_CONST) * intensity, INTENSITY_MAX)
+    frac = Fraction(1, divisor) - Fraction(INTENSITY_MAX - intensity,
+                                           CURVE_CONST * INTENSITY_MAX)
+    return round(frac * (1 << FRAC_SHIFT))
+
+
+def table_pulse_width(table, period, intensity):
+    """The lookup done by ui_buzzer_pulse_width() in ui_buzzer_tables.h."""
+    return (period * table[intensity] + (1 << (FRAC_SHIFT - 1))) >> FRAC_SHIFT
+
+
+def note_period(note):
+    freq = 440.0 * 2.0 ** ((note - NOTE_A4) / 12.0)
+    return round(USEC_PER_SEC / freq)
+
+
+def verify(table):
+    worst = 0
+    mismatches = 0
+    checked = 0
+    periods = {USEC_PER_SEC // f for f in range(1, FREQUENCY_MAX + 1)}
+    periods.update(note_period(n) for n in range(NOTE_NUM))
+
+    for period in sorted(periods):
+        for intensity in range(INTENSITY_MAX + 1):
+            delta = abs(formula_pulse_width(period, intensity) -
+                        table_pulse_width(table, period, intensity))
+            worst = max(worst, delta)
+            mismatches += delta != 0
+            checked += 1
+
+    print(f'Checked {checked} period/intensity pairs: {mismatches} differ, '
+          f'largest difference {worst} us')
+
+    return worst <= 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('-o', '--output', help='C source file to generate')
+    parser.add_argument('--verify', action='store_true',
+                        help='compare the tables against the formula')
+    args = parser.parse_args()
+
+    table = [pulse_fraction(i) for i in range(INTENSITY_MAX + 1)]
+
+    if args.verify and not verify(table):
+        sys.exit('Pulse width table is more than 1 us off the formula')
+
+    if not args.output:
+        return
+
+    out = ['/* Generated by scripts/gen_buzzer_tables.py, do not edit. */',
+           '',
+           '#include "ui_buzzer_tables.h"',
+           '',
+           '/* Pulse width / period per intensity, '
+           'Q.{} fixed point. */'.format(FRAC_SHIFT),
+           'const uint32_t ui_buzzer_pulse_frac[UI_BUZZER_INTENSITY_NUM] = {']
+    for i in range(0, len(table), 6):
+        out.append('\t' + ' '.join(f'{v},' for v in table[i:i + 6]))
+    out.append('};')
+    out.append('')
+    out.append('/* Period in microseconds per note, C0..B7. */')
+    out.append('const uint16_t ui_buzzer_note_period[UI_BUZZER_PERIOD_NUM] = {')
+    for octave in range(NOTE_NUM // 12):
+        out.append('\t' + ' '.join(f'{note_period(octave * 12 + s)},'
+                                   for s in range(12)))
+    out.append('};')
+    out.append('')
+
+    with open(args.output, 'w', encoding='utf-8') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
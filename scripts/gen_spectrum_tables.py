@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Generate the twiddle and window tables of the Q15 real FFT in spectrum.c.
+
+The tables are made for the largest transform, SPECTRUM_SIZE_MAX, smaller
+transforms take every n-th entry, so one set in flash serves all sizes.
+"""
+
+import argparse
+import math
+
+# Must match SPECTRUM_SIZE_MAX in src/spectrum.h
+SIZE_MAX = 512
+
+Q15_ONE = 32768
+
+
+def q15(v):
+    """Round to Q15, 1.0 saturates to 32767."""
+    return max(-Q15_ONE, min(Q15_ONE - 1, round(v * Q15_ONE)))
+
+
+def twiddle(k):
+    """e^(-2 pi j k / SIZE_MAX), packed as cos | sin << 16."""
+    angle = 2 * math.pi * k / SIZE_MAX
+    c = q15(math.cos(angle)) & 0xffff
+    s = q15(math.sin(angle)) & 0xffff
+    return c | (s << 16)
+
+
+def hann(n):
+    """Periodic Hann window, so every n-th entry is the window of a smaller size."""
+    return q15(0.5 - 0.5 * math.cos(2 * math.pi * n / SIZE_MAX))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('-o', '--output', required=True,
+                        help='C source file to generate')
+    args = parser.parse_args()
+
+    out = ['/* Generated by scripts/gen_spectrum_tables.py, do not edit. */',
+           '',
+           '#include "spectrum_tables.h"',
+           '',
+           'const uint32_t spectrum_twiddle[SPECTRUM_SIZE_MAX / 2] = {']
+    table = [twiddle(k) for k in range(SIZE_MAX // 2)]
+    for i in range(0, len(table), 6):
+        out.append('\t' + ' '.join(f'0x{v:08x},' for v in table[i:i + 6]))
+    out.append('};')
+    out.append('')
+    out.append('const int16_t spectrum_hann[SPECTRUM_SIZE_MAX] = {')
+    table = [hann(n) for n in range(SIZE_MAX)]
+    for i in range(0, len(table), 8):
+        out.append('\t' + ' '.join(f'{v},' for v in table[i:i + 8]))
+    out.append('};')
+    out.append('')
+
+    with open(args.output, 'w', encoding='utf-8') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
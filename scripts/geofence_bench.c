@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/*
+ * Host benchmark of the geofence lookup in src/geofence.c.
+ *
+ *   for n in 100 1000 5000; do
+ *     python3 scripts/geofence_compile.py -b -o fences_$n.bin --random $n
+ *   done
+ *   cc -O2 -Isrc -o geofence_bench scripts/geofence_bench.c src/geofence.c
+ *   ./geofence_bench fences_*.bin
+ *
+ * Looks up random points, half of them near a fence, with the grid index
+ * and with a scan of every fence, in TSC cycles on x86 and ns elsewhere.
+ * Both must find the same fences, and a floating point point-in-polygon
+ * test must agree with the fixed point one. Exits non-zero if not.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "geofence.h"
+
+#define POINTS    20000
+#define FOUND_MAX 16
+
+static uint64_t now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+#endif
+}
+
+static void *load(const char *path, size_t *len)
+{
+	FILE *f = fopen(path, "rb");
+	void *blob;
+
+	if (f == NULL) {
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	*len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	/* The blob must be 4 byte aligned, as it is in flash. */
+	blob = aligned_alloc(4, (*len + 3) & ~(size_t)3);
+	if ((blob != NULL) && (fread(blob, 1, *len, f) != *len)) {
+		free(blob);
+		blob = NULL;
+	}
+	fclose(f);
+
+	return blob;
+}
+
+static bool reference(const struct geofence_index *index, size_t fence, int32_t lat, int32_t lon)
+{
+	const struct geofence_fence *f = &index->fences[fence];
+	const struct geofence_vertex *v = &index->vertices[f->first_vertex];
+	bool inside = false;
+
+	for (size_t i = 0, j = f->num_vertices - 1; i < f->num_vertices; j = i++) {
+		if ((v[i].lat > lat) != (v[j].lat > lat)) {
+			double x = v[i].lon + ((double)(lat - v[i].lat) * (v[j].lon - v[i].lon)) /
+					     (v[j].lat - v[i].lat);
+
+			if (lon < x) {
+				inside = !inside;
+			}
+		}
+	}
+
+	return inside;
+}
+
+static size_t scan(const struct geofence_index *index, int32_t lat, int32_t lon, uint16_t *found,
+		   size_t max)
+{
+	size_t num = 0;
+
+	for (size_t i = 0; (i < geofence_index_count(index)) && (num < max); i++) {
+		if (geofence_index_contains(index, i, lat, lon)) {
+			found[num++] = i;
+		}
+	}
+
+	return num;
+}
+
+static int32_t random_between(int32_t min, int32_t max)
+{
+	return min + (int32_t)(((double)rand() / RAND_MAX) * ((double)max - min));
+}
+
+static bool bench(const char *path)
+{
+	static int32_t lat[POINTS];
+	static int32_t lon[POINTS];
+	static uint8_t num[POINTS];
+	static uint8_t num_scan[POINTS];
+	struct geofence_index index;
+	const struct geofence_header *h;
+	uint16_t found[FOUND_MAX];
+	uint64_t start;
+	uint64_t grid_time;
+	uint64_t scan_time;
+	size_t hits = 0;
+	size_t len;
+	bool ok = true;
+	void *blob;
+
+	blob = load(path, &len);
+	if ((blob == NULL) || (geofence_index_load(&index, blob, len) != 0)) {
+		printf("%s: cannot load\n", path);
+		free(blob);
+		return false;
+	}
+	h = index.header;
+
+	for (size_t i = 0; i < POINTS; i++) {
+		if ((i % 2) && (h->num_fences > 0)) {
+			const struct geofence_fence *f = &index.fences[rand() % h->num_fences];
+
+			lat[i] = random_between(f->min.lat, f->max.lat);
+			lon[i] = random_between(f->min.lon, f->max.lon);
+		} else {
+			lat[i] = random_between(h->origin_lat,
+						h->origin_lat + (int32_t)(h->cell_lat * h->grid_rows));
+			lon[i] = random_between(h->origin_lon,
+						h->origin_lon + (int32_t)(h->cell_lon * h->grid_cols));
+		}
+	}
+
+	start = now();
+	for (size_t i = 0; i < POINTS; i++) {
+		num[i] = geofence_index_lookup(&index, lat[i], lon[i], found, FOUND_MAX);
+	}
+	grid_time = now() - start;
+
+	start = now();
+	for (size_t i = 0; i < POINTS; i++) {
+		num_scan[i] = scan(&index, lat[i], lon[i], found, FOUND_MAX);
+	}
+	scan_time = now() - start;
+
+	for (size_t i = 0; i < POINTS; i++) {
+		hits += num[i];
+		if (num[i] != num_scan[i]) {
+			ok = false;
+		}
+		for (size_t k = 0; k < h->num_fences; k++) {
+			if (geofence_index_contains(&index, k, lat[i], lon[i]) !=
+			    reference(&index, k, lat[i], lon[i])) {
+				ok = false;
+			}
+		}
+	}
+
+	printf("%s: %u fences, %u vertices, %ux%u grid, %u refs, %zu bytes\n", path,
+	       h->num_fences, h->num_vertices, h->grid_rows, h->grid_cols, h->num_refs, len);
+	printf("  grid %.1f, scan %.1f %s per lookup, %.2f fences tested per cell, %zu hits%s\n",
+	       (double)grid_time / POINTS, (double)scan_time / POINTS,
+#if defined(__x86_64__) || defined(__i386__)
+	       "TSC cycles",
+#else
+	       "ns",
+#endif
+	       /* The cells are of equal area, so a point lands in any of them alike. */
+	       (double)h->num_refs / ((size_t)h->grid_rows * h->grid_cols), hits,
+	       ok ? "" : ", MISMATCH");
+
+	free(blob);
+
+	return ok;
+}
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s fences.bin...\n", argv[0]);
+		return 2;
+	}
+
+	srand(1);
+
+	for (int i = 1; i < argc; i++) {
+		ok &= bench(argv[i]);
+	}
+
+	printf("%s\n", ok ? "PASS" : "FAIL");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Compile geofence polygons into the indexed blob read by src/geofence.c.
+
+Input files are JSON, {"fences": [{"id": 1, "name": "depot", "polygon":
+[[lat, lon], ...]}, ...]} in degrees. The blob format is described in
+src/geofence.h. Emits either a C source defining geofence_builtin[] for
+flash, or the raw blob to deliver over the downlink. --random makes
+synthetic fences, for scripts/geofence_bench.c.
+"""
+
+import argparse
+import json
+import math
+import random
+import struct
+import sys
+
+MAGIC = 0x4647
+VERSION = 1
+HEADER = struct.Struct('<HBBHHHHiiIIII')
+FENCE = struct.Struct('<HHIiiii')
+VERTEX = struct.Struct('<ii')
+
+# 1e-7 degrees, as the GNSS fixes are converted on target.
+UNITS = 10000000
+
+# Enough cells to list about two fences each, at most as many as keep the
+# cell table of the blob within 64 kB.
+CELLS_PER_FENCE = 2
+CELLS_MAX = 16384
+
+
+def fixed(deg):
+    return int(round(deg * UNITS))
+
+
+def load_fences(path):
+    with open(path, encoding='utf-8') as f:
+        doc = json.load(f)
+
+    fences = []
+    for fence in doc.get('fences', []):
+        polygon = [(fixed(lat), fixed(lon)) for lat, lon in fence['polygon']]
+        if len(polygon) > 1 and polygon[0] == polygon[-1]:
+            polygon.pop()
+        if len(polygon) < 3:
+            raise ValueError(f'fence {fence["id"]} has fewer than 3 vertices')
+        if not 0 <= fence['id'] <= 0xFFFF:
+            raise ValueError(f'fence id {fence["id"]} does not fit 16 bits')
+        fences.append((fence['id'], fence.get('name', ''), polygon))
+    return fences
+
+
+def random_fences(count, seed, lat, lon):
+    """Star shaped polygons of 6 to 24 vertices, 50 to 500 m across, spread
+    so the density stays the same for any count."""
+    rng = random.Random(seed)
+    side_m = 2000 * math.sqrt(count)
+    m_per_deg_lat = 111320
+    m_per_deg_lon = 111320 * math.cos(math.radians(lat))
+
+    fences = []
+    for i in range(count):
+        c_lat = lat + rng.uniform(-side_m / 2, side_m / 2) / m_per_deg_lat
+        c_lon = lon + rng.uniform(-side_m / 2, side_m / 2) / m_per_deg_lon
+        radius = rng.uniform(25, 250)
+        num = rng.randint(6, 24)
+        polygon = []
+        for k in range(num):
+            angle = 2 * math.pi * k / num
+            r = radius * rng.uniform(0.5, 1.0)
+            polygon.append((fixed(c_lat + r * math.sin(angle) / m_per_deg_lat),
+                            fixed(c_lon + r * math.cos(angle) / m_per_deg_lon)))
+        fences.append((i + 1, f'random {i + 1}', polygon))
+    return fences
+
+
+def build_blob(fences):
+    if len(fences) > 0xFFFF:
+        raise ValueError('more than 65535 fences')
+    ids = [fence_id for fence_id, _, _ in fences]
+    if len(set(ids)) != len(ids):
+        raise ValueError('fence ids are not unique')
+
+    boxes = []
+    for _, _, polygon in fences:
+        lats = [p[0] for p in polygon]
+        lons = [p[1] for p in polygon]
+        boxes.append((min(lats), min(lons), max(lats), max(lons)))
+
+    if boxes:
+        origin_lat = min(b[0] for b in boxes)
+        origin_lon = min(b[1] for b in boxes)
+        height = max(b[2] for b in boxes) - origin_lat + 1
+        width = max(b[3] for b in boxes) - origin_lon + 1
+    else:
+        origin_lat, origin_lon, height, width = 0, 0, 1, 1
+
+    # Square-ish cells in degrees, which is close enough away from the poles.
+    cells = max(1, min(CELLS_MAX, CELLS_PER_FENCE * len(fences)))
+    cell = max(1, math.ceil(math.sqrt(height * width / cells)))
+    rows = min(0xFFFF, math.ceil(height / cell))
+    cols = min(0xFFFF, math.ceil(width / cell))
+    cell_lat = math.ceil(height / rows)
+    cell_lon = math.ceil(width / cols)
+
+    lists = [[] for _ in range(rows * cols)]
+    for i, (min_lat, min_lon, max_lat, max_lon) in enumerate(boxes):
+        for row in range((min_lat - origin_lat) // cell_lat,
+                         (max_lat - origin_lat) // cell_lat + 1):
+            for col in range((min_lon - origin_lon) // cell_lon,
+                             (max_lon - origin_lon) // cell_lon + 1):
+                lists[row * cols + col].append(i)
+
+    num_vertices = sum(len(polygon) for _, _, polygon in fences)
+    num_refs = sum(len(refs) for refs in lists)
+
+    blob = bytearray(HEADER.pack(MAGIC, VERSION, 0, len(fences), rows, cols, 0,
+                                 origin_lat, origin_lon, cell_lat, cell_lon,
+                                 num_vertices, num_refs))
+    first = 0
+    for (fence_id, _, polygon), box in zip(fences, boxes):
+        blob += FENCE.pack(fence_id, len(polygon), first, *box)
+        first += len(polygon)
+    for _, _, polygon in fences:
+        for lat, lon in polygon:
+            blob += VERTEX.pack(lat, lon)
+    start = 0
+    for refs in lists:
+        blob += struct.pack('<I', start)
+        start += len(refs)
+    blob += struct.pack('<I', start)
+    for refs in lists:
+        blob += struct.pack(f'<{len(refs)}H', *refs)
+    while len(blob) % 4:
+        blob.append(0)
+
+    return bytes(blob), (rows, cols, num_refs)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('-o', '--output', required=True,
+                        help='file to generate')
+    parser.add_argument('-b', '--binary', action='store_true',
+                        help='write the raw blob instead of a C source')
+    parser.add_argument('--random', type=int, metavar='N',
+                        help='add N synthetic fences')
+    parser.add_argument('--seed', type=int, default=1,
+                        help='seed of the synthetic fences')
+    parser.add_argument('--center', default='63.4305,10.3951', metavar='LAT,LON',
+                        help='center of the synthetic fences')
+    parser.add_argument('fences', nargs='*',
+                        help='JSON files of fences')
+    args = parser.parse_args()
+
+    fences = []
+    for path in args.fences:
+        try:
+            fences += load_fences(path)
+        except (ValueError, KeyError, TypeError) as e:
+            sys.exit(f'{path}: {e}')
+    if args.random:
+        lat, lon = (float(v) for v in args.center.split(','))
+        fences += random_fences(args.random, args.seed, lat, lon)
+
+    try:
+        blob, (rows, cols, num_refs) = build_blob(fences)
+    except ValueError as e:
+        sys.exit(str(e))
+
+    if args.binary:
+        with open(args.output, 'wb') as f:
+            f.write(blob)
+        return
+
+    out = ['/* Generated by scripts/geofence_compile.py, do not edit. */',
+           '',
+           '#include "geofence_mgr.h"',
+           '']
+    for fence_id, name, polygon in fences:
+        out.append(f'/* {fence_id}: {name}, {len(polygon)} vertices */')
+    out.append(f'/* {rows} x {cols} grid, {num_refs} fence references */')
+    out.append('const uint8_t geofence_builtin[] __aligned(4) = {')
+    for i in range(0, len(blob), 12):
+        out.append('\t' + ' '.join(f'0x{b:02x},' for b in blob[i:i + 12]))
+    out.append('};')
+    out.append('')
+    out.append('const size_t geofence_builtin_size = sizeof(geofence_builtin);')
+    out.append('')
+
+    with open(args.output, 'w', encoding='utf-8') as f:
+        f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()
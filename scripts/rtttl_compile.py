@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Compile RTTTL melodies into the bytecode played by ui_melody.
+
+Emits a C source defining ui_melody_builtin[] with one entry per melody, the
+bytecode format is described in src/ui_melody.h and matches
+ui_melody_compile() on target.
+"""
+
+import argparse
+import sys
+
+HEADER_SIZE = 2
+OP_REST = 12
+OP_OCTAVE = 13
+OCTAVE_MAX = 7
+DURATION_MAX = 5
+BPM_MAX = 900
+
+LETTER_PITCH = {'c': 0, 'd': 2, 'e': 4, 'f': 5, 'g': 7, 'a': 9, 'b': 11, 'h': 11}
+
+
+def duration_exponent(value):
+    for exp in range(DURATION_MAX + 1):
+        if value == 1 << exp:
+            return exp
+    raise ValueError(f'invalid duration {value}')
+
+
+def whole_ms(bpm):
+    return (4 * 60 * 1000) // bpm
+
+
+def compile_rtttl(text):
+    """Return (name, bytecode) of one RTTTL string."""
+    name, defaults, notes = (part.strip() for part in text.split(':', 2))
+
+    duration, octave, bpm = 2, 6, 63
+    for item in filter(None, (d.strip() for d in defaults.split(','))):
+        key, value = item.split('=')
+        key, value = key.strip().lower(), int(value)
+        if key == 'd':
+            duration = duration_exponent(value)
+        elif key == 'o':
+            if value > OCTAVE_MAX:
+                raise ValueError(f'invalid octave {value}')
+            octave = value
+        elif key == 'b':
+            if not 0 < value <= BPM_MAX or whole_ms(value) > 0xFFFF:
+                raise ValueError(f'invalid tempo {value}')
+            bpm = value
+        else:
+            raise ValueError(f'unknown default {key}')
+
+    code = bytearray(whole_ms(bpm).to_bytes(HEADER_SIZE, 'little'))
+    cur_octave = None
+
+    for note in filter(None, (n.strip().lower() for n in notes.split(','))):
+        i = 0
+        note_duration, note_octave, dotted = duration, octave, False
+
+        digits = ''
+        while i < len(note) and note[i].isdigit():
+            digits += note[i]
+            i += 1
+        if digits:
+            note_duration = duration_exponent(int(digits))
+
+        letter = note[i]
+        i += 1
+        if letter == 'p':
+            pitch = OP_REST
+        elif letter in LETTER_PITCH:
+            pitch = LETTER_PITCH[letter]
+        else:
+            raise ValueError(f'invalid note {note}')
+
+        if note[i:i + 1] == '#' and pitch != OP_REST:
+            pitch += 1
+            i += 1
+        if note[i:i + 1] == '.':
+            dotted = True
+            i += 1
+        if note[i:i + 1].isdigit():
+            note_octave = int(note[i])
+            i += 1
+        if note[i:i + 1] == '.':
+            dotted = True
+            i += 1
+        if i != len(note):
+            raise ValueError(f'invalid note {note}')
+
+        if letter != 'p' and pitch == 12:
+            pitch = 0
+            note_octave += 1
+        if note_octave > OCTAVE_MAX:
+            raise ValueError(f'invalid octave in {note}')
+
+        if pitch != OP_REST and note_octave != cur_octave:
+            code.append((note_octave << 5) | OP_OCTAVE)
+            cur_octave = note_octave
+
+        code.append((note_duration << 5) | (dotted << 4) | pitch)
+
+    return name, bytes(code)
+
+
+def c_identifier(name):
+    return ''.join(c if c.isalnum() else '_' for c in name.lower())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('-o', '--output', required=True,
+                        help='C source file to generate')
+    parser.add_argument('melodies', nargs='*',
+                        help='files holding one RTTTL string per line')
+    args = parser.parse_args()
+
+    melodies = []
+    for path in args.melodies:
+        with open(path, encoding='utf-8') as f:
+            for line in f:
+                line = line.strip()
+                if line and not line.startswith('#'):
+                    try:
+                        melodies.append((compile_rtttl(line), len(line)))
+                    except (ValueError, IndexError) as e:
+                        sys.exit(f'{path}: {e}')
+
+    out = ['/* Generated by scripts/rtttl_compile.py, do not edit. */',
+           '',
+           '#include "ui_melody.h"',
+           '']
+
+    for (name, code), _ in melodies:
+        out.append(f'static const uint8_t melody_{c_identifier(name)}[] = {{')
+        for i in range(0, len(code), 12):
+            out.append('\t' + ' '.join(f'0x{b:02x},' for b in code[i:i + 12]))
+        out.append('};')
+        out.append('')
+
+    out.append('const struct ui_melody ui_melody_builtin[] = {')
+    for (name, code), source_len in melodies:
+        out.append(f'\t/* {source_len} RTTTL chars -> {len(code)} bytes */')
+        out.append(f'\t{{ "{name}", melody_{c_identifier(name)}, '
+                   f'sizeof(melody_{c_identifier(name)}) }},')
+    if not melodies:
+        out.append('\t{ 0 },')
+    out.append('};')
+    out.append('')
+    out.append(f'const size_t ui_melody_builtin_count = {len(melodies)};')
+    out.append('')
+
+    with open(args.output, 'w', encoding='utf-8') as f:
+        f.write('\n'.join(out))
+
+    source_size = sum(source_len for _, source_len in melodies)
+    code_size = sum(len(code) for (_, code), _ in melodies)
+    print(f'Compiled {len(melodies)} melodies, {source_size} RTTTL chars '
+          f'into {code_size} bytes of bytecode')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/*
+ * Simulated timeline of the just in time sampling in src/sample_plan.c.
+ *
+ *   cc -O2 -Isrc -o sample_plan_sim scripts/sample_plan_sim.c src/sample_plan.c
+ *   ./sample_plan_sim
+ *
+ * Steps through a day in ms, once with the BME680 and BH1749 fetched
+ * periodically as the sensor manager does by default, and once with the
+ * sampling coordinator fetching them for the uplink. Modem wakeups stand
+ * for the LTE_LC_EVT_MODEM_SLEEP_EXIT notifications, they wake the CPU
+ * only when the coordinator subscribes to them. Activities within the
+ * grouping window of the sensor manager count as one CPU wakeup. Prints
+ * the wakeups per hour and the age of the oldest sensor data in every
+ * periodic datagram. Exits non-zero if the coordinator misses an uplink,
+ * sends data older than lead plus slack, or wakes the CPU more often.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sample_plan.h"
+
+#define DAY_MS (24 * 3600 * 1000LL)
+
+/* The defaults of Kconfig. */
+#define BME680_PERIOD_MS 10000
+#define BH1749_PERIOD_MS 2000
+#define GROUP_WINDOW_MS  20
+#define LEAD_MS          500
+#define SLACK_MS         5000
+
+struct scenario {
+	const char *name;
+	int64_t uplink_ms;
+	/* Period of the modem wakeups of their own, 0 for none. */
+	int64_t modem_ms;
+};
+
+static const struct scenario scenarios[] = {
+	{ "moving, 60 s uplink, PSM", 60000, 0 },
+	{ "900 s uplink, PSM TAU 1 h", 900000, 3600000 },
+	{ "900 s uplink, eDRX 163.84 s", 900000, 163840 },
+	{ "still, 1 h uplink, PSM TAU 1 h", 3600000, 3600000 },
+	{ "300 s uplink, eDRX 20.48 s", 300000, 20480 },
+};
+
+struct result {
+	uint32_t wakeups;
+	uint32_t sends;
+	uint32_t shared;
+	int64_t age_total;
+	int64_t age_max;
+};
+
+struct cpu {
+	int64_t last;
+	uint32_t wakeups;
+};
+
+static void cpu_active(struct cpu *cpu, int64_t t)
+{
+	if ((cpu->wakeups == 0) || ((t - cpu->last) > GROUP_WINDOW_MS)) {
+		cpu->wakeups++;
+	}
+	cpu->last = t;
+}
+
+static void send(struct result *res, int64_t t, int64_t oldest)
+{
+	int64_t age = t - oldest;
+
+	res->sends++;
+	res->age_total += age;
+	if (age > res->age_max) {
+		res->age_max = age;
+	}
+}
+
+static bool modem_wakes(const struct scenario *sc, int64_t phase, int64_t t)
+{
+	return (sc->modem_ms != 0) && (t % sc->modem_ms == phase);
+}
+
+static void run_periodic(const struct scenario *sc, int64_t start, struct result *res)
+{
+	struct cpu cpu = { 0 };
+	int64_t bme = -1;
+	int64_t bh = -1;
+	int64_t next_uplink = start + sc->uplink_ms;
+
+	for (int64_t t = 0; t < DAY_MS; t++) {
+		if ((t % BH1749_PERIOD_MS) == 0) {
+			bh = t;
+			cpu_active(&cpu, t);
+		}
+		if ((t % BME680_PERIOD_MS) == 0) {
+			bme = t;
+			cpu_active(&cpu, t);
+		}
+		if (t == next_uplink) {
+			cpu_active(&cpu, t);
+			send(res, t, (bme < bh) ? bme : bh);
+			next_uplink += sc->uplink_ms;
+		}
+	}
+
+	res->wakeups = cpu.wakeups;
+}
+
+static bool run_planned(const struct scenario *sc, int64_t start, int64_t phase,
+			struct result *res)
+{
+	struct sample_plan plan;
+	struct cpu cpu = { 0 };
+	int64_t sampled = -1;
+	int64_t next_uplink = start + sc->uplink_ms;
+	bool ok = true;
+
+	sample_plan_init(&plan, LEAD_MS, SLACK_MS);
+	(void)sample_plan_uplink(&plan, next_uplink);
+
+	for (int64_t t = 0; t < DAY_MS; t++) {
+		if (modem_wakes(sc, phase, t)) {
+			cpu_active(&cpu, t);
+			if (sample_plan_wake(&plan, t)) {
+				sampled = t;
+				res->shared++;
+			}
+		}
+		if ((t == sample_plan_next(&plan)) && sample_plan_due(&plan, t)) {
+			sampled = t;
+			cpu_active(&cpu, t);
+		}
+		if (t == next_uplink) {
+			cpu_active(&cpu, t);
+			/* Every uplink has been sampled for, after the previous one. */
+			if ((sampled < 0) || ((t - sampled) > (LEAD_MS + SLACK_MS)) ||
+			    ((t - sampled) >= sc->uplink_ms)) {
+				ok = false;
+			}
+			send(res, t, sampled);
+			next_uplink += sc->uplink_ms;
+			(void)sample_plan_uplink(&plan, next_uplink);
+		}
+	}
+
+	res->wakeups = cpu.wakeups;
+
+	return ok;
+}
+
+int main(void)
+{
+	bool ok = true;
+
+	srand(1);
+
+	printf("%-32s %21s %21s %8s\n", "", "periodic", "just in time", "");
+	printf("%-32s %9s %11s %9s %11s %8s\n", "scenario", "wakeups/h", "age avg/max",
+	       "wakeups/h", "age avg/max", "shared");
+
+	for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+		const struct scenario *sc = &scenarios[s];
+		/* The uplink starts once LTE is connected, out of phase with the sensors. */
+		int64_t start = 3000 + (rand() % 30000);
+		int64_t phase = sc->modem_ms ? (rand() % sc->modem_ms) : 0;
+		struct result periodic = { 0 };
+		struct result planned = { 0 };
+		bool pass;
+
+		run_periodic(sc, start, &periodic);
+		pass = run_planned(sc, start, phase, &planned);
+		pass &= (planned.wakeups < periodic.wakeups);
+		ok &= pass;
+
+		printf("%-32s %9.1f %5lld/%5lld %9.1f %5lld/%5lld %7u%%%s\n", sc->name,
+		       periodic.wakeups / 24.0, (long long)(periodic.age_total / periodic.sends),
+		       (long long)periodic.age_max, planned.wakeups / 24.0,
+		       (long long)(planned.age_total / planned.sends), (long long)planned.age_max,
+		       (planned.shared * 100) / planned.sends, pass ? "" : " FAIL");
+	}
+
+	printf("ages in ms, of the oldest sensor data in a periodic datagram\n");
+	printf("%s\n", ok ? "PASS" : "FAIL");
+
+	return ok ? 0 : 1;
+}
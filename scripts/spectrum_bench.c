@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/*
+ * Host benchmark and accuracy check of the Q15 real FFT in src/spectrum.c.
+ *
+ *   python3 scripts/gen_spectrum_tables.py -o spectrum_tables.c
+ *   cc -O2 -Isrc -o spectrum_bench scripts/spectrum_bench.c src/spectrum.c \
+ *      spectrum_tables.c -lm
+ *   ./spectrum_bench
+ *
+ * For 256 and 512 point blocks of tones in noise it prints the time per
+ * block, in TSC cycles on x86 and ns elsewhere, and the error against a
+ * double precision DFT of the same windowed input: SNR over all bins, the
+ * largest error in Q15 LSB and whether the strongest peaks agree.
+ *
+ * The host runs the portable code. The cycles of the DSP code on the
+ * target are measured by "thingy bench spectrum_256" and spectrum_512.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "spectrum.h"
+
+#define REPETITIONS 2000
+#define PEAKS       4
+
+static int16_t input[SPECTRUM_SIZE_MAX];
+static int16_t work[SPECTRUM_SIZE_MAX];
+
+/* Tones as a machine gives them, a fundamental with harmonics, in noise. */
+static void signal_make(size_t n)
+{
+	static const struct {
+		double bin;
+		double amplitude;
+	} tones[] = {
+		{ 12.3, 8000 }, { 24.6, 3000 }, { 36.9, 1200 }, { 61.0, 600 },
+	};
+
+	srand(1);
+	for (size_t i = 0; i < n; i++) {
+		double v = 0;
+
+		for (size_t t = 0; t < sizeof(tones) / sizeof(tones[0]); t++) {
+			double bin = tones[t].bin * (double)n / 256;
+
+			v += tones[t].amplitude * cos((2 * M_PI * bin * i) / n);
+		}
+		v += ((rand() % 2001) - 1000) * 0.5;
+		input[i] = (int16_t)lround(v);
+	}
+}
+
+static uint64_t now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+#endif
+}
+
+static void bench(size_t n)
+{
+	uint64_t best = UINT64_MAX;
+
+	for (int r = 0; r < REPETITIONS; r++) {
+		uint64_t start;
+		uint64_t t;
+
+		memcpy(work, input, n * sizeof(work[0]));
+		start = now();
+		spectrum_window_q15(work, n);
+		spectrum_rfft_q15(work, n);
+		t = now() - start;
+		if (t < best) {
+			best = t;
+		}
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	printf("%4zu points: %8llu TSC cycles per block, window included\n", n,
+	       (unsigned long long)best);
+#else
+	printf("%4zu points: %8llu ns per block, window included\n", n, (unsigned long long)best);
+#endif
+}
+
+static void accuracy(size_t n)
+{
+	static uint64_t power[SPECTRUM_SIZE_MAX / 2 + 1];
+	static uint64_t power_ref[SPECTRUM_SIZE_MAX / 2 + 1];
+	struct spectrum_peak peaks[PEAKS];
+	struct spectrum_peak peaks_ref[PEAKS];
+	double signal = 0;
+	double noise = 0;
+	double worst = 0;
+	size_t num;
+	size_t match = 0;
+
+	memcpy(work, input, n * sizeof(work[0]));
+	spectrum_window_q15(work, n);
+	spectrum_rfft_q15(work, n);
+	memset(power, 0, sizeof(power));
+	spectrum_power_add(work, n, power);
+
+	for (size_t k = 0; k <= n / 2; k++) {
+		double re = 0;
+		double im = 0;
+		double q_re;
+		double q_im;
+		double err;
+
+		/* The window in double too, so its rounding counts as error. */
+		for (size_t i = 0; i < n; i++) {
+			double w = 0.5 - (0.5 * cos((2 * M_PI * i) / n));
+			double x = input[i] * w;
+
+			re += x * cos((2 * M_PI * k * i) / n);
+			im -= x * sin((2 * M_PI * k * i) / n);
+		}
+		re /= n;
+		im /= n;
+
+		q_re = (k == n / 2) ? work[1] : work[2 * k];
+		q_im = ((k == 0) || (k == n / 2)) ? 0 : work[2 * k + 1];
+		err = hypot(q_re - re, q_im - im);
+		signal += (re * re) + (im * im);
+		noise += err * err;
+		if (err > worst) {
+			worst = err;
+		}
+		power_ref[k] = (uint64_t)llround((re * re) + (im * im));
+	}
+
+	num = spectrum_peaks(power, n, peaks, PEAKS);
+	spectrum_peaks(power_ref, n, peaks_ref, PEAKS);
+	for (size_t i = 0; i < num; i++) {
+		match += (peaks[i].bin == peaks_ref[i].bin);
+	}
+
+	printf("%4zu points: SNR %.1f dB, worst bin error %.2f LSB, %zu of %zu peaks match\n", n,
+	       10 * log10(signal / noise), worst, match, num);
+}
+
+int main(void)
+{
+	static const size_t sizes[] = { 256, 512 };
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		signal_make(sizes[i]);
+		bench(sizes[i]);
+		accuracy(sizes[i]);
+	}
+
+	return 0;
+}
@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Capture and decode a "thingy stream" binary telemetry stream.
+
+Reads COBS framed records from a serial port, a native_sim pty or a file,
+checks their CRC and sequence numbers and prints them, or writes them as CSV.
+The frame format is described in src/stream.h. At the end the record rate
+per channel, lost records and bad frames are reported.
+
+Example, on native_sim with the console on /dev/pts/5:
+
+    stream_capture.py /dev/pts/5 --start "thingy stream rate=1000 load" -t 10
+"""
+
+import argparse
+import csv
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+HEADER = struct.Struct('<BBHI')
+CRC_SIZE = 2
+
+CHANNELS = ['rgb', 'buzzer', 'input', 'load', 'sensor']
+
+FIELDS = {
+    'rgb': (struct.Struct('<BBBB'), ('red', 'green', 'blue', 'on')),
+    'buzzer': (struct.Struct('<HBBB'), ('frequency', 'note', 'intensity', 'on')),
+    'input': (struct.Struct('<BBH'), ('device', 'gesture', 'repeat')),
+    'load': (struct.Struct('<I'), ('number',)),
+}
+
+SENSOR_CHANNELS = ['temperature', 'humidity', 'pressure', 'gas', 'accel', 'light']
+
+BAUD = {9600: termios.B9600, 115200: termios.B115200, 230400: termios.B230400,
+        460800: getattr(termios, 'B460800', termios.B230400),
+        1000000: getattr(termios, 'B1000000', termios.B230400)}
+
+
+def crc16_ccitt(data, seed=0xffff):
+    """crc16_ccitt() of Zephyr, the reflected CCITT polynomial."""
+    crc = seed
+    for byte in data:
+        e = (crc ^ byte) & 0xff
+        f = (e ^ (e << 4)) & 0xff
+        crc = (crc >> 8) ^ (f << 8) ^ (f << 3) ^ (f >> 4)
+        crc &= 0xffff
+    return crc
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            return None
+        out += frame[i + 1:i + code]
+        i += code
+        if code < 0xff and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+class Capture:
+    def __init__(self, writer):
+        self.writer = writer
+        self.pending = bytearray()
+        self.seq = None
+        self.counts = [0] * len(CHANNELS)
+        self.lost = 0
+        self.bad = 0
+        self.timestamp = None
+        self.elapsed_us = 0
+
+    def feed(self, data):
+        self.pending += data
+        *frames, self.pending = self.pending.split(b'\0')
+        for frame in frames:
+            if frame:
+                self.frame(bytes(frame))
+
+    def frame(self, frame):
+        record = cobs_decode(frame)
+        if record is None or len(record) < HEADER.size + CRC_SIZE:
+            self.bad += 1
+            return
+
+        channel, length, seq, timestamp = HEADER.unpack_from(record)
+        body = record[:HEADER.size + length]
+        if len(record) != HEADER.size + length + CRC_SIZE or \
+                struct.unpack_from('<H', record, len(body))[0] != crc16_ccitt(body):
+            self.bad += 1
+            return
+
+        if self.seq is not None:
+            self.lost += (seq - self.seq - 1) & 0xffff
+        self.seq = seq
+
+        # Rates are taken from the target timestamps, which wrap at 32 bits.
+        if self.timestamp is not None:
+            self.elapsed_us += (timestamp - self.timestamp) & 0xffffffff
+        self.timestamp = timestamp
+
+        data = body[HEADER.size:]
+        name = CHANNELS[channel] if channel < len(CHANNELS) else f'channel {channel}'
+        if channel < len(self.counts):
+            self.counts[channel] += 1
+
+        fields = {}
+        if name == 'sensor' and len(data) >= 2:
+            count = min(data[1], (len(data) - 2) // 4)
+            fields['sensor'] = SENSOR_CHANNELS[data[0]] if data[0] < len(SENSOR_CHANNELS) \
+                else data[0]
+            for i, value in enumerate(struct.unpack_from(f'<{count}i', data, 2)):
+                fields[f'v{i}'] = value / 1000
+        elif name in FIELDS:
+            fmt, names = FIELDS[name]
+            if len(data) >= fmt.size:
+                fields = dict(zip(names, fmt.unpack_from(data)))
+
+        self.writer(name, seq, timestamp, fields, data)
+
+    def summary(self):
+        elapsed = self.elapsed_us / 1e6
+        total = sum(self.counts)
+        print(f'{total} records in {elapsed:.2f} s, {self.lost} lost, {self.bad} bad frames',
+              file=sys.stderr)
+        for name, count in zip(CHANNELS, self.counts):
+            if count:
+                rate = count / elapsed if elapsed else 0
+                print(f'  {name:<8} {count:8} records {rate:10.1f} /s', file=sys.stderr)
+
+
+def open_port(path, baud):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = BAUD.get(baud, termios.B115200)
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('port', help='serial port, pty or capture file')
+    parser.add_argument('-b', '--baud', type=int, default=115200)
+    parser.add_argument('-t', '--duration', type=float,
+                        help='seconds to capture, until the end of a file or ^C if omitted')
+    parser.add_argument('--start', help='shell command to send first, e.g. "thingy stream rgb"')
+    parser.add_argument('--csv', type=argparse.FileType('w'), help='write records as CSV')
+    parser.add_argument('-q', '--quiet', action='store_true', help='only print the summary')
+    args = parser.parse_args()
+
+    if args.csv:
+        out = csv.writer(args.csv)
+        out.writerow(['channel', 'seq', 'timestamp_us', 'fields', 'data'])
+
+        def writer(name, seq, timestamp, fields, data):
+            out.writerow([name, seq, timestamp,
+                          ' '.join(f'{k}={v}' for k, v in fields.items()), data.hex()])
+    elif args.quiet:
+        def writer(name, seq, timestamp, fields, data):
+            pass
+    else:
+        def writer(name, seq, timestamp, fields, data):
+            text = ' '.join(f'{k}={v}' for k, v in fields.items()) or data.hex()
+            print(f'{timestamp / 1e6:12.6f} {seq:5} {name:<8} {text}', flush=True)
+
+    capture = Capture(writer)
+    fd = open_port(args.port, args.baud)
+    interactive = os.isatty(fd)
+
+    if args.start:
+        os.write(fd, args.start.encode() + b'\r\n')
+
+    end = time.monotonic() + args.duration if args.duration else None
+    try:
+        while end is None or time.monotonic() < end:
+            if interactive:
+                ready, _, _ = select.select([fd], [], [], 0.1)
+                if not ready:
+                    continue
+            data = os.read(fd, 4096)
+            if not data:
+                break
+            capture.feed(data)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if interactive:
+            # Any byte ends the stream and gives the console back to the shell.
+            os.write(fd, b'\r')
+        os.close(fd)
+
+    capture.summary()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Decode a "thingy trace" dump into a timeline.
+
+Reads a console log holding the output of "thingy trace", every record is a
+"T:" line with the 16 record bytes in hex, see struct trace_record in
+src/trace.h. The trace point names are taken from enum trace_id in the same
+header. Timestamps are CPU cycles, wrapping at 32 bits, and are printed in
+microseconds since the first record along with the gap to the previous one.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+RECORD = struct.Struct('<IHHII')
+LINE = re.compile(r'T:([0-9a-f]{32})\b')
+RATE = re.compile(r'T:rate (\d+)')
+LOST = re.compile(r'T:lost (\d+)')
+ENUM_ENTRY = re.compile(r'^\s*(TRACE_\w+)\s*(?:=\s*(\d+))?\s*,')
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(__file__), '..', 'src', 'trace.h')
+
+
+def read_names(path):
+    names = {}
+    value = 0
+    in_enum = False
+
+    with open(path) as f:
+        for line in f:
+            if line.startswith('enum trace_id'):
+                in_enum = True
+                continue
+            if not in_enum:
+                continue
+            if line.startswith('}'):
+                break
+            m = ENUM_ENTRY.match(line)
+            if m:
+                if m.group(2) is not None:
+                    value = int(m.group(2))
+                names[value] = m.group(1)[len('TRACE_'):].lower()
+                value += 1
+
+    return names
+
+
+def read_dump(f):
+    rate = None
+    lost = 0
+    records = []
+
+    for line in f:
+        m = RATE.search(line)
+        if m:
+            # A new dump starts, keep only the last one.
+            rate = int(m.group(1))
+            records = []
+            continue
+        m = LOST.search(line)
+        if m:
+            lost = int(m.group(1))
+            continue
+        m = LINE.search(line)
+        if m:
+            records.append(RECORD.unpack(bytes.fromhex(m.group(1))))
+
+    return rate, lost, records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('log', nargs='?', type=argparse.FileType('r'), default=sys.stdin,
+                        help='console log, stdin if omitted')
+    parser.add_argument('--header', default=DEFAULT_HEADER,
+                        help='trace.h to take the trace point names from')
+    args = parser.parse_args()
+
+    names = read_names(args.header)
+    rate, lost, records = read_dump(args.log)
+    if rate is None:
+        sys.exit('no "thingy trace" dump found')
+
+    print(f'{len(records)} records, {lost} lost, {rate} Hz')
+    print(f'{"time us":>12} {"delta us":>10}  {"seq":>5}  {"trace point":<16} arg0 arg1')
+
+    cycles = 0
+    prev = None
+    for timestamp, trace_id, seq, arg0, arg1 in records:
+        if prev is not None:
+            cycles += (timestamp - prev) & 0xffffffff
+            delta = ((timestamp - prev) & 0xffffffff) * 1e6 / rate
+        else:
+            delta = 0.0
+        prev = timestamp
+
+        name = names.get(trace_id, f'id {trace_id}')
+        print(f'{cycles * 1e6 / rate:12.1f} {delta:10.1f}  {seq:5}  {name:<16} {arg0} {arg1}')
+
+
+if __name__ == '__main__':
+    main()
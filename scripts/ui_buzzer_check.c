@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/*
+ * Host check of the buzzer tables made by scripts/gen_buzzer_tables.py.
+ *
+ *   python3 scripts/gen_buzzer_tables.py -o ui_buzzer_tables.c
+ *   cc -O2 -Isrc/ui -o ui_buzzer_check scripts/ui_buzzer_check.c ui_buzzer_tables.c -lm
+ *   ./ui_buzzer_check
+ *
+ * Looks up the pulse width with ui_buzzer_pulse_width(), as the driver
+ * does, for every period ui_buzzer_set_frequency() and ui_buzzer_set_note()
+ * can set and every intensity. Compares it against the curve evaluated in
+ * double precision and against the integer formula it replaced. Checks the
+ * note periods against equal temperament from A4 = 440 Hz. Prints the
+ * largest errors. Exits non-zero if the table is further off the curve
+ * than rounding to the us and the Q.24 fraction allow, more than 1 us off
+ * the old formula, if the pulse width decreases with the intensity, or if
+ * a note is more than 5 cents off.
+ *
+ * Then times the pulse width of ui_buzzer_set_frequency() and
+ * ui_buzzer_set_note() against calculate_pulse_width() of the old driver
+ * over the same sweep of frequencies and intensities, and prints the time
+ * per call in TSC cycles on x86 and ns elsewhere.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TIME_UNIT "TSC cycles"
+#else
+#define TIME_UNIT "ns"
+#endif
+
+#include "ui_buzzer_tables.h"
+
+/* As in ui_buzzer.c and the calculate_pulse_width() the table replaced. */
+#define USEC_PER_SEC  1000000
+#define FREQUENCY_MAX 10000
+#define INTENSITY_MAX 100
+#define CURVE_CONST   50
+
+#define NOTE_A4 57
+
+#define CENTS_MAX 5.0
+
+#define REPETITIONS 5
+
+static int curve_divisor(int intensity)
+{
+	return CURVE_CONST + (((2 - CURVE_CONST) * intensity) / INTENSITY_MAX);
+}
+
+static double curve_pulse_width(uint32_t period, int intensity)
+{
+	return (double)period / curve_divisor(intensity) -
+	       (double)period * (INTENSITY_MAX - intensity) / (CURVE_CONST * INTENSITY_MAX);
+}
+
+static int32_t formula_pulse_width(uint32_t period, int intensity)
+{
+	int32_t offset = ((int32_t)period * (INTENSITY_MAX - intensity)) /
+			 (CURVE_CONST * INTENSITY_MAX);
+
+	return ((int32_t)period / curve_divisor(intensity)) - offset;
+}
+
+/* Period and pulse width of a set as the old driver did it, with its four divisions. */
+static __attribute__((noinline)) uint32_t old_set_frequency(uint32_t freq, int intensity)
+{
+	return (uint32_t)formula_pulse_width(USEC_PER_SEC / freq, intensity);
+}
+
+static __attribute__((noinline)) uint32_t set_frequency(uint32_t freq, int intensity)
+{
+	return ui_buzzer_pulse_width(USEC_PER_SEC / freq, intensity);
+}
+
+static __attribute__((noinline)) uint32_t set_note(uint32_t note, int intensity)
+{
+	return ui_buzzer_pulse_width(ui_buzzer_note_period[note], intensity);
+}
+
+struct worst {
+	double error;
+	uint32_t period;
+	int intensity;
+};
+
+static uint32_t checked;
+static uint32_t off_curve;
+static struct worst curve_worst;
+static struct worst formula_worst;
+static uint32_t formula_differ;
+static uint32_t not_monotonic;
+static uint32_t bad_ends;
+
+static void note_worst(struct worst *w, double error, uint32_t period, int intensity)
+{
+	if (error > w->error) {
+		w->error = error;
+		w->period = period;
+		w->intensity = intensity;
+	}
+}
+
+static void check_period(uint32_t period)
+{
+	uint32_t last = 0;
+
+	for (int i = 0; i <= INTENSITY_MAX; i++) {
+		uint32_t width = ui_buzzer_pulse_width(period, i);
+		double curve = curve_pulse_width(period, i);
+		int32_t formula = formula_pulse_width(period, i);
+
+		/* Half a us of rounding, half a step of the fraction times the period. */
+		off_curve += (fabs(width - curve) >
+			      (0.5 + ldexp(period, -(UI_BUZZER_PULSE_FRAC_SHIFT + 1)) + 1e-9));
+		note_worst(&curve_worst, fabs(width - curve), period, i);
+		note_worst(&formula_worst, abs((int32_t)width - formula), period, i);
+		formula_differ += ((int32_t)width != formula);
+		not_monotonic += (width < last);
+		last = width;
+		checked++;
+	}
+
+	/* Silent at 0, a square wave at full intensity. */
+	bad_ends += (ui_buzzer_pulse_width(period, 0) != 0);
+	bad_ends += (ui_buzzer_pulse_width(period, INTENSITY_MAX) != ((period + 1) / 2));
+}
+
+static uint64_t now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+#endif
+}
+
+static volatile uint32_t sink;
+
+/* Best of REPETITIONS sweeps of every frequency and intensity, per call. */
+static double bench(uint32_t (*set)(uint32_t, int), bool note)
+{
+	uint64_t best = UINT64_MAX;
+
+	for (int r = 0; r < REPETITIONS; r++) {
+		uint32_t sum = 0;
+		uint64_t start = now();
+		uint64_t t;
+
+		for (uint32_t freq = 1; freq <= FREQUENCY_MAX; freq++) {
+			uint32_t arg = note ? (freq % UI_BUZZER_PERIOD_NUM) : freq;
+
+			for (int i = 0; i <= INTENSITY_MAX; i++) {
+				sum += set(arg, i);
+			}
+		}
+		t = now() - start;
+		sink = sum;
+		if (t < best) {
+			best = t;
+		}
+	}
+
+	return (double)best / (FREQUENCY_MAX * (INTENSITY_MAX + 1));
+}
+
+int main(void)
+{
+	double cents_worst = 0;
+	int cents_note = 0;
+	bool ok;
+
+	for (uint32_t freq = 1; freq <= FREQUENCY_MAX; freq++) {
+		check_period(USEC_PER_SEC / freq);
+	}
+	for (int note = 0; note < UI_BUZZER_PERIOD_NUM; note++) {
+		double freq = 440.0 * pow(2.0, (note - NOTE_A4) / 12.0);
+		double cents = 1200.0 * log2((USEC_PER_SEC / freq) / ui_buzzer_note_period[note]);
+
+		check_period(ui_buzzer_note_period[note]);
+		if (fabs(cents) > fabs(cents_worst)) {
+			cents_worst = cents;
+			cents_note = note;
+		}
+	}
+
+	printf("%u period/intensity pairs\n", checked);
+	printf("off the curve:   %.3f us at %u us, intensity %d, %u pairs beyond rounding\n",
+	       curve_worst.error, curve_worst.period, curve_worst.intensity, off_curve);
+	printf("off the formula: %.0f us at %u us, intensity %d, %u pairs differ\n",
+	       formula_worst.error, formula_worst.period, formula_worst.intensity,
+	       formula_differ);
+	printf("decreasing with the intensity: %u, wrong at 0 or %d: %u\n", not_monotonic,
+	       INTENSITY_MAX, bad_ends);
+	printf("note periods:    %+.2f cents at note %d, %u us\n", cents_worst, cents_note,
+	       ui_buzzer_note_period[cents_note]);
+
+	printf("old formula:     %6.2f " TIME_UNIT " per call\n", bench(old_set_frequency, false));
+	printf("frequency:       %6.2f " TIME_UNIT " per call\n", bench(set_frequency, false));
+	printf("note:            %6.2f " TIME_UNIT " per call\n", bench(set_note, true));
+
+	ok = (off_curve == 0) && (formula_worst.error <= 1) &&
+	     (not_monotonic == 0) && (bad_ends == 0) && (fabs(cents_worst) <= CENTS_MAX);
+	printf("%s\n", ok ? "PASS" : "FAIL");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/*
+ * Host check of the output layers and mailboxes in src/ui_layers.c.
+ *
+ *   cc -O2 -pthread -Isrc -o ui_layers_check scripts/ui_layers_check.c src/ui_layers.c
+ *   ./ui_layers_check
+ *
+ * Drives an engine like the rgb and buzzer control do, with a message that
+ * sets a blinky effect for a duration, and checks that a layer with a
+ * duration expires and the layer below takes over at its own phase, that
+ * a release falls through the same way, that a newer post replaces an
+ * older one that was not taken and counts it as replaced, and the blinky
+ * phase. A producer thread then posts while the consumer takes, and every
+ * copy taken must be whole and newer than the one before. The producer
+ * yields after most posts so that takes interleave with the posts on a
+ * single CPU too, and a minimum share of the posts must be taken. The
+ * time of each post is printed as percentiles and maximum, in ns. Prints
+ * one line per check and exits non-zero if one fails.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ui_layers.h"
+
+#define STRESS_POSTS 200000
+#define FILL_WORDS   14
+/* The producer yields after all posts but every STRESS_BURST-th, which follows right away. */
+#define STRESS_BURST 4
+/* Three of four posts are taken when every yield switches, at least a tenth must be. */
+#define STRESS_TAKES_MIN (STRESS_POSTS / 10)
+
+struct msg {
+	uint32_t id;
+	/* ms, 0 for never. */
+	uint32_t duration;
+	uint8_t interval;
+	uint8_t duty;
+	bool clear;
+	/* All id, a torn copy mixes two of them. */
+	uint32_t fill[FILL_WORDS];
+};
+
+struct effect {
+	uint32_t id;
+	uint8_t interval;
+	uint8_t duty;
+};
+
+static struct msg messages[UI_LAYERS_NUM][2];
+static struct msg taken;
+
+static struct effect effects[UI_LAYERS_NUM];
+static uint32_t updates;
+static uint32_t replaced_total;
+
+/* What the last render drove. */
+static int rendered;
+static bool rendered_on;
+
+static bool ok = true;
+
+static void update(struct ui_layers *l, int index, const void *msg_in, uint32_t replaced,
+		   int64_t now)
+{
+	const struct msg *msg = msg_in;
+
+	updates++;
+	replaced_total += replaced;
+
+	if (msg->clear) {
+		l->layer[index].active = false;
+		return;
+	}
+
+	effects[index].id = msg->id;
+	effects[index].interval = msg->interval;
+	effects[index].duty = msg->duty;
+	ui_layers_start(&l->layer[index], now, msg->duration);
+}
+
+static int64_t render(struct ui_layers *l, int index, int64_t now)
+{
+	int64_t to_edge = UI_LAYERS_NEVER;
+
+	rendered = index;
+	rendered_on = false;
+	if (index < 0) {
+		return UI_LAYERS_NEVER;
+	}
+
+	rendered_on = ui_layers_blinky_phase(effects[index].interval, effects[index].duty,
+					     now - l->layer[index].start, &to_edge);
+
+	return (to_edge == UI_LAYERS_NEVER) ? UI_LAYERS_NEVER : (now + to_edge);
+}
+
+static struct ui_layers layers;
+
+static void reset(void)
+{
+	memset(&layers, 0, sizeof(layers));
+	memset(messages, 0, sizeof(messages));
+	memset(effects, 0, sizeof(effects));
+	layers.messages = messages;
+	layers.message_size = sizeof(struct msg);
+	layers.scratch = &taken;
+	layers.update = update;
+	layers.render = render;
+	updates = 0;
+	replaced_total = 0;
+}
+
+static void post(int index, uint32_t id, uint32_t duration, uint8_t interval, uint8_t duty)
+{
+	struct msg msg = {
+		.id = id,
+		.duration = duration,
+		.interval = interval,
+		.duty = duty,
+	};
+
+	ui_layers_post(&layers, index, &msg);
+}
+
+static void release(int index)
+{
+	struct msg msg = { .clear = true };
+
+	ui_layers_post(&layers, index, &msg);
+}
+
+static void check(const char *name, bool pass)
+{
+	printf("%-56s %s\n", name, pass ? "ok" : "FAIL");
+	ok &= pass;
+}
+
+static void check_expiry(void)
+{
+	int64_t next;
+
+	reset();
+	/* Base blinks 2 s at 50 %, the app layer is steady on for 3.5 s. */
+	post(0, 1, 0, 2, 50);
+	post(1, 2, 3500, 0, 0);
+
+	next = ui_layers_step(&layers, 0);
+	check("higher layer masks the base", (rendered == 1) && rendered_on);
+	check("next edge is the expiry of the higher layer", next == 3500);
+
+	next = ui_layers_step(&layers, 3499);
+	check("higher layer still shown 1 ms before its expiry", rendered == 1);
+
+	next = ui_layers_step(&layers, 3500);
+	check("base takes over at the expiry", (rendered == 0) && !layers.layer[1].active);
+	/* 3500 % 2000 = 1500 is in the off half, the edge is at 4000. */
+	check("base continues at its own phase", !rendered_on && (next == 4000));
+
+	next = ui_layers_step(&layers, 4000);
+	check("base turns on at the next period", rendered_on && (next == 5000));
+	check("no update without a post", updates == 2);
+}
+
+static void check_release(void)
+{
+	int64_t next;
+
+	reset();
+	post(0, 1, 0, 0, 0);
+	post(2, 2, 0, 0, 0);
+	post(3, 3, 1000, 0, 0);
+
+	next = ui_layers_step(&layers, 100);
+	check("highest active layer is shown", (rendered == 3) && (next == 1100));
+
+	release(3);
+	ui_layers_step(&layers, 200);
+	check("release falls through to the next active layer", rendered == 2);
+
+	release(2);
+	ui_layers_step(&layers, 300);
+	check("release skips inactive layers", rendered == 0);
+
+	release(0);
+	next = ui_layers_step(&layers, 400);
+	check("no active layer turns the output off",
+	      (rendered == -1) && (next == UI_LAYERS_NEVER));
+}
+
+static void check_replace(void)
+{
+	reset();
+	post(2, 1, 0, 0, 0);
+	post(2, 2, 0, 0, 0);
+	post(2, 3, 0, 0, 0);
+
+	ui_layers_step(&layers, 0);
+	check("newest of three posts is taken", (updates == 1) && (effects[2].id == 3));
+	check("older posts are counted as replaced", replaced_total == 2);
+
+	post(2, 4, 0, 0, 0);
+	ui_layers_step(&layers, 10);
+	check("a post taken right away replaces nothing",
+	      (updates == 2) && (effects[2].id == 4) && (replaced_total == 2));
+
+	/* A newer effect restarts the duration of the layer. */
+	post(2, 5, 500, 0, 0);
+	ui_layers_step(&layers, 20);
+	post(2, 6, 500, 0, 0);
+	ui_layers_step(&layers, 400);
+	ui_layers_step(&layers, 600);
+	check("a newer post restarts the duration", (rendered == 2) && (effects[2].id == 6));
+	ui_layers_step(&layers, 900);
+	check("and expires from there", rendered == -1);
+}
+
+static void check_blinky(void)
+{
+	int64_t to_edge;
+	bool on;
+
+	on = ui_layers_blinky_phase(0, 50, 12345, &to_edge);
+	check("interval 0 is always on", on && (to_edge == UI_LAYERS_NEVER));
+
+	on = ui_layers_blinky_phase(3, 0, 12345, &to_edge);
+	check("duty 0 is always off", !on && (to_edge == UI_LAYERS_NEVER));
+
+	on = ui_layers_blinky_phase(3, 100, 2999, &to_edge);
+	check("duty 100 is on to the end of the period", on && (to_edge == 1));
+
+	on = ui_layers_blinky_phase(3, 25, 750, &to_edge);
+	check("duty 25 turns off after a quarter", !on && (to_edge == 2250));
+
+	on = ui_layers_blinky_phase(255, 50, 255000LL * 1000 + 7, &to_edge);
+	check("long elapsed times keep the phase", on && (to_edge == 127500 - 7));
+}
+
+static volatile bool producing;
+
+/* ns each post took. */
+static uint32_t post_ns[STRESS_POSTS];
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void *producer(void *arg)
+{
+	struct msg msg = { 0 };
+
+	(void)arg;
+
+	for (uint32_t id = 1; id <= STRESS_POSTS; id++) {
+		uint64_t start;
+
+		msg.id = id;
+		for (int i = 0; i < FILL_WORDS; i++) {
+			msg.fill[i] = id;
+		}
+		start = now_ns();
+		ui_layers_post(&layers, 1, &msg);
+		post_ns[id - 1] = (uint32_t)(now_ns() - start);
+
+		if ((id % STRESS_BURST) != 0) {
+			sched_yield();
+		}
+	}
+	__atomic_store_n(&producing, false, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+static void check_concurrent(void)
+{
+	struct msg out;
+	pthread_t thread;
+	uint32_t last = 0;
+	uint32_t takes = 0;
+	uint32_t replaced = 0;
+	uint32_t lost = 0;
+	bool whole = true;
+	bool newer = true;
+	bool more = true;
+
+	reset();
+	producing = true;
+	pthread_create(&thread, NULL, producer, NULL);
+
+	while (more) {
+		uint32_t r;
+
+		more = __atomic_load_n(&producing, __ATOMIC_ACQUIRE);
+		if (!ui_layers_take(&layers, 1, &out, &r)) {
+			/* Nothing new, let the producer post on a single CPU. */
+			sched_yield();
+			continue;
+		}
+		takes++;
+		replaced += r;
+		for (int i = 0; i < FILL_WORDS; i++) {
+			whole &= (out.fill[i] == out.id);
+		}
+		newer &= (out.id > last);
+		lost += out.id - last - 1 - r;
+		last = out.id;
+	}
+	pthread_join(thread, NULL);
+
+	qsort(post_ns, STRESS_POSTS, sizeof(post_ns[0]), compare_u32);
+	printf("%u posts, %u taken, %u replaced\n", STRESS_POSTS, takes, replaced);
+	printf("post ns: p50 %u, p99 %u, p99.9 %u, max %u\n", post_ns[STRESS_POSTS / 2],
+	       post_ns[(STRESS_POSTS / 100) * 99], post_ns[(STRESS_POSTS / 1000) * 999],
+	       post_ns[STRESS_POSTS - 1]);
+	check("takes interleave with the posts", takes >= STRESS_TAKES_MIN);
+	check("every copy taken during posts is whole", whole);
+	check("every copy taken is newer than the one before", newer);
+	check("taken and replaced add up to the posts",
+	      (last == STRESS_POSTS) && (lost == 0) && (takes + replaced == STRESS_POSTS));
+}
+
+int main(void)
+{
+	check_expiry();
+	check_release();
+	check_replace();
+	check_blinky();
+	check_concurrent();
+
+	printf("%s\n", ok ? "PASS" : "FAIL");
+
+	return ok ? 0 : 1;
+}
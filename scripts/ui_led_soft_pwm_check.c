@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/*
+ * Host check of the soft PWM schedule in src/ui/ui_led_soft_pwm_schedule.c.
+ *
+ *   cc -O2 -Isrc/ui -o ui_led_soft_pwm_check scripts/ui_led_soft_pwm_check.c \
+ *      src/ui/ui_led_soft_pwm_schedule.c
+ *   ./ui_led_soft_pwm_check
+ *
+ * Builds the schedule for every combination of duty cycles on three
+ * channels, two of them on one port and one active low, and for the edge
+ * duty cycles 0, 1, 127, 128, 254 and 255 on six channels over both ports.
+ * Every schedule must start lit at offset 0, have strictly rising offsets
+ * with one event per distinct duty cycle between 0 and 255, so equal duty
+ * cycles share an edge, darken each channel at its own duty cycle and
+ * never light it again, keep duty 0 dark and duty 255 lit all period, and
+ * touch no pin but those of the channels of a port. Prints one line per
+ * check and exits non-zero if one fails.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ui_led_soft_pwm_schedule.h"
+
+/* Not a multiple of the 256 steps, the offsets are rounded down. */
+#define PERIOD_TICKS 1000
+#define CHANNELS_MAX 6
+
+static const uint8_t edge_duty[] = { 0, 1, 127, 128, 254, 255 };
+
+static bool ok = true;
+
+static void check(const char *name, const char *what, bool pass)
+{
+	printf("%-28s %-44s %s\n", name, what, pass ? "ok" : "FAIL");
+	ok &= pass;
+}
+
+struct failures {
+	uint32_t schedules;
+	uint32_t start;
+	uint32_t order;
+	uint32_t count;
+	uint32_t edge;
+	uint32_t mask;
+};
+
+static bool lit(const struct ui_led_soft_pwm_layout *layout,
+		const struct ui_led_soft_pwm_event *event, uint8_t ch)
+{
+	const struct ui_led_soft_pwm_channel *c = &layout->channels[ch];
+
+	return ((event->level[c->port] ^ layout->active_low[c->port]) & c->pin) != 0;
+}
+
+static void check_schedule(const struct ui_led_soft_pwm_layout *layout, struct failures *f)
+{
+	struct ui_led_soft_pwm_event event[CHANNELS_MAX + 1];
+	uint32_t port_pins[UI_LED_SOFT_PWM_PORTS_MAX] = { 0 };
+	bool distinct[UI_LED_SOFT_PWM_DUTY_STEPS] = { false };
+	uint8_t expected = 1;
+	uint8_t num;
+
+	memset(event, 0xa5, sizeof(event));
+	num = ui_led_soft_pwm_schedule_build(layout, event);
+	f->schedules++;
+
+	for (uint8_t ch = 0; ch < layout->num_channels; ch++) {
+		uint8_t duty = layout->duty[ch];
+
+		port_pins[layout->channels[ch].port] |= layout->channels[ch].pin;
+		if ((duty > 0) && (duty < UI_LED_SOFT_PWM_DUTY_FULL) && !distinct[duty]) {
+			distinct[duty] = true;
+			expected++;
+		}
+	}
+
+	/* One edge per distinct duty cycle, equal ones coalesce. */
+	if ((num != expected) || (num > (layout->num_channels + 1))) {
+		f->count++;
+		return;
+	}
+
+	f->start += (event[0].offset != 0);
+	for (uint8_t i = 1; i < num; i++) {
+		f->order += (event[i].offset <= event[i - 1].offset);
+	}
+
+	for (uint8_t p = 0; p < layout->num_ports; p++) {
+		for (uint8_t i = 0; i < num; i++) {
+			f->mask += ((event[i].level[p] & ~port_pins[p]) != 0);
+		}
+	}
+
+	for (uint8_t ch = 0; ch < layout->num_channels; ch++) {
+		uint8_t duty = layout->duty[ch];
+		uint32_t off = (uint32_t)(((uint64_t)layout->period_ticks * duty) /
+					  UI_LED_SOFT_PWM_DUTY_STEPS);
+
+		for (uint8_t i = 0; i < num; i++) {
+			bool on;
+
+			if (duty == 0) {
+				on = false;
+			} else if (duty == UI_LED_SOFT_PWM_DUTY_FULL) {
+				on = true;
+			} else {
+				/* Lit from the start of the period to the offset of its duty cycle. */
+				on = event[i].offset < off;
+			}
+			f->edge += (lit(layout, &event[i], ch) != on);
+		}
+	}
+}
+
+static void report(const char *name, const struct failures *f)
+{
+	char what[44];
+
+	snprintf(what, sizeof(what), "%u schedules", f->schedules);
+	check(name, what, f->schedules > 0);
+	check(name, "one event per distinct duty cycle", f->count == 0);
+	check(name, "lit at offset 0", f->start == 0);
+	check(name, "offsets strictly rising", f->order == 0);
+	check(name, "every channel darkened at its duty cycle", f->edge == 0);
+	check(name, "only the pins of the port", f->mask == 0);
+}
+
+static void check_all_duties(void)
+{
+	/* Two pins on port 0, one of them active low, and one on port 1. */
+	static const struct ui_led_soft_pwm_channel channels[] = {
+		{ 0, 1U << 2 },
+		{ 0, 1U << 5 },
+		{ 1, 1U << 3 },
+	};
+	static const uint32_t active_low[UI_LED_SOFT_PWM_PORTS_MAX] = { 1U << 5, 0 };
+	uint8_t duty[3];
+	struct ui_led_soft_pwm_layout layout = {
+		.channels = channels,
+		.duty = duty,
+		.num_channels = 3,
+		.active_low = active_low,
+		.num_ports = 2,
+		.period_ticks = PERIOD_TICKS,
+	};
+	struct failures f = { 0 };
+
+	for (uint32_t d0 = 0; d0 < UI_LED_SOFT_PWM_DUTY_STEPS; d0++) {
+		for (uint32_t d1 = 0; d1 < UI_LED_SOFT_PWM_DUTY_STEPS; d1++) {
+			for (uint32_t d2 = 0; d2 < UI_LED_SOFT_PWM_DUTY_STEPS; d2++) {
+				duty[0] = d0;
+				duty[1] = d1;
+				duty[2] = d2;
+				check_schedule(&layout, &f);
+			}
+		}
+	}
+
+	report("3 channels, every duty", &f);
+}
+
+static void check_edge_duties(void)
+{
+	static const struct ui_led_soft_pwm_channel channels[CHANNELS_MAX] = {
+		{ 0, 1U << 0 },
+		{ 0, 1U << 31 },
+		{ 0, 1U << 7 },
+		{ 1, 1U << 1 },
+		{ 1, 1U << 2 },
+		{ 1, 1U << 30 },
+	};
+	static const uint32_t active_low[UI_LED_SOFT_PWM_PORTS_MAX] = { 1U << 31, 1U << 2 };
+	const size_t num_duty = sizeof(edge_duty) / sizeof(edge_duty[0]);
+	uint8_t duty[CHANNELS_MAX];
+	struct ui_led_soft_pwm_layout layout = {
+		.channels = channels,
+		.duty = duty,
+		.num_channels = CHANNELS_MAX,
+		.active_low = active_low,
+		.num_ports = 2,
+		.period_ticks = PERIOD_TICKS,
+	};
+	struct failures f = { 0 };
+	size_t combinations = 1;
+
+	for (int ch = 0; ch < CHANNELS_MAX; ch++) {
+		combinations *= num_duty;
+	}
+
+	for (size_t n = 0; n < combinations; n++) {
+		size_t rest = n;
+
+		for (int ch = 0; ch < CHANNELS_MAX; ch++) {
+			duty[ch] = edge_duty[rest % num_duty];
+			rest /= num_duty;
+		}
+		check_schedule(&layout, &f);
+	}
+
+	report("6 channels, edge duties", &f);
+}
+
+static void check_fixed(void)
+{
+	static const struct ui_led_soft_pwm_channel channels[] = {
+		{ 0, 1U << 2 },
+		{ 0, 1U << 5 },
+		{ 1, 1U << 3 },
+	};
+	static const uint32_t active_low[UI_LED_SOFT_PWM_PORTS_MAX] = { 1U << 5, 0 };
+	struct ui_led_soft_pwm_event event[4];
+	uint8_t duty[3] = { 64, 64, 255 };
+	struct ui_led_soft_pwm_layout layout = {
+		.channels = channels,
+		.duty = duty,
+		.num_channels = 3,
+		.active_low = active_low,
+		.num_ports = 2,
+		.period_ticks = PERIOD_TICKS,
+	};
+	uint8_t num;
+
+	num = ui_led_soft_pwm_schedule_build(&layout, event);
+	check("64, 64, 255", "two events, the equal duties share one",
+	      (num == 2) && (event[1].offset == 250));
+	check("64, 64, 255", "port 0 lit, active low pin raw low",
+	      (event[0].level[0] == (1U << 2)) && (event[0].level[1] == (1U << 3)));
+	check("64, 64, 255", "port 0 dark after the edge, port 1 stays",
+	      (event[1].level[0] == (1U << 5)) && (event[1].level[1] == (1U << 3)));
+
+	duty[0] = 0;
+	duty[1] = 0;
+	duty[2] = 0;
+	num = ui_led_soft_pwm_schedule_build(&layout, event);
+	check("0, 0, 0", "one event, all dark",
+	      (num == 1) && (event[0].level[0] == (1U << 5)) && (event[0].level[1] == 0));
+}
+
+int main(void)
+{
+	check_fixed();
+	check_edge_duties();
+	check_all_duties();
+
+	printf("%s\n", ok ? "PASS" : "FAIL");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/*
+ * Host check of the RTTTL compiler and melody player in src/ui_melody.c.
+ *
+ *   python3 scripts/rtttl_compile.py -o ui_melody_builtin.c melodies/ui.rtttl
+ *   cc -O2 -Isrc -o ui_melody_check scripts/ui_melody_check.c src/ui_melody.c ui_melody_builtin.c
+ *   ./ui_melody_check melodies/ui.rtttl
+ *
+ * Compiles RTTTL strings on the host as "thingy buzzer play" does on
+ * target and checks the bytecode, the notes and durations the player
+ * makes of it, and the error of every malformed string. Bytecode that
+ * would make the player spin must fail ui_melody_validate(). Every melody of
+ * the given files is then compiled again and must match the built-in
+ * bytecode that scripts/rtttl_compile.py made of it. Prints one line per
+ * check and exits non-zero if one fails.
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ui_melody.h"
+
+#define CODE_SIZE 128
+#define LINE_SIZE 1024
+#define NOTES_MAX 8
+
+struct vector {
+	const char *rtttl;
+	uint8_t code[16];
+	size_t len;
+	struct ui_melody_note notes[NOTES_MAX];
+	size_t notes_len;
+	uint32_t length_ms;
+};
+
+/* Bytecode as scripts/rtttl_compile.py makes it. */
+static const struct vector vectors[] = {
+	{
+		/* Octave switches, dotted, sharp, rest, B# wrapping to C7. */
+		"test:d=4,o=5,b=120:c,8d#6.,p,2b#6",
+		{ 0xd0, 0x07, 0xad, 0x40, 0xcd, 0x73, 0x4c, 0xed, 0x20 },
+		9,
+		{ { 60, 500 }, { 75, 375 }, { UI_MELODY_NOTE_REST, 500 }, { 84, 1000 } },
+		4,
+		2375,
+	},
+	{
+		/* Defaults of RTTTL when the section is empty. */
+		"plain::c",
+		{ 0xe1, 0x0e, 0xcd, 0x40 },
+		4,
+		{ { 72, 952 } },
+		1,
+		952,
+	},
+	{
+		/* Fastest tempo, the dot after the octave, h for b, a dotted rest. */
+		"fast:d=32,o=4,b=900:16f#.,h4,p.",
+		{ 0x0a, 0x01, 0x8d, 0x96, 0xab, 0xbc },
+		6,
+		{ { 54, 24 }, { 59, 8 }, { UI_MELODY_NOTE_REST, 12 } },
+		3,
+		44,
+	},
+	{
+		/* Upper case and spaces around the separators. */
+		"Loud: D=8, O=5, B=160 : C , E",
+		{ 0xdc, 0x05, 0xad, 0x60, 0x64 },
+		5,
+		{ { 60, 187 }, { 64, 187 } },
+		2,
+		374,
+	},
+	{
+		/* No notes at all. */
+		"silent:d=4:",
+		{ 0xe1, 0x0e },
+		2,
+		{ { 0 } },
+		0,
+		0,
+	},
+};
+
+struct error_vector {
+	const char *rtttl;
+	size_t size;
+	int err;
+};
+
+static const struct error_vector errors[] = {
+	{ "no sections", CODE_SIZE, -EINVAL },
+	{ "short:d=4:c", 1, -EINVAL },
+	{ "duration:d=3:c", CODE_SIZE, -EINVAL },
+	{ "duration:d=64:c", CODE_SIZE, -EINVAL },
+	{ "octave:o=8:c", CODE_SIZE, -EINVAL },
+	{ "tempo:b=0:c", CODE_SIZE, -EINVAL },
+	{ "tempo:b=901:c", CODE_SIZE, -EINVAL },
+	/* A whole note of 80 s does not fit the header. */
+	{ "tempo:b=3:c", CODE_SIZE, -EINVAL },
+	{ "key:x=1:c", CODE_SIZE, -EINVAL },
+	{ "value:d=:c", CODE_SIZE, -EINVAL },
+	{ "equals:d4:c", CODE_SIZE, -EINVAL },
+	{ "unterminated:d=4", CODE_SIZE, -EINVAL },
+	{ "letter::i", CODE_SIZE, -EINVAL },
+	{ "note duration::3c", CODE_SIZE, -EINVAL },
+	{ "note octave::c8", CODE_SIZE, -EINVAL },
+	{ "wrap octave::b#7", CODE_SIZE, -EINVAL },
+	{ "trailing::c5x", CODE_SIZE, -EINVAL },
+	{ "separator::c d", CODE_SIZE, -EINVAL },
+	/* The octave and the note need two bytes after the header. */
+	{ "full::c", 3, -ENOMEM },
+	{ "full::c", 4, 4 },
+	{ "full::c,d,e", 5, -ENOMEM },
+};
+
+struct invalid_vector {
+	const char *name;
+	uint8_t code[8];
+	uint16_t len;
+};
+
+/* Bytecode the compiler never makes, on which the player would spin. */
+static const struct invalid_vector invalid[] = {
+	{ "no header", { 0xd0 }, 1 },
+	{ "whole note of 0 ms", { 0x00, 0x00, 0xad, 0x40 }, 4 },
+	{ "duration 6", { 0xd0, 0x07, 0xad, 0xc0 }, 4 },
+	{ "duration 7", { 0xd0, 0x07, 0xad, 0x40, 0xe0 }, 5 },
+	{ "unknown note 14", { 0xd0, 0x07, 0xad, 0x4e }, 4 },
+	{ "octave switches only", { 0xd0, 0x07, 0xad, 0xcd }, 4 },
+	{ "every note 0 ms", { 0x01, 0x00, 0xad, 0xa0, 0x40 }, 5 },
+	{ "no notes", { 0xd0, 0x07 }, 2 },
+};
+
+/* As many notes as fit into CODE_SIZE, with one octave switch. */
+static char long_melody[16 + (2 * CODE_SIZE)];
+
+static bool ok = true;
+
+static void check(const char *name, const char *what, bool pass)
+{
+	printf("%-36s %-32s %s\n", name, what, pass ? "ok" : "FAIL");
+	ok &= pass;
+}
+
+static void check_vector(const struct vector *v)
+{
+	uint8_t code[CODE_SIZE];
+	struct ui_melody melody = { .name = "check", .code = code };
+	struct ui_melody_player player;
+	struct ui_melody_note note;
+	size_t notes = 0;
+	bool same = true;
+	int len;
+
+	memset(code, 0xee, sizeof(code));
+	len = ui_melody_compile(v->rtttl, code, sizeof(code));
+	check(v->rtttl, "bytecode", (len == (int)v->len) && !memcmp(code, v->code, v->len));
+	if (len < 0) {
+		return;
+	}
+	check(v->rtttl, "nothing written past the end", code[len] == 0xee);
+
+	melody.len = len;
+	ui_melody_player_start(&player, &melody);
+	while (ui_melody_player_next(&player, &note) == 0) {
+		if ((notes >= v->notes_len) || (note.note != v->notes[notes].note) ||
+		    (note.duration != v->notes[notes].duration)) {
+			same = false;
+		}
+		notes++;
+	}
+	check(v->rtttl, "notes played", same && (notes == v->notes_len));
+	check(v->rtttl, "length", ui_melody_length_ms(&melody) == v->length_ms);
+	check(v->rtttl, "player stays at the end",
+	      ui_melody_player_next(&player, &note) == -ENODATA);
+	check(v->rtttl, "valid unless silent",
+	      (ui_melody_validate(&melody) == 0) == (v->length_ms > 0));
+}
+
+static void check_invalid(void)
+{
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		struct ui_melody melody = {
+			.name = invalid[i].name,
+			.code = invalid[i].code,
+			.len = invalid[i].len,
+		};
+
+		check(invalid[i].name, "rejected", ui_melody_validate(&melody) == -EINVAL);
+	}
+}
+
+static void check_errors(void)
+{
+	for (size_t i = 0; i < sizeof(errors) / sizeof(errors[0]); i++) {
+		const struct error_vector *e = &errors[i];
+		uint8_t code[CODE_SIZE];
+		char what[32];
+		int ret;
+
+		ret = ui_melody_compile(e->rtttl, code, e->size);
+		snprintf(what, sizeof(what), "%zu bytes -> %d", e->size, e->err);
+		check(e->rtttl, what, ret == e->err);
+	}
+}
+
+static void check_long(void)
+{
+	uint8_t code[CODE_SIZE];
+	size_t pos;
+	int ret;
+
+	/* Header, one octave switch and CODE_SIZE - 3 notes fill the buffer. */
+	pos = (size_t)snprintf(long_melody, sizeof(long_melody), "long:o=5:");
+	for (size_t i = 0; i < CODE_SIZE - 3; i++) {
+		pos += (size_t)snprintf(long_melody + pos, sizeof(long_melody) - pos, "c,");
+	}
+
+	ret = ui_melody_compile(long_melody, code, sizeof(code));
+	check("long", "fills the buffer", ret == CODE_SIZE);
+
+	snprintf(long_melody + pos, sizeof(long_melody) - pos, "c");
+	ret = ui_melody_compile(long_melody, code, sizeof(code));
+	check("long", "one note more", ret == -ENOMEM);
+}
+
+static void check_builtin(const char *path)
+{
+	char line[LINE_SIZE];
+	FILE *f = fopen(path, "r");
+
+	if (f == NULL) {
+		perror(path);
+		ok = false;
+		return;
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		uint8_t code[CODE_SIZE];
+		const struct ui_melody *builtin;
+		char *name = line;
+		char *colon;
+		int len;
+
+		line[strcspn(line, "\r\n")] = '\0';
+		if ((line[0] == '\0') || (line[0] == '#')) {
+			continue;
+		}
+
+		len = ui_melody_compile(line, code, sizeof(code));
+
+		colon = strchr(name, ':');
+		if (colon != NULL) {
+			*colon = '\0';
+		}
+		builtin = ui_melody_find(name);
+
+		check(name, "same as rtttl_compile.py",
+		      (builtin != NULL) && (len == builtin->len) &&
+		      !memcmp(code, builtin->code, builtin->len));
+	}
+
+	fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+	for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+		check_vector(&vectors[i]);
+	}
+	check_errors();
+	check_invalid();
+	check_long();
+	for (int i = 1; i < argc; i++) {
+		check_builtin(argv[i]);
+	}
+	check("unknown", "not a built-in melody", ui_melody_find("no such melody") == NULL);
+
+	printf("%s\n", ok ? "PASS" : "FAIL");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,992 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/*
+ * Reference collector for the uplink datagrams of src/uplink.h, and a load
+ * generator to benchmark it. Linux only, for recvmmsg() and sendmmsg().
+ *
+ *   cc -O2 -pthread -o uplink_collector scripts/uplink_collector.c
+ *   ./uplink_collector --listen 0.0.0.0:2469 --threads 4 --capture uplink.bin
+ *   ./uplink_collector --load 127.0.0.1:2469 --rate 200000 --devices 1000 -t 10
+ *
+ * Collecting, every thread has a socket of its own on the port with
+ * SO_REUSEPORT, so the kernel keeps a device on one thread and the
+ * per-device state needs no locks. Datagrams are received a batch at a
+ * time and decoded in place: the header, the sequence number, which is
+ * tracked apart for the filler of "thingy uplink burst", and the records,
+ * whose lengths are checked against their type. The format carries no
+ * checksum of its own, the UDP checksum covers it, so a datagram whose
+ * records do not add up to its length counts as malformed.
+ *
+ * Every --interval seconds it prints the datagrams/s of every thread, the
+ * decode time per datagram and the datagrams the kernel dropped for a full
+ * socket buffer. At the end it prints the busiest devices with their
+ * sequence gaps, late datagrams and reboots. --capture writes what was
+ * received as datagrams each preceded by its length, little endian 16
+ * bits, the framing of CONFIG_UDP_TRANSPORT_TCP.
+ *
+ * Loading, --devices sockets each stand for a device and send copies of
+ * the datagrams of --replay, a capture as above, or of a built-in mix of
+ * periodic and urgent datagrams, with sequence numbers of their own, at
+ * --rate datagrams/s over all threads, 0 for as fast as they go.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/* From src/uplink.h. */
+#define UPLINK_VERSION            1
+#define UPLINK_HEADER_SIZE        4
+#define UPLINK_RECORD_HEADER_SIZE 2
+#define UPLINK_FLAG_URGENT        0x01
+#define UPLINK_FLAG_BURST         0x02
+
+#define RECORD_HEARTBEAT 1
+#define RECORD_BUTTON    2
+#define RECORD_STATS     3
+#define RECORD_SPECTRUM  4
+#define RECORD_SUMMARY   5
+#define RECORD_GEOFENCE  6
+#define RECORD_TYPES     7
+
+/* Record sizes, from perf_stats.h, vibration.h, sensor_agg.h and geofence_mgr.h. */
+#define BUTTON_SIZE           2
+#define STATS_SIZE            8
+#define SPECTRUM_HEADER_SIZE  6
+#define SUMMARY_HEADER_SIZE   7
+#define SUMMARY_VALUE_SIZE    16
+#define GEOFENCE_SIZE         11
+
+#define DATAGRAM_SIZE_MAX 2048
+#define BATCH_MAX         256
+#define THREADS_MAX       64
+#define DEVICES_BITS      16
+#define DEVICES_MAX       (1 << DEVICES_BITS)
+#define TOP_DEFAULT       10
+
+/* Power of two buckets of the decode time per datagram, bucket i counts [2^i, 2^(i+1)) ns. */
+#define DECODE_BUCKETS 24
+
+enum status {
+	DECODE_OK,
+	DECODE_SHORT,
+	DECODE_VERSION,
+	/* A record runs past the end of the datagram. */
+	DECODE_TRUNCATED,
+	/* A record of a known type has the wrong length. */
+	DECODE_LENGTH,
+};
+
+struct device {
+	uint32_t addr;
+	uint16_t port;
+	bool used;
+	/* Next sequence number, of the periodic and urgent datagrams and of the burst filler. */
+	uint16_t seq_next[2];
+	bool seq_valid[2];
+	uint64_t datagrams;
+	uint64_t bytes;
+	/* Index 0 counts the types this collector does not know. */
+	uint64_t records[RECORD_TYPES];
+	uint64_t urgent;
+	uint64_t burst;
+	uint64_t malformed;
+	uint64_t gaps;
+	uint64_t late;
+	uint64_t reboots;
+};
+
+struct worker {
+	pthread_t thread;
+	int fd;
+	uint32_t index;
+	struct device *devices;
+	uint32_t num_devices;
+	uint32_t full;
+	/* Written by the worker, read for the reports, torn reads only blur a report. */
+	volatile uint64_t datagrams;
+	volatile uint64_t bytes;
+	volatile uint64_t batches;
+	volatile uint64_t kernel_drops;
+	volatile uint64_t decode_ns;
+	volatile uint64_t decode_bucket[DECODE_BUCKETS];
+	volatile uint64_t sent;
+	volatile uint64_t send_errors;
+};
+
+static struct {
+	struct sockaddr_in addr;
+	bool load;
+	uint32_t threads;
+	uint32_t batch;
+	double interval;
+	double time;
+	const char *capture;
+	const char *replay;
+	double rate;
+	uint32_t devices;
+	uint32_t top;
+	bool verbose;
+} opt = {
+	.threads = 1,
+	.batch = 64,
+	.interval = 10,
+	.devices = 100,
+	.top = TOP_DEFAULT,
+};
+
+static struct worker workers[THREADS_MAX];
+static volatile sig_atomic_t stop;
+
+static FILE *capture_file;
+static pthread_mutex_t capture_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Datagrams sent by the load generator, each one preceded by its length. */
+static uint8_t *templates;
+static size_t templates_len;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint16_t get_le16(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static bool record_length_ok(uint8_t type, const uint8_t *data, uint8_t len)
+{
+	switch (type) {
+	case RECORD_BUTTON:
+		return len == BUTTON_SIZE;
+	case RECORD_STATS:
+		return len == STATS_SIZE;
+	case RECORD_SPECTRUM:
+		/* Bands and peaks, 2 and 4 bytes each. */
+		return (len >= SPECTRUM_HEADER_SIZE) &&
+		       (len == (SPECTRUM_HEADER_SIZE + (2 * data[4]) + (4 * data[5])));
+	case RECORD_SUMMARY:
+		return (len >= SUMMARY_HEADER_SIZE) &&
+		       (len == (SUMMARY_HEADER_SIZE + (SUMMARY_VALUE_SIZE * data[1])));
+	case RECORD_GEOFENCE:
+		return len == GEOFENCE_SIZE;
+	default:
+		/* The heartbeat has the length of CONFIG_UDP_DATA_UPLOAD_SIZE_BYTES, newer types any. */
+		return true;
+	}
+}
+
+/* Walk the records in place, counting them by type into counts if given. */
+static enum status decode(const uint8_t *buf, size_t len, uint64_t *counts)
+{
+	size_t pos = UPLINK_HEADER_SIZE;
+
+	if (len < UPLINK_HEADER_SIZE) {
+		return DECODE_SHORT;
+	}
+	if (buf[0] != UPLINK_VERSION) {
+		return DECODE_VERSION;
+	}
+
+	while (pos < len) {
+		uint8_t type;
+		uint8_t rlen;
+
+		if ((len - pos) < UPLINK_RECORD_HEADER_SIZE) {
+			return DECODE_TRUNCATED;
+		}
+		type = buf[pos];
+		rlen = buf[pos + 1];
+		pos += UPLINK_RECORD_HEADER_SIZE;
+		if ((len - pos) < rlen) {
+			return DECODE_TRUNCATED;
+		}
+		if (!record_length_ok(type, &buf[pos], rlen)) {
+			return DECODE_LENGTH;
+		}
+		if (counts != NULL) {
+			counts[(type < RECORD_TYPES) ? type : 0]++;
+		}
+		pos += rlen;
+	}
+
+	return DECODE_OK;
+}
+
+static struct device *device_get(struct worker *w, uint32_t addr, uint16_t port)
+{
+	/*
+	 * Open addressing on the address and port, carrier NAT puts many
+	 * devices behind one address. A device whose NAT binding changes
+	 * shows up anew.
+	 */
+	uint32_t i = ((addr ^ ((uint32_t)port << 16) ^ port) * 2654435761u) >> (32 - DEVICES_BITS);
+
+	while (w->devices[i].used &&
+	       ((w->devices[i].addr != addr) || (w->devices[i].port != port))) {
+		i = (i + 1) & (DEVICES_MAX - 1);
+	}
+
+	if (!w->devices[i].used) {
+		/* Keep a free slot so that the probing ends. */
+		if (w->num_devices >= (DEVICES_MAX - 1)) {
+			w->full++;
+			return NULL;
+		}
+		w->devices[i].used = true;
+		w->devices[i].addr = addr;
+		w->devices[i].port = port;
+		w->num_devices++;
+	}
+
+	return &w->devices[i];
+}
+
+static void sequence_check(struct device *dev, const uint8_t *buf)
+{
+	int lane = (buf[1] & UPLINK_FLAG_BURST) ? 1 : 0;
+	uint16_t seq = get_le16(&buf[2]);
+	uint16_t ahead = (uint16_t)(seq - dev->seq_next[lane]);
+
+	if (!dev->seq_valid[lane]) {
+		dev->seq_valid[lane] = true;
+	} else if (ahead == 0) {
+		/* In order. */
+	} else if ((seq == 0) && (lane == 0)) {
+		/* The sequence starts over at boot. */
+		dev->reboots++;
+	} else if (ahead < 0x8000) {
+		dev->gaps += ahead;
+	} else {
+		/* Behind what was seen, reordered or duplicated, the gap was counted already. */
+		dev->late++;
+		if (dev->gaps > 0) {
+			dev->gaps--;
+		}
+		return;
+	}
+
+	dev->seq_next[lane] = seq + 1;
+}
+
+static void datagram_handle(struct worker *w, const uint8_t *buf, size_t len,
+			    const struct sockaddr_in *from)
+{
+	struct device *dev = device_get(w, from->sin_addr.s_addr, ntohs(from->sin_port));
+	enum status status;
+
+	if (dev == NULL) {
+		return;
+	}
+
+	dev->datagrams++;
+	dev->bytes += len;
+
+	status = decode(buf, len, dev->records);
+	if (status != DECODE_OK) {
+		dev->malformed++;
+		if (opt.verbose) {
+			char name[INET_ADDRSTRLEN];
+
+			inet_ntop(AF_INET, &from->sin_addr, name, sizeof(name));
+			printf("%s:%u malformed datagram of %zu bytes (%d)\n", name,
+			       ntohs(from->sin_port), len, status);
+		}
+		if (status < DECODE_TRUNCATED) {
+			return;
+		}
+	}
+
+	if (buf[1] & UPLINK_FLAG_URGENT) {
+		dev->urgent++;
+	}
+	if (buf[1] & UPLINK_FLAG_BURST) {
+		dev->burst++;
+	}
+	sequence_check(dev, buf);
+}
+
+static void capture_write(struct mmsghdr *msgs, unsigned int n)
+{
+	uint8_t frame[2];
+
+	pthread_mutex_lock(&capture_lock);
+	for (unsigned int i = 0; i < n; i++) {
+		put_le16(frame, (uint16_t)msgs[i].msg_len);
+		fwrite(frame, sizeof(frame), 1, capture_file);
+		fwrite(msgs[i].msg_hdr.msg_iov->iov_base, msgs[i].msg_len, 1, capture_file);
+	}
+	pthread_mutex_unlock(&capture_lock);
+}
+
+static int decode_bucket(uint64_t ns)
+{
+	int bucket = (ns < 2) ? 0 : (63 - __builtin_clzll(ns));
+
+	return (bucket < DECODE_BUCKETS) ? bucket : (DECODE_BUCKETS - 1);
+}
+
+static void *collect_thread(void *arg)
+{
+	static __thread uint8_t bufs[BATCH_MAX][DATAGRAM_SIZE_MAX];
+	static __thread uint8_t controls[BATCH_MAX][CMSG_SPACE(sizeof(uint32_t))];
+	struct worker *w = arg;
+	struct mmsghdr msgs[BATCH_MAX];
+	struct iovec iovs[BATCH_MAX];
+	struct sockaddr_in from[BATCH_MAX];
+	uint32_t drops_last = 0;
+	bool drops_seen = false;
+
+	while (!stop) {
+		uint64_t start;
+		uint64_t per;
+		int n;
+
+		for (uint32_t i = 0; i < opt.batch; i++) {
+			iovs[i].iov_base = bufs[i];
+			iovs[i].iov_len = sizeof(bufs[i]);
+			memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = &from[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+			msgs[i].msg_hdr.msg_control = controls[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+		}
+
+		n = recvmmsg(w->fd, msgs, opt.batch, MSG_WAITFORONE, NULL);
+		if (n <= 0) {
+			if ((n < 0) && (errno != EAGAIN) && (errno != EINTR)) {
+				perror("recvmmsg");
+				break;
+			}
+			continue;
+		}
+
+		start = now_ns();
+		for (int i = 0; i < n; i++) {
+			datagram_handle(w, bufs[i], msgs[i].msg_len, &from[i]);
+		}
+		per = (now_ns() - start) / (uint64_t)n;
+
+		/* SO_RXQ_OVFL, the drops of the socket so far, on every datagram. */
+		for (struct cmsghdr *c = CMSG_FIRSTHDR(&msgs[n - 1].msg_hdr); c != NULL;
+		     c = CMSG_NXTHDR(&msgs[n - 1].msg_hdr, c)) {
+			if ((c->cmsg_level == SOL_SOCKET) && (c->cmsg_type == SO_RXQ_OVFL)) {
+				uint32_t drops;
+
+				memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+				if (drops_seen) {
+					w->kernel_drops += (uint32_t)(drops - drops_last);
+				} else {
+					w->kernel_drops = drops;
+				}
+				drops_last = drops;
+				drops_seen = true;
+			}
+		}
+
+		if (capture_file != NULL) {
+			capture_write(msgs, n);
+		}
+
+		for (int i = 0; i < n; i++) {
+			w->bytes += msgs[i].msg_len;
+		}
+		w->datagrams += n;
+		w->batches++;
+		w->decode_ns += per * n;
+		w->decode_bucket[decode_bucket(per)] += n;
+	}
+
+	return NULL;
+}
+
+/* The decode time below which the given share of the datagrams took, as the bucket top. */
+static uint64_t decode_percentile(const uint64_t *bucket, uint64_t total, uint32_t percent)
+{
+	uint64_t count = 0;
+
+	for (int i = 0; i < DECODE_BUCKETS; i++) {
+		count += bucket[i];
+		if ((count * 100) >= (total * percent)) {
+			return (1ull << (i + 1)) - 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Since the start, and since the last report. */
+static void collect_report(double elapsed, double span, uint64_t *last, uint64_t *last_bucket)
+{
+	uint64_t bucket[DECODE_BUCKETS] = { 0 };
+	uint64_t total = 0;
+	uint64_t bytes = 0;
+	uint64_t drops = 0;
+	uint64_t decode_ns = 0;
+	uint64_t batches = 0;
+	uint64_t interval_total = 0;
+
+	printf("%.0f s:", elapsed);
+	for (uint32_t t = 0; t < opt.threads; t++) {
+		struct worker *w = &workers[t];
+		uint64_t d = w->datagrams;
+
+		printf(" %.0f", (d - last[t]) / span);
+		interval_total += d - last[t];
+		last[t] = d;
+		total += d;
+		bytes += w->bytes;
+		drops += w->kernel_drops;
+		decode_ns += w->decode_ns;
+		batches += w->batches;
+		for (int i = 0; i < DECODE_BUCKETS; i++) {
+			bucket[i] += w->decode_bucket[i];
+		}
+	}
+	printf(" datagrams/s per thread, %.0f total\n", interval_total / span);
+
+	for (int i = 0; i < DECODE_BUCKETS; i++) {
+		uint64_t b = bucket[i];
+
+		bucket[i] -= last_bucket[i];
+		last_bucket[i] = b;
+	}
+	printf("  %llu datagrams, %llu bytes, %.1f per batch, %llu dropped by the kernel\n",
+	       (unsigned long long)total, (unsigned long long)bytes,
+	       batches ? (double)total / batches : 0.0, (unsigned long long)drops);
+	if (interval_total > 0) {
+		printf("  decode %.0f ns per datagram on average, p50 < %llu ns, p99 < %llu ns\n",
+		       total ? (double)decode_ns / total : 0.0,
+		       (unsigned long long)decode_percentile(bucket, interval_total, 50),
+		       (unsigned long long)decode_percentile(bucket, interval_total, 99));
+	}
+}
+
+static int compare_devices(const void *a, const void *b)
+{
+	const struct device *x = *(const struct device *const *)a;
+	const struct device *y = *(const struct device *const *)b;
+
+	return (x->datagrams < y->datagrams) - (x->datagrams > y->datagrams);
+}
+
+static void devices_report(void)
+{
+	const struct device **sorted = malloc(opt.threads * DEVICES_MAX * sizeof(*sorted));
+	struct device total = { 0 };
+	uint32_t num = 0;
+	uint32_t full = 0;
+
+	if (sorted == NULL) {
+		return;
+	}
+
+	/* SO_REUSEPORT keeps an address and port on one thread, no device is on two. */
+	for (uint32_t t = 0; t < opt.threads; t++) {
+		full += workers[t].full;
+		for (uint32_t i = 0; i < DEVICES_MAX; i++) {
+			if (workers[t].devices[i].used) {
+				sorted[num++] = &workers[t].devices[i];
+			}
+		}
+	}
+
+	qsort(sorted, num, sizeof(sorted[0]), compare_devices);
+
+	printf("%-21s %9s %10s %6s %6s %6s %6s %6s %6s  records of type 1-6, other\n",
+	       "device", "datagrams", "bytes", "urgent", "burst", "bad", "gaps", "late",
+	       "boots");
+	for (uint32_t i = 0; i < num; i++) {
+		const struct device *d = sorted[i];
+		struct in_addr in = { .s_addr = d->addr };
+		char name[INET_ADDRSTRLEN + 6];
+		char ip[INET_ADDRSTRLEN];
+
+		total.datagrams += d->datagrams;
+		total.bytes += d->bytes;
+		total.urgent += d->urgent;
+		total.burst += d->burst;
+		total.malformed += d->malformed;
+		total.gaps += d->gaps;
+		total.late += d->late;
+		total.reboots += d->reboots;
+		if (i >= opt.top) {
+			continue;
+		}
+
+		inet_ntop(AF_INET, &in, ip, sizeof(ip));
+		snprintf(name, sizeof(name), "%s:%u", ip, d->port);
+		printf("%-21s %9llu %10llu %6llu %6llu %6llu %6llu %6llu %6llu ", name,
+		       (unsigned long long)d->datagrams, (unsigned long long)d->bytes,
+		       (unsigned long long)d->urgent, (unsigned long long)d->burst,
+		       (unsigned long long)d->malformed, (unsigned long long)d->gaps,
+		       (unsigned long long)d->late, (unsigned long long)d->reboots);
+		for (int r = 1; r <= RECORD_TYPES; r++) {
+			printf(" %llu", (unsigned long long)d->records[r % RECORD_TYPES]);
+		}
+		printf("\n");
+	}
+
+	printf("%u devices%s: %llu datagrams, %llu bytes, %llu urgent, %llu burst, "
+	       "%llu malformed, %llu missing, %llu late, %llu reboots\n", num,
+	       full ? " (table full, some not counted)" : "",
+	       (unsigned long long)total.datagrams, (unsigned long long)total.bytes,
+	       (unsigned long long)total.urgent, (unsigned long long)total.burst,
+	       (unsigned long long)total.malformed, (unsigned long long)total.gaps,
+	       (unsigned long long)total.late, (unsigned long long)total.reboots);
+
+	free(sorted);
+}
+
+static int collect(void)
+{
+	uint64_t last[THREADS_MAX] = { 0 };
+	uint64_t last_bucket[DECODE_BUCKETS] = { 0 };
+	uint64_t start = now_ns();
+	uint64_t next_report = start + (uint64_t)(opt.interval * 1e9);
+	uint64_t reported = start;
+	uint64_t end;
+
+	if (opt.capture != NULL) {
+		capture_file = fopen(opt.capture, "wb");
+		if (capture_file == NULL) {
+			perror(opt.capture);
+			return 1;
+		}
+	}
+
+	for (uint32_t t = 0; t < opt.threads; t++) {
+		struct worker *w = &workers[t];
+		struct timeval timeout = { .tv_usec = 200000 };
+		int one = 1;
+		int rcvbuf = 8 << 20;
+
+		w->index = t;
+		w->devices = calloc(DEVICES_MAX, sizeof(struct device));
+		w->fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if ((w->devices == NULL) || (w->fd < 0)) {
+			perror("socket");
+			return 1;
+		}
+		(void)setsockopt(w->fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+		(void)setsockopt(w->fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+		(void)setsockopt(w->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+		(void)setsockopt(w->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		if (bind(w->fd, (struct sockaddr *)&opt.addr, sizeof(opt.addr)) < 0) {
+			perror("bind");
+			return 1;
+		}
+		pthread_create(&w->thread, NULL, collect_thread, w);
+	}
+
+	while (!stop) {
+		uint64_t now = now_ns();
+
+		if ((opt.time > 0) && ((now - start) >= (uint64_t)(opt.time * 1e9))) {
+			break;
+		}
+		if (now >= next_report) {
+			collect_report((now - start) / 1e9, (now - reported) / 1e9, last, last_bucket);
+			reported = now;
+			next_report += (uint64_t)(opt.interval * 1e9);
+		}
+		usleep(50000);
+	}
+
+	stop = 1;
+	for (uint32_t t = 0; t < opt.threads; t++) {
+		pthread_join(workers[t].thread, NULL);
+		close(workers[t].fd);
+	}
+
+	end = now_ns();
+	collect_report((end - start) / 1e9, (end - reported) / 1e9, last, last_bucket);
+	devices_report();
+
+	if (capture_file != NULL) {
+		fclose(capture_file);
+	}
+
+	return 0;
+}
+
+/* A periodic datagram with heartbeat, stats and two summaries, a button and a geofence event. */
+static void templates_builtin(void)
+{
+	static uint8_t buf[256];
+	size_t len = 0;
+	size_t start;
+
+	/* Periodic, the records as datagram_begin() and the collectors put them. */
+	start = len;
+	len += 2;
+	buf[len++] = UPLINK_VERSION;
+	buf[len++] = 0;
+	len += 2;
+	buf[len++] = RECORD_HEARTBEAT;
+	buf[len++] = 10;
+	memcpy(&buf[len], "hello from", 10);
+	len += 10;
+	buf[len++] = RECORD_STATS;
+	buf[len++] = STATS_SIZE;
+	len += STATS_SIZE;
+	for (int i = 0; i < 2; i++) {
+		buf[len++] = RECORD_SUMMARY;
+		buf[len++] = SUMMARY_HEADER_SIZE + (3 * SUMMARY_VALUE_SIZE);
+		buf[len] = (uint8_t)i;
+		buf[len + 1] = 3;
+		len += SUMMARY_HEADER_SIZE + (3 * SUMMARY_VALUE_SIZE);
+	}
+	put_le16(&buf[start], (uint16_t)(len - start - 2));
+
+	/* Urgent button press. */
+	start = len;
+	len += 2;
+	buf[len++] = UPLINK_VERSION;
+	buf[len++] = UPLINK_FLAG_URGENT;
+	len += 2;
+	buf[len++] = RECORD_BUTTON;
+	buf[len++] = BUTTON_SIZE;
+	buf[len++] = 1;
+	buf[len++] = 0;
+	put_le16(&buf[start], (uint16_t)(len - start - 2));
+
+	/* Urgent geofence entry. */
+	start = len;
+	len += 2;
+	buf[len++] = UPLINK_VERSION;
+	buf[len++] = UPLINK_FLAG_URGENT;
+	len += 2;
+	buf[len++] = RECORD_GEOFENCE;
+	buf[len++] = GEOFENCE_SIZE;
+	buf[len] = 1;
+	len += GEOFENCE_SIZE;
+	put_le16(&buf[start], (uint16_t)(len - start - 2));
+
+	templates = buf;
+	templates_len = len;
+}
+
+static int templates_load(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	size_t pos = 0;
+	long size;
+
+	if ((f == NULL) || (fseek(f, 0, SEEK_END) != 0) || ((size = ftell(f)) <= 0)) {
+		fprintf(stderr, "%s: cannot read a capture\n", path);
+		return -1;
+	}
+	rewind(f);
+	templates = malloc(size);
+	templates_len = fread(templates, 1, size, f);
+	fclose(f);
+
+	/* Only whole datagrams with a header, the sequence numbers are rewritten. */
+	while ((pos + 2) <= templates_len) {
+		size_t len = get_le16(&templates[pos]);
+
+		if (((pos + 2 + len) > templates_len) || (len < UPLINK_HEADER_SIZE)) {
+			break;
+		}
+		pos += 2 + len;
+	}
+	templates_len = pos;
+	if (templates_len == 0) {
+		fprintf(stderr, "%s: no datagrams\n", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+struct sender {
+	int fd;
+	uint16_t seq[2];
+	size_t template_pos;
+};
+
+static void *load_thread(void *arg)
+{
+	struct worker *w = arg;
+	uint32_t first = (opt.devices * w->index) / opt.threads;
+	uint32_t num = ((opt.devices * (w->index + 1)) / opt.threads) - first;
+	double rate = opt.rate / opt.threads;
+	struct sender *senders = calloc(num, sizeof(*senders));
+	static __thread uint8_t bufs[BATCH_MAX][DATAGRAM_SIZE_MAX];
+	struct mmsghdr msgs[BATCH_MAX];
+	struct iovec iovs[BATCH_MAX];
+	uint64_t start = now_ns();
+	uint32_t next = 0;
+
+	for (uint32_t i = 0; i < num; i++) {
+		senders[i].fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if ((senders[i].fd < 0) ||
+		    (connect(senders[i].fd, (struct sockaddr *)&opt.addr, sizeof(opt.addr)) < 0)) {
+			perror("socket");
+			stop = 1;
+			num = i;
+			break;
+		}
+	}
+
+	while (!stop && (num > 0)) {
+		struct sender *s = &senders[next];
+		uint32_t n = opt.batch;
+		int sent;
+
+		/* Pace to the rate, a batch from one device at a time. */
+		if (rate > 0) {
+			double due = (now_ns() - start) / 1e9 * rate;
+
+			if ((double)w->sent > due) {
+				uint64_t wait = (uint64_t)(((double)w->sent - due) / rate * 1e9);
+
+				struct timespec ts = { .tv_sec = wait / 1000000000u,
+						       .tv_nsec = wait % 1000000000u };
+				nanosleep(&ts, NULL);
+				continue;
+			}
+			if ((due - w->sent + 1) < n) {
+				n = (uint32_t)(due - w->sent + 1);
+			}
+		}
+
+		for (uint32_t i = 0; i < n; i++) {
+			size_t len = get_le16(&templates[s->template_pos]);
+			int lane;
+
+			memcpy(bufs[i], &templates[s->template_pos + 2], len);
+			lane = (bufs[i][1] & UPLINK_FLAG_BURST) ? 1 : 0;
+			put_le16(&bufs[i][2], s->seq[lane]++);
+			s->template_pos += 2 + len;
+			if (s->template_pos >= templates_len) {
+				s->template_pos = 0;
+			}
+
+			iovs[i].iov_base = bufs[i];
+			iovs[i].iov_len = len;
+			memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		sent = sendmmsg(s->fd, msgs, n, 0);
+		if (sent < 0) {
+			w->send_errors++;
+			/* The sequence numbers of the batch are lost as the datagrams would be. */
+		} else {
+			w->sent += sent;
+			w->send_errors += n - sent;
+		}
+
+		next = (next + 1) % num;
+	}
+
+	for (uint32_t i = 0; i < num; i++) {
+		close(senders[i].fd);
+	}
+	free(senders);
+
+	return NULL;
+}
+
+static int load(void)
+{
+	uint64_t last[THREADS_MAX] = { 0 };
+	uint64_t start = now_ns();
+	uint64_t next_report = start + (uint64_t)(opt.interval * 1e9);
+	uint64_t total = 0;
+	uint64_t errors = 0;
+	double elapsed;
+
+	if (opt.replay != NULL) {
+		if (templates_load(opt.replay) != 0) {
+			return 1;
+		}
+	} else {
+		templates_builtin();
+	}
+
+	for (uint32_t t = 0; t < opt.threads; t++) {
+		workers[t].index = t;
+		pthread_create(&workers[t].thread, NULL, load_thread, &workers[t]);
+	}
+
+	while (!stop) {
+		uint64_t now = now_ns();
+
+		if ((opt.time > 0) && ((now - start) >= (uint64_t)(opt.time * 1e9))) {
+			break;
+		}
+		if (now >= next_report) {
+			printf("%.0f s:", (now - start) / 1e9);
+			for (uint32_t t = 0; t < opt.threads; t++) {
+				uint64_t s = workers[t].sent;
+
+				printf(" %.0f", (s - last[t]) / opt.interval);
+				last[t] = s;
+			}
+			printf(" datagrams/s sent per thread\n");
+			next_report += (uint64_t)(opt.interval * 1e9);
+		}
+		usleep(50000);
+	}
+
+	stop = 1;
+	for (uint32_t t = 0; t < opt.threads; t++) {
+		pthread_join(workers[t].thread, NULL);
+		total += workers[t].sent;
+		errors += workers[t].send_errors;
+	}
+
+	elapsed = (now_ns() - start) / 1e9;
+	printf("sent %llu datagrams from %u devices in %.1f s, %.0f datagrams/s, %llu failed\n",
+	       (unsigned long long)total, opt.devices, elapsed, total / elapsed,
+	       (unsigned long long)errors);
+
+	return 0;
+}
+
+static int address_parse(const char *arg, struct sockaddr_in *addr)
+{
+	char host[INET_ADDRSTRLEN];
+	const char *colon = strrchr(arg, ':');
+
+	if ((colon == NULL) || ((size_t)(colon - arg) >= sizeof(host))) {
+		return -1;
+	}
+	memcpy(host, arg, colon - arg);
+	host[colon - arg] = '\0';
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_port = htons((uint16_t)atoi(colon + 1));
+
+	return (inet_pton(AF_INET, host, &addr->sin_addr) == 1) ? 0 : -1;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [--listen HOST:PORT] [--capture FILE] [--top N]\n"
+		"       %s --load HOST:PORT [--rate N] [--devices N] [--replay FILE]\n"
+		"common: [--threads N] [--batch N] [--interval S] [-t S] [-v]\n",
+		name, name);
+}
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stop = 1;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct option options[] = {
+		{ "listen", required_argument, NULL, 'l' },
+		{ "load", required_argument, NULL, 'L' },
+		{ "threads", required_argument, NULL, 'j' },
+		{ "batch", required_argument, NULL, 'b' },
+		{ "interval", required_argument, NULL, 'i' },
+		{ "time", required_argument, NULL, 't' },
+		{ "capture", required_argument, NULL, 'c' },
+		{ "replay", required_argument, NULL, 'r' },
+		{ "rate", required_argument, NULL, 'R' },
+		{ "devices", required_argument, NULL, 'd' },
+		{ "top", required_argument, NULL, 'n' },
+		{ "verbose", no_argument, NULL, 'v' },
+		{ NULL, 0, NULL, 0 },
+	};
+	int c;
+
+	(void)address_parse("0.0.0.0:2469", &opt.addr);
+
+	while ((c = getopt_long(argc, argv, "t:v", options, NULL)) != -1) {
+		switch (c) {
+		case 'l':
+		case 'L':
+			if (address_parse(optarg, &opt.addr) != 0) {
+				fprintf(stderr, "bad address %s\n", optarg);
+				return 2;
+			}
+			opt.load = (c == 'L');
+			break;
+		case 'j':
+			opt.threads = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			opt.batch = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'i':
+			opt.interval = atof(optarg);
+			break;
+		case 't':
+			opt.time = atof(optarg);
+			break;
+		case 'c':
+			opt.capture = optarg;
+			break;
+		case 'r':
+			opt.replay = optarg;
+			break;
+		case 'R':
+			opt.rate = atof(optarg);
+			break;
+		case 'd':
+			opt.devices = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			opt.top = (uint32_t)strtoul(optarg, NULL, 10);
+			break;
+		case 'v':
+			opt.verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if ((optind != argc) || (opt.threads == 0) || (opt.threads > THREADS_MAX) ||
+	    (opt.batch == 0) || (opt.batch > BATCH_MAX) || (opt.interval <= 0) ||
+	    (opt.devices < opt.threads)) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	return opt.load ? load() : collect();
+}
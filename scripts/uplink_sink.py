@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+"""Local server for the uplink over UDP and TCP, to benchmark the transports.
+
+Listens on the same port for plain UDP datagrams and for TCP streams of
+length prefixed datagrams (CONFIG_UDP_TRANSPORT_TCP, see src/uplink_tcp.c).
+Checks the datagram header of src/uplink.h and the sequence numbers, kept
+apart for the filler of "thingy uplink burst", and counts the records.
+
+Every --interval seconds and at the end it prints, per transport, the
+datagrams and bytes per second while traffic was flowing, how many
+datagrams arrived per UDP packet or TCP read, and any sequence gaps or
+malformed frames.
+
+Example, on qemu_x86 at 192.0.2.1, with the host at 192.0.2.2:
+
+    west build -b qemu_x86 -- -DCONFIG_UDP_TRANSPORT_TCP=y \\
+        -DCONFIG_UDP_SERVER_ADDRESS_STATIC=\\"192.0.2.2\\"
+    uplink_sink.py --listen 192.0.2.2:2469
+    uart:~$ thingy uplink burst 1000 200
+"""
+
+import argparse
+import select
+import socket
+import struct
+import time
+
+UPLINK_VERSION = 1
+UPLINK_HEADER = struct.Struct('<BBH')
+FLAG_BURST = 0x02
+FRAME_HEADER = struct.Struct('<H')
+
+
+class Counter:
+    """Traffic of one transport."""
+
+    def __init__(self, name):
+        self.name = name
+        self.datagrams = self.records = self.bytes = self.reads = 0
+        self.gaps = self.malformed = 0
+        self.first = self.last = None
+        self.seq = {}
+
+    def datagram(self, data, source):
+        now = time.monotonic()
+        self.first = self.first or now
+        self.last = now
+        if len(data) < UPLINK_HEADER.size:
+            self.malformed += 1
+            return
+        version, flags, seq = UPLINK_HEADER.unpack_from(data)
+        if version != UPLINK_VERSION:
+            self.malformed += 1
+            return
+        self.datagrams += 1
+        self.bytes += len(data)
+        key = (source, bool(flags & FLAG_BURST))
+        expected = self.seq.get(key)
+        if expected is not None and seq != expected:
+            self.gaps += (seq - expected) & 0xffff
+        self.seq[key] = (seq + 1) & 0xffff
+        pos = UPLINK_HEADER.size
+        while pos + 2 <= len(data):
+            pos += 2 + data[pos + 1]
+            self.records += 1
+        if pos != len(data):
+            self.malformed += 1
+
+    def report(self):
+        if not self.datagrams:
+            return
+        elapsed = max(self.last - self.first, 1e-3)
+        print(f'{self.name}: {self.datagrams} datagrams, {self.records} records, '
+              f'{self.bytes} bytes in {elapsed:.2f} s, {self.datagrams / elapsed:.0f} '
+              f'datagrams/s, {self.bytes / elapsed / 1000:.1f} kB/s, '
+              f'{self.datagrams / max(self.reads, 1):.2f} datagrams per read, '
+              f'{self.gaps} missing, {self.malformed} malformed')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--listen', default='0.0.0.0:2469', metavar='HOST:PORT',
+                        help='address to listen on, UDP and TCP')
+    parser.add_argument('--interval', type=float, default=10,
+                        help='seconds between reports')
+    parser.add_argument('-t', '--time', type=float,
+                        help='seconds to run, until Ctrl-C if not given')
+    args = parser.parse_args()
+
+    host, _, port = args.listen.rpartition(':')
+    udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    udp.bind((host, int(port)))
+    tcp = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    tcp.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    tcp.bind((host, int(port)))
+    tcp.listen(4)
+
+    counters = {'UDP': Counter('UDP'), 'TCP': Counter('TCP')}
+    # Connection to the bytes received and not yet a whole frame.
+    streams = {}
+    next_report = time.monotonic() + args.interval
+    end = time.monotonic() + args.time if args.time else None
+
+    try:
+        while end is None or time.monotonic() < end:
+            if time.monotonic() >= next_report:
+                for counter in counters.values():
+                    counter.report()
+                next_report += args.interval
+            ready, _, _ = select.select([udp, tcp] + list(streams), [], [], 0.5)
+            for sock in ready:
+                if sock is udp:
+                    data, addr = udp.recvfrom(65535)
+                    counters['UDP'].reads += 1
+                    counters['UDP'].datagram(data, addr[0])
+                elif sock is tcp:
+                    conn, addr = tcp.accept()
+                    streams[conn] = (addr, bytearray())
+                    print(f'{addr[0]}:{addr[1]} connected')
+                else:
+                    addr, buf = streams[sock]
+                    try:
+                        data = sock.recv(65535)
+                    except ConnectionResetError:
+                        data = b''
+                    if not data:
+                        if buf:
+                            print(f'{addr[0]}:{addr[1]} closed with a torn frame '
+                                  f'of {len(buf)} bytes')
+                        else:
+                            print(f'{addr[0]}:{addr[1]} closed')
+                        del streams[sock]
+                        sock.close()
+                        continue
+                    counters['TCP'].reads += 1
+                    buf += data
+                    while len(buf) >= FRAME_HEADER.size:
+                        length = FRAME_HEADER.unpack_from(buf)[0]
+                        if len(buf) < FRAME_HEADER.size + length:
+                            break
+                        counters['TCP'].datagram(bytes(buf[FRAME_HEADER.size:
+                                                           FRAME_HEADER.size + length]),
+                                                 addr[0])
+                        del buf[:FRAME_HEADER.size + length]
+    except KeyboardInterrupt:
+        pass
+
+    for counter in counters.values():
+        counter.report()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/*
+ * Simulated arrivals at the collector of a fleet that powers up together,
+ * with the upload slots of src/uplink_slot.c.
+ *
+ *   cc -O2 -Isrc -o uplink_slot_sim scripts/uplink_slot_sim.c src/uplink_slot.c
+ *   ./uplink_slot_sim [devices]
+ *
+ * Every device boots at the same time after a power event and starts the
+ * uplink once LTE is connected, a few seconds to half a minute later. It
+ * then sends as src/uplink.c does: offset ms into each period of 900 s,
+ * the phase of its slot from the hash of its IMEI plus a new jitter every
+ * period. The device clocks are off by up to 20 ppm. Counts the datagrams
+ * reaching the collector in every second of the first hour and prints the
+ * peak, the 99th percentile and the mean per second, and the longest wait
+ * from the LTE connection to the first datagram. Exits non-zero if the
+ * default slots do not cut the peak to a tenth, or leave a device
+ * without a datagram in a period.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "uplink_slot.h"
+
+#define PERIOD_MS    900000
+#define DURATION_MS  (4 * PERIOD_MS)
+#define BIN_MS       1000
+#define BINS         (DURATION_MS / BIN_MS)
+#define DRIFT_PPM    20
+
+/* Time from the power event to the uplink start. */
+#define CONNECT_MIN_MS 3000
+#define CONNECT_SPREAD_MS 30000
+
+#define DEVICES_DEFAULT 10000
+
+struct scenario {
+	const char *name;
+	uint32_t width;
+	uint32_t jitter;
+	/* The defaults of Kconfig, checked against the first scenario. */
+	bool check;
+};
+
+static const struct scenario scenarios[] = {
+	{ "no slots, as before", 0, 0, false },
+	{ "jitter 1 s only", 0, 1000, false },
+	{ "slots 1 s, jitter 1 s", 1000, 1000, true },
+	{ "slots 10 s, jitter 10 s", 10000, 10000, false },
+	{ "slots 100 ms, no jitter", 100, 0, false },
+};
+
+struct result {
+	uint32_t peak;
+	uint32_t p99;
+	double mean;
+	int64_t first_max;
+	bool every_period;
+};
+
+static uint32_t bins[BINS];
+
+static uint64_t rng = 0x9e3779b97f4a7c15ull;
+
+static uint32_t rand32(void)
+{
+	/* xorshift64*, the same sequence on every host. */
+	rng ^= rng >> 12;
+	rng ^= rng << 25;
+	rng ^= rng >> 27;
+
+	return (uint32_t)((rng * 0x2545f4914f6cdd1dull) >> 32);
+}
+
+static int compare(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void run(const struct scenario *sc, uint32_t devices, struct result *res)
+{
+	static uint32_t sorted[BINS];
+	uint64_t total = 0;
+
+	memset(bins, 0, sizeof(bins));
+	memset(res, 0, sizeof(*res));
+	res->every_period = true;
+
+	for (uint32_t d = 0; d < devices; d++) {
+		/* IMEIs of one batch, the serial numbers in a row. */
+		char imei[16];
+		struct uplink_slot slot = { .width = sc->width, .jitter = sc->jitter };
+		int64_t start = CONNECT_MIN_MS + (rand32() % CONNECT_SPREAD_MS);
+		double drift = 1.0 + (((int32_t)(rand32() % (2 * DRIFT_PPM + 1)) - DRIFT_PPM) / 1e6);
+		int64_t last_periodic = start;
+		int64_t last_sent = -1;
+		uint32_t offset;
+		int64_t next;
+
+		snprintf(imei, sizeof(imei), "35265610%07u", 1000000 + d);
+		slot.hash = uplink_slot_hash(imei, strlen(imei));
+
+		/* As uplink_start() and server_transmission_work_fn(), in device time. */
+		offset = uplink_slot_offset(&slot, PERIOD_MS, rand32());
+		next = last_periodic + offset;
+		if ((next - start) > res->first_max) {
+			res->first_max = next - start;
+		}
+
+		for (;;) {
+			int64_t at = (int64_t)(next * drift);
+
+			if (at >= DURATION_MS) {
+				break;
+			}
+			bins[at / BIN_MS]++;
+			if ((last_sent >= 0) && ((at - last_sent) >= (2 * PERIOD_MS))) {
+				res->every_period = false;
+			}
+			last_sent = at;
+
+			last_periodic = next - offset;
+			offset = uplink_slot_offset(&slot, PERIOD_MS, rand32());
+			next = last_periodic + PERIOD_MS + offset;
+		}
+	}
+
+	for (size_t i = 0; i < BINS; i++) {
+		total += bins[i];
+		if (bins[i] > res->peak) {
+			res->peak = bins[i];
+		}
+	}
+
+	memcpy(sorted, bins, sizeof(sorted));
+	qsort(sorted, BINS, sizeof(sorted[0]), compare);
+	res->p99 = sorted[(BINS * 99) / 100];
+	res->mean = (double)total / BINS;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t devices = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : DEVICES_DEFAULT;
+	struct result before = { 0 };
+	bool ok = true;
+
+	if (devices == 0) {
+		fprintf(stderr, "usage: %s [devices]\n", argv[0]);
+		return 2;
+	}
+
+	printf("%u devices, %u s period, connected %u - %u s after power up\n", devices,
+	       PERIOD_MS / 1000, CONNECT_MIN_MS / 1000,
+	       (CONNECT_MIN_MS + CONNECT_SPREAD_MS) / 1000);
+	printf("%-28s %8s %8s %8s %10s\n", "scenario", "peak/s", "p99/s", "mean/s", "first max");
+
+	for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+		const struct scenario *sc = &scenarios[s];
+		struct result res;
+		bool pass = true;
+
+		run(sc, devices, &res);
+		if (s == 0) {
+			before = res;
+		}
+		if (sc->check) {
+			pass = ((res.peak * 10) <= before.peak);
+		}
+		pass &= res.every_period;
+		ok &= pass;
+
+		printf("%-28s %8u %8u %8.1f %8.1f s%s\n", sc->name, res.peak, res.p99, res.mean,
+		       res.first_max / 1000.0, pass ? "" : " FAIL");
+	}
+
+	printf("datagrams per second at the collector over %u s\n", DURATION_MS / 1000);
+	printf("%s\n", ok ? "PASS" : "FAIL");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "aggregate.h"
+#include "isqrt.h"
+
+#define MEAN_ONE (1 << AGGREGATE_MEAN_SHIFT)
+
+static uint64_t mul_sat(uint64_t a, uint64_t b)
+{
+	if ((b != 0) && (a > (UINT64_MAX / b))) {
+		return UINT64_MAX;
+	}
+
+	return a * b;
+}
+
+static uint64_t add_sat(uint64_t a, uint64_t b)
+{
+	return ((a + b) < a) ? UINT64_MAX : (a + b);
+}
+
+/*
+ * Product of two differences of the same sign in Q.AGGREGATE_MEAN_SHIFT,
+ * in units squared. Small ones keep their fraction and are rounded, large
+ * ones lose it, which does not matter next to their square.
+ */
+static uint64_t product(int64_t a, int64_t b)
+{
+	if ((a > -INT32_MAX) && (a < INT32_MAX) && (b > -INT32_MAX) && (b < INT32_MAX)) {
+		int64_t p = a * b;
+
+		return (p <= 0) ? 0 : (((uint64_t)p + (MEAN_ONE * MEAN_ONE / 2)) >>
+				       (2 * AGGREGATE_MEAN_SHIFT));
+	}
+
+	if ((a < 0) != (b < 0)) {
+		return 0;
+	}
+
+	return mul_sat((a < 0) ? (uint64_t)(-a / MEAN_ONE) : (uint64_t)(a / MEAN_ONE),
+		       (b < 0) ? (uint64_t)(-b / MEAN_ONE) : (uint64_t)(b / MEAN_ONE));
+}
+
+void aggregate_reset(struct aggregate *agg)
+{
+	agg->count = 0;
+	agg->min = INT32_MAX;
+	agg->max = INT32_MIN;
+	agg->mean = 0;
+	agg->m2 = 0;
+}
+
+void aggregate_add(struct aggregate *agg, int32_t value)
+{
+	int64_t x = (int64_t)value * MEAN_ONE;
+	int64_t d1 = x - agg->mean;
+	int64_t n;
+
+	agg->count++;
+	n = agg->count;
+	/* Rounded, truncation would bias the mean by up to count LSB. */
+	agg->mean += (d1 + ((d1 < 0) ? -(n / 2) : (n / 2))) / n;
+	agg->m2 = add_sat(agg->m2, product(d1, x - agg->mean));
+
+	if (value < agg->min) {
+		agg->min = value;
+	}
+	if (value > agg->max) {
+		agg->max = value;
+	}
+}
+
+void aggregate_merge(struct aggregate *into, const struct aggregate *from)
+{
+	uint64_t n = (uint64_t)into->count + from->count;
+	int64_t delta;
+
+	if (from->count == 0) {
+		return;
+	}
+	if (into->count == 0) {
+		*into = *from;
+		return;
+	}
+
+	/* Chan et al.: mean += delta nb / n, m2 += m2b + delta^2 na nb / n. */
+	delta = from->mean - into->mean;
+	into->m2 = add_sat(into->m2, from->m2);
+	into->m2 = add_sat(into->m2, mul_sat(mul_sat(product(delta, delta), into->count) / n,
+					      from->count));
+	into->mean += ((delta / (int64_t)n) * from->count) +
+		      (((delta % (int64_t)n) * from->count) / (int64_t)n);
+
+	into->count = (uint32_t)n;
+	if (from->min < into->min) {
+		into->min = from->min;
+	}
+	if (from->max > into->max) {
+		into->max = from->max;
+	}
+}
+
+int32_t aggregate_mean(const struct aggregate *agg)
+{
+	int64_t mean = agg->mean;
+
+	/* Round half away from zero, an arithmetic shift would round -0.5 up. */
+	mean = (mean < 0) ? -((-mean + (MEAN_ONE / 2)) / MEAN_ONE) :
+			    ((mean + (MEAN_ONE / 2)) / MEAN_ONE);
+
+	return (int32_t)mean;
+}
+
+uint32_t aggregate_stddev(const struct aggregate *agg)
+{
+	if (agg->count == 0) {
+		return 0;
+	}
+
+	return isqrt64(agg->m2 / agg->count);
+}
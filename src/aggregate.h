@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef AGGREGATE_H__
+#define AGGREGATE_H__
+
+/* Plain C without Zephyr headers, so scripts/aggregate_check.c can build it on the host. */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Fraction bits of the running mean. */
+#define AGGREGATE_MEAN_SHIFT 8
+
+/**
+ * @brief Running min, max, mean and variance of a series, in constant memory.
+ *
+ * Welford's update in fixed point, so there is no cancellation between
+ * large sums. Values are in any integer unit, e.g. the thousandths of the
+ * sensor manager. Counts should stay below 2^24 per aggregate.
+ */
+struct aggregate {
+	uint32_t count;
+	int32_t min;
+	int32_t max;
+	/* Mean, Q.AGGREGATE_MEAN_SHIFT. */
+	int64_t mean;
+	/* Sum of squared differences from the mean, in units squared. */
+	uint64_t m2;
+};
+
+/**
+ * @brief Empty an aggregate.
+ */
+void aggregate_reset(struct aggregate *agg);
+
+/**
+ * @brief Add a value.
+ */
+void aggregate_add(struct aggregate *agg, int32_t value);
+
+/**
+ * @brief Add all values of another aggregate, as if they had been added one by one.
+ *
+ * @param[in,out] into The aggregate to add to.
+ * @param from The aggregate to add.
+ */
+void aggregate_merge(struct aggregate *into, const struct aggregate *from);
+
+/**
+ * @brief Get the mean, rounded.
+ */
+int32_t aggregate_mean(const struct aggregate *agg);
+
+/**
+ * @brief Get the population standard deviation, rounded down.
+ */
+uint32_t aggregate_stddev(const struct aggregate *agg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AGGREGATE_H__ */
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "cycles.h"
+#include "ui_led.h"
+#include "ui_rgb_control.h"
+
+static uint32_t samples[CONFIG_BENCH_REPETITIONS];
+
+/* Cost of timing an empty function, taken off every result. */
+static uint32_t overhead;
+static bool calibrated;
+
+static int sample_compare(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void bench_sample(const struct bench *bench, struct bench_result *result)
+{
+	uint32_t start;
+
+	for (size_t i = 0; i < CONFIG_BENCH_WARMUP; i++) {
+		if (bench->setup) {
+			bench->setup();
+		}
+		bench->fn();
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(samples); i++) {
+		if (bench->setup) {
+			bench->setup();
+		}
+		start = cycles_get();
+		bench->fn();
+		samples[i] = cycles_get() - start;
+	}
+
+	if (bench->teardown) {
+		bench->teardown();
+	}
+
+	qsort(samples, ARRAY_SIZE(samples), sizeof(samples[0]), sample_compare);
+
+	result->min = samples[0];
+	result->median = samples[ARRAY_SIZE(samples) / 2];
+	result->max = samples[ARRAY_SIZE(samples) - 1];
+	result->repetitions = ARRAY_SIZE(samples);
+}
+
+static void bench_empty(void)
+{
+	compiler_barrier();
+}
+
+void bench_run(const struct bench *bench, struct bench_result *result)
+{
+	cycles_enable();
+
+	if (!calibrated) {
+		const struct bench empty = { .name = "empty", .fn = bench_empty };
+
+		bench_sample(&empty, result);
+		overhead = result->min;
+		calibrated = true;
+	}
+
+	bench_sample(bench, result);
+
+	result->min -= MIN(result->min, overhead);
+	result->median -= MIN(result->median, overhead);
+	result->max -= MIN(result->max, overhead);
+}
+
+const struct bench *bench_find(const char *name)
+{
+	BENCH_FOREACH(bench) {
+		if (strcmp(bench->name, name) == 0) {
+			return bench;
+		}
+	}
+
+	return NULL;
+}
+
+/* Benchmarks of kernel and public UI calls, the others live next to their code. */
+
+K_MSGQ_DEFINE(bench_msgq, sizeof(uint32_t), 4, 4);
+
+static void bench_msgq_setup(void)
+{
+	k_msgq_purge(&bench_msgq);
+}
+
+static void bench_msgq_put(void)
+{
+	uint32_t data = 0;
+
+	(void)k_msgq_put(&bench_msgq, &data, K_NO_WAIT);
+}
+
+BENCH_DEFINE(k_msgq_put, bench_msgq_setup, bench_msgq_put, bench_msgq_setup);
+
+/* Same path as ui_rgb_control_set, on the shell layer so the base pattern survives. */
+static void bench_rgb_control_set(void)
+{
+	struct ui_rgb_control_color color = { .green = 255 };
+	struct ui_rgb_control_effect effect = { .type = UI_RGB_CONTROL_TYPE_CONTINUE };
+
+	(void)ui_rgb_control_layer_set(UI_RGB_CONTROL_LAYER_SHELL, color, effect);
+}
+
+static void bench_rgb_control_teardown(void)
+{
+	(void)ui_rgb_control_layer_clear(UI_RGB_CONTROL_LAYER_SHELL);
+}
+
+BENCH_DEFINE(ui_rgb_control_set, NULL, bench_rgb_control_set, bench_rgb_control_teardown);
+
+#if defined(CONFIG_UI_LED_USE_PWM)
+static void bench_led_pwm_set_intensity(void)
+{
+	static uint8_t intensity;
+
+	(void)ui_led_pwm_set_intensity(0, intensity++);
+}
+
+/* Make the rgb control write all LEDs again, it only writes what changed. */
+static void bench_led_pwm_teardown(void)
+{
+	struct ui_rgb_control_color color = { 0 };
+	struct ui_rgb_control_effect effect = { .type = UI_RGB_CONTROL_TYPE_CONTINUE };
+
+	(void)ui_rgb_control_layer_set(UI_RGB_CONTROL_LAYER_SHELL, color, effect);
+	k_sleep(K_MSEC(10));
+	(void)ui_rgb_control_layer_clear(UI_RGB_CONTROL_LAYER_SHELL);
+}
+
+BENCH_DEFINE(ui_led_pwm_set_intensity, NULL, bench_led_pwm_set_intensity,
+	     bench_led_pwm_teardown);
+#endif
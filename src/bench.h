@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef BENCH_H__
+#define BENCH_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief A registered microbenchmark. */
+struct bench {
+	const char *name;
+
+	/* Called before every timed run, not timed itself. May be NULL. */
+	void (*setup)(void);
+
+	/* The code under test. */
+	void (*fn)(void);
+
+	/* Called once after the last run. May be NULL. */
+	void (*teardown)(void);
+};
+
+/** @brief Cycle counts of one benchmark, the call overhead taken off. */
+struct bench_result {
+	uint32_t min;
+	uint32_t median;
+	uint32_t max;
+	uint32_t repetitions;
+};
+
+/**
+ * @brief Register a benchmark.
+ *
+ * Benchmarks are collected in a linker section, so they can be defined next
+ * to the static functions they measure.
+ */
+#define BENCH_DEFINE(_name, _setup, _fn, _teardown)		\
+	const STRUCT_SECTION_ITERABLE(bench, bench_##_name) = {	\
+		.name = #_name,					\
+		.setup = _setup,				\
+		.fn = _fn,					\
+		.teardown = _teardown,				\
+	}
+
+/** @brief Iterate over all registered benchmarks. */
+#define BENCH_FOREACH(_bench) STRUCT_SECTION_FOREACH(bench, _bench)
+
+/**
+ * @brief Run a benchmark.
+ *
+ * Runs CONFIG_BENCH_WARMUP untimed iterations, then times
+ * CONFIG_BENCH_REPETITIONS with the DWT cycle counter, or k_cycle_get_32
+ * where there is none.
+ *
+ * @param bench The benchmark.
+ * @param[out] result Cycle counts.
+ */
+void bench_run(const struct bench *bench, struct bench_result *result);
+
+/**
+ * @brief Look up a benchmark by name.
+ *
+ * @return const struct bench* The benchmark, NULL if there is none.
+ */
+const struct bench *bench_find(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCH_H__ */
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef CYCLES_H__
+#define CYCLES_H__
+
+#include <zephyr/kernel.h>
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+#include <zephyr/arch/arm/aarch32/cortex_m/cmsis.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * CPU cycle counter for timing short code paths. The DWT counter runs at the
+ * core clock where there is one, k_cycle_get_32() is used elsewhere, e.g. on
+ * native_sim.
+ */
+
+static inline void cycles_enable(void)
+{
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+static inline uint32_t cycles_get(void)
+{
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+	return DWT->CYCCNT;
+#else
+	return k_cycle_get_32();
+#endif
+}
+
+static inline uint32_t cycles_per_sec(void)
+{
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+	return SystemCoreClock;
+#else
+	return sys_clock_hw_cycles_per_sec();
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CYCLES_H__ */
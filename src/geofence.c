@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+
+#include "geofence.h"
+
+_Static_assert(sizeof(struct geofence_header) == 36, "Header does not match the blob");
+_Static_assert(sizeof(struct geofence_fence) == 24, "Fence does not match the blob");
+
+/* Degrees in 1e-7, the range keeps the products in geofence_index_contains() within 63 bits. */
+#define LAT_MAX 900000000
+#define LON_MAX 1800000000
+
+static bool fences_valid(const struct geofence_index *index)
+{
+	const struct geofence_header *header = index->header;
+
+	for (size_t i = 0; i < header->num_vertices; i++) {
+		const struct geofence_vertex *v = &index->vertices[i];
+
+		if ((v->lat < -LAT_MAX) || (v->lat > LAT_MAX) ||
+		    (v->lon < -LON_MAX) || (v->lon > LON_MAX)) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < header->num_fences; i++) {
+		const struct geofence_fence *fence = &index->fences[i];
+
+		if ((fence->num_vertices < 3) ||
+		    (fence->first_vertex > header->num_vertices) ||
+		    (fence->num_vertices > (header->num_vertices - fence->first_vertex))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool grid_valid(const struct geofence_index *index)
+{
+	const struct geofence_header *header = index->header;
+	size_t num_cells = (size_t)header->grid_rows * header->grid_cols;
+
+	if ((index->cells[0] != 0) || (index->cells[num_cells] != header->num_refs)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < num_cells; i++) {
+		if (index->cells[i] > index->cells[i + 1]) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < header->num_refs; i++) {
+		if (index->refs[i] >= header->num_fences) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int geofence_index_load(struct geofence_index *index, const void *blob, size_t len)
+{
+	const uint8_t *pos = blob;
+	const struct geofence_header *header = blob;
+	uint64_t size;
+
+	if ((((uintptr_t)blob % 4) != 0) || (len < sizeof(*header)) ||
+	    (header->magic != GEOFENCE_MAGIC) || (header->version != GEOFENCE_VERSION) ||
+	    (header->grid_rows == 0) || (header->grid_cols == 0) ||
+	    (header->cell_lat == 0) || (header->cell_lon == 0)) {
+		return -EINVAL;
+	}
+
+	/* In 64 bits, the counts of a malformed blob could overflow a size_t. */
+	size = sizeof(*header) + ((uint64_t)header->num_fences * sizeof(struct geofence_fence)) +
+	       ((uint64_t)header->num_vertices * sizeof(struct geofence_vertex)) +
+	       ((((uint64_t)header->grid_rows * header->grid_cols) + 1) * sizeof(uint32_t)) +
+	       ((uint64_t)header->num_refs * sizeof(uint16_t));
+	if (size > len) {
+		return -EINVAL;
+	}
+
+	pos += sizeof(*header);
+	index->header = header;
+	index->fences = (const struct geofence_fence *)pos;
+	pos += header->num_fences * sizeof(struct geofence_fence);
+	index->vertices = (const struct geofence_vertex *)pos;
+	pos += header->num_vertices * sizeof(struct geofence_vertex);
+	index->cells = (const uint32_t *)pos;
+	pos += (((size_t)header->grid_rows * header->grid_cols) + 1) * sizeof(uint32_t);
+	index->refs = (const uint16_t *)pos;
+
+	if (!fences_valid(index) || !grid_valid(index)) {
+		index->header = NULL;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+size_t geofence_index_count(const struct geofence_index *index)
+{
+	return (index->header != NULL) ? index->header->num_fences : 0;
+}
+
+bool geofence_index_contains(const struct geofence_index *index, size_t fence, int32_t lat,
+			     int32_t lon)
+{
+	const struct geofence_fence *f = &index->fences[fence];
+	const struct geofence_vertex *v = &index->vertices[f->first_vertex];
+	const struct geofence_vertex *a = &v[f->num_vertices - 1];
+	bool inside = false;
+
+	if ((lat < f->min.lat) || (lat > f->max.lat) || (lon < f->min.lon) || (lon > f->max.lon)) {
+		return false;
+	}
+
+	/*
+	 * Count the edges crossing the ray going east of the point. The edge
+	 * from a to b crosses it if the point is west of the edge at its
+	 * latitude, cross multiplied so there is no division. With the
+	 * coordinates in range, differences of latitudes take 31 bits and
+	 * of longitudes 32, their products 63.
+	 */
+	for (size_t i = 0; i < f->num_vertices; i++) {
+		const struct geofence_vertex *b = &v[i];
+
+		if ((a->lat > lat) != (b->lat > lat)) {
+			int64_t dlat = (int64_t)b->lat - a->lat;
+			int64_t lhs = ((int64_t)lon - a->lon) * dlat;
+			int64_t rhs = ((int64_t)lat - a->lat) * ((int64_t)b->lon - a->lon);
+
+			if ((dlat > 0) ? (lhs < rhs) : (lhs > rhs)) {
+				inside = !inside;
+			}
+		}
+		a = b;
+	}
+
+	return inside;
+}
+
+size_t geofence_index_lookup(const struct geofence_index *index, int32_t lat, int32_t lon,
+			     uint16_t *found, size_t max)
+{
+	const struct geofence_header *header = index->header;
+	int64_t row;
+	int64_t col;
+	size_t cell;
+	size_t num = 0;
+
+	if (header == NULL) {
+		return 0;
+	}
+
+	row = ((int64_t)lat - header->origin_lat) / header->cell_lat;
+	col = ((int64_t)lon - header->origin_lon) / header->cell_lon;
+	if ((lat < header->origin_lat) || (lon < header->origin_lon) ||
+	    (row >= header->grid_rows) || (col >= header->grid_cols)) {
+		return 0;
+	}
+
+	cell = ((size_t)row * header->grid_cols) + (size_t)col;
+	for (uint32_t i = index->cells[cell]; (i < index->cells[cell + 1]) && (num < max); i++) {
+		if (geofence_index_contains(index, index->refs[i], lat, lon)) {
+			found[num++] = index->refs[i];
+		}
+	}
+
+	return num;
+}
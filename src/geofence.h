@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef GEOFENCE_H__
+#define GEOFENCE_H__
+
+/* Plain C without Zephyr headers, so scripts/geofence_bench.c can build it on the host. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Geofence blob, made by scripts/geofence_compile.py
+ *
+ * Little endian, 4 byte aligned. Coordinates are latitude and longitude in
+ * 1e-7 degrees, fences must not cross the antimeridian. In order:
+ *
+ * - struct geofence_header
+ * - num_fences struct geofence_fence
+ * - num_vertices struct geofence_vertex, the polygons one after another
+ * - (grid_rows * grid_cols + 1) u32, where the fence list of every grid
+ *   cell starts, row by row, the last one is where the lists end
+ * - num_refs u16, the fence lists, indexes into the fence table
+ *
+ * The grid covers the bounding box of all fences. Every fence is listed in
+ * each cell its bounding box overlaps, so a lookup only tests the fences
+ * of one cell.
+ */
+#define GEOFENCE_MAGIC   0x4647
+#define GEOFENCE_VERSION 1
+
+struct geofence_header {
+	uint16_t magic;
+	uint8_t version;
+	uint8_t reserved;
+	uint16_t num_fences;
+	uint16_t grid_rows;
+	uint16_t grid_cols;
+	uint16_t reserved2;
+	/* South west corner of the grid and the size of a cell. */
+	int32_t origin_lat;
+	int32_t origin_lon;
+	uint32_t cell_lat;
+	uint32_t cell_lon;
+	uint32_t num_vertices;
+	uint32_t num_refs;
+};
+
+struct geofence_vertex {
+	int32_t lat;
+	int32_t lon;
+};
+
+struct geofence_fence {
+	uint16_t id;
+	uint16_t num_vertices;
+	uint32_t first_vertex;
+	/* Bounding box. */
+	struct geofence_vertex min;
+	struct geofence_vertex max;
+};
+
+/** @brief A loaded blob, it points into the blob and does not copy it. */
+struct geofence_index {
+	const struct geofence_header *header;
+	const struct geofence_fence *fences;
+	const struct geofence_vertex *vertices;
+	const uint32_t *cells;
+	const uint16_t *refs;
+};
+
+/**
+ * @brief Check a blob and index it.
+ *
+ * @param[out] index The index, it refers to the blob, which must stay.
+ * @param blob The blob, 4 byte aligned.
+ * @param len Length of the blob.
+ * @return int 0 if successful, -EINVAL if the blob is malformed.
+ */
+int geofence_index_load(struct geofence_index *index, const void *blob, size_t len);
+
+/**
+ * @brief Get the number of fences.
+ */
+size_t geofence_index_count(const struct geofence_index *index);
+
+/**
+ * @brief Check whether a fence contains a point.
+ *
+ * Even-odd rule, in integers only. A point right on the boundary may
+ * count as inside or outside.
+ *
+ * @param fence Index of the fence in the fence table.
+ */
+bool geofence_index_contains(const struct geofence_index *index, size_t fence, int32_t lat,
+			     int32_t lon);
+
+/**
+ * @brief Find the fences containing a point.
+ *
+ * @param[out] found Indexes of the fences in the fence table.
+ * @param max Length of found, further fences are not reported.
+ * @return size_t Number of fences found.
+ */
+size_t geofence_index_lookup(const struct geofence_index *index, int32_t lat, int32_t lon,
+			     uint16_t *found, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GEOFENCE_H__ */
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+#include "geofence_mgr.h"
+#include "uplink.h"
+#include "perf_stats.h"
+#include "cycles.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(geofence_mgr, CONFIG_UDP_LOG_LEVEL);
+
+#define INSIDE_MAX CONFIG_GEOFENCE_INSIDE_MAX
+#define DWELL_MS   (CONFIG_GEOFENCE_DWELL_SECONDS * MSEC_PER_SEC)
+
+/* A fence the device is in, by id so it survives loading new fences. */
+struct inside_fence {
+	uint16_t id;
+	bool dwelled;
+	int64_t since;
+};
+
+PERF_WORK_DEFINE(geofence_work);
+
+/* Guards the newest fix, which the GNSS event handler writes. */
+static struct k_spinlock fix_lock;
+static double fix_lat;
+static double fix_lon;
+static int64_t fix_time;
+static bool fix_pending;
+
+/* Guards the fences, the state and the counters. */
+static K_MUTEX_DEFINE(geofence_lock);
+
+static struct geofence_index geofences;
+static uint8_t blob[CONFIG_GEOFENCE_BLOB_SIZE] __aligned(4);
+
+static struct inside_fence inside[INSIDE_MAX];
+static size_t num_inside;
+
+static struct geofence_mgr_stats stats;
+
+static int32_t degrees_fixed(double deg)
+{
+	deg *= 10000000.0;
+
+	return (int32_t)((deg < 0) ? (deg - 0.5) : (deg + 0.5));
+}
+
+static void event_send(enum geofence_event event, uint16_t id, int32_t lat, int32_t lon,
+		       int64_t origin)
+{
+	uint8_t record[GEOFENCE_RECORD_SIZE];
+	int err;
+
+	record[0] = event;
+	sys_put_le16(id, &record[1]);
+	sys_put_le32(lat, &record[3]);
+	sys_put_le32(lon, &record[7]);
+
+	err = uplink_send_urgent(UPLINK_RECORD_GEOFENCE, record, sizeof(record), origin);
+	if (err) {
+		LOG_WRN("Sending geofence %u event %d failed (%d)", id, event, err);
+		stats.lost++;
+	}
+
+	switch (event) {
+	case GEOFENCE_ENTER:
+		stats.enters++;
+		break;
+	case GEOFENCE_EXIT:
+		stats.exits++;
+		break;
+	case GEOFENCE_DWELL:
+		stats.dwells++;
+		break;
+	}
+}
+
+static bool ids_contain(const uint16_t *ids, size_t num, uint16_t id)
+{
+	for (size_t i = 0; i < num; i++) {
+		if (ids[i] == id) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static size_t lookup_ids(int32_t lat, int32_t lon, uint16_t *ids, size_t max)
+{
+	size_t num = geofence_index_lookup(&geofences, lat, lon, ids, max);
+
+	for (size_t i = 0; i < num; i++) {
+		ids[i] = geofences.fences[ids[i]].id;
+	}
+
+	return num;
+}
+
+static void geofence_work_fn(struct k_work *work)
+{
+	uint16_t found[INSIDE_MAX];
+	k_spinlock_key_t key;
+	double lat_deg;
+	double lon_deg;
+	int64_t origin;
+	int64_t now;
+	int32_t lat;
+	int32_t lon;
+	uint32_t start;
+	uint32_t cycles;
+	size_t num;
+	bool pending;
+
+	key = k_spin_lock(&fix_lock);
+	pending = fix_pending;
+	lat_deg = fix_lat;
+	lon_deg = fix_lon;
+	origin = fix_time;
+	fix_pending = false;
+	k_spin_unlock(&fix_lock, key);
+
+	if (!pending || (lat_deg < -90.0) || (lat_deg > 90.0) ||
+	    (lon_deg < -180.0) || (lon_deg > 180.0)) {
+		return;
+	}
+
+	lat = degrees_fixed(lat_deg);
+	lon = degrees_fixed(lon_deg);
+	now = k_uptime_get();
+
+	k_mutex_lock(&geofence_lock, K_FOREVER);
+
+	start = cycles_get();
+	num = lookup_ids(lat, lon, found, ARRAY_SIZE(found));
+	cycles = cycles_get() - start;
+
+	stats.fixes++;
+	stats.lookup_cycles_last = cycles;
+	stats.lookup_cycles_max = MAX(stats.lookup_cycles_max, cycles);
+	stats.lookup_cycles_total += cycles;
+
+	/* Exits first, they make room for the enters. */
+	for (size_t i = 0; i < num_inside;) {
+		if (ids_contain(found, num, inside[i].id)) {
+			i++;
+			continue;
+		}
+		event_send(GEOFENCE_EXIT, inside[i].id, lat, lon, origin);
+		inside[i] = inside[--num_inside];
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		bool known = false;
+
+		for (size_t k = 0; k < num_inside; k++) {
+			known |= (inside[k].id == found[i]);
+		}
+		if (known) {
+			continue;
+		}
+		if (num_inside == ARRAY_SIZE(inside)) {
+			stats.lost++;
+			continue;
+		}
+		inside[num_inside++] = (struct inside_fence){ .id = found[i], .since = now };
+		event_send(GEOFENCE_ENTER, found[i], lat, lon, origin);
+	}
+
+	for (size_t i = 0; (DWELL_MS > 0) && (i < num_inside); i++) {
+		if (!inside[i].dwelled && ((now - inside[i].since) >= DWELL_MS)) {
+			inside[i].dwelled = true;
+			event_send(GEOFENCE_DWELL, inside[i].id, lat, lon, origin);
+		}
+	}
+
+	stats.inside = num_inside;
+
+	k_mutex_unlock(&geofence_lock);
+}
+
+void geofence_mgr_fix(double lat, double lon)
+{
+	k_spinlock_key_t key = k_spin_lock(&fix_lock);
+
+	fix_lat = lat;
+	fix_lon = lon;
+	fix_time = k_uptime_get();
+	fix_pending = true;
+
+	k_spin_unlock(&fix_lock, key);
+
+	perf_work_reschedule(&geofence_work, K_NO_WAIT);
+}
+
+int geofence_mgr_load(const void *data, size_t len)
+{
+	int err;
+
+	if (len > sizeof(blob)) {
+		return -ENOMEM;
+	}
+
+	k_mutex_lock(&geofence_lock, K_FOREVER);
+
+	memcpy(blob, data, len);
+	err = geofence_index_load(&geofences, blob, len);
+	if (err) {
+		/* The copy overwrote the fences, fall back to the built-in ones. */
+		LOG_ERR("Malformed geofence blob, using the built-in fences");
+		(void)geofence_index_load(&geofences, geofence_builtin, geofence_builtin_size);
+	}
+	stats.fences = geofence_index_count(&geofences);
+
+	k_mutex_unlock(&geofence_lock);
+
+	return err;
+}
+
+size_t geofence_mgr_check(int32_t lat, int32_t lon, uint16_t *ids, size_t max)
+{
+	size_t num;
+
+	k_mutex_lock(&geofence_lock, K_FOREVER);
+	num = lookup_ids(lat, lon, ids, max);
+	k_mutex_unlock(&geofence_lock);
+
+	return num;
+}
+
+void geofence_mgr_stats_get(struct geofence_mgr_stats *out)
+{
+	k_mutex_lock(&geofence_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&geofence_lock);
+}
+
+static int geofence_mgr_init(const struct device *dev)
+{
+	int err;
+
+	ARG_UNUSED(dev);
+
+	perf_work_init(&geofence_work, geofence_work_fn);
+	cycles_enable();
+
+	err = geofence_index_load(&geofences, geofence_builtin, geofence_builtin_size);
+	if (err) {
+		LOG_ERR("Malformed built-in geofences (%d)", err);
+		return err;
+	}
+	stats.fences = geofence_index_count(&geofences);
+
+	return 0;
+}
+
+SYS_INIT(geofence_mgr_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
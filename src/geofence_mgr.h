@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef GEOFENCE_MGR_H__
+#define GEOFENCE_MGR_H__
+
+#include <zephyr/kernel.h>
+
+#include "geofence.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Uplink record
+ *
+ * Sent urgently on every event. Little endian: event (u8), fence id (u16),
+ * latitude and longitude of the fix in 1e-7 degrees (s32 each).
+ */
+#define GEOFENCE_RECORD_SIZE 11
+
+enum geofence_event {
+	GEOFENCE_ENTER = 1,
+	GEOFENCE_EXIT,
+	/* Still inside CONFIG_GEOFENCE_DWELL_SECONDS after entering. */
+	GEOFENCE_DWELL,
+};
+
+/* The blob compiled from geofences/ into flash. */
+extern const uint8_t geofence_builtin[];
+extern const size_t geofence_builtin_size;
+
+/** @brief Counters of the geofencing. */
+struct geofence_mgr_stats {
+	uint32_t fences;
+	uint32_t fixes;
+	/* CPU cycles of the lookups, see cycles.h for the rate. */
+	uint32_t lookup_cycles_last;
+	uint32_t lookup_cycles_max;
+	uint64_t lookup_cycles_total;
+	uint32_t enters;
+	uint32_t exits;
+	uint32_t dwells;
+	/* Events the uplink had no room for, or fences beyond CONFIG_GEOFENCE_INSIDE_MAX. */
+	uint32_t lost;
+	uint8_t inside;
+};
+
+/**
+ * @brief Check a GNSS fix against the fences.
+ *
+ * Only notes the fix, the lookup runs on the system work queue, so it can
+ * be called from the GNSS event handler.
+ *
+ * @param lat Latitude in degrees.
+ * @param lon Longitude in degrees.
+ */
+void geofence_mgr_fix(double lat, double lon);
+
+/**
+ * @brief Replace the fences, e.g. with a blob from the downlink.
+ *
+ * The blob is copied. Fences keep their state by id, so a fence that is
+ * gone reports an exit on the next fix.
+ *
+ * @param blob Blob made by scripts/geofence_compile.py --binary.
+ * @param len Length of the blob.
+ * @return int 0 if successful, -ENOMEM if it is larger than
+ *             CONFIG_GEOFENCE_BLOB_SIZE, -EINVAL if it is malformed.
+ */
+int geofence_mgr_load(const void *blob, size_t len);
+
+/**
+ * @brief Find the fences containing a point, without reporting events.
+ *
+ * @param lat Latitude in 1e-7 degrees.
+ * @param lon Longitude in 1e-7 degrees.
+ * @param[out] ids Ids of the fences.
+ * @param max Length of ids.
+ * @return size_t Number of fences found.
+ */
+size_t geofence_mgr_check(int32_t lat, int32_t lon, uint16_t *ids, size_t max);
+
+/**
+ * @brief Get the counters.
+ *
+ * @param[out] stats Counters.
+ */
+void geofence_mgr_stats_get(struct geofence_mgr_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GEOFENCE_MGR_H__ */
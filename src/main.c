@@ -6,22 +6,22 @@
 
 #include <zephyr/kernel.h>
 #include <stdio.h>
+#include <string.h>
 #include <modem/lte_lc.h>
-#include <zephyr/net/socket.h>
 #include <nrf_modem_gnss.h>
 #include "ui_led.h"
 #include "ui_buzzer.h"
-#include <dk_buttons_and_leds.h>
+#include "ui_input.h"
 #include "ui_rgb_control.h"
+#include "uplink.h"
+#include "bench.h"
+#include "perf_stats.h"
+#include "motion.h"
+#include "sample_coord.h"
+#include "geofence_mgr.h"
 
 LOG_MODULE_REGISTER(main, 3);
 
-#define UDP_IP_HEADER_SIZE 28
-
-static int client_fd;
-static struct sockaddr_storage host_addr;
-static struct k_work_delayable server_transmission_work;
-
 K_SEM_DEFINE(lte_connected, 0, 1);
 
 
@@ -32,7 +32,7 @@ K_THREAD_STACK_DEFINE(user_work_q_stack, USER_WORK_Q_STACK_SIZE);
 static struct k_work_q user_work_q;
 
 /*gnss*/
-static struct k_work_delayable gnss_data_process_dwork;
+PERF_WORK_DEFINE(gnss_data_process_dwork);
 
 static struct k_work_delayable multi_cell_request_dwork;
 
@@ -51,35 +51,15 @@ static uint8_t colour_val[NUM_LEDS];
 #define FREQUENCY_START_VAL 440U
 
 /* test */
-static struct k_work_delayable ui_test;
-
-
-static void server_transmission_work_fn(struct k_work *work)
-{
-	int err;
-	char buffer[CONFIG_UDP_DATA_UPLOAD_SIZE_BYTES] = {"hello from thingy\0"};
+PERF_WORK_DEFINE(ui_test);
 
-	printk("Transmitting UDP/IP payload of %d bytes to the ",
-	       CONFIG_UDP_DATA_UPLOAD_SIZE_BYTES + UDP_IP_HEADER_SIZE);
-	printk("IP address %s, port number %d\n",
-	       CONFIG_UDP_SERVER_ADDRESS_STATIC,
-	       CONFIG_UDP_SERVER_PORT);
+/*motion*/
+#if defined(CONFIG_MOTION)
+PERF_WORK_DEFINE(motion_state_work);
 
-	err = send(client_fd, buffer, sizeof(buffer), 0);
-	if (err < 0) {
-		printk("Failed to transmit UDP packet, %d\n", errno);
-		return;
-	}
+static atomic_t moving;
+#endif
 
-	k_work_schedule(&server_transmission_work,
-			K_SECONDS(CONFIG_UDP_DATA_UPLOAD_FREQUENCY_SECONDS));
-}
-
-static void work_init(void)
-{
-	k_work_init_delayable(&server_transmission_work,
-			      server_transmission_work_fn);
-}
 
 #if defined(CONFIG_NRF_MODEM_LIB)
 static void lte_handler(const struct lte_lc_evt *const evt)
@@ -121,6 +101,12 @@ static void lte_handler(const struct lte_lc_evt *const evt)
 		printk("LTE cell changed: Cell ID: %d, Tracking area: %d\n",
 		       evt->cell.id, evt->cell.tac);
 		break;
+#if defined(CONFIG_SAMPLE_COORD)
+	case LTE_LC_EVT_MODEM_SLEEP_EXIT:
+		/* The CPU is awake for the modem anyway, sample now if the uplink is near. */
+		sample_coord_modem_wake();
+		break;
+#endif
 	default:
 		break;
 	}
@@ -187,6 +173,12 @@ static void modem_init(void)
 
 	nrf_modem_at_cmd(at_buf, sizeof(at_buf), "AT+CGMR");
 	printk("Current modem firmware version: %s\n", at_buf);	
+
+	/* The IMEI picks the upload slot, the same one on every boot. */
+	err = nrf_modem_at_cmd(at_buf, sizeof(at_buf), "AT+CGSN");
+	if (err == 0) {
+		uplink_device_id_set(at_buf, strspn((char *)at_buf, "0123456789"));
+	}
 }
 
 static void modem_connect(void)
@@ -206,64 +198,85 @@ static void modem_connect(void)
 }
 #endif
 
-static void server_disconnect(void)
+/*victor add functions */
+
+static void gnss_data_process_dwork_fn(struct k_work *work)
 {
-	(void)close(client_fd);
+	printf("\033[1;1H");
+	printf("\033[2J");
+	//print_satellite_stats(&last_pvt);
+	if (last_pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID) {
+		//print_fix_data(&last_pvt);
+	}
 }
 
-static int server_init(void)
+#if defined(CONFIG_MOTION)
+#if defined(CONFIG_NRF_MODEM_LIB)
+static void gnss_event_handler(int event)
 {
-	struct sockaddr_in *server4 = ((struct sockaddr_in *)&host_addr);
-
-	server4->sin_family = AF_INET;
-	server4->sin_port = htons(CONFIG_UDP_SERVER_PORT);
-
-	inet_pton(AF_INET, CONFIG_UDP_SERVER_ADDRESS_STATIC,
-		  &server4->sin_addr);
-
-	return 0;
+	if (event == NRF_MODEM_GNSS_EVT_PVT) {
+		if (nrf_modem_gnss_read(&last_pvt, sizeof(last_pvt),
+					NRF_MODEM_GNSS_DATA_PVT) == 0) {
+			k_sem_give(&pvt_data_sem);
+#if defined(CONFIG_GEOFENCE)
+			if (last_pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID) {
+				geofence_mgr_fix(last_pvt.latitude, last_pvt.longitude);
+			}
+#endif
+		}
+	}
 }
 
-static int server_connect(void)
+/* Track with GNSS only while moving, a still device keeps its last fix. */
+static void gnss_tracking_set(bool on)
 {
+	static bool tracking;
 	int err;
 
-	client_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-	if (client_fd < 0) {
-		printk("Failed to create UDP socket: %d\n", errno);
-		err = -errno;
-		goto error;
+	if (on == tracking) {
+		return;
 	}
 
-	err = connect(client_fd, (struct sockaddr *)&host_addr,
-		      sizeof(struct sockaddr_in));
-	if (err < 0) {
-		printk("Connect failed : %d\n", errno);
-		goto error;
+	if (on) {
+		err = nrf_modem_gnss_event_handler_set(gnss_event_handler);
+		if (err == 0) {
+			err = nrf_modem_gnss_fix_interval_set(1);
+		}
+		if (err == 0) {
+			err = nrf_modem_gnss_start();
+		}
+	} else {
+		err = nrf_modem_gnss_stop();
 	}
 
-	return 0;
-
-error:
-	server_disconnect();
+	if (err) {
+		LOG_WRN("GNSS %s failed (%d)", on ? "start" : "stop", err);
+		return;
+	}
 
-	return err;
+	tracking = on;
 }
+#else
+static void gnss_tracking_set(bool on)
+{
+}
+#endif
 
+static void motion_state_work_fn(struct k_work *work)
+{
+	bool on = atomic_get(&moving);
 
+	uplink_period_set(on ? (CONFIG_UDP_DATA_UPLOAD_FREQUENCY_SECONDS * MSEC_PER_SEC) :
+			       (CONFIG_MOTION_STILL_UPLOAD_SECONDS * MSEC_PER_SEC));
+	gnss_tracking_set(on);
+}
 
-
-/*victor add functions */
-
-static void gnss_data_process_dwork_fn(struct k_work *work)
+static void motion_handler(enum motion_state motion)
 {
-	printf("\033[1;1H");
-	printf("\033[2J");
-	//print_satellite_stats(&last_pvt);
-	if (last_pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID) {
-		//print_fix_data(&last_pvt);
-	}
+	atomic_set(&moving, motion == MOTION_MOVING);
+	perf_work_reschedule_for_queue(&user_work_q, &motion_state_work, K_NO_WAIT);
 }
+#endif
 
 /* test function*/
 static void ui_test_fn(struct k_work *work)
@@ -281,7 +294,7 @@ static void ui_test_fn(struct k_work *work)
 	rgb_effect.duty = 50;
 	rgb_effect.duration = 120;
 	
-	ret = ui_rgb_control_set(rgb_color,rgb_effect);
+	ret = ui_rgb_control_layer_set(UI_RGB_CONTROL_LAYER_APP, rgb_color, rgb_effect);
 	if(ret) {
 		LOG_ERR("ui_rgb_control_set error");
 	}
@@ -289,13 +302,20 @@ static void ui_test_fn(struct k_work *work)
 
 void user_work_init(void)
 {
+        struct k_work_queue_config user_work_q_config = {
+                .name = "user_work_q",
+        };
+
         k_work_queue_init(&user_work_q);
         k_work_queue_start(&user_work_q, user_work_q_stack,
                            K_THREAD_STACK_SIZEOF(user_work_q_stack), USER_WORK_Q_PRIORITY,
-                           NULL);
+                           &user_work_q_config);
 
-        k_work_init_delayable(&gnss_data_process_dwork, gnss_data_process_dwork_fn);
-		k_work_init_delayable(&ui_test, ui_test_fn);
+        perf_work_init(&gnss_data_process_dwork, gnss_data_process_dwork_fn);
+		perf_work_init(&ui_test, ui_test_fn);
+#if defined(CONFIG_MOTION)
+		perf_work_init(&motion_state_work, motion_state_work_fn);
+#endif
 }
 
 
@@ -328,6 +348,19 @@ static uint8_t calculate_intensity(uint8_t colour_value, uint8_t brightness_valu
 	return (uint8_t)(numerator / denominator);
 }
 
+#if defined(CONFIG_BENCH)
+static volatile uint8_t bench_colour = 200;
+static volatile uint8_t bench_brightness = 75;
+static volatile uint8_t bench_intensity;
+
+static void bench_intensity_calculate(void)
+{
+	bench_intensity = calculate_intensity(bench_colour, bench_brightness);
+}
+
+BENCH_DEFINE(calculate_intensity, NULL, bench_intensity_calculate, NULL);
+#endif
+
 static void user_led_init(void)
 {
 	uint8_t intensity;
@@ -362,11 +395,27 @@ static void user_led_init(void)
 	}
 }
 
-static void button_event_handler(uint32_t button_state, uint32_t has_changed)
+static void input_event_handler(const struct ui_input_event *event)
 {
-	if (has_changed & button_state & DK_BTN1_MSK) {
+	uint8_t record[2] = { event->device_number, event->gesture };
+	int err;
+
+	if ((event->device_number == 1) &&
+	    (event->gesture == UI_INPUT_GESTURE_SHORT_PRESS)) {
 		printk("Button 1 pressed\n");
 	}
+
+	if ((event->gesture == UI_INPUT_GESTURE_HOLD_REPEAT) ||
+	    (event->gesture == UI_INPUT_GESTURE_SWITCH_ON) ||
+	    (event->gesture == UI_INPUT_GESTURE_SWITCH_OFF)) {
+		return;
+	}
+
+	err = uplink_send_urgent(UPLINK_RECORD_BUTTON, record, sizeof(record),
+				 event->timestamp);
+	if (err) {
+		LOG_ERR("Urgent uplink failed (%d)", err);
+	}
 }
 void main(void)
 {
@@ -376,15 +425,16 @@ void main(void)
 
 	printk("Thing simple example start\n");
 
-	work_init();
-
 	user_work_init();
 
 	user_led_init();
 
 	user_buzzer_init();
 
-	err = dk_buttons_init(button_event_handler);
+	err = ui_input_subscribe(input_event_handler);
+	if (err == 0) {
+		err = ui_input_init();
+	}
 	if (err) {
 		LOG_ERR("Could not initialize buttons (%d)", err);
 	}
@@ -424,19 +474,25 @@ void main(void)
 
 	printk("LTE connected\n");
 
-	err = server_init();
+#if defined(CONFIG_MOTION)
+	err = motion_subscribe(motion_handler);
+	if (err == 0) {
+		err = motion_init();
+	}
 	if (err) {
-		printk("Not able to initialize UDP server connection\n");
-		return;
+		LOG_ERR("Could not initialize motion gating (%d)", err);
+	} else {
+		/* Start out still, until the accelerometer tells otherwise. */
+		motion_handler(motion_state_get());
 	}
+#endif
 
-	err = server_connect();
+	err = uplink_init();
 	if (err) {
-		printk("Not able to connect to UDP server\n");
 		return;
 	}
 
-	k_work_schedule(&server_transmission_work, K_NO_WAIT);
+	uplink_start();
 
 
 }
@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/spi.h>
+#include <zephyr/sys/byteorder.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "motion.h"
+#include "sensor_mgr.h"
+#if defined(CONFIG_VIBRATION)
+#include "vibration.h"
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(motion, CONFIG_UDP_LOG_LEVEL);
+
+#define MOTION_THREAD_STACK_SIZE 1024
+#define MOTION_THREAD_PRIORITY   K_LOWEST_APPLICATION_THREAD_PRIO - 1
+
+#define MOTION_SUBSCRIBERS_MAX 2
+
+#define ADXL362_NODE DT_INST(0, adi_adxl362)
+
+BUILD_ASSERT(DT_NODE_HAS_STATUS(ADXL362_NODE, okay), "No ADXL362 in the devicetree");
+
+/* SPI commands */
+#define ADXL362_WRITE_REG     0x0A
+#define ADXL362_READ_REG      0x0B
+#define ADXL362_READ_FIFO     0x0D
+
+/* Registers */
+#define ADXL362_DEVID_AD      0x00
+#define ADXL362_STATUS        0x0B
+#define ADXL362_SOFT_RESET    0x1F
+#define ADXL362_THRESH_ACT_L  0x20
+#define ADXL362_THRESH_INACT_L 0x23
+#define ADXL362_ACT_INACT_CTL 0x27
+#define ADXL362_FIFO_CONTROL  0x28
+#define ADXL362_FIFO_SAMPLES  0x29
+#define ADXL362_INTMAP1       0x2A
+#define ADXL362_FILTER_CTL    0x2C
+#define ADXL362_POWER_CTL     0x2D
+
+#define ADXL362_DEVID_VALUE   0xAD
+#define ADXL362_RESET_KEY     0x52
+
+/* STATUS and INTMAP1 bits */
+#define ADXL362_FIFO_WATERMARK BIT(2)
+#define ADXL362_FIFO_OVERRUN  BIT(3)
+#define ADXL362_ACT           BIT(4)
+#define ADXL362_INACT         BIT(5)
+#define ADXL362_AWAKE         BIT(6)
+
+/* Referenced activity and inactivity, in loop mode. */
+#define ADXL362_ACT_INACT_LOOP 0x3F
+
+#define ADXL362_FIFO_STREAM   0x02
+#define ADXL362_FIFO_AH       BIT(3)
+
+#define ADXL362_RANGE_2G      0x00
+#define ADXL362_MEASURE       0x02
+#define ADXL362_AUTOSLEEP     BIT(2)
+
+/* FIFO entries are 16 bit, the top 2 bits tell the axis. */
+#define ADXL362_FIFO_ENTRIES_MAX 512
+#define ADXL362_AXIS_X        0
+
+/* The FIFO holds x, y, z sets, ODR and watermark are counted in sets. */
+#define WATERMARK_ENTRIES (CONFIG_MOTION_FIFO_WATERMARK * 3)
+
+BUILD_ASSERT(WATERMARK_ENTRIES < ADXL362_FIFO_ENTRIES_MAX, "Watermark does not fit the FIFO");
+
+/* At +-2 g one LSB is 1 mg, converted to thousandths of m/s^2. */
+#define MG_TO_MILLI_MS2(_mg) (((_mg) * 9807) / 1000)
+
+static const struct spi_dt_spec spi = SPI_DT_SPEC_GET(ADXL362_NODE,
+	SPI_WORD_SET(8) | SPI_TRANSFER_MSB | SPI_OP_MODE_MASTER, 0);
+static const struct gpio_dt_spec int1 = GPIO_DT_SPEC_GET(ADXL362_NODE, int1_gpios);
+static struct gpio_callback int1_cb;
+
+static K_SEM_DEFINE(motion_sem, 0, 1);
+
+static motion_handler_t subscribers[MOTION_SUBSCRIBERS_MAX];
+static size_t num_subscribers;
+
+static struct motion_stats stats;
+static struct k_spinlock stats_lock;
+
+/* Raw FIFO entries of one burst. */
+static uint8_t fifo_buf[ADXL362_FIFO_ENTRIES_MAX * 2];
+
+static int reg_write(uint8_t reg, uint8_t val)
+{
+	uint8_t cmd[3] = { ADXL362_WRITE_REG, reg, val };
+	const struct spi_buf tx_buf = { .buf = cmd, .len = sizeof(cmd) };
+	const struct spi_buf_set tx = { .buffers = &tx_buf, .count = 1 };
+
+	return spi_write_dt(&spi, &tx);
+}
+
+static int reg_read(uint8_t reg, uint8_t *val, size_t len)
+{
+	uint8_t cmd[2] = { ADXL362_READ_REG, reg };
+	const struct spi_buf tx_buf = { .buf = cmd, .len = sizeof(cmd) };
+	const struct spi_buf_set tx = { .buffers = &tx_buf, .count = 1 };
+	struct spi_buf rx_bufs[2] = {
+		{ .buf = NULL, .len = sizeof(cmd) },
+		{ .buf = val, .len = len },
+	};
+	const struct spi_buf_set rx = { .buffers = rx_bufs, .count = ARRAY_SIZE(rx_bufs) };
+
+	return spi_transceive_dt(&spi, &tx, &rx);
+}
+
+static int fifo_read(uint8_t *buf, size_t len)
+{
+	uint8_t cmd = ADXL362_READ_FIFO;
+	const struct spi_buf tx_buf = { .buf = &cmd, .len = sizeof(cmd) };
+	const struct spi_buf_set tx = { .buffers = &tx_buf, .count = 1 };
+	struct spi_buf rx_bufs[2] = {
+		{ .buf = NULL, .len = sizeof(cmd) },
+		{ .buf = buf, .len = len },
+	};
+	const struct spi_buf_set rx = { .buffers = rx_bufs, .count = ARRAY_SIZE(rx_bufs) };
+
+	return spi_transceive_dt(&spi, &tx, &rx);
+}
+
+static int reg_write_u16(uint8_t reg, uint16_t val)
+{
+	int err = reg_write(reg, val & 0xff);
+
+	return err ? err : reg_write(reg + 1, val >> 8);
+}
+
+BUILD_ASSERT((CONFIG_MOTION_ODR_HZ == 12) || (CONFIG_MOTION_ODR_HZ == 25) ||
+	     (CONFIG_MOTION_ODR_HZ == 50) || (CONFIG_MOTION_ODR_HZ == 100) ||
+	     (CONFIG_MOTION_ODR_HZ == 200) || (CONFIG_MOTION_ODR_HZ == 400),
+	     "CONFIG_MOTION_ODR_HZ must be one of 12, 25, 50, 100, 200 or 400");
+
+static uint8_t odr_bits(void)
+{
+	switch (CONFIG_MOTION_ODR_HZ) {
+	case 12:
+		return 0;
+	case 25:
+		return 1;
+	case 50:
+		return 2;
+	case 100:
+		return 3;
+	case 200:
+		return 4;
+	case 400:
+	default:
+		return 5;
+	}
+}
+
+static void int1_handler(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+	k_sem_give(&motion_sem);
+}
+
+/*
+ * Sign extend the 14 bit entries, the x, y, z sets are passed on and
+ * the mean sample to sample change over the burst is returned in mg.
+ */
+static uint32_t burst_process(const uint8_t *buf, size_t entries, int64_t now, bool awake)
+{
+	static int16_t last[3];
+	int16_t set[3];
+	uint32_t jerk = 0;
+	size_t sets = 0;
+	size_t axis = 0;
+
+	for (size_t i = 0; i < entries; i++) {
+		uint16_t raw = sys_get_le16(&buf[2 * i]);
+		size_t tag = raw >> 14;
+
+		/* Resynchronise on x if an entry was lost. */
+		if (tag != axis) {
+			axis = 0;
+			if (tag != ADXL362_AXIS_X) {
+				continue;
+			}
+		}
+
+		set[axis] = (int16_t)(raw << 2) >> 2;
+		if (++axis < 3) {
+			continue;
+		}
+		axis = 0;
+
+		for (size_t a = 0; a < 3; a++) {
+			jerk += abs(set[a] - last[a]);
+			last[a] = set[a];
+		}
+		sets++;
+
+#if defined(CONFIG_VIBRATION)
+		/* Asleep the ADXL362 samples at its wake-up rate, which the blocks cannot mix with. */
+		if (awake) {
+			vibration_feed(set);
+		} else {
+			vibration_restart();
+		}
+#endif
+
+		if (IS_ENABLED(CONFIG_SENSOR_MGR)) {
+			/* The burst is read at once, sample times are spread back from now. */
+			struct sensor_mgr_sample sample = {
+				.timestamp = now - ((((entries - i) / 3) * MSEC_PER_SEC) /
+						    CONFIG_MOTION_ODR_HZ),
+				.value = { MG_TO_MILLI_MS2(set[0]), MG_TO_MILLI_MS2(set[1]),
+					   MG_TO_MILLI_MS2(set[2]) },
+			};
+
+			sensor_mgr_push(SENSOR_MGR_ACCEL, &sample);
+		}
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.samples += sets;
+	k_spin_unlock(&stats_lock, key);
+
+	return sets ? (jerk / sets) : 0;
+}
+
+/* Hardware activity detection decides, the jerk adds hysteresis on top. */
+static enum motion_state classify(enum motion_state state, uint8_t status, uint32_t jerk_mg)
+{
+	if (!(status & ADXL362_AWAKE)) {
+		return MOTION_STILL;
+	}
+
+	if (jerk_mg >= CONFIG_MOTION_MOVING_JERK_MG) {
+		return MOTION_MOVING;
+	}
+
+	if (jerk_mg < CONFIG_MOTION_STILL_JERK_MG) {
+		return MOTION_STILL;
+	}
+
+	return state;
+}
+
+static void motion_drain(void)
+{
+	uint8_t regs[3];
+	enum motion_state state;
+	k_spinlock_key_t key;
+	size_t entries;
+	uint32_t jerk_mg;
+	bool changed;
+	int err;
+
+	/* STATUS and the FIFO entry count in one read. */
+	err = reg_read(ADXL362_STATUS, regs, sizeof(regs));
+	if (err) {
+		LOG_ERR("Reading ADXL362 status failed (%d)", err);
+		return;
+	}
+
+	entries = sys_get_le16(&regs[1]) & 0x3ff;
+	entries -= entries % 3;
+	if (entries > 0) {
+		err = fifo_read(fifo_buf, entries * 2);
+		if (err) {
+			LOG_ERR("Reading ADXL362 FIFO failed (%d)", err);
+			return;
+		}
+	}
+
+#if defined(CONFIG_VIBRATION)
+	/* Samples were lost, the block would have a gap. */
+	if (regs[0] & ADXL362_FIFO_OVERRUN) {
+		vibration_restart();
+	}
+#endif
+
+	jerk_mg = burst_process(fifo_buf, entries, k_uptime_get(), regs[0] & ADXL362_AWAKE);
+
+	key = k_spin_lock(&stats_lock);
+	stats.wakeups++;
+	if (regs[0] & ADXL362_FIFO_OVERRUN) {
+		stats.overruns++;
+	}
+	if (entries > 0) {
+		stats.jerk_mg = jerk_mg;
+	}
+	state = classify(stats.state, regs[0], stats.jerk_mg);
+	changed = (state != stats.state);
+	if (changed) {
+		stats.state = state;
+		stats.state_changes++;
+	}
+	k_spin_unlock(&stats_lock, key);
+
+	if (changed) {
+		LOG_INF("%s, %u mg jerk", (state == MOTION_MOVING) ? "Moving" : "Still", jerk_mg);
+		for (size_t i = 0; i < num_subscribers; i++) {
+			subscribers[i](state);
+		}
+	}
+}
+
+static void motion_thread_fn(void)
+{
+	for (;;) {
+		(void)k_sem_take(&motion_sem, K_FOREVER);
+
+		/* The interrupt is level, drain until it is released. */
+		do {
+			motion_drain();
+		} while (gpio_pin_get_dt(&int1) > 0);
+	}
+}
+
+K_THREAD_DEFINE(motion_thread, MOTION_THREAD_STACK_SIZE,
+		motion_thread_fn, NULL, NULL, NULL,
+		MOTION_THREAD_PRIORITY, 0, 0);
+
+static int adxl362_configure(void)
+{
+	uint32_t inact_samples = (CONFIG_MOTION_INACTIVITY_TIME_MS * CONFIG_MOTION_ODR_HZ) /
+				 MSEC_PER_SEC;
+	uint8_t devid;
+	int err;
+
+	err = reg_write(ADXL362_SOFT_RESET, ADXL362_RESET_KEY);
+	if (err) {
+		return err;
+	}
+	k_sleep(K_MSEC(1));
+
+	err = reg_read(ADXL362_DEVID_AD, &devid, sizeof(devid));
+	if (err) {
+		return err;
+	}
+	if (devid != ADXL362_DEVID_VALUE) {
+		LOG_ERR("Unexpected ADXL362 device id 0x%02x", devid);
+		return -ENODEV;
+	}
+
+	err = reg_write_u16(ADXL362_THRESH_ACT_L, CONFIG_MOTION_ACTIVITY_THRESHOLD_MG);
+	err = err ? err : reg_write_u16(ADXL362_THRESH_INACT_L,
+					CONFIG_MOTION_INACTIVITY_THRESHOLD_MG);
+	/* TIME_INACT follows THRESH_INACT_H, TIME_ACT stays 0, one sample. */
+	err = err ? err : reg_write_u16(ADXL362_THRESH_INACT_L + 2,
+					MIN(inact_samples, UINT16_MAX));
+	err = err ? err : reg_write(ADXL362_ACT_INACT_CTL, ADXL362_ACT_INACT_LOOP);
+	err = err ? err : reg_write(ADXL362_FIFO_SAMPLES, WATERMARK_ENTRIES & 0xff);
+	err = err ? err : reg_write(ADXL362_FIFO_CONTROL, ADXL362_FIFO_STREAM |
+				    ((WATERMARK_ENTRIES > 0xff) ? ADXL362_FIFO_AH : 0));
+	err = err ? err : reg_write(ADXL362_INTMAP1, ADXL362_FIFO_WATERMARK |
+				    ADXL362_ACT | ADXL362_INACT);
+	err = err ? err : reg_write(ADXL362_FILTER_CTL, ADXL362_RANGE_2G | odr_bits());
+	/* Autosleep drops to the wake-up rate while there is no activity. */
+	err = err ? err : reg_write(ADXL362_POWER_CTL, ADXL362_MEASURE | ADXL362_AUTOSLEEP);
+
+	return err;
+}
+
+int motion_subscribe(motion_handler_t handler)
+{
+	if (num_subscribers >= ARRAY_SIZE(subscribers)) {
+		return -ENOMEM;
+	}
+
+	subscribers[num_subscribers++] = handler;
+
+	return 0;
+}
+
+int motion_init(void)
+{
+	int err;
+
+	if (!spi_is_ready(&spi) || !device_is_ready(int1.port)) {
+		return -ENODEV;
+	}
+
+	err = adxl362_configure();
+	if (err) {
+		LOG_ERR("Configuring ADXL362 failed (%d)", err);
+		return err;
+	}
+
+	err = gpio_pin_configure_dt(&int1, GPIO_INPUT);
+	if (err) {
+		return err;
+	}
+
+	gpio_init_callback(&int1_cb, int1_handler, BIT(int1.pin));
+	err = gpio_add_callback(int1.port, &int1_cb);
+	if (err) {
+		return err;
+	}
+
+	err = gpio_pin_interrupt_configure_dt(&int1, GPIO_INT_EDGE_TO_ACTIVE);
+	if (err) {
+		return err;
+	}
+
+	stats.since = k_uptime_get();
+
+	/* The line may have gone active before the edge interrupt was set up. */
+	k_sem_give(&motion_sem);
+
+	return 0;
+}
+
+enum motion_state motion_state_get(void)
+{
+	return stats.state;
+}
+
+void motion_stats_get(struct motion_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+	out->polled_wakeups = (uint32_t)(((k_uptime_get() - stats.since) * CONFIG_MOTION_ODR_HZ) /
+					 MSEC_PER_SEC);
+	k_spin_unlock(&stats_lock, key);
+}
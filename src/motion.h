@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef MOTION_H__
+#define MOTION_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum motion_state {
+	MOTION_STILL,
+	MOTION_MOVING,
+};
+
+typedef void (*motion_handler_t)(enum motion_state state);
+
+/** @brief Counters of the FIFO draining. */
+struct motion_stats {
+	enum motion_state state;
+	/* Interrupts handled, each drains the FIFO in one burst. */
+	uint32_t wakeups;
+	uint32_t samples;
+	uint32_t overruns;
+	uint32_t state_changes;
+	/* Mean sample to sample change of the last burst in mg. */
+	uint32_t jerk_mg;
+	/* Wakeups a data ready interrupt per sample would have taken. */
+	uint32_t polled_wakeups;
+	/* Uptime in ms the counters were started. */
+	int64_t since;
+};
+
+/**
+ * @brief Register a handler for still/moving changes.
+ *
+ * Handlers are called from the motion thread.
+ *
+ * @return int 0 if successful, -ENOMEM if there are too many handlers.
+ */
+int motion_subscribe(motion_handler_t handler);
+
+/**
+ * @brief Set up the ADXL362 FIFO, activity detection and its interrupt.
+ *
+ * The accelerometer then samples on its own, the CPU only wakes when the
+ * FIFO reaches its watermark or activity changes.
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int motion_init(void);
+
+/**
+ * @brief Get the current still/moving state.
+ */
+enum motion_state motion_state_get(void);
+
+/**
+ * @brief Get the counters.
+ *
+ * @param[out] stats Counters.
+ */
+void motion_stats_get(struct motion_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTION_H__ */
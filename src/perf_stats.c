@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "perf_stats.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(perf_stats, CONFIG_UDP_LOG_LEVEL);
+
+#define WORK_BUDGET_US ((uint32_t)CONFIG_PERF_STATS_WORK_BUDGET_MS * USEC_PER_MSEC)
+
+/* Protects stalled and the worst runs, which are shared with the watchdog. */
+static struct k_spinlock perf_work_lock;
+
+static struct perf_work_offender worst[CONFIG_PERF_STATS_WORK_WORST];
+static size_t worst_num;
+
+/* Keep the list sorted, longest first, and one entry per work. */
+static void worst_update(const struct perf_work *work, uint32_t us)
+{
+	size_t i;
+
+	for (i = 0; i < worst_num; i++) {
+		if (worst[i].work == work) {
+			break;
+		}
+	}
+
+	if (i < worst_num) {
+		if (us <= worst[i].exec_us) {
+			return;
+		}
+		memmove(&worst[i], &worst[i + 1], (worst_num - i - 1) * sizeof(worst[0]));
+		worst_num--;
+	} else if (worst_num == ARRAY_SIZE(worst)) {
+		if (us <= worst[worst_num - 1].exec_us) {
+			return;
+		}
+		worst_num--;
+	}
+
+	for (i = 0; (i < worst_num) && (worst[i].exec_us >= us); i++) {
+	}
+	memmove(&worst[i + 1], &worst[i], (worst_num - i) * sizeof(worst[0]));
+	worst[i].work = work;
+	worst[i].exec_us = us;
+	worst[i].at_ms = k_uptime_get();
+	worst_num++;
+}
+
+/* Reports a handler that is still running past the budget, such as one
+ * blocked in an AT command, while the queue it runs on is stuck.
+ */
+static void perf_work_watchdog_fn(struct k_timer *timer)
+{
+	struct perf_work *work = CONTAINER_OF(timer, struct perf_work, watchdog);
+	k_spinlock_key_t key = k_spin_lock(&perf_work_lock);
+
+	work->stalled = true;
+	k_spin_unlock(&perf_work_lock, key);
+
+	LOG_WRN("%s (%p) still running after %u ms", work->name, work->handler,
+		CONFIG_PERF_STATS_WORK_BUDGET_MS);
+}
+
+static void perf_work_run(struct perf_work *work, struct k_work *item)
+{
+	k_spinlock_key_t key;
+	int64_t start = k_uptime_ticks();
+	uint32_t us;
+	bool stalled;
+
+	work->stalled = false;
+	k_timer_start(&work->watchdog, K_MSEC(CONFIG_PERF_STATS_WORK_BUDGET_MS), K_NO_WAIT);
+
+	work->handler(item);
+
+	k_timer_stop(&work->watchdog);
+	us = (uint32_t)MIN(k_ticks_to_us_floor64(k_uptime_ticks() - start), UINT32_MAX);
+
+	key = k_spin_lock(&perf_work_lock);
+	work->exec_last_us = us;
+	work->exec_max_us = MAX(work->exec_max_us, us);
+	if (us > WORK_BUDGET_US) {
+		work->overruns++;
+	}
+	stalled = work->stalled;
+	worst_update(work, us);
+	k_spin_unlock(&perf_work_lock, key);
+
+	if (us > WORK_BUDGET_US) {
+		LOG_WRN("%s (%p) %s after %u us, budget %u ms", work->name, work->handler,
+			stalled ? "returned" : "ran over", us, CONFIG_PERF_STATS_WORK_BUDGET_MS);
+	}
+}
+
+static void perf_work_handler(struct k_work *item)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(item);
+	struct perf_work *work = CONTAINER_OF(dwork, struct perf_work, dwork);
+	int64_t late = MAX(k_uptime_ticks() - work->due, 0);
+	uint32_t us = (uint32_t)MIN(k_ticks_to_us_floor64(late), UINT32_MAX);
+	uint32_t scaled = us >> PERF_STATS_LATENCY_SHIFT;
+	size_t bucket = scaled ? (32 - __builtin_clz(scaled)) : 0;
+
+	work->runs++;
+	work->latency_max_us = MAX(work->latency_max_us, us);
+	work->latency[MIN(bucket, PERF_STATS_LATENCY_BUCKETS - 1)]++;
+
+	perf_work_run(work, item);
+}
+
+size_t perf_work_worst_get(struct perf_work_offender *out, size_t max)
+{
+	k_spinlock_key_t key = k_spin_lock(&perf_work_lock);
+	size_t num = MIN(max, worst_num);
+
+	memcpy(out, worst, num * sizeof(worst[0]));
+	k_spin_unlock(&perf_work_lock, key);
+
+	return num;
+}
+
+void perf_work_init(struct perf_work *work, k_work_handler_t handler)
+{
+	work->handler = handler;
+	k_work_init_delayable(&work->dwork, perf_work_handler);
+	k_timer_init(&work->watchdog, perf_work_watchdog_fn, NULL);
+}
+
+int perf_work_schedule_for_queue(struct k_work_q *queue, struct perf_work *work,
+				 k_timeout_t delay)
+{
+	/* Scheduling a pending work does not move it. */
+	if (!k_work_delayable_is_pending(&work->dwork)) {
+		work->due = k_uptime_ticks() + delay.ticks;
+	}
+
+	return k_work_schedule_for_queue(queue, &work->dwork, delay);
+}
+
+int perf_work_reschedule_for_queue(struct k_work_q *queue, struct perf_work *work,
+				   k_timeout_t delay)
+{
+	work->due = k_uptime_ticks() + delay.ticks;
+
+	return k_work_reschedule_for_queue(queue, &work->dwork, delay);
+}
+
+int perf_work_cancel(struct perf_work *work)
+{
+	return k_work_cancel_delayable(&work->dwork);
+}
+
+#if defined(CONFIG_PERF_STATS_THREADS)
+struct threads_get_ctx {
+	struct perf_stats_thread *threads;
+	size_t max;
+	size_t num;
+	uint64_t total_cycles;
+};
+
+static void threads_get_cb(const struct k_thread *cthread, void *user_data)
+{
+	struct threads_get_ctx *ctx = user_data;
+	struct k_thread *thread = (struct k_thread *)cthread;
+	struct perf_stats_thread *out;
+	k_thread_runtime_stats_t runtime;
+	size_t unused;
+
+	if (ctx->num >= ctx->max) {
+		return;
+	}
+
+	out = &ctx->threads[ctx->num++];
+	memset(out, 0, sizeof(*out));
+
+	out->name = k_thread_name_get(thread);
+	out->stack_size = thread->stack_info.size;
+
+	if ((k_thread_runtime_stats_get(thread, &runtime) == 0) && (ctx->total_cycles > 0)) {
+		out->cpu_permille = (uint16_t)((runtime.execution_cycles * 1000) /
+					       ctx->total_cycles);
+	}
+
+	if (k_thread_stack_space_get(thread, &unused) == 0) {
+		out->stack_unused = unused;
+	}
+}
+
+int perf_stats_threads_get(struct perf_stats_thread *threads, size_t max)
+{
+	struct threads_get_ctx ctx = {
+		.threads = threads,
+		.max = max,
+	};
+	k_thread_runtime_stats_t all;
+	int err;
+
+	err = k_thread_runtime_stats_all_get(&all);
+	if (err) {
+		return err;
+	}
+
+	ctx.total_cycles = all.execution_cycles;
+	k_thread_foreach_unlocked(threads_get_cb, &ctx);
+
+	return ctx.num;
+}
+#else
+int perf_stats_threads_get(struct perf_stats_thread *threads, size_t max)
+{
+	return -ENOTSUP;
+}
+#endif /* CONFIG_PERF_STATS_THREADS */
+
+void perf_stats_record(uint8_t *buf)
+{
+	uint32_t latency_max_us = 0;
+	uint32_t dropped = 0;
+	uint32_t stack_unused = UINT16_MAX;
+	uint16_t busy_permille = 0;
+
+	STRUCT_SECTION_FOREACH(perf_work, work) {
+		latency_max_us = MAX(latency_max_us, work->latency_max_us);
+	}
+
+	STRUCT_SECTION_FOREACH(perf_stats_queue, queue) {
+		dropped += atomic_get(&queue->dropped);
+	}
+
+#if defined(CONFIG_PERF_STATS_THREADS)
+	static struct perf_stats_thread threads[CONFIG_PERF_STATS_THREADS_MAX];
+	int num = perf_stats_threads_get(threads, ARRAY_SIZE(threads));
+
+	busy_permille = 1000;
+	for (int i = 0; i < num; i++) {
+		stack_unused = MIN(stack_unused, threads[i].stack_unused);
+		if ((threads[i].name != NULL) && (strcmp(threads[i].name, "idle") == 0)) {
+			busy_permille -= MIN(busy_permille, threads[i].cpu_permille);
+		}
+	}
+#endif
+
+	sys_put_le16(MIN(latency_max_us / USEC_PER_MSEC, UINT16_MAX), &buf[0]);
+	sys_put_le16(MIN(dropped, UINT16_MAX), &buf[2]);
+	sys_put_le16(stack_unused, &buf[4]);
+	buf[6] = busy_permille / 10;
+	buf[7] = 0;
+}
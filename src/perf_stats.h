@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef PERF_STATS_H__
+#define PERF_STATS_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Power of two latency buckets, bucket 0 counts [0, 64) us and bucket i
+ * counts [2^(i+5), 2^(i+6)) us, the last one everything above.
+ */
+#define PERF_STATS_LATENCY_BUCKETS 16
+#define PERF_STATS_LATENCY_SHIFT   6
+
+/**
+ * @brief Counters of a message queue or mailbox.
+ *
+ * Occupancy is posted - taken - dropped. For latest-wins mailboxes dropped
+ * counts messages that were replaced before the consumer read them.
+ */
+struct perf_stats_queue {
+	const char *name;
+	atomic_t posted;
+	atomic_t taken;
+	atomic_t dropped;
+};
+
+#define PERF_STATS_QUEUE_DEFINE(_name)					\
+	STRUCT_SECTION_ITERABLE(perf_stats_queue, _name) = {		\
+		.name = #_name,						\
+	}
+
+static inline void perf_stats_queue_posted(struct perf_stats_queue *queue)
+{
+	atomic_inc(&queue->posted);
+}
+
+static inline void perf_stats_queue_taken(struct perf_stats_queue *queue, uint32_t dropped)
+{
+	atomic_inc(&queue->taken);
+	if (dropped) {
+		atomic_add(&queue->dropped, dropped);
+	}
+}
+
+/**
+ * @brief A delayable work that keeps a schedule-to-execute latency histogram.
+ *
+ * The handler gets the struct k_work of the embedded dwork, as it would
+ * with a plain struct k_work_delayable. Its execution time is checked
+ * against CONFIG_PERF_STATS_WORK_BUDGET_MS, see perf_work_worst_get().
+ */
+struct perf_work {
+	struct k_work_delayable dwork;
+	k_work_handler_t handler;
+	const char *name;
+
+	/* Uptime in ticks the work is due. */
+	int64_t due;
+
+	uint32_t runs;
+	uint32_t latency_max_us;
+	uint32_t latency[PERF_STATS_LATENCY_BUCKETS];
+
+	uint32_t exec_last_us;
+	uint32_t exec_max_us;
+
+	/* Runs over the budget, counted when they end. */
+	uint32_t overruns;
+
+	/* Runs while the handler does, expires when it is over the budget. */
+	struct k_timer watchdog;
+
+	/* The watchdog has reported the current run. */
+	bool stalled;
+};
+
+#define PERF_WORK_DEFINE(_name)						\
+	STRUCT_SECTION_ITERABLE(perf_work, _name) = {			\
+		.name = #_name,						\
+	}
+
+void perf_work_init(struct perf_work *work, k_work_handler_t handler);
+
+int perf_work_schedule_for_queue(struct k_work_q *queue, struct perf_work *work,
+				 k_timeout_t delay);
+
+int perf_work_reschedule_for_queue(struct k_work_q *queue, struct perf_work *work,
+				   k_timeout_t delay);
+
+int perf_work_cancel(struct perf_work *work);
+
+static inline int perf_work_schedule(struct perf_work *work, k_timeout_t delay)
+{
+	return perf_work_schedule_for_queue(&k_sys_work_q, work, delay);
+}
+
+static inline int perf_work_reschedule(struct perf_work *work, k_timeout_t delay)
+{
+	return perf_work_reschedule_for_queue(&k_sys_work_q, work, delay);
+}
+
+/** @brief One of the longest work handler runs since boot. */
+struct perf_work_offender {
+	const struct perf_work *work;
+	uint32_t exec_us;
+	/* Uptime in ms the run ended. */
+	int64_t at_ms;
+};
+
+/**
+ * @brief Get the longest work handler runs, longest first.
+ *
+ * Keeps the CONFIG_PERF_STATS_WORK_WORST longest runs, one per work.
+ *
+ * @param[out] worst Array filled with one entry per run.
+ * @param max Length of worst.
+ * @return size_t Number of entries.
+ */
+size_t perf_work_worst_get(struct perf_work_offender *worst, size_t max);
+
+/** @brief CPU share and stack margin of one thread. */
+struct perf_stats_thread {
+	const char *name;
+	/* Share of all cycles since boot, in tenths of a percent. */
+	uint16_t cpu_permille;
+	uint32_t stack_size;
+	uint32_t stack_unused;
+};
+
+/**
+ * @brief Get CPU share and stack margin of all threads.
+ *
+ * @param[out] threads Array filled with one entry per thread.
+ * @param max Length of threads.
+ * @return int Number of entries if successful, negative error code if not.
+ */
+int perf_stats_threads_get(struct perf_stats_thread *threads, size_t max);
+
+/* Size of the record written by perf_stats_record(). */
+#define PERF_STATS_RECORD_SIZE 8
+
+/**
+ * @brief Write a summary for the uplink.
+ *
+ * Little endian: worst work latency in ms (u16), dropped queue messages
+ * (u16), smallest unused stack in bytes (u16), busy CPU share in percent
+ * (u8) and a reserved byte.
+ *
+ * @param[out] buf Buffer of at least PERF_STATS_RECORD_SIZE bytes.
+ */
+void perf_stats_record(uint8_t *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERF_STATS_H__ */
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+
+#include "sample_coord.h"
+#include "sample_plan.h"
+#include "sensor_mgr.h"
+#include "uplink.h"
+#include "perf_stats.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(sample_coord, CONFIG_UDP_LOG_LEVEL);
+
+/* The sensors whose period is left at 0 to be fetched for the uplink only. */
+#define SENSORS (BIT(SENSOR_MGR_BME680) | BIT(SENSOR_MGR_BH1749))
+
+PERF_WORK_DEFINE(sample_coord_work);
+
+/* Guards the plan and the counters. */
+static struct k_spinlock coord_lock;
+
+static struct sample_plan plan;
+static int64_t sampled_at = SAMPLE_PLAN_NEVER;
+
+static struct sample_coord_stats stats;
+
+static void sample_coord_work_fn(struct k_work *work)
+{
+	k_spinlock_key_t key = k_spin_lock(&coord_lock);
+	int64_t now = k_uptime_get();
+	bool due = sample_plan_due(&plan, now);
+
+	if (due) {
+		sampled_at = now;
+		stats.planned++;
+	}
+
+	k_spin_unlock(&coord_lock, key);
+
+	if (due) {
+		sensor_mgr_trigger(SENSORS);
+	}
+}
+
+/* Plan a wakeup lead ms before every uplink. */
+static void schedule_handler(int64_t next)
+{
+	k_spinlock_key_t key = k_spin_lock(&coord_lock);
+	int64_t at = sample_plan_uplink(&plan, next);
+
+	/* Under the lock, so a modem wakeup cannot cancel the new one. */
+	if (at == SAMPLE_PLAN_NEVER) {
+		(void)perf_work_cancel(&sample_coord_work);
+	} else {
+		(void)perf_work_reschedule(&sample_coord_work,
+					   K_MSEC(MAX(at - k_uptime_get(), 0)));
+	}
+
+	k_spin_unlock(&coord_lock, key);
+}
+
+void sample_coord_modem_wake(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&coord_lock);
+	int64_t now = k_uptime_get();
+	bool shared = sample_plan_wake(&plan, now);
+
+	if (shared) {
+		sampled_at = now;
+		stats.shared++;
+		/* The planned wakeup is not needed any more. */
+		(void)perf_work_cancel(&sample_coord_work);
+	}
+
+	k_spin_unlock(&coord_lock, key);
+
+	if (shared) {
+		sensor_mgr_trigger(SENSORS);
+	}
+}
+
+/* Right before every periodic datagram, how old is what it carries? */
+static void sample_coord_collect(bool all)
+{
+	k_spinlock_key_t key = k_spin_lock(&coord_lock);
+	uint32_t age;
+
+	ARG_UNUSED(all);
+
+	if (sampled_at != SAMPLE_PLAN_NEVER) {
+		age = (uint32_t)MIN(k_uptime_get() - sampled_at, UINT32_MAX);
+		stats.sends++;
+		stats.age_ms_last = age;
+		stats.age_ms_max = MAX(stats.age_ms_max, age);
+		stats.age_ms_total += age;
+	}
+
+	k_spin_unlock(&coord_lock, key);
+}
+
+void sample_coord_stats_get(struct sample_coord_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&coord_lock);
+
+	*out = stats;
+	k_spin_unlock(&coord_lock, key);
+}
+
+static int sample_coord_init(const struct device *dev)
+{
+	int err;
+
+	ARG_UNUSED(dev);
+
+	sample_plan_init(&plan, CONFIG_SAMPLE_COORD_LEAD_MS, CONFIG_SAMPLE_COORD_SLACK_MS);
+	perf_work_init(&sample_coord_work, sample_coord_work_fn);
+
+	err = uplink_collector_add(sample_coord_collect);
+	if (err == 0) {
+		err = uplink_schedule_subscribe(schedule_handler);
+	}
+
+	return err;
+}
+
+SYS_INIT(sample_coord_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
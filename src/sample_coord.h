@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef SAMPLE_COORD_H__
+#define SAMPLE_COORD_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Counters of the sampling coordinator. */
+struct sample_coord_stats {
+	/* Samplings on a wakeup of their own, and on a modem wakeup. */
+	uint32_t planned;
+	uint32_t shared;
+	/* Periodic datagrams and the age of the sampled data when they were sent. */
+	uint32_t sends;
+	uint32_t age_ms_last;
+	uint32_t age_ms_max;
+	uint64_t age_ms_total;
+};
+
+/**
+ * @brief Tell the coordinator the modem has woken the CPU.
+ *
+ * Call on LTE_LC_EVT_MODEM_SLEEP_EXIT, the sensors are fetched right away
+ * if the next uplink is close enough.
+ */
+void sample_coord_modem_wake(void);
+
+/**
+ * @brief Get the counters.
+ *
+ * @param[out] stats Counters.
+ */
+void sample_coord_stats_get(struct sample_coord_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLE_COORD_H__ */
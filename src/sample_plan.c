@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "sample_plan.h"
+
+void sample_plan_init(struct sample_plan *plan, uint32_t lead, uint32_t slack)
+{
+	plan->lead = lead;
+	plan->slack = slack;
+	plan->uplink_at = SAMPLE_PLAN_NEVER;
+	plan->sampled_for = SAMPLE_PLAN_NEVER;
+}
+
+int64_t sample_plan_uplink(struct sample_plan *plan, int64_t uplink_at)
+{
+	plan->uplink_at = uplink_at;
+
+	return sample_plan_next(plan);
+}
+
+int64_t sample_plan_next(const struct sample_plan *plan)
+{
+	if ((plan->uplink_at == SAMPLE_PLAN_NEVER) || (plan->sampled_for == plan->uplink_at)) {
+		return SAMPLE_PLAN_NEVER;
+	}
+
+	return plan->uplink_at - plan->lead;
+}
+
+bool sample_plan_wake(struct sample_plan *plan, int64_t now)
+{
+	int64_t at = sample_plan_next(plan);
+
+	/* Earlier than that the data would be older than the slack allows. */
+	if ((at == SAMPLE_PLAN_NEVER) || (now < (at - (int64_t)plan->slack))) {
+		return false;
+	}
+
+	plan->sampled_for = plan->uplink_at;
+
+	return true;
+}
+
+bool sample_plan_due(struct sample_plan *plan, int64_t now)
+{
+	int64_t at = sample_plan_next(plan);
+
+	if ((at == SAMPLE_PLAN_NEVER) || (now < at)) {
+		return false;
+	}
+
+	plan->sampled_for = plan->uplink_at;
+
+	return true;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef SAMPLE_PLAN_H__
+#define SAMPLE_PLAN_H__
+
+/* Plain C without Zephyr headers, so scripts/sample_plan_sim.c can build it on the host. */
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SAMPLE_PLAN_NEVER INT64_MAX
+
+/**
+ * @brief When to sample for the next uplink, all times are uptime in ms.
+ *
+ * Sampling is due lead ms before the uplink, so the data is fresh when it
+ * is sent. If the modem wakes the CPU up to slack ms before that, the
+ * sampling is done right then and no wakeup of its own is needed.
+ */
+struct sample_plan {
+	uint32_t lead;
+	uint32_t slack;
+	/* The next planned uplink. */
+	int64_t uplink_at;
+	/* The uplink that has been sampled for already. */
+	int64_t sampled_for;
+};
+
+/**
+ * @brief Start a plan without any uplink.
+ */
+void sample_plan_init(struct sample_plan *plan, uint32_t lead, uint32_t slack);
+
+/**
+ * @brief Set the time of the next uplink.
+ *
+ * @return int64_t When to sample, SAMPLE_PLAN_NEVER if already done.
+ */
+int64_t sample_plan_uplink(struct sample_plan *plan, int64_t uplink_at);
+
+/**
+ * @brief Get when to sample for the next uplink.
+ *
+ * @return int64_t When to sample, SAMPLE_PLAN_NEVER if already done.
+ */
+int64_t sample_plan_next(const struct sample_plan *plan);
+
+/**
+ * @brief Check whether to sample now, on a wakeup caused by something else.
+ *
+ * @param now The uptime.
+ * @return bool true if the sampling should be done now, it counts as done.
+ */
+bool sample_plan_wake(struct sample_plan *plan, int64_t now);
+
+/**
+ * @brief Check whether to sample now, on the wakeup from sample_plan_next().
+ *
+ * @param now The uptime.
+ * @return bool true if the sampling is due, it counts as done.
+ */
+bool sample_plan_due(struct sample_plan *plan, int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLE_PLAN_H__ */
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+#include "sensor_agg.h"
+#include "aggregate.h"
+#include "uplink.h"
+#include "cycles.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(sensor_agg, CONFIG_UDP_LOG_LEVEL);
+
+/*
+ * Every upload interval closes a pane, the window is the last PANES of
+ * them. One pane is a tumbling window, more slide by one interval.
+ */
+#define PANES CONFIG_SENSOR_AGG_PANES
+
+#define RECORD_SIZE_MAX (SENSOR_AGG_RECORD_HEADER_SIZE + \
+			 (SENSOR_MGR_VALUES_MAX * SENSOR_AGG_RECORD_VALUE_SIZE))
+
+BUILD_ASSERT(RECORD_SIZE_MAX <= UPLINK_RECORD_DATA_MAX, "Record does not fit");
+
+/*
+ * Guards the panes and the counters. A mutex, the merge of every pane at
+ * the upload interval is too long to mask interrupts for, and samples are
+ * only added from threads.
+ */
+static K_MUTEX_DEFINE(agg_lock);
+
+static struct aggregate panes[SENSOR_MGR_CHANNEL_NUM][PANES][SENSOR_MGR_VALUES_MAX];
+static size_t current;
+static uint8_t closed;
+
+/* The windows being sent, only touched by the uplink work item. */
+static struct aggregate window[SENSOR_MGR_CHANNEL_NUM][SENSOR_MGR_VALUES_MAX];
+
+static struct sensor_agg_stats stats;
+
+/* Smallest change of a mean worth a record, per channel. */
+static struct sensor_agg_deadband deadbands[SENSOR_MGR_CHANNEL_NUM] = {
+	[SENSOR_MGR_TEMPERATURE] = { .abs = 200 },
+	[SENSOR_MGR_HUMIDITY] = { .abs = 1000 },
+	[SENSOR_MGR_PRESSURE] = { .abs = 100 },
+	[SENSOR_MGR_GAS_RES] = { .abs = 1000000, .rel = 100 },
+	[SENSOR_MGR_ACCEL] = { .abs = 500 },
+	[SENSOR_MGR_LIGHT] = { .abs = 5000, .rel = 100 },
+};
+
+/* Means of the last record per channel, only touched by the uplink work item. */
+static int32_t reported[SENSOR_MGR_CHANNEL_NUM][SENSOR_MGR_VALUES_MAX];
+static bool ever_reported[SENSOR_MGR_CHANNEL_NUM];
+
+static void panes_reset(size_t pane)
+{
+	for (size_t ch = 0; ch < SENSOR_MGR_CHANNEL_NUM; ch++) {
+		for (size_t v = 0; v < SENSOR_MGR_VALUES_MAX; v++) {
+			aggregate_reset(&panes[ch][pane][v]);
+		}
+	}
+}
+
+void sensor_agg_add(enum sensor_mgr_channel channel, const struct sensor_mgr_sample *sample)
+{
+	size_t num = sensor_mgr_channel_values(channel);
+	uint32_t start;
+
+	k_mutex_lock(&agg_lock, K_FOREVER);
+	start = cycles_get();
+
+	for (size_t v = 0; v < num; v++) {
+		aggregate_add(&panes[channel][current][v], sample->value[v]);
+	}
+
+	stats.cycles += cycles_get() - start;
+	stats.samples++;
+	stats.raw_bytes += sizeof(uint32_t) + (num * sizeof(sample->value[0]));
+	k_mutex_unlock(&agg_lock);
+}
+
+static size_t record_build(uint8_t *buf, enum sensor_mgr_channel channel, uint8_t intervals)
+{
+	size_t num = sensor_mgr_channel_values(channel);
+	size_t len = 0;
+
+	buf[len++] = channel;
+	buf[len++] = num;
+	buf[len++] = intervals;
+	sys_put_le32(window[channel][0].count, &buf[len]);
+	len += 4;
+
+	for (size_t v = 0; v < num; v++) {
+		const struct aggregate *agg = &window[channel][v];
+
+		sys_put_le32(agg->min, &buf[len]);
+		sys_put_le32(agg->max, &buf[len + 4]);
+		sys_put_le32(aggregate_mean(agg), &buf[len + 8]);
+		sys_put_le32(aggregate_stddev(agg), &buf[len + 12]);
+		len += SENSOR_AGG_RECORD_VALUE_SIZE;
+	}
+
+	return len;
+}
+
+/* Has any mean of the window left the deadband around the last record? */
+static bool changed(enum sensor_mgr_channel channel, struct sensor_agg_deadband deadband)
+{
+	size_t num = sensor_mgr_channel_values(channel);
+
+	if (!ever_reported[channel]) {
+		return true;
+	}
+
+	for (size_t v = 0; v < num; v++) {
+		int64_t last = reported[channel][v];
+		int64_t diff = (int64_t)aggregate_mean(&window[channel][v]) - last;
+		int64_t band = MAX((int64_t)deadband.abs,
+				   ((last < 0) ? -last : last) * deadband.rel / 1000);
+
+		if (((diff < 0) ? -diff : diff) > band) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Close the pane at the upload interval and send the windows that changed. */
+static void sensor_agg_collect(bool all)
+{
+	struct sensor_agg_deadband deadband[SENSOR_MGR_CHANNEL_NUM];
+	uint8_t record[RECORD_SIZE_MAX];
+	uint8_t intervals;
+	int err;
+
+	k_mutex_lock(&agg_lock, K_FOREVER);
+
+	memcpy(deadband, deadbands, sizeof(deadband));
+
+	for (size_t ch = 0; ch < SENSOR_MGR_CHANNEL_NUM; ch++) {
+		for (size_t v = 0; v < SENSOR_MGR_VALUES_MAX; v++) {
+			aggregate_reset(&window[ch][v]);
+			for (size_t p = 0; p < PANES; p++) {
+				aggregate_merge(&window[ch][v], &panes[ch][p][v]);
+			}
+		}
+	}
+
+	closed = MIN(closed + 1, PANES);
+	intervals = closed;
+	current = (current + 1) % PANES;
+	panes_reset(current);
+
+	k_mutex_unlock(&agg_lock);
+
+	for (size_t ch = 0; ch < SENSOR_MGR_CHANNEL_NUM; ch++) {
+		size_t len;
+
+		if (window[ch][0].count == 0) {
+			continue;
+		}
+
+		if (!all && !changed(ch, deadband[ch])) {
+			k_mutex_lock(&agg_lock, K_FOREVER);
+			stats.suppressed++;
+			k_mutex_unlock(&agg_lock);
+			continue;
+		}
+
+		len = record_build(record, ch, intervals);
+		err = uplink_queue(UPLINK_RECORD_SUMMARY, record, len);
+		if (err) {
+			LOG_WRN("Queueing the %s summary failed (%d)", sensor_mgr_channel_name(ch),
+				err);
+		}
+
+		k_mutex_lock(&agg_lock, K_FOREVER);
+		stats.records++;
+		if (err) {
+			stats.lost++;
+		} else {
+			stats.record_bytes += UPLINK_RECORD_HEADER_SIZE + len;
+		}
+		k_mutex_unlock(&agg_lock);
+
+		if (!err) {
+			for (size_t v = 0; v < SENSOR_MGR_VALUES_MAX; v++) {
+				reported[ch][v] = aggregate_mean(&window[ch][v]);
+			}
+			ever_reported[ch] = true;
+		}
+	}
+}
+
+int sensor_agg_deadband_set(enum sensor_mgr_channel channel,
+			    const struct sensor_agg_deadband *deadband)
+{
+	if (channel >= SENSOR_MGR_CHANNEL_NUM) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&agg_lock, K_FOREVER);
+	deadbands[channel] = *deadband;
+	k_mutex_unlock(&agg_lock);
+
+	return 0;
+}
+
+int sensor_agg_deadband_get(enum sensor_mgr_channel channel, struct sensor_agg_deadband *out)
+{
+	if (channel >= SENSOR_MGR_CHANNEL_NUM) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&agg_lock, K_FOREVER);
+	*out = deadbands[channel];
+	k_mutex_unlock(&agg_lock);
+
+	return 0;
+}
+
+void sensor_agg_stats_get(struct sensor_agg_stats *out)
+{
+	k_mutex_lock(&agg_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&agg_lock);
+}
+
+static int sensor_agg_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	for (size_t p = 0; p < PANES; p++) {
+		panes_reset(p);
+	}
+
+	cycles_enable();
+
+	return uplink_collector_add(sensor_agg_collect);
+}
+
+SYS_INIT(sensor_agg_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
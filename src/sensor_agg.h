@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef SENSOR_AGG_H__
+#define SENSOR_AGG_H__
+
+#include <zephyr/kernel.h>
+
+#include "sensor_mgr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Uplink record
+ *
+ * One per channel with samples in the window, right before every periodic
+ * datagram. With report on change, only for channels whose mean left the
+ * deadband, and for all of them on the heartbeat. Little endian: sensor_mgr channel (u8), number of values (u8),
+ * upload intervals in the window (u8), samples (u32), then per value its
+ * min, max and mean (s32 each) and population standard deviation (u32), in
+ * thousandths.
+ */
+#define SENSOR_AGG_RECORD_HEADER_SIZE 7
+#define SENSOR_AGG_RECORD_VALUE_SIZE  16
+
+/** @brief Counters of the aggregation. */
+struct sensor_agg_stats {
+	uint32_t samples;
+	uint32_t records;
+	/* Records skipped, the means had stayed within the deadband. */
+	uint32_t suppressed;
+	/* Records the uplink queue had no room for. */
+	uint32_t lost;
+	/* Uplink bytes of the records, and of the samples sent raw. */
+	uint64_t record_bytes;
+	uint64_t raw_bytes;
+	/* CPU cycles spent adding samples, see cycles.h for the rate. */
+	uint64_t cycles;
+};
+
+/**
+ * @brief Deadband of a channel, in the thousandths of its values.
+ *
+ * A window is reported when a mean differs from the last reported one by
+ * more than the larger of abs and rel permille of the last one.
+ */
+struct sensor_agg_deadband {
+	uint32_t abs;
+	uint32_t rel;
+};
+
+/**
+ * @brief Add a sample to the open window of its channel.
+ *
+ * Called by the sensor manager for every sample.
+ */
+void sensor_agg_add(enum sensor_mgr_channel channel, const struct sensor_mgr_sample *sample);
+
+/**
+ * @brief Get the counters.
+ *
+ * @param[out] stats Counters.
+ */
+void sensor_agg_stats_get(struct sensor_agg_stats *stats);
+
+/**
+ * @brief Set the deadband of a channel.
+ *
+ * @return 0 on success, -EINVAL for an unknown channel.
+ */
+int sensor_agg_deadband_set(enum sensor_mgr_channel channel,
+			    const struct sensor_agg_deadband *deadband);
+
+/**
+ * @brief Get the deadband of a channel.
+ *
+ * @param[out] deadband Deadband.
+ * @return 0 on success, -EINVAL for an unknown channel.
+ */
+int sensor_agg_deadband_get(enum sensor_mgr_channel channel,
+			    struct sensor_agg_deadband *deadband);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_AGG_H__ */
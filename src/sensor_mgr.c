@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <string.h>
+
+#include "sensor_mgr.h"
+#include "sensor_agg.h"
+#include "stream.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(sensor_mgr, CONFIG_UDP_LOG_LEVEL);
+
+#define SENSOR_MGR_THREAD_STACK_SIZE 1536
+#define SENSOR_MGR_THREAD_PRIORITY   K_LOWEST_APPLICATION_THREAD_PRIO - 1
+
+#define RING_SIZE CONFIG_SENSOR_MGR_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+
+BUILD_ASSERT((RING_SIZE & RING_MASK) == 0, "Ring size must be a power of two");
+
+#define SENSOR_MGR_NEVER INT64_MAX
+
+/* The sensor channels read into the values of one sample. */
+struct channel_desc {
+	const char *name;
+	enum sensor_mgr_sensor sensor;
+	uint8_t num;
+	enum sensor_channel chan[SENSOR_MGR_VALUES_MAX];
+};
+
+struct sensor_desc {
+	const char *name;
+	const struct device *dev;
+	uint32_t period_ms;
+};
+
+struct channel_ring {
+	struct sensor_mgr_sample sample[RING_SIZE];
+	uint32_t head;
+	uint32_t tail;
+};
+
+static const struct channel_desc channels[SENSOR_MGR_CHANNEL_NUM] = {
+	[SENSOR_MGR_TEMPERATURE] = { "temperature", SENSOR_MGR_BME680, 1,
+				     { SENSOR_CHAN_AMBIENT_TEMP } },
+	[SENSOR_MGR_HUMIDITY] = { "humidity", SENSOR_MGR_BME680, 1, { SENSOR_CHAN_HUMIDITY } },
+	[SENSOR_MGR_PRESSURE] = { "pressure", SENSOR_MGR_BME680, 1, { SENSOR_CHAN_PRESS } },
+	[SENSOR_MGR_GAS_RES] = { "gas", SENSOR_MGR_BME680, 1, { SENSOR_CHAN_GAS_RES } },
+	[SENSOR_MGR_ACCEL] = { "accel", SENSOR_MGR_ADXL362, 3,
+			       { SENSOR_CHAN_ACCEL_X, SENSOR_CHAN_ACCEL_Y, SENSOR_CHAN_ACCEL_Z } },
+	[SENSOR_MGR_LIGHT] = { "light", SENSOR_MGR_BH1749, 4,
+			       { SENSOR_CHAN_RED, SENSOR_CHAN_GREEN, SENSOR_CHAN_BLUE,
+				 SENSOR_CHAN_IR } },
+};
+
+/* A sensor whose driver is not built stays NULL and is never sampled. */
+static struct sensor_desc sensors[SENSOR_MGR_SENSOR_NUM] = {
+	[SENSOR_MGR_BME680] = {
+		.name = "bme680",
+#if defined(CONFIG_BME680)
+		.dev = DEVICE_DT_GET_ANY(bosch_bme680),
+#endif
+		.period_ms = CONFIG_SENSOR_MGR_BME680_PERIOD_MS,
+	},
+	[SENSOR_MGR_ADXL362] = {
+		.name = "adxl362",
+#if defined(CONFIG_ADXL362)
+		.dev = DEVICE_DT_GET_ANY(adi_adxl362),
+#endif
+		.period_ms = CONFIG_SENSOR_MGR_ADXL362_PERIOD_MS,
+	},
+	[SENSOR_MGR_BH1749] = {
+		.name = "bh1749",
+#if defined(CONFIG_BH1749)
+		.dev = DEVICE_DT_GET_ANY(rohm_bh1749),
+#endif
+		.period_ms = CONFIG_SENSOR_MGR_BH1749_PERIOD_MS,
+	},
+};
+
+static struct channel_ring rings[SENSOR_MGR_CHANNEL_NUM];
+
+/* Guards the rings, the periods and the counters. */
+static struct k_spinlock sensor_mgr_lock;
+
+/* Given when a period changes, so the thread works out its next wakeup again. */
+static K_SEM_DEFINE(sensor_mgr_sem, 0, 1);
+
+/* Bit mask of the sensors whose period changed. */
+static atomic_t restart;
+
+/* Bit mask of the sensors to fetch right away, see sensor_mgr_trigger(). */
+static atomic_t triggered;
+
+static struct sensor_mgr_stats stats;
+
+static int32_t value_milli(const struct sensor_value *val)
+{
+	int64_t milli = ((int64_t)val->val1 * 1000) + (val->val2 / 1000);
+
+	return (int32_t)CLAMP(milli, INT32_MIN, INT32_MAX);
+}
+
+static void ring_put(enum sensor_mgr_channel channel, const struct sensor_mgr_sample *sample)
+{
+	struct channel_ring *ring = &rings[channel];
+	k_spinlock_key_t key = k_spin_lock(&sensor_mgr_lock);
+
+	ring->sample[ring->head & RING_MASK] = *sample;
+	ring->head++;
+	if ((ring->head - ring->tail) > RING_SIZE) {
+		ring->tail = ring->head - RING_SIZE;
+		stats.overwritten++;
+	}
+	stats.samples++;
+
+	k_spin_unlock(&sensor_mgr_lock, key);
+}
+
+static void stream_sample(enum sensor_mgr_channel channel, const struct sensor_mgr_sample *sample)
+{
+	uint8_t record[2 + sizeof(sample->value)];
+	size_t num = channels[channel].num;
+
+	record[0] = channel;
+	record[1] = num;
+	memcpy(&record[2], sample->value, num * sizeof(sample->value[0]));
+
+	(void)stream_write(STREAM_CHANNEL_SENSOR, record, 2 + (num * sizeof(sample->value[0])));
+}
+
+void sensor_mgr_push(enum sensor_mgr_channel channel, const struct sensor_mgr_sample *sample)
+{
+	ring_put(channel, sample);
+	if (IS_ENABLED(CONFIG_SENSOR_AGG)) {
+		sensor_agg_add(channel, sample);
+	}
+	if (stream_channel_enabled(STREAM_CHANNEL_SENSOR)) {
+		stream_sample(channel, sample);
+	}
+}
+
+static void sensor_sample(enum sensor_mgr_sensor sensor, int64_t now)
+{
+	const struct device *dev = sensors[sensor].dev;
+	struct sensor_mgr_sample sample;
+	struct sensor_value val;
+	int err;
+
+	err = sensor_sample_fetch(dev);
+	stats.sensor[sensor].fetches++;
+	if (err) {
+		stats.sensor[sensor].errors++;
+		LOG_WRN("Fetching %s failed (%d)", sensors[sensor].name, err);
+		return;
+	}
+
+	for (size_t ch = 0; ch < SENSOR_MGR_CHANNEL_NUM; ch++) {
+		if (channels[ch].sensor != sensor) {
+			continue;
+		}
+
+		memset(&sample, 0, sizeof(sample));
+		sample.timestamp = now;
+		for (size_t i = 0; i < channels[ch].num; i++) {
+			err = sensor_channel_get(dev, channels[ch].chan[i], &val);
+			if (err) {
+				break;
+			}
+			sample.value[i] = value_milli(&val);
+		}
+		if (err) {
+			stats.sensor[sensor].errors++;
+			continue;
+		}
+
+		sensor_mgr_push(ch, &sample);
+	}
+}
+
+static uint64_t thread_cpu_us(void)
+{
+#if defined(CONFIG_THREAD_RUNTIME_STATS)
+	k_thread_runtime_stats_t runtime;
+
+	if (k_thread_runtime_stats_get(k_current_get(), &runtime) == 0) {
+		return k_cyc_to_us_floor64(runtime.execution_cycles);
+	}
+#endif
+	return 0;
+}
+
+/*
+ * One round fetches every sensor that is due, and also those due within
+ * the grouping window, so sensors with related periods share a bus wakeup.
+ * Triggered sensors are fetched too, whatever their period. Returns the
+ * uptime in ms of the next round.
+ */
+static int64_t sensor_mgr_round(int64_t *due, atomic_val_t trigger)
+{
+	int64_t now = k_uptime_get();
+	int64_t next = SENSOR_MGR_NEVER;
+	uint32_t start = k_cycle_get_32();
+	uint64_t cpu_start = thread_cpu_us();
+	bool fetched = false;
+	uint32_t round_us;
+	k_spinlock_key_t key;
+
+	for (size_t i = 0; i < SENSOR_MGR_SENSOR_NUM; i++) {
+		uint32_t period = sensors[i].period_ms;
+
+		if (stats.sensor[i].ready && (trigger & BIT(i))) {
+			sensor_sample(i, now);
+			fetched = true;
+			/* A periodic sensor starts its next period from here. */
+			if (period != 0) {
+				due[i] = now + period;
+			}
+		}
+
+		if ((period == 0) || !stats.sensor[i].ready) {
+			due[i] = SENSOR_MGR_NEVER;
+			continue;
+		}
+
+		if (due[i] == SENSOR_MGR_NEVER) {
+			due[i] = now;
+		}
+
+		if (due[i] <= (now + CONFIG_SENSOR_MGR_GROUP_WINDOW_MS)) {
+			sensor_sample(i, now);
+			fetched = true;
+			/* Keep the phase, but do not catch up with missed periods. */
+			due[i] += period;
+			if (due[i] <= now) {
+				due[i] = now + period;
+			}
+		}
+
+		next = MIN(next, due[i]);
+	}
+
+	if (fetched) {
+		round_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+		key = k_spin_lock(&sensor_mgr_lock);
+		stats.rounds++;
+		stats.round_us_max = MAX(stats.round_us_max, round_us);
+		stats.round_us_total += round_us;
+		stats.cpu_us_total += thread_cpu_us() - cpu_start;
+		k_spin_unlock(&sensor_mgr_lock, key);
+	}
+
+	return next;
+}
+
+static void sensor_mgr_thread_fn(void)
+{
+	int64_t due[SENSOR_MGR_SENSOR_NUM];
+	atomic_val_t changed;
+	int64_t next;
+
+	for (size_t i = 0; i < SENSOR_MGR_SENSOR_NUM; i++) {
+		stats.sensor[i].name = sensors[i].name;
+		stats.sensor[i].ready = (sensors[i].dev != NULL) && device_is_ready(sensors[i].dev);
+		if ((sensors[i].dev != NULL) && !stats.sensor[i].ready) {
+			LOG_ERR("%s is not ready", sensors[i].name);
+		}
+		due[i] = SENSOR_MGR_NEVER;
+	}
+	stats.since = k_uptime_get();
+
+	for (;;) {
+		next = sensor_mgr_round(due, atomic_clear(&triggered));
+
+		(void)k_sem_take(&sensor_mgr_sem, (next == SENSOR_MGR_NEVER) ?
+				 K_FOREVER : K_TIMEOUT_ABS_MS(next));
+
+		/* Sensors with a new period start over with a fetch right away. */
+		changed = atomic_clear(&restart);
+
+		for (size_t i = 0; i < SENSOR_MGR_SENSOR_NUM; i++) {
+			if (changed & BIT(i)) {
+				due[i] = SENSOR_MGR_NEVER;
+			}
+		}
+	}
+}
+
+K_THREAD_DEFINE(sensor_mgr_thread, SENSOR_MGR_THREAD_STACK_SIZE,
+		sensor_mgr_thread_fn, NULL, NULL, NULL,
+		SENSOR_MGR_THREAD_PRIORITY, 0, 0);
+
+int sensor_mgr_period_set(enum sensor_mgr_sensor sensor, uint32_t period_ms)
+{
+	if (sensor >= SENSOR_MGR_SENSOR_NUM) {
+		return -EINVAL;
+	}
+
+	if (sensors[sensor].dev == NULL) {
+		return -ENODEV;
+	}
+
+	sensors[sensor].period_ms = period_ms;
+	atomic_set_bit(&restart, sensor);
+	k_sem_give(&sensor_mgr_sem);
+
+	return 0;
+}
+
+void sensor_mgr_trigger(uint32_t mask)
+{
+	atomic_or(&triggered, mask);
+	k_sem_give(&sensor_mgr_sem);
+}
+
+size_t sensor_mgr_read(enum sensor_mgr_channel channel, struct sensor_mgr_sample *samples,
+		       size_t max)
+{
+	struct channel_ring *ring = &rings[channel];
+	k_spinlock_key_t key = k_spin_lock(&sensor_mgr_lock);
+	size_t num = 0;
+
+	while ((num < max) && (ring->tail != ring->head)) {
+		samples[num++] = ring->sample[ring->tail & RING_MASK];
+		ring->tail++;
+	}
+
+	k_spin_unlock(&sensor_mgr_lock, key);
+
+	return num;
+}
+
+int sensor_mgr_latest(enum sensor_mgr_channel channel, struct sensor_mgr_sample *sample)
+{
+	struct channel_ring *ring = &rings[channel];
+	k_spinlock_key_t key = k_spin_lock(&sensor_mgr_lock);
+	int err = -ENODATA;
+
+	/* head is never reset, so a sample that was read is still the newest. */
+	if (ring->head != 0) {
+		*sample = ring->sample[(ring->head - 1) & RING_MASK];
+		err = 0;
+	}
+
+	k_spin_unlock(&sensor_mgr_lock, key);
+
+	return err;
+}
+
+size_t sensor_mgr_channel_values(enum sensor_mgr_channel channel)
+{
+	return channels[channel].num;
+}
+
+const char *sensor_mgr_channel_name(enum sensor_mgr_channel channel)
+{
+	return channels[channel].name;
+}
+
+void sensor_mgr_stats_get(struct sensor_mgr_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&sensor_mgr_lock);
+
+	*out = stats;
+	for (size_t i = 0; i < SENSOR_MGR_SENSOR_NUM; i++) {
+		out->sensor[i].period_ms = sensors[i].period_ms;
+	}
+
+	k_spin_unlock(&sensor_mgr_lock, key);
+}
+
+void sensor_mgr_stats_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&sensor_mgr_lock);
+
+	for (size_t i = 0; i < SENSOR_MGR_SENSOR_NUM; i++) {
+		stats.sensor[i].fetches = 0;
+		stats.sensor[i].errors = 0;
+	}
+	stats.rounds = 0;
+	stats.samples = 0;
+	stats.overwritten = 0;
+	stats.round_us_max = 0;
+	stats.round_us_total = 0;
+	stats.cpu_us_total = 0;
+	stats.since = k_uptime_get();
+
+	k_spin_unlock(&sensor_mgr_lock, key);
+}
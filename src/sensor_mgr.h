@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef SENSOR_MGR_H__
+#define SENSOR_MGR_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sensors, each is fetched at its own period. */
+enum sensor_mgr_sensor {
+	SENSOR_MGR_BME680,
+	SENSOR_MGR_ADXL362,
+	SENSOR_MGR_BH1749,
+
+	SENSOR_MGR_SENSOR_NUM,
+};
+
+/* Channels, each has a ring of samples. Values are in thousandths. */
+enum sensor_mgr_channel {
+	/* Degrees Celsius. */
+	SENSOR_MGR_TEMPERATURE,
+	/* Percent relative humidity. */
+	SENSOR_MGR_HUMIDITY,
+	/* kPa. */
+	SENSOR_MGR_PRESSURE,
+	/* Ohm. */
+	SENSOR_MGR_GAS_RES,
+	/* x, y, z in m/s^2. */
+	SENSOR_MGR_ACCEL,
+	/* red, green, blue, infrared in counts. */
+	SENSOR_MGR_LIGHT,
+
+	SENSOR_MGR_CHANNEL_NUM,
+};
+
+/* Most values in a sample. */
+#define SENSOR_MGR_VALUES_MAX 4
+
+struct sensor_mgr_sample {
+	/* Uptime in ms of the fetch. */
+	int64_t timestamp;
+	int32_t value[SENSOR_MGR_VALUES_MAX];
+};
+
+/** @brief Counters of one sensor. */
+struct sensor_mgr_sensor_stats {
+	const char *name;
+	bool ready;
+	/* Fetch period in ms, 0 if the sensor is not sampled. */
+	uint32_t period_ms;
+	uint32_t fetches;
+	uint32_t errors;
+};
+
+/** @brief Counters of the sampling thread. */
+struct sensor_mgr_stats {
+	struct sensor_mgr_sensor_stats sensor[SENSOR_MGR_SENSOR_NUM];
+	uint32_t rounds;
+	uint32_t samples;
+	/* Samples overwritten before they were read. */
+	uint32_t overwritten;
+	/* Duration of the sampling rounds, waiting for the bus included. */
+	uint32_t round_us_max;
+	uint64_t round_us_total;
+	/* CPU time of the sampling thread, 0 without CONFIG_THREAD_RUNTIME_STATS. */
+	uint64_t cpu_us_total;
+	/* Uptime in ms the counters were started. */
+	int64_t since;
+};
+
+/**
+ * @brief Set the fetch period of a sensor.
+ *
+ * @param sensor The sensor.
+ * @param period_ms Period in ms, 0 to only fetch it on sensor_mgr_trigger().
+ * @return int 0 if successful, negative error code if not.
+ */
+int sensor_mgr_period_set(enum sensor_mgr_sensor sensor, uint32_t period_ms);
+
+/**
+ * @brief Fetch sensors right away, whatever their period.
+ *
+ * For sensors with a period of 0 that are only sampled on demand, such as
+ * by the sampling coordinator of sample_coord.c. Returns without waiting
+ * for the fetch.
+ *
+ * @param mask Bit mask of the sensors, BIT(SENSOR_MGR_BME680) and so on.
+ */
+void sensor_mgr_trigger(uint32_t mask);
+
+/**
+ * @brief Add a sample read outside the sampling thread to a channel.
+ *
+ * For sensors that sample on their own, such as the ADXL362 FIFO of motion.c.
+ * From a thread, not an interrupt, the aggregation takes a mutex.
+ *
+ * @param channel The channel.
+ * @param sample The sample.
+ */
+void sensor_mgr_push(enum sensor_mgr_channel channel, const struct sensor_mgr_sample *sample);
+
+/**
+ * @brief Take samples of a channel out of its ring, oldest first.
+ *
+ * @param channel The channel.
+ * @param[out] samples Array filled with the samples.
+ * @param max Length of samples.
+ * @return size_t Number of samples.
+ */
+size_t sensor_mgr_read(enum sensor_mgr_channel channel, struct sensor_mgr_sample *samples,
+		       size_t max);
+
+/**
+ * @brief Get the newest sample of a channel without taking it.
+ *
+ * @param channel The channel.
+ * @param[out] sample The sample.
+ * @return int 0 if successful, -ENODATA if there was no sample yet.
+ */
+int sensor_mgr_latest(enum sensor_mgr_channel channel, struct sensor_mgr_sample *sample);
+
+/**
+ * @brief Get the number of values in the samples of a channel.
+ */
+size_t sensor_mgr_channel_values(enum sensor_mgr_channel channel);
+
+/**
+ * @brief Get the name of a channel.
+ */
+const char *sensor_mgr_channel_name(enum sensor_mgr_channel channel);
+
+/**
+ * @brief Get the counters.
+ *
+ * @param[out] stats Counters.
+ */
+void sensor_mgr_stats_get(struct sensor_mgr_stats *stats);
+
+/**
+ * @brief Restart the counters.
+ */
+void sensor_mgr_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_MGR_H__ */
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shell_args.h"
+
+static void field_store(const struct shell_arg *arg, void *out, uint32_t val)
+{
+	uint8_t *field = (uint8_t *)out + arg->offset;
+
+	switch (arg->size) {
+	case sizeof(uint8_t): {
+		uint8_t v = val;
+
+		memcpy(field, &v, sizeof(v));
+		break;
+	}
+	case sizeof(uint16_t): {
+		uint16_t v = val;
+
+		memcpy(field, &v, sizeof(v));
+		break;
+	}
+	default:
+		memcpy(field, &val, sizeof(val));
+		break;
+	}
+}
+
+static int value_parse(const struct shell_arg *arg, const char *str, uint32_t *val)
+{
+	char *end;
+	unsigned long v;
+	int base = 10;
+
+	/* Hex only with 0x, a leading 0 is still decimal and not octal. */
+	if ((str[0] == '0') && ((str[1] == 'x') || (str[1] == 'X'))) {
+		str += 2;
+		base = 16;
+	}
+
+	if (!isxdigit((unsigned char)*str) || ((base == 10) && !isdigit((unsigned char)*str))) {
+		return -EINVAL;
+	}
+
+	errno = 0;
+	v = strtoul(str, &end, base);
+	if ((errno != 0) || (*end != '\0') || (v < arg->min) || (v > arg->max)) {
+		return -EINVAL;
+	}
+
+	*val = v;
+
+	return 0;
+}
+
+static int option_find(const struct shell_arg *schema, size_t num, const char *name,
+		       size_t name_len)
+{
+	for (size_t i = 0; i < num; i++) {
+		if ((strncmp(schema[i].name, name, name_len) == 0) &&
+		    (schema[i].name[name_len] == '\0')) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int shell_args_parse(const struct shell_arg *schema, size_t num, size_t argc, char **argv,
+		     void *out, const char **bad)
+{
+	uint32_t given = 0;
+	size_t positional = 0;
+
+	__ASSERT_NO_MSG(num <= SHELL_ARGS_MAX);
+
+	for (size_t i = 0; i < num; i++) {
+		field_store(&schema[i], out, schema[i].def);
+	}
+
+	for (size_t i = 0; i < argc; i++) {
+		const char *value = strchr(argv[i], '=');
+		uint32_t val;
+		int opt;
+
+		if (value != NULL) {
+			opt = option_find(schema, num, argv[i], value - argv[i]);
+			value++;
+		} else {
+			/* Positional arguments fill the options not named so far, in order. */
+			while ((positional < num) && (given & BIT(positional))) {
+				positional++;
+			}
+			opt = (positional < num) ? (int)positional : -E2BIG;
+			value = argv[i];
+		}
+
+		if ((opt < 0) || (given & BIT(opt)) || value_parse(&schema[opt], value, &val)) {
+			if (bad != NULL) {
+				*bad = argv[i];
+			}
+			return (opt == -E2BIG) ? -E2BIG : -EINVAL;
+		}
+
+		field_store(&schema[opt], out, val);
+		given |= BIT(opt);
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		if (schema[i].required && !(given & BIT(i))) {
+			if (bad != NULL) {
+				*bad = schema[i].name;
+			}
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef SHELL_ARGS_H__
+#define SHELL_ARGS_H__
+
+#include <zephyr/kernel.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Most options a schema can have, they are tracked in a bit mask. */
+#define SHELL_ARGS_MAX 32
+
+/**
+ * @brief One unsigned integer option, stored into a field of the output struct.
+ *
+ * Options are given in schema order as positional arguments or in any order
+ * as name=value, and both forms can be mixed.
+ */
+struct shell_arg {
+	const char *name;
+	uint16_t offset;
+	/* Size of the field, 1, 2 or 4 bytes. */
+	uint8_t size;
+	bool required;
+	uint32_t min;
+	uint32_t max;
+	uint32_t def;
+};
+
+#define SHELL_ARG_FIELD(_type, _field, _name, _required, _min, _max, _def)	\
+	{									\
+		.name = _name,							\
+		.offset = offsetof(_type, _field),				\
+		.size = sizeof(((_type *)0)->_field),				\
+		.required = _required,						\
+		.min = _min,							\
+		.max = _max,							\
+		.def = _def,							\
+	}
+
+/** @brief A required option. */
+#define SHELL_ARG(_type, _field, _name, _min, _max) \
+	SHELL_ARG_FIELD(_type, _field, _name, true, _min, _max, 0)
+
+/** @brief An option that falls back to _def. */
+#define SHELL_ARG_OPT(_type, _field, _name, _min, _max, _def) \
+	SHELL_ARG_FIELD(_type, _field, _name, false, _min, _max, _def)
+
+/**
+ * @brief Parse arguments into a struct.
+ *
+ * Every option of the schema is written, the omitted ones with their
+ * default. Values are decimal, or hex with 0x. Nothing is allocated.
+ *
+ * @param schema Options.
+ * @param num Number of options, at most SHELL_ARGS_MAX.
+ * @param argc Number of arguments.
+ * @param argv Arguments, without the command name.
+ * @param[out] out Struct the options are stored into.
+ * @param[out] bad The offending argument, or the name of a missing required
+ *                 option. May be NULL.
+ * @return int 0 if successful, -EINVAL for an unknown or repeated option,
+ *             a malformed or out of range value or a missing required
+ *             option, -E2BIG for more arguments than options.
+ */
+int shell_args_parse(const struct shell_arg *schema, size_t num, size_t argc, char **argv,
+		     void *out, const char **bad);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHELL_ARGS_H__ */
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "spectrum.h"
+#include "spectrum_tables.h"
+
+/* The Cortex-M33 DSP extension does a complex Q15 multiply in two instructions. */
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include <arm_acle.h>
+#define SPECTRUM_SIMD 1
+#else
+#define SPECTRUM_SIMD 0
+#endif
+
+/*
+ * Complex values are re, im pairs of int16_t. Loaded as one word, re is the
+ * low and im the high half word. memcpy keeps the compiler from assuming
+ * anything about aliasing and is a single LDR/STR on the target.
+ */
+static inline uint32_t cpx_load(const int16_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void cpx_store(int16_t *p, uint32_t v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline int16_t sat16(int32_t v)
+{
+	return (v > INT16_MAX) ? INT16_MAX : ((v < INT16_MIN) ? INT16_MIN : (int16_t)v);
+}
+
+/* a = (a + w b) / 2, b = (a - w b) / 2 */
+static inline void butterfly(int16_t *a, int16_t *b, uint32_t w)
+{
+#if SPECTRUM_SIMD
+	uint32_t bv = cpx_load(b);
+	/* w b / 2 rounded, re = br c + bi s, im = bi c - br s */
+	int32_t re = __smlad(bv, w, 0x8000) >> 16;
+	int32_t im = __smlsdx(w, bv, 0x8000) >> 16;
+	uint32_t t = (uint16_t)re | ((uint32_t)(uint16_t)im << 16);
+	uint32_t ah = __shadd16(cpx_load(a), 0);
+
+	cpx_store(a, __qadd16(ah, t));
+	cpx_store(b, __qsub16(ah, t));
+#else
+	int32_t c = (int16_t)(w & 0xffff);
+	int32_t s = (int16_t)(w >> 16);
+	int32_t re = ((b[0] * c) + (b[1] * s) + 0x8000) >> 16;
+	int32_t im = ((b[1] * c) - (b[0] * s) + 0x8000) >> 16;
+	int32_t ar = a[0] >> 1;
+	int32_t ai = a[1] >> 1;
+
+	a[0] = sat16(ar + re);
+	a[1] = sat16(ai + im);
+	b[0] = sat16(ar - re);
+	b[1] = sat16(ai - im);
+#endif
+}
+
+static void bit_reverse(int16_t *z, size_t m)
+{
+	size_t j = 0;
+
+	for (size_t i = 1; i < m; i++) {
+		size_t bit = m >> 1;
+
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+
+		if (i < j) {
+			uint32_t t = cpx_load(&z[2 * i]);
+
+			cpx_store(&z[2 * i], cpx_load(&z[2 * j]));
+			cpx_store(&z[2 * j], t);
+		}
+	}
+}
+
+/* Radix-2 decimation in time, every stage halves its output. */
+static void cfft_q15(int16_t *z, size_t m)
+{
+	bit_reverse(z, m);
+
+	for (size_t len = 2; len <= m; len <<= 1) {
+		size_t half = len / 2;
+		size_t step = SPECTRUM_SIZE_MAX / len;
+
+		for (size_t k = 0; k < half; k++) {
+			uint32_t w = spectrum_twiddle[k * step];
+
+			for (size_t i = k; i < m; i += len) {
+				butterfly(&z[2 * i], &z[2 * (i + half)], w);
+			}
+		}
+	}
+}
+
+static bool size_valid(size_t n)
+{
+	return (n >= 4) && (n <= SPECTRUM_SIZE_MAX) && ((n & (n - 1)) == 0);
+}
+
+void spectrum_window_q15(int16_t *x, size_t n)
+{
+	size_t step = SPECTRUM_SIZE_MAX / n;
+
+	for (size_t i = 0; i < n; i++) {
+		x[i] = (int16_t)((x[i] * spectrum_hann[i * step]) >> 15);
+	}
+}
+
+int spectrum_rfft_q15(int16_t *buf, size_t n)
+{
+	size_t m = n / 2;
+	size_t step = SPECTRUM_SIZE_MAX / n;
+	int16_t re0;
+	int16_t im0;
+
+	if (!size_valid(n)) {
+		return -EINVAL;
+	}
+
+	/* Even samples as re, odd ones as im, is already the layout of buf. */
+	cfft_q15(buf, m);
+
+	/*
+	 * Split the n/2 point spectrum Z into the n point one, for the bin pair
+	 * k and m - k: E = (Z[k] + Z*[m-k]) / 2, O = -j (Z[k] - Z*[m-k]) / 2,
+	 * X[k] = (E + w O) / 2 and X[m-k] = ((E - w O) / 2)*.
+	 */
+	re0 = buf[0];
+	im0 = buf[1];
+	buf[0] = (int16_t)((re0 + im0) >> 1);
+	buf[1] = (int16_t)((re0 - im0) >> 1);
+
+	for (size_t k = 1; k <= m / 2; k++) {
+		int16_t *zk = &buf[2 * k];
+		int16_t *zm = &buf[2 * (m - k)];
+		int16_t e[2] = {
+			(int16_t)((zk[0] + zm[0]) >> 1),
+			(int16_t)((zk[1] - zm[1]) >> 1),
+		};
+		int16_t o[2] = {
+			(int16_t)((zk[1] + zm[1]) >> 1),
+			(int16_t)((zm[0] - zk[0]) >> 1),
+		};
+
+		butterfly(e, o, spectrum_twiddle[k * step]);
+
+		/* For k == m - k both are the same bin, e is written last. */
+		zm[0] = o[0];
+		zm[1] = sat16(-o[1]);
+		zk[0] = e[0];
+		zk[1] = e[1];
+	}
+
+	return 0;
+}
+
+void spectrum_power_add(const int16_t *bins, size_t n, uint64_t *power)
+{
+	size_t m = n / 2;
+
+	power[0] += (uint32_t)(bins[0] * bins[0]);
+	power[m] += (uint32_t)(bins[1] * bins[1]);
+
+	for (size_t k = 1; k < m; k++) {
+#if SPECTRUM_SIMD
+		uint32_t v = cpx_load(&bins[2 * k]);
+
+		/* At most 2^31, which only fits unsigned. */
+		power[k] += (uint32_t)__smuad(v, v);
+#else
+		power[k] += (uint32_t)(bins[2 * k] * bins[2 * k]) +
+			    (uint32_t)(bins[2 * k + 1] * bins[2 * k + 1]);
+#endif
+	}
+}
+
+void spectrum_bands(const uint64_t *power, size_t n, uint64_t *energy, size_t bands)
+{
+	size_t m = n / 2;
+
+	for (size_t b = 0; b < bands; b++) {
+		size_t first = 1 + ((b * m) / bands);
+		size_t end = 1 + (((b + 1) * m) / bands);
+
+		energy[b] = 0;
+		for (size_t k = first; k < end; k++) {
+			energy[b] += power[k];
+		}
+	}
+}
+
+size_t spectrum_peaks(const uint64_t *power, size_t n, struct spectrum_peak *peaks, size_t max)
+{
+	size_t m = n / 2;
+	size_t num = 0;
+
+	for (size_t k = 1; k <= m; k++) {
+		size_t i;
+
+		if ((power[k] == 0) || (power[k] <= power[k - 1]) ||
+		    ((k < m) && (power[k] < power[k + 1]))) {
+			continue;
+		}
+
+		/* Insertion into the list, strongest first. */
+		for (i = num; (i > 0) && (peaks[i - 1].power < power[k]); i--) {
+			if (i < max) {
+				peaks[i] = peaks[i - 1];
+			}
+		}
+		if (i < max) {
+			peaks[i].bin = (uint16_t)k;
+			peaks[i].power = power[k];
+			if (num < max) {
+				num++;
+			}
+		}
+	}
+
+	return num;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef SPECTRUM_H__
+#define SPECTRUM_H__
+
+/* Plain C without Zephyr headers, so scripts/spectrum_bench.c can build it on the host. */
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Largest transform, the twiddle and window tables are generated for it. */
+#define SPECTRUM_SIZE_MAX 512
+
+/** @brief A spectral peak. */
+struct spectrum_peak {
+	uint16_t bin;
+	uint64_t power;
+};
+
+/**
+ * @brief Apply a periodic Hann window in place.
+ *
+ * @param x Q15 samples.
+ * @param n Number of samples, a power of two up to SPECTRUM_SIZE_MAX.
+ */
+void spectrum_window_q15(int16_t *x, size_t n);
+
+/**
+ * @brief Real FFT in place, Q15.
+ *
+ * Runs as an n/2 point complex radix-2 FFT and a split step. Every stage
+ * halves its output so nothing saturates, the result is X[k] / n: a cosine
+ * of amplitude A at bin k comes out with magnitude A / 2. Uses the
+ * Cortex-M33 DSP instructions where the compiler has them, the portable
+ * code gives the same results bit for bit.
+ *
+ * @param buf n real samples in. Out, bins 0 to n/2 - 1 as re, im pairs,
+ *            with the real bin n/2 in place of the imaginary part of bin 0.
+ * @param n Number of samples, a power of two from 4 up to SPECTRUM_SIZE_MAX.
+ * @return int 0 if successful, -EINVAL for an unsupported size.
+ */
+int spectrum_rfft_q15(int16_t *buf, size_t n);
+
+/**
+ * @brief Add the power of every bin of a spectrum_rfft_q15() result.
+ *
+ * @param bins Output of spectrum_rfft_q15().
+ * @param n Size of the transform.
+ * @param[in,out] power n/2 + 1 accumulators, re^2 + im^2 is added to each.
+ */
+void spectrum_power_add(const int16_t *bins, size_t n, uint64_t *power);
+
+/**
+ * @brief Sum the power in equal width bands, bin 0 left out.
+ *
+ * @param power n/2 + 1 bins.
+ * @param n Size of the transform.
+ * @param[out] energy Power per band.
+ * @param bands Number of bands, at most n/2.
+ */
+void spectrum_bands(const uint64_t *power, size_t n, uint64_t *energy, size_t bands);
+
+/**
+ * @brief Find the strongest local maxima, bin 0 left out.
+ *
+ * @param power n/2 + 1 bins.
+ * @param n Size of the transform.
+ * @param[out] peaks Peaks, strongest first.
+ * @param max Length of peaks.
+ * @return size_t Number of peaks found.
+ */
+size_t spectrum_peaks(const uint64_t *power, size_t n, struct spectrum_peak *peaks, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPECTRUM_H__ */
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef SPECTRUM_TABLES_H__
+#define SPECTRUM_TABLES_H__
+
+#include "spectrum.h"
+
+/* Tables generated at build time by scripts/gen_spectrum_tables.py. */
+
+/* e^(-2 pi j k / SPECTRUM_SIZE_MAX), cos in the low and sin in the high half word, Q15. */
+extern const uint32_t spectrum_twiddle[SPECTRUM_SIZE_MAX / 2];
+
+/* Periodic Hann window of SPECTRUM_SIZE_MAX points, Q15. */
+extern const int16_t spectrum_hann[SPECTRUM_SIZE_MAX];
+
+#endif /* SPECTRUM_TABLES_H__ */
@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <string.h>
+
+#include "stream.h"
+#include "cycles.h"
+
+#define STREAM_THREAD_STACK_SIZE 1024
+#define STREAM_THREAD_PRIORITY   K_LOWEST_APPLICATION_THREAD_PRIO
+
+#define STREAM_RECORD_MAX (STREAM_HEADER_SIZE + STREAM_DATA_MAX + STREAM_CRC_SIZE)
+
+/* COBS adds a code byte for every 254 bytes, the delimiter follows. */
+#define STREAM_FRAME_MAX  (1 + STREAM_RECORD_MAX + 1)
+
+/* Bytes moved from the ring to the UART at a time. */
+#define STREAM_DRAIN_CHUNK 64
+
+/* Load records generated at most per wakeup, when the thread falls behind. */
+#define STREAM_LOAD_BURST  32
+
+/* Time the frames already written get to go out when the stream stops. */
+#define STREAM_FLUSH_TIMEOUT_MS 1000
+
+BUILD_ASSERT(STREAM_RECORD_MAX < 254, "Records must fit a single COBS block");
+BUILD_ASSERT(STREAM_CHANNEL_NUM <= 32, "Channels are a bit mask");
+
+atomic_t stream_channels;
+
+static const struct device *const stream_uart = DEVICE_DT_GET(DT_CHOSEN(zephyr_shell_uart));
+
+RING_BUF_DECLARE(stream_ring, CONFIG_STREAM_BUFFER_SIZE);
+
+/* Serializes writers and guards the ring, the sequence number and stats. */
+static struct k_spinlock stream_lock;
+static K_SEM_DEFINE(stream_sem, 0, 1);
+
+static uint16_t stream_seq;
+static struct stream_stats stats;
+static int64_t started_ms;
+
+static int64_t load_period;
+static uint32_t load_len;
+
+/*
+ * COBS encode the len bytes at buf[1] into buf[0], which works in place
+ * because the output never gets ahead of the input. Returns the encoded
+ * length.
+ */
+static size_t cobs_encode(uint8_t *buf, size_t len)
+{
+	size_t code_pos = 0;
+	size_t out = 1;
+	uint8_t code = 1;
+
+	for (size_t in = 1; in <= len; in++) {
+		if (buf[in] == 0) {
+			buf[code_pos] = code;
+			code_pos = out++;
+			code = 1;
+		} else {
+			buf[out++] = buf[in];
+			code++;
+		}
+	}
+	buf[code_pos] = code;
+
+	return out;
+}
+
+int stream_write(enum stream_channel channel, const void *data, size_t len)
+{
+	uint8_t frame[STREAM_FRAME_MAX];
+	uint8_t *record = &frame[1];
+	uint32_t start = cycles_get();
+	k_spinlock_key_t key;
+	size_t frame_len;
+	uint16_t crc;
+	bool put = false;
+
+	if (!stream_channel_enabled(channel)) {
+		return -EAGAIN;
+	}
+
+	if (len > STREAM_DATA_MAX) {
+		return -EINVAL;
+	}
+
+	record[0] = channel;
+	record[1] = len;
+	sys_put_le32((uint32_t)k_ticks_to_us_floor64(k_uptime_ticks()), &record[4]);
+	memcpy(&record[STREAM_HEADER_SIZE], data, len);
+
+	key = k_spin_lock(&stream_lock);
+
+	/* Dropped records use up a sequence number too, the host sees the gap. */
+	sys_put_le16(stream_seq++, &record[2]);
+	crc = crc16_ccitt(0xffff, record, STREAM_HEADER_SIZE + len);
+	sys_put_le16(crc, &record[STREAM_HEADER_SIZE + len]);
+
+	frame_len = cobs_encode(frame, STREAM_HEADER_SIZE + len + STREAM_CRC_SIZE);
+	frame[frame_len++] = 0;
+
+	if (ring_buf_space_get(&stream_ring) >= frame_len) {
+		ring_buf_put(&stream_ring, frame, frame_len);
+		stats.records++;
+		stats.bytes += frame_len;
+		put = true;
+	} else {
+		stats.dropped++;
+	}
+	stats.cycles += cycles_get() - start;
+
+	k_spin_unlock(&stream_lock, key);
+
+	if (!put) {
+		return -ENOMEM;
+	}
+
+	k_sem_give(&stream_sem);
+
+	return 0;
+}
+
+static void stream_drain(void)
+{
+	uint8_t chunk[STREAM_DRAIN_CHUNK];
+	k_spinlock_key_t key;
+	uint32_t len;
+
+	do {
+		key = k_spin_lock(&stream_lock);
+		len = ring_buf_get(&stream_ring, chunk, sizeof(chunk));
+		k_spin_unlock(&stream_lock, key);
+
+		for (uint32_t i = 0; i < len; i++) {
+			uart_poll_out(stream_uart, chunk[i]);
+		}
+	} while (len > 0);
+}
+
+static void stream_load(int64_t *next)
+{
+	static uint32_t number;
+	uint8_t data[STREAM_DATA_MAX] = { 0 };
+	int64_t now = k_uptime_ticks();
+
+	for (int i = 0; (i < STREAM_LOAD_BURST) && (now >= *next); i++) {
+		sys_put_le32(number++, data);
+		(void)stream_write(STREAM_CHANNEL_LOAD, data, load_len);
+		*next += load_period;
+	}
+
+	/* Skip what could not be caught up with rather than bursting later. */
+	*next = MAX(*next, now);
+}
+
+static void stream_thread_fn(void)
+{
+	int64_t next = 0;
+	k_timeout_t wait;
+
+	for (;;) {
+		bool load = stream_channel_enabled(STREAM_CHANNEL_LOAD) && (load_period > 0);
+
+		if (!load) {
+			next = 0;
+			wait = K_FOREVER;
+		} else if (next == 0) {
+			next = k_uptime_ticks();
+			wait = K_NO_WAIT;
+		} else {
+			wait = K_TIMEOUT_ABS_TICKS(next);
+		}
+
+		(void)k_sem_take(&stream_sem, wait);
+
+		if (load) {
+			stream_load(&next);
+		}
+
+		stream_drain();
+	}
+}
+
+K_THREAD_DEFINE(stream_thread, STREAM_THREAD_STACK_SIZE,
+		stream_thread_fn, NULL, NULL, NULL,
+		STREAM_THREAD_PRIORITY, 0, 0);
+
+static void stream_bypass(const struct shell *shell, uint8_t *data, size_t len)
+{
+	struct stream_stats last;
+
+	ARG_UNUSED(data);
+	ARG_UNUSED(len);
+
+	stream_stats_get(&last);
+	atomic_clear(&stream_channels);
+
+	for (int i = 0; (i < STREAM_FLUSH_TIMEOUT_MS / 10) && !ring_buf_is_empty(&stream_ring); i++) {
+		k_sleep(K_MSEC(10));
+	}
+
+	stats.elapsed_ms = last.elapsed_ms;
+	shell_set_bypass(shell, NULL);
+
+	shell_print(shell, "");
+	shell_print(shell, "stream stopped: %u records, %u dropped, %u bytes in %u ms",
+		    last.records, last.dropped, last.bytes, last.elapsed_ms);
+	shell_print(shell, "framing %u cycles per record on average, %u Hz",
+		    last.records ? (uint32_t)(last.cycles / last.records) : 0U, cycles_per_sec());
+}
+
+int stream_start(const struct shell *shell, uint32_t channels, uint32_t load_rate,
+		 uint32_t load_size)
+{
+	static const uint8_t delimiter;
+	k_spinlock_key_t key;
+
+	if (!device_is_ready(stream_uart)) {
+		return -ENODEV;
+	}
+
+	if (atomic_get(&stream_channels) != 0) {
+		return -EBUSY;
+	}
+
+	if ((channels == 0) || (channels >= BIT(STREAM_CHANNEL_NUM)) ||
+	    (load_size < sizeof(uint32_t)) || (load_size > STREAM_DATA_MAX)) {
+		return -EINVAL;
+	}
+
+	cycles_enable();
+
+	key = k_spin_lock(&stream_lock);
+	memset(&stats, 0, sizeof(stats));
+	/* End whatever text came before, the first frame then decodes cleanly. */
+	ring_buf_put(&stream_ring, &delimiter, sizeof(delimiter));
+	k_spin_unlock(&stream_lock, key);
+
+	started_ms = k_uptime_get();
+	load_period = load_rate ? k_us_to_ticks_ceil64(USEC_PER_SEC / load_rate) : 0;
+	load_len = load_size;
+
+	shell_set_bypass(shell, stream_bypass);
+	atomic_set(&stream_channels, channels);
+	k_sem_give(&stream_sem);
+
+	return 0;
+}
+
+void stream_stats_get(struct stream_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream_lock);
+
+	*out = stats;
+	if (atomic_get(&stream_channels) != 0) {
+		out->elapsed_ms = (uint32_t)(k_uptime_get() - started_ms);
+	}
+	k_spin_unlock(&stream_lock, key);
+}
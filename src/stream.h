@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef STREAM_H__
+#define STREAM_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Frame format
+ *
+ * Every record is COBS encoded and followed by a 0x00 delimiter. Decoded it
+ * is a channel byte, a data length byte, a little endian sequence number
+ * (u16) counting all records written, a little endian timestamp in us (u32),
+ * the data, and a little endian CRC-16/CCITT (crc16_ccitt(), seed 0xffff)
+ * over everything before it. scripts/stream_capture.py decodes it.
+ */
+#define STREAM_HEADER_SIZE 8
+#define STREAM_CRC_SIZE    2
+#define STREAM_DATA_MAX    32
+
+/* Channels, data of each is little endian. */
+enum stream_channel {
+	/* red, green, blue, on (u8 each), on every render of the RGB control. */
+	STREAM_CHANNEL_RGB,
+	/* frequency in Hz (u16), melody note, 0xff for a rest or 0xfe for none
+	 * (u8), intensity (u8), on (u8), on every render of the buzzer control.
+	 */
+	STREAM_CHANNEL_BUZZER,
+	/* device (u8), gesture (u8), repeat (u16), on every gesture. */
+	STREAM_CHANNEL_INPUT,
+	/* record number (u32) and padding, generated at a set rate to measure throughput. */
+	STREAM_CHANNEL_LOAD,
+	/* sensor_mgr channel (u8), number of values (u8), values in thousandths
+	 * (s32 each), on every sample.
+	 */
+	STREAM_CHANNEL_SENSOR,
+
+	STREAM_CHANNEL_NUM,
+};
+
+/** @brief Counters of the current or last stream. */
+struct stream_stats {
+	uint32_t records;
+	uint32_t dropped;
+	uint32_t bytes;
+	/* CPU cycles spent framing records, see cycles.h for the rate. */
+	uint64_t cycles;
+	uint32_t elapsed_ms;
+};
+
+#if defined(CONFIG_STREAM)
+/* Bit mask of the channels being streamed, read with stream_channel_enabled(). */
+extern atomic_t stream_channels;
+
+static inline bool stream_channel_enabled(enum stream_channel channel)
+{
+	return atomic_test_bit(&stream_channels, channel);
+}
+
+/**
+ * @brief Write a record, if its channel is being streamed.
+ *
+ * Callable from any context. The record is framed into a buffer drained to
+ * the console UART by the stream thread, it is dropped if the buffer is
+ * full.
+ *
+ * @param channel Channel of the record.
+ * @param data Record data.
+ * @param len Length of data, at most STREAM_DATA_MAX.
+ * @return int 0 if successful, -EAGAIN if the channel is off, -ENOMEM if
+ *             the record was dropped, -EINVAL if it is too long.
+ */
+int stream_write(enum stream_channel channel, const void *data, size_t len);
+#else
+static inline bool stream_channel_enabled(enum stream_channel channel)
+{
+	return false;
+}
+
+static inline int stream_write(enum stream_channel channel, const void *data, size_t len)
+{
+	return -ENOTSUP;
+}
+#endif
+
+/**
+ * @brief Switch the console to binary records.
+ *
+ * Shell input stops until any byte is received, which ends the stream and
+ * prints its counters.
+ *
+ * @param shell Shell of the console.
+ * @param channels Bit mask of the channels to stream.
+ * @param load_rate Records per second of STREAM_CHANNEL_LOAD.
+ * @param load_size Data length of STREAM_CHANNEL_LOAD records.
+ * @return int 0 if successful, negative error code if not.
+ */
+int stream_start(const struct shell *shell, uint32_t channels, uint32_t load_rate,
+		 uint32_t load_size);
+
+/**
+ * @brief Get the counters of the current or last stream.
+ *
+ * @param[out] stats Counters.
+ */
+void stream_stats_get(struct stream_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_H__ */
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+
+#include "trace.h"
+#include "cycles.h"
+#include "bench.h"
+
+#define TRACE_RING_SIZE CONFIG_TRACEPOINT_RING_SIZE
+#define TRACE_RING_MASK (TRACE_RING_SIZE - 1)
+
+BUILD_ASSERT((TRACE_RING_SIZE & TRACE_RING_MASK) == 0, "Ring size must be a power of two");
+BUILD_ASSERT(TRACE_RING_SIZE <= (UINT16_MAX / 2), "Ring size must fit the record seq");
+BUILD_ASSERT(sizeof(struct trace_record) == 16, "Trace records are dumped as 16 bytes");
+
+static struct trace_record trace_ring[TRACE_RING_SIZE];
+
+/* Number of the next record. Writers claim a record by incrementing it, so
+ * they never wait for each other or for the reader.
+ */
+static atomic_t trace_head;
+static atomic_t trace_tail;
+
+void trace_write(uint16_t id, uint32_t arg0, uint32_t arg1)
+{
+	atomic_val_t num = atomic_inc(&trace_head);
+	struct trace_record *record = &trace_ring[num & TRACE_RING_MASK];
+
+	/* Not the seq of this or the previous use of the slot while it is written. */
+	record->seq = (uint16_t)~num;
+	compiler_barrier();
+
+	record->timestamp = cycles_get();
+	record->id = id;
+	record->arg0 = arg0;
+	record->arg1 = arg1;
+
+	compiler_barrier();
+	record->seq = (uint16_t)num;
+}
+
+uint32_t trace_foreach(trace_record_cb_t cb, void *user_data)
+{
+	atomic_val_t head = atomic_get(&trace_head);
+	atomic_val_t tail = atomic_get(&trace_tail);
+	atomic_val_t first = MAX(tail, head - TRACE_RING_SIZE);
+	uint32_t lost = first - tail;
+	struct trace_record copy;
+
+	for (atomic_val_t num = first; num != head; num++) {
+		const volatile struct trace_record *record = &trace_ring[num & TRACE_RING_MASK];
+		uint16_t seq = record->seq;
+
+		compiler_barrier();
+		copy.timestamp = record->timestamp;
+		copy.id = record->id;
+		copy.arg0 = record->arg0;
+		copy.arg1 = record->arg1;
+		compiler_barrier();
+
+		if ((seq != (uint16_t)num) || (record->seq != seq)) {
+			lost++;
+			continue;
+		}
+
+		copy.seq = seq;
+		cb(&copy, user_data);
+	}
+
+	return lost;
+}
+
+void trace_clear(void)
+{
+	atomic_set(&trace_tail, atomic_get(&trace_head));
+}
+
+uint32_t trace_timestamp_rate(void)
+{
+	return cycles_per_sec();
+}
+
+static int trace_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	cycles_enable();
+
+	return 0;
+}
+
+SYS_INIT(trace_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#if defined(CONFIG_BENCH)
+static void bench_trace(void)
+{
+	TRACE(TRACE_BENCH, 0, 0);
+}
+
+BENCH_DEFINE(trace_point, NULL, bench_trace, NULL);
+#endif
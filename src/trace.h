@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef TRACE_H__
+#define TRACE_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Trace point ids. scripts/trace_decode.py reads the names from this enum,
+ * keep one id per line.
+ */
+enum trace_id {
+	TRACE_RGB_SET = 1,         /* layer, clear */
+	TRACE_RGB_WAKE,            /* 0, 0 */
+	TRACE_RGB_LAYER,           /* layer, clear */
+	TRACE_RGB_RENDER,          /* 0, ms to the next edge */
+	TRACE_BUZZER_SET,          /* layer, clear */
+	TRACE_BUZZER_WAKE,         /* 0, 0 */
+	TRACE_BUZZER_LAYER,        /* layer, clear */
+	TRACE_BUZZER_RENDER,       /* 0, ms to the next edge */
+	TRACE_INPUT_GESTURE,       /* device, gesture */
+	TRACE_UPLINK_SEND,         /* length, flags */
+	TRACE_BENCH,               /* 0, 0 */
+};
+
+/**
+ * @brief One trace record, 16 bytes little endian as dumped by the shell.
+ *
+ * seq holds the low bits of the record number, so a record rewritten while
+ * it is read can be told apart.
+ */
+struct trace_record {
+	uint32_t timestamp;
+	uint16_t id;
+	uint16_t seq;
+	uint32_t arg0;
+	uint32_t arg1;
+};
+
+#if defined(CONFIG_TRACEPOINT)
+#define TRACE(_id, _arg0, _arg1) \
+	trace_write(_id, (uint32_t)(_arg0), (uint32_t)(_arg1))
+#else
+#define TRACE(_id, _arg0, _arg1) do { } while (false)
+#endif
+
+/**
+ * @brief Write a trace record, use TRACE() so trace points compile away.
+ *
+ * Lock-free, callable from any context.
+ */
+void trace_write(uint16_t id, uint32_t arg0, uint32_t arg1);
+
+typedef void (*trace_record_cb_t)(const struct trace_record *record, void *user_data);
+
+/**
+ * @brief Walk the records still in the ring, oldest first.
+ *
+ * Tracing goes on meanwhile, a record that is rewritten while it is copied
+ * is skipped.
+ *
+ * @param cb Called with a copy of every record.
+ * @return uint32_t Records written since the last clear that were lost.
+ */
+uint32_t trace_foreach(trace_record_cb_t cb, void *user_data);
+
+/**
+ * @brief Forget all records.
+ */
+void trace_clear(void);
+
+/**
+ * @brief Get the rate of the record timestamps.
+ *
+ * @return uint32_t Ticks per second.
+ */
+uint32_t trace_timestamp_rate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H__ */
@@ -13,6 +13,11 @@
 extern "C" {
 #endif
 
+/* Notes C0..B7, the note index is octave * 12 + semitones above C. */
+#define UI_BUZZER_NOTE_NUM	96
+/* Silence, the buzzer keeps its on/off state. */
+#define UI_BUZZER_NOTE_REST	UINT8_MAX
+
 /**
  * @brief Turn the buzzer on or off. If false the buzzer
  *        will be off regardless of the frequency and the intensity.
@@ -30,6 +35,17 @@ int ui_buzzer_on_off(bool new_state);
  */
 int ui_buzzer_set_frequency(uint32_t freq);
 
+/**
+ * @brief Set the frequency of the buzzer to a note.
+ *
+ * Cheaper than ui_buzzer_set_frequency, the period is looked up.
+ *
+ * @param note Note index below UI_BUZZER_NOTE_NUM, A4 = 57 = 440 Hz,
+ *        or UI_BUZZER_NOTE_REST.
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_buzzer_set_note(uint8_t note);
+
 /**
  * @brief Set the intesity of the buzzer.
  *
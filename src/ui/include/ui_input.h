@@ -12,10 +12,56 @@
 extern "C" {
 #endif
 
+/** @brief Gestures recognised on the input devices. */
+enum ui_input_gesture {
+	/* Button pressed and released once, reported after the double press window. */
+	UI_INPUT_GESTURE_SHORT_PRESS,
+	/* Button pressed again within the double press window. */
+	UI_INPUT_GESTURE_DOUBLE_PRESS,
+	/* Button held down for the long press time. */
+	UI_INPUT_GESTURE_LONG_PRESS,
+	/* Button still held, repeated every hold repeat interval. */
+	UI_INPUT_GESTURE_HOLD_REPEAT,
+	/* On/off-switch turned on or off. */
+	UI_INPUT_GESTURE_SWITCH_ON,
+	UI_INPUT_GESTURE_SWITCH_OFF,
+};
+
+/** @brief One recognised gesture. */
+struct ui_input_event {
+	/* Push-button or on/off-switch number, starting at 1. */
+	uint8_t device_number;
+
+	enum ui_input_gesture gesture;
+
+	/* Hold repeat intervals passed so far, starting at 1. A late wake up
+	 * skips numbers instead of sending the missed events.
+	 */
+	uint16_t repeat;
+	/* Uptime in ms of the edge that started the gesture. */
+	int64_t timestamp;
+};
+
+/** @brief Callback function type for gesture subscribers. */
+typedef void (*ui_input_handler_t)(const struct ui_input_event *event);
+
+/** @brief Latency from the button callback to the subscribers. */
+struct ui_input_latency {
+	/* Gestures published. */
+	uint32_t count;
+
+	/* Latency of the last and of the slowest gesture in us. */
+	uint32_t last_us;
+	uint32_t max_us;
+
+	/* Edges lost because the event queue was full. */
+	uint32_t dropped;
+};
+
 /**
  * @brief Initialize the dk_buttons_and_leds library
- *        with a callback function that submits a ui input event
- *        when a input device's state changes.
+ *        with a callback function that queues the input device's
+ *        state changes for gesture recognition.
  *        The DK buttons library interpret switch state changes as button state changes,
  *        and can thus be used for both.
  *
@@ -23,6 +69,26 @@ extern "C" {
  */
 int ui_input_init(void);
 
+/**
+ * @brief Subscribe to recognised gestures.
+ *
+ * Handlers run in the input thread and should return quickly.
+ *
+ * @param handler Function called for every gesture.
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_input_subscribe(ui_input_handler_t handler);
+
+/**
+ * @brief Get the latency statistics of the gesture pipeline.
+ *
+ * Gestures decided by an edge are measured from the button callback,
+ * gestures decided by a timeout from the end of that timeout.
+ *
+ * @param[out] latency The statistics.
+ */
+void ui_input_latency_get(struct ui_input_latency *latency);
+
 #ifdef __cplusplus
 }
 #endif
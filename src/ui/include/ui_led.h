@@ -60,6 +60,17 @@ int ui_led_pwm_init(void);
  */
 int ui_led_gpio_on_off(uint8_t led_id, bool new_state);
 
+/**
+ * @brief Set the intensity of the LED. Needs CONFIG_UI_LED_SOFT_PWM,
+ *        without it GPIO LEDs are either dark or fully lit.
+ *
+ * @param led_id The ID of the LED. [0, 3].
+ * @param[in] led_intensity Integer between [0, 255], describing
+ *            a percentage of the maximum LED intensity.
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_led_gpio_set_intensity(uint8_t led_id, uint8_t led_intensity);
+
 /**
  * @brief Initialize the LEDs to use GPIO.
  *
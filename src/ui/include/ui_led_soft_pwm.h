@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef UI_LED_SOFT_PWM_H__
+#define UI_LED_SOFT_PWM_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the software PWM engine.
+ *
+ * All channels share one hardware timer. Each PWM period starts by lighting
+ * every channel with a non-zero duty cycle, and one timer interrupt per
+ * distinct duty cycle turns the channels with that duty cycle dark again.
+ * Pins of the same port are written together.
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_led_soft_pwm_init(void);
+
+/**
+ * @brief Hand a GPIO LED over to the engine.
+ *
+ * The pin is configured as an inactive output.
+ *
+ * @param spec The LED pin.
+ * @return int Channel number if successful, negative error code if not.
+ */
+int ui_led_soft_pwm_add(const struct gpio_dt_spec *spec);
+
+/**
+ * @brief Set the duty cycle of a channel.
+ *
+ * Takes effect at the start of the next PWM period.
+ *
+ * @param channel Channel number returned by ui_led_soft_pwm_add.
+ * @param duty Integer between [0, 255], 0 is dark and 255 is fully lit.
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_led_soft_pwm_set(uint8_t channel, uint8_t duty);
+
+/**
+ * @brief Get the longest time spent in the timer interrupt.
+ *
+ * @return uint32_t CPU cycles.
+ */
+uint32_t ui_led_soft_pwm_isr_cycles_max(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UI_LED_SOFT_PWM_H__ */
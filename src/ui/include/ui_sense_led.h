@@ -21,6 +21,16 @@ extern "C" {
  */
 int ui_sense_led_on_off(bool new_state);
 
+/**
+ * @brief Set the colour of the sense LEDs. Needs CONFIG_UI_LED_SOFT_PWM.
+ *
+ * @param[in] red Integer between [0, 255], intensity of the red LED.
+ * @param[in] green Integer between [0, 255], intensity of the green LED.
+ * @param[in] blue Integer between [0, 255], intensity of the blue LED.
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_sense_led_set_color(uint8_t red, uint8_t green, uint8_t blue);
+
 /**
  * @brief Initialize the sense LEDs.
  *
@@ -8,6 +8,9 @@
 #include <zephyr/drivers/pwm.h>
 #include <zephyr/devicetree.h>
 
+#include "ui_buzzer.h"
+#include "ui_buzzer_tables.h"
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(ui_buzzer, CONFIG_UI_LOG_LEVEL);
 
@@ -17,51 +20,27 @@ LOG_MODULE_REGISTER(ui_buzzer, CONFIG_UI_LOG_LEVEL);
 #define FREQUENCY_MAX 10000
 #define INTENSITY_MAX 100
 
-/* Affects curvature of pulse width graph */
-#define CURVE_CONST 50
+BUILD_ASSERT(UI_BUZZER_INTENSITY_NUM == INTENSITY_MAX + 1);
+BUILD_ASSERT(UI_BUZZER_PERIOD_NUM == UI_BUZZER_NOTE_NUM);
 
 static const struct pwm_dt_spec buzzer = PWM_DT_SPEC_GET(DT_NODELABEL(buzzer));
 
-static uint32_t frequency;
+/* Period in microseconds, 0 when the buzzer is silent. */
+static uint32_t period;
+static uint32_t pulse_width;
 static uint8_t intensity;
 static bool state;
 
-/**
- * @brief Calculate pulse width.
- *
- * Perceived sound level is logarithmic with respect to the pulse width.
- * This transformation is exponential to try to get a linear relationship
- * between intensity and perceived sound level.
- *
- * Designed to achieve pulse width = 0 with intensity = 0,
- * and pulse width = period/2 with intensity = 100.
- *
- * @param period Period in microseconds.
- * @param intensity Integer between [0, 100], describing
- * a percentage of the maximum buzzer volume intensity.
- * @return uint32_t Pulse width in microseconds.
- */
-static uint32_t calculate_pulse_width(int32_t period, int32_t intensity)
-{
-	int32_t divisor = CURVE_CONST + ((2 - CURVE_CONST) * intensity) / INTENSITY_MAX;
-	int32_t offset = (period * (INTENSITY_MAX - intensity)) / (CURVE_CONST * INTENSITY_MAX);
-
-	return (uint32_t)(period / divisor - offset);
-}
-
 int ui_buzzer_on_off(bool new_state)
 {
 	int ret;
 
 	state = new_state;
 
-	if (frequency == 0) {
+	if (period == 0) {
 		/* Turn off buzzer when frequency = 0 */
 		ret = pwm_set_pulse_dt(&buzzer, 0);
 	} else {
-		uint32_t period = PERIOD(frequency);
-		uint32_t pulse_width = calculate_pulse_width(period, intensity);
-
 		ret = pwm_set_dt(&buzzer, PWM_USEC(period), PWM_USEC(pulse_width * state));
 	}
 
@@ -73,16 +52,13 @@ int ui_buzzer_on_off(bool new_state)
 	return 0;
 }
 
-int ui_buzzer_set_frequency(uint32_t freq)
+static int retune(uint32_t new_period, uint8_t new_intensity)
 {
 	int ret;
 
-	if (freq > FREQUENCY_MAX) {
-		LOG_ERR("Frequency too high (%d)", -EINVAL);
-		return -EINVAL;
-	}
-
-	frequency = freq;
+	period = new_period;
+	intensity = new_intensity;
+	pulse_width = ui_buzzer_pulse_width(period, intensity);
 
 	if (state) {
 		ret = ui_buzzer_on_off(state);
@@ -95,26 +71,38 @@ int ui_buzzer_set_frequency(uint32_t freq)
 	return 0;
 }
 
-int ui_buzzer_set_intensity(uint8_t new_intensity)
+int ui_buzzer_set_frequency(uint32_t freq)
 {
-	int ret;
+	if (freq > FREQUENCY_MAX) {
+		LOG_ERR("Frequency too high (%d)", -EINVAL);
+		return -EINVAL;
+	}
 
-	if (new_intensity > INTENSITY_MAX) {
-		LOG_ERR("Dutycycle too large (%d)", -EINVAL);
+	return retune((freq == 0) ? 0 : PERIOD(freq), intensity);
+}
+
+int ui_buzzer_set_note(uint8_t note)
+{
+	if (note == UI_BUZZER_NOTE_REST) {
+		return retune(0, intensity);
+	}
+
+	if (note >= UI_BUZZER_NOTE_NUM) {
+		LOG_ERR("Note out of range (%d)", -EINVAL);
 		return -EINVAL;
 	}
 
-	intensity = new_intensity;
+	return retune(ui_buzzer_note_period[note], intensity);
+}
 
-	if (state) {
-		ret = ui_buzzer_on_off(state);
-		if (ret) {
-			LOG_ERR("Set buzzer on/off failed (%d)", ret);
-			return ret;
-		}
+int ui_buzzer_set_intensity(uint8_t new_intensity)
+{
+	if (new_intensity > INTENSITY_MAX) {
+		LOG_ERR("Dutycycle too large (%d)", -EINVAL);
+		return -EINVAL;
 	}
 
-	return 0;
+	return retune(period, new_intensity);
 }
 
 int ui_buzzer_init(void)
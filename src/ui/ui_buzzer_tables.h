@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef UI_BUZZER_TABLES_H__
+#define UI_BUZZER_TABLES_H__
+
+/* Plain C without Zephyr headers, so scripts/ui_buzzer_check.c can build it on the host. */
+#include <stdint.h>
+
+/* Tables generated at build time by scripts/gen_buzzer_tables.py. */
+
+#define UI_BUZZER_PULSE_FRAC_SHIFT	24
+#define UI_BUZZER_INTENSITY_NUM		101
+/* The same as UI_BUZZER_NOTE_NUM. */
+#define UI_BUZZER_PERIOD_NUM		96
+
+/* Pulse width / period per intensity, Q.UI_BUZZER_PULSE_FRAC_SHIFT. */
+extern const uint32_t ui_buzzer_pulse_frac[UI_BUZZER_INTENSITY_NUM];
+
+/* Period in microseconds per note. */
+extern const uint16_t ui_buzzer_note_period[UI_BUZZER_PERIOD_NUM];
+
+/**
+ * @brief Calculate pulse width.
+ *
+ * Perceived sound level is logarithmic with respect to the pulse width.
+ * The curve is exponential to try to get a linear relationship between
+ * intensity and perceived sound level, pulse width = 0 with intensity = 0
+ * and pulse width = period/2 with intensity = 100.
+ *
+ * The curve is tabulated at build time as a fraction of the period, and is
+ * within 1 us of the formula it replaces.
+ *
+ * @param period Period in microseconds.
+ * @param intensity Integer between [0, 100], describing
+ * a percentage of the maximum buzzer volume intensity.
+ * @return uint32_t Pulse width in microseconds.
+ */
+static inline uint32_t ui_buzzer_pulse_width(uint32_t period, uint8_t intensity)
+{
+	uint64_t frac = (uint64_t)period * ui_buzzer_pulse_frac[intensity];
+
+	return (uint32_t)((frac + (1ULL << (UI_BUZZER_PULSE_FRAC_SHIFT - 1))) >>
+			  UI_BUZZER_PULSE_FRAC_SHIFT);
+}
+
+#endif /* UI_BUZZER_TABLES_H__ */
@@ -7,57 +7,380 @@
 #include <zephyr/kernel.h>
 #include <dk_buttons_and_leds.h>
 
-#include "ui_input_event.h"
+#include "ui_input.h"
+#include "trace.h"
+#include "stream.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(ui_input, CONFIG_UI_LOG_LEVEL);
 
+#define UI_INPUT_THREAD_STACK_SIZE 1024
+#define UI_INPUT_THREAD_PRIORITY   K_LOWEST_APPLICATION_THREAD_PRIO - 2
+
+/* Devices 1 and 2 are push-buttons, 3 and 4 are on/off-switches. */
+#define INPUT_DEVICES_NUM 4
+#define INPUT_BUTTONS_NUM 2
+
+#define INPUT_NEVER INT64_MAX
+
+#define QUEUE_SIZE CONFIG_UI_INPUT_QUEUE_SIZE
+#define QUEUE_MASK (QUEUE_SIZE - 1)
+
+BUILD_ASSERT((QUEUE_SIZE & QUEUE_MASK) == 0, "Queue size must be a power of two");
+/* A deadline that does not move would keep timers_process() looping. */
+BUILD_ASSERT(CONFIG_UI_INPUT_HOLD_REPEAT_MS > 0, "Hold repeat interval must not be 0");
+
+/* One state change as seen by the DK buttons callback. */
+struct input_edge {
+	int64_t time;
+	uint32_t cycles;
+	uint8_t device;
+	bool pressed;
+};
+
+enum button_state {
+	BUTTON_IDLE,
+	/* Down, a long press if it stays down until the deadline. */
+	BUTTON_PRESSED,
+	/* Released after a short press, waiting for a second press. */
+	BUTTON_RELEASED,
+	/* Down for the second time, the double press is reported. */
+	BUTTON_SECOND,
+	/* Down past the long press time, repeating. */
+	BUTTON_HELD,
+};
+
+struct input_device {
+	/* Debounced and last raw level. */
+	bool level;
+	bool raw;
+
+	/* Time of the last accepted edge, and when a rejected edge is checked again. */
+	int64_t last_edge;
+	int64_t settle;
+
+	enum button_state state;
+	int64_t deadline;
+	int64_t gesture_start;
+	uint16_t repeat;
+};
+
+/* Single producer, single consumer ring between the DK buttons callback and
+ * the input thread. Each side only writes its own index.
+ */
+static struct input_edge queue[QUEUE_SIZE];
+static atomic_t queue_head;
+static atomic_t queue_tail;
+static atomic_t queue_dropped;
+
+K_SEM_DEFINE(ui_input_sem, 0, 1);
+
+static struct input_device devices[INPUT_DEVICES_NUM];
+
+static ui_input_handler_t subscribers[CONFIG_UI_INPUT_SUBSCRIBERS_MAX];
+static size_t num_subscribers;
+static struct k_spinlock subscribers_lock;
+
+static struct ui_input_latency latency;
+static struct k_spinlock latency_lock;
+
+static bool queue_push(const struct input_edge *edge)
+{
+	atomic_val_t head = atomic_get(&queue_head);
+
+	if ((head - atomic_get(&queue_tail)) >= QUEUE_SIZE) {
+		atomic_inc(&queue_dropped);
+		return false;
+	}
+
+	queue[head & QUEUE_MASK] = *edge;
+	atomic_set(&queue_head, head + 1);
+
+	return true;
+}
+
+static bool queue_pop(struct input_edge *edge)
+{
+	atomic_val_t tail = atomic_get(&queue_tail);
+
+	if (tail == atomic_get(&queue_head)) {
+		return false;
+	}
+
+	*edge = queue[tail & QUEUE_MASK];
+	atomic_set(&queue_tail, tail + 1);
+
+	return true;
+}
+
 /**
  * @brief Callback used by the DK buttons and LEDs library.
  *
- * Submits a ui input event when a input device changes states.
- * The input device can either be a push-button or a on/off-switch.
+ * Queues one edge per changed device and wakes the input thread.
  *
  * @param device_states Bitmask containing the devices' state,
- * i.e. bit 1 corresponds to the state of device 1 etc.
+ * i.e. bit 0 corresponds to the state of device 1 etc.
  * @param has_changed Bitmask indicating whether the devices' state has
- * changed, i.e. bit 1 high corresponds to a change in the state
+ * changed, i.e. bit 0 high corresponds to a change in the state
  * of device 1.
  */
 static void dk_input_device_event_handler(uint32_t device_states, uint32_t has_changed)
 {
-	uint8_t dev_num;
+	struct input_edge edge = {
+		.time = k_uptime_get(),
+		.cycles = k_cycle_get_32(),
+	};
+
+	has_changed &= BIT_MASK(INPUT_DEVICES_NUM);
 
 	while (has_changed) {
-		dev_num = 0;
+		edge.device = __builtin_ctz(has_changed);
+		edge.pressed = (device_states & BIT(edge.device)) != 0;
+
+		/* Clear the lowest set bit. */
+		has_changed &= has_changed - 1;
+
+		(void)queue_push(&edge);
+	}
+
+	k_sem_give(&ui_input_sem);
+}
+
+static void gesture_publish(uint8_t device, enum ui_input_gesture gesture,
+			    uint16_t repeat, uint32_t latency_us)
+{
+	struct ui_input_event event = {
+		.gesture = gesture,
+		.repeat = repeat,
+		.timestamp = devices[device].gesture_start,
+	};
+	k_spinlock_key_t key;
+
+	/* Device numbers as the input events used to have them. */
+	if (device >= INPUT_BUTTONS_NUM) {
+		event.device_number = device - INPUT_BUTTONS_NUM + 1;
+	} else {
+		event.device_number = device + 1;
+	}
+
+	TRACE(TRACE_INPUT_GESTURE, event.device_number, gesture);
+
+	if (stream_channel_enabled(STREAM_CHANNEL_INPUT)) {
+		uint8_t record[4] = { event.device_number, gesture, event.repeat & 0xff,
+				      event.repeat >> 8 };
+
+		(void)stream_write(STREAM_CHANNEL_INPUT, record, sizeof(record));
+	}
+
+	for (size_t i = 0; i < num_subscribers; i++) {
+		subscribers[i](&event);
+	}
+
+	key = k_spin_lock(&latency_lock);
+	latency.count++;
+	latency.last_us = latency_us;
+	latency.max_us = MAX(latency.max_us, latency_us);
+	k_spin_unlock(&latency_lock, key);
+
+	LOG_DBG("Device %u gesture %d, %u us", event.device_number, gesture, latency_us);
+}
+
+static uint32_t edge_latency_us(uint32_t cycles)
+{
+	return k_cyc_to_us_floor32(k_cycle_get_32() - cycles);
+}
+
+static void device_edge(uint8_t index, bool pressed, uint32_t cycles, int64_t now)
+{
+	struct input_device *dev = &devices[index];
+
+	dev->level = pressed;
+	dev->last_edge = now;
+
+	if (index >= INPUT_BUTTONS_NUM) {
+		dev->gesture_start = now;
+		gesture_publish(index, pressed ? UI_INPUT_GESTURE_SWITCH_ON :
+						 UI_INPUT_GESTURE_SWITCH_OFF,
+				0, edge_latency_us(cycles));
+		return;
+	}
+
+	switch (dev->state) {
+	case BUTTON_IDLE:
+		if (pressed) {
+			dev->gesture_start = now;
+			dev->state = BUTTON_PRESSED;
+			dev->deadline = now + CONFIG_UI_INPUT_LONG_PRESS_MS;
+		}
+		break;
+	case BUTTON_PRESSED:
+		if (!pressed) {
+			dev->state = BUTTON_RELEASED;
+			dev->deadline = now + CONFIG_UI_INPUT_DOUBLE_PRESS_MS;
+		}
+		break;
+	case BUTTON_RELEASED:
+		if (pressed) {
+			dev->gesture_start = now;
+			dev->state = BUTTON_SECOND;
+			dev->deadline = INPUT_NEVER;
+			gesture_publish(index, UI_INPUT_GESTURE_DOUBLE_PRESS, 0,
+					edge_latency_us(cycles));
+		}
+		break;
+	case BUTTON_SECOND:
+	case BUTTON_HELD:
+		if (!pressed) {
+			dev->state = BUTTON_IDLE;
+			dev->deadline = INPUT_NEVER;
+		}
+		break;
+	}
+}
+
+static void device_timeout(uint8_t index, int64_t now)
+{
+	struct input_device *dev = &devices[index];
+	uint32_t late_us = (uint32_t)MIN(now - dev->deadline, UINT32_MAX / USEC_PER_MSEC) *
+			   USEC_PER_MSEC;
+	int64_t owed;
+
+	switch (dev->state) {
+	case BUTTON_PRESSED:
+		dev->state = BUTTON_HELD;
+		dev->repeat = 0;
+		dev->deadline += CONFIG_UI_INPUT_HOLD_REPEAT_MS;
+		gesture_publish(index, UI_INPUT_GESTURE_LONG_PRESS, 0, late_us);
+		break;
+	case BUTTON_HELD:
+		/* Repeats owed by a late wake up are counted, not published one by one. */
+		owed = ((now - dev->deadline) / CONFIG_UI_INPUT_HOLD_REPEAT_MS) + 1;
+		dev->repeat += owed;
+		dev->deadline += owed * CONFIG_UI_INPUT_HOLD_REPEAT_MS;
+		gesture_publish(index, UI_INPUT_GESTURE_HOLD_REPEAT, dev->repeat, late_us);
+		break;
+	case BUTTON_RELEASED:
+		dev->state = BUTTON_IDLE;
+		dev->deadline = INPUT_NEVER;
+		gesture_publish(index, UI_INPUT_GESTURE_SHORT_PRESS, 0, late_us);
+		break;
+	default:
+		dev->deadline = INPUT_NEVER;
+		break;
+	}
+}
+
+/**
+ * @brief Debounce one raw edge.
+ *
+ * An edge closer than the debounce time to the last accepted one is not
+ * dropped but checked again once the time has passed, so a release that
+ * bounces is still seen.
+ */
+static void edge_process(const struct input_edge *edge)
+{
+	struct input_device *dev = &devices[edge->device];
+
+	dev->raw = edge->pressed;
+
+	if (dev->raw == dev->level) {
+		dev->settle = INPUT_NEVER;
+	} else if ((edge->time - dev->last_edge) >= CONFIG_UI_INPUT_DEBOUNCE_MS) {
+		dev->settle = INPUT_NEVER;
+		device_edge(edge->device, edge->pressed, edge->cycles, edge->time);
+	} else {
+		dev->settle = dev->last_edge + CONFIG_UI_INPUT_DEBOUNCE_MS;
+	}
+}
+
+static int64_t timers_process(int64_t now)
+{
+	int64_t next = INPUT_NEVER;
 
-		/* Get bit position for next device that changed state. */
-		for (uint8_t i = 0; i < 32; i++) {
-			if (has_changed & BIT(i)) {
-				dev_num = i + 1;
-				break;
+	for (uint8_t i = 0; i < INPUT_DEVICES_NUM; i++) {
+		struct input_device *dev = &devices[i];
+
+		if (dev->settle <= now) {
+			dev->settle = INPUT_NEVER;
+			if (dev->raw != dev->level) {
+				device_edge(i, dev->raw, k_cycle_get_32(), now);
 			}
 		}
 
-		if (dev_num == 0) {
-			return;
+		/* At most a long press and then the owed hold repeats at once. */
+		while (dev->deadline <= now) {
+			device_timeout(i, now);
 		}
 
-		/* Device number has been stored, remove from bitmask. */
-		has_changed &= ~(1UL << (dev_num - 1));
+		next = MIN(next, MIN(dev->settle, dev->deadline));
+	}
+
+	return next;
+}
 
-		struct ui_input_event *event = new_ui_input_event();
+static void ui_input_task(void)
+{
+	struct input_edge edge;
+	int64_t next = INPUT_NEVER;
+	k_timeout_t wait;
+
+	for (uint8_t i = 0; i < INPUT_DEVICES_NUM; i++) {
+		devices[i].last_edge = INT64_MIN / 2;
+		devices[i].settle = INPUT_NEVER;
+		devices[i].deadline = INPUT_NEVER;
+	}
 
-		event->type = dev_num > 2 ? ON_OFF_SWITCH : PUSH_BUTTON;
-		if (dev_num > 2) {
-			event->device_number = (dev_num % 3) + 1;
+	for (;;) {
+		if (next == INPUT_NEVER) {
+			wait = K_FOREVER;
 		} else {
-			event->device_number = dev_num;
+			wait = K_MSEC(MAX(next - k_uptime_get(), 0));
 		}
-		event->state = (device_states & BIT(dev_num - 1));
 
-		APP_EVENT_SUBMIT(event);
+		(void)k_sem_take(&ui_input_sem, wait);
+
+		while (queue_pop(&edge)) {
+			edge_process(&edge);
+		}
+
+		next = timers_process(k_uptime_get());
+	}
+}
+
+K_THREAD_DEFINE(ui_input_thread, UI_INPUT_THREAD_STACK_SIZE,
+		ui_input_task, NULL, NULL, NULL,
+		UI_INPUT_THREAD_PRIORITY, 0, 0);
+
+int ui_input_subscribe(ui_input_handler_t handler)
+{
+	k_spinlock_key_t key;
+	int ret = 0;
+
+	if (handler == NULL) {
+		return -EINVAL;
 	}
+
+	key = k_spin_lock(&subscribers_lock);
+
+	if (num_subscribers < ARRAY_SIZE(subscribers)) {
+		subscribers[num_subscribers++] = handler;
+	} else {
+		ret = -ENOMEM;
+	}
+
+	k_spin_unlock(&subscribers_lock, key);
+
+	return ret;
+}
+
+void ui_input_latency_get(struct ui_input_latency *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&latency_lock);
+
+	*out = latency;
+	out->dropped = atomic_get(&queue_dropped);
+
+	k_spin_unlock(&latency_lock, key);
 }
 
 int ui_input_init(void)
@@ -9,6 +9,7 @@
 #include <zephyr/drivers/gpio.h>
 
 #include "ui_led.h"
+#include "ui_led_soft_pwm.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(ui_led, CONFIG_UI_LOG_LEVEL);
@@ -31,6 +32,11 @@ static const struct gpio_dt_spec leds[] = {
 	GPIO_DT_SPEC_GET_OR(DT_ALIAS(led3), gpios, {}),
 };
 
+/* With the software PWM the GPIO LEDs are driven through its channels. */
+static int soft_pwm_channel[ARRAY_SIZE(leds)];
+static uint8_t gpio_intensity[ARRAY_SIZE(leds)];
+static bool gpio_state[ARRAY_SIZE(leds)];
+
 int ui_led_pwm_on_off(uint8_t led_num, bool new_state)
 {
 	int ret;
@@ -97,6 +103,12 @@ int ui_led_gpio_on_off(uint8_t led_num, bool new_state)
 		return -EINVAL;
 	}
 
+	if (IS_ENABLED(CONFIG_UI_LED_SOFT_PWM)) {
+		gpio_state[led_num] = new_state;
+		return ui_led_soft_pwm_set(soft_pwm_channel[led_num],
+					   gpio_intensity[led_num] * new_state);
+	}
+
 	ret = gpio_pin_set_dt(&leds[led_num], new_state);
 	if (ret) {
 		LOG_ERR("Set LED %u pin failed (%d)", led_num, ret);
@@ -106,11 +118,50 @@ int ui_led_gpio_on_off(uint8_t led_num, bool new_state)
 	return 0;
 }
 
+int ui_led_gpio_set_intensity(uint8_t led_num, uint8_t led_intensity)
+{
+	if (!IS_ENABLED(CONFIG_UI_LED_SOFT_PWM)) {
+		return -ENOTSUP;
+	}
+
+	if (led_num >= ARRAY_SIZE(leds) || leds[led_num].port == NULL) {
+		return -EINVAL;
+	}
+
+	gpio_intensity[led_num] = led_intensity;
+
+	return ui_led_soft_pwm_set(soft_pwm_channel[led_num],
+				   led_intensity * gpio_state[led_num]);
+}
+
 int ui_led_gpio_init(void)
 {
 	int ret;
 
+	if (IS_ENABLED(CONFIG_UI_LED_SOFT_PWM)) {
+		ret = ui_led_soft_pwm_init();
+		if (ret) {
+			return ret;
+		}
+	}
+
 	for (size_t i = 0; i < ARRAY_SIZE(leds); ++i) {
+		if (IS_ENABLED(CONFIG_UI_LED_SOFT_PWM)) {
+			if (leds[i].port == NULL) {
+				continue;
+			}
+
+			ret = ui_led_soft_pwm_add(&leds[i]);
+			if (ret < 0) {
+				LOG_ERR("Add LED %d to soft PWM failed (%d)", i, ret);
+				return ret;
+			}
+
+			soft_pwm_channel[i] = ret;
+			gpio_intensity[i] = UINT8_MAX;
+			continue;
+		}
+
 		if (leds[i].port != NULL && !device_is_ready(leds[i].port)) {
 			return -ENODEV;
 		}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/counter.h>
+#include <zephyr/drivers/gpio.h>
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+#include <zephyr/arch/arm/aarch32/cortex_m/cmsis.h>
+#endif
+
+#include "ui_led_soft_pwm.h"
+#include "ui_led_soft_pwm_schedule.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(ui_led_soft_pwm, CONFIG_UI_LOG_LEVEL);
+
+#define CHANNELS_MAX CONFIG_UI_LED_SOFT_PWM_CHANNELS
+#define PORTS_MAX UI_LED_SOFT_PWM_PORTS_MAX
+#define DUTY_STEPS UI_LED_SOFT_PWM_DUTY_STEPS
+
+BUILD_ASSERT(sizeof(gpio_port_value_t) == sizeof(uint32_t), "Port levels are 32 bits");
+
+/* Time from starting the engine to its first period. */
+#define START_DELAY_USEC 100
+
+static const struct device *const timer = DEVICE_DT_GET(DT_ALIAS(ui_led_pwm_timer));
+
+struct soft_pwm_port {
+	const struct device *dev;
+	gpio_port_pins_t mask;
+};
+
+/* The events of one period, see ui_led_soft_pwm_schedule_build(). */
+struct soft_pwm_schedule {
+	uint8_t num_events;
+	struct ui_led_soft_pwm_event event[CHANNELS_MAX + 1];
+};
+
+static struct soft_pwm_port ports[PORTS_MAX];
+static uint32_t active_low[PORTS_MAX];
+static uint8_t num_ports;
+static struct ui_led_soft_pwm_channel channels[CHANNELS_MAX];
+static uint8_t duty[CHANNELS_MAX];
+static uint8_t num_channels;
+
+/* The interrupt runs the active schedule and switches to the pending one
+ * at the start of a period, so a period is never cut short.
+ */
+static struct soft_pwm_schedule schedules[2];
+static struct soft_pwm_schedule *active = &schedules[0];
+static struct soft_pwm_schedule *pending;
+static uint8_t next_event;
+static uint32_t period_start;
+static uint32_t period_ticks;
+static bool running;
+static uint32_t isr_cycles_max;
+static struct k_spinlock lock;
+
+static inline uint32_t cycles_get(void)
+{
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+	return DWT->CYCCNT;
+#else
+	return k_cycle_get_32();
+#endif
+}
+
+static void levels_write(const gpio_port_value_t *level)
+{
+	for (uint8_t p = 0; p < num_ports; p++) {
+		(void)gpio_port_set_masked_raw(ports[p].dev, ports[p].mask, level[p]);
+	}
+}
+
+static void schedule_build(struct soft_pwm_schedule *schedule)
+{
+	const struct ui_led_soft_pwm_layout layout = {
+		.channels = channels,
+		.duty = duty,
+		.num_channels = num_channels,
+		.active_low = active_low,
+		.num_ports = num_ports,
+		.period_ticks = period_ticks,
+	};
+
+	schedule->num_events = ui_led_soft_pwm_schedule_build(&layout, schedule->event);
+}
+
+static void alarm_set(uint32_t ticks);
+
+static void soft_pwm_alarm(const struct device *dev, uint8_t chan_id,
+			   uint32_t ticks, void *user_data)
+{
+	uint32_t start = cycles_get();
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if ((next_event == 0) && (pending != NULL)) {
+		active = pending;
+		pending = NULL;
+	}
+
+	levels_write(active->event[next_event].level);
+
+	if (active->num_events == 1) {
+		/* Nothing to darken within the period, the levels can just stay. */
+		running = false;
+		(void)counter_stop(timer);
+	} else if (++next_event < active->num_events) {
+		alarm_set(period_start + active->event[next_event].offset);
+	} else {
+		next_event = 0;
+		period_start += period_ticks;
+		alarm_set(period_start);
+	}
+
+	k_spin_unlock(&lock, key);
+
+	isr_cycles_max = MAX(isr_cycles_max, cycles_get() - start);
+}
+
+static void alarm_set(uint32_t ticks)
+{
+	struct counter_alarm_cfg alarm = {
+		.callback = soft_pwm_alarm,
+		.ticks = ticks,
+		.flags = COUNTER_ALARM_CFG_ABSOLUTE | COUNTER_ALARM_CFG_EXPIRE_WHEN_LATE,
+	};
+	int ret;
+
+	ret = counter_set_channel_alarm(timer, 0, &alarm);
+	if (ret) {
+		LOG_ERR("Set soft PWM alarm failed (%d)", ret);
+	}
+}
+
+static void soft_pwm_start(void)
+{
+	uint32_t now;
+	int ret;
+
+	ret = counter_start(timer);
+	if (ret == 0) {
+		ret = counter_get_value(timer, &now);
+	}
+	if (ret) {
+		LOG_ERR("Start soft PWM timer failed (%d)", ret);
+		return;
+	}
+
+	running = true;
+	next_event = 0;
+	period_start = now + counter_us_to_ticks(timer, START_DELAY_USEC);
+	alarm_set(period_start);
+}
+
+int ui_led_soft_pwm_set(uint8_t channel, uint8_t new_duty)
+{
+	struct soft_pwm_schedule *schedule;
+	k_spinlock_key_t key;
+
+	if (channel >= num_channels) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&lock);
+
+	duty[channel] = new_duty;
+
+	schedule = (active == &schedules[0]) ? &schedules[1] : &schedules[0];
+	schedule_build(schedule);
+
+	if (running) {
+		pending = schedule;
+	} else {
+		active = schedule;
+		levels_write(schedule->event[0].level);
+		if (schedule->num_events > 1) {
+			soft_pwm_start();
+		}
+	}
+
+	k_spin_unlock(&lock, key);
+
+	return 0;
+}
+
+int ui_led_soft_pwm_add(const struct gpio_dt_spec *spec)
+{
+	k_spinlock_key_t key;
+	uint8_t p;
+	int ret;
+
+	if (num_channels >= CHANNELS_MAX) {
+		return -ENOMEM;
+	}
+
+	if (!device_is_ready(spec->port)) {
+		return -ENODEV;
+	}
+
+	for (p = 0; p < num_ports; p++) {
+		if (ports[p].dev == spec->port) {
+			break;
+		}
+	}
+	if (p == PORTS_MAX) {
+		return -ENOMEM;
+	}
+
+	ret = gpio_pin_configure_dt(spec, GPIO_OUTPUT_INACTIVE);
+	if (ret) {
+		LOG_ERR("Configure soft PWM pin %u failed (%d)", spec->pin, ret);
+		return ret;
+	}
+
+	key = k_spin_lock(&lock);
+
+	if (p == num_ports) {
+		ports[p].dev = spec->port;
+		num_ports++;
+	}
+
+	ports[p].mask |= BIT(spec->pin);
+	if (spec->dt_flags & GPIO_ACTIVE_LOW) {
+		active_low[p] |= BIT(spec->pin);
+	}
+
+	channels[num_channels].port = p;
+	channels[num_channels].pin = BIT(spec->pin);
+	duty[num_channels] = 0;
+	ret = num_channels++;
+
+	k_spin_unlock(&lock, key);
+
+	return ret;
+}
+
+uint32_t ui_led_soft_pwm_isr_cycles_max(void)
+{
+	return isr_cycles_max;
+}
+
+int ui_led_soft_pwm_init(void)
+{
+	static bool initialised;
+
+	if (initialised) {
+		return 0;
+	}
+
+	if (!device_is_ready(timer)) {
+		LOG_ERR("Soft PWM timer not ready");
+		return -ENODEV;
+	}
+
+	period_ticks = counter_us_to_ticks(timer,
+					   USEC_PER_SEC / CONFIG_UI_LED_SOFT_PWM_FREQUENCY);
+	if (period_ticks < DUTY_STEPS) {
+		LOG_WRN("Soft PWM timer too slow for 8-bit duty cycles");
+	}
+
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT)
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+	initialised = true;
+
+	return 0;
+}
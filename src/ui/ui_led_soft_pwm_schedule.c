@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "ui_led_soft_pwm_schedule.h"
+
+static void levels_above(const struct ui_led_soft_pwm_layout *layout, uint8_t threshold,
+			 uint32_t *level)
+{
+	for (uint8_t p = 0; p < layout->num_ports; p++) {
+		level[p] = 0;
+	}
+
+	for (uint8_t ch = 0; ch < layout->num_channels; ch++) {
+		if (layout->duty[ch] > threshold) {
+			level[layout->channels[ch].port] |= layout->channels[ch].pin;
+		}
+	}
+
+	for (uint8_t p = 0; p < layout->num_ports; p++) {
+		level[p] ^= layout->active_low[p];
+	}
+}
+
+uint8_t ui_led_soft_pwm_schedule_build(const struct ui_led_soft_pwm_layout *layout,
+				       struct ui_led_soft_pwm_event *event)
+{
+	uint8_t num_events = 0;
+	uint8_t threshold = 0;
+	uint8_t next;
+
+	for (;;) {
+		struct ui_led_soft_pwm_event *e = &event[num_events++];
+
+		e->offset = (uint32_t)(((uint64_t)layout->period_ticks * threshold) /
+				       UI_LED_SOFT_PWM_DUTY_STEPS);
+		levels_above(layout, threshold, e->level);
+
+		/* Channels at full duty are never darkened. */
+		next = UI_LED_SOFT_PWM_DUTY_FULL;
+		for (uint8_t ch = 0; ch < layout->num_channels; ch++) {
+			if ((layout->duty[ch] > threshold) && (layout->duty[ch] < next)) {
+				next = layout->duty[ch];
+			}
+		}
+
+		if (next == UI_LED_SOFT_PWM_DUTY_FULL) {
+			return num_events;
+		}
+
+		threshold = next;
+	}
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef UI_LED_SOFT_PWM_SCHEDULE_H__
+#define UI_LED_SOFT_PWM_SCHEDULE_H__
+
+/* Plain C without Zephyr headers, so scripts/ui_led_soft_pwm_check.c can build it on the host. */
+#include <stdint.h>
+
+#define UI_LED_SOFT_PWM_PORTS_MAX	2
+#define UI_LED_SOFT_PWM_DUTY_STEPS	256U
+#define UI_LED_SOFT_PWM_DUTY_FULL	UINT8_MAX
+
+/* A channel is one pin, a bit of the port value as gpio_port_pins_t. */
+struct ui_led_soft_pwm_channel {
+	uint8_t port;
+	uint32_t pin;
+};
+
+/* Raw levels of every port at one point in the period. */
+struct ui_led_soft_pwm_event {
+	/* Timer ticks from the start of the period. */
+	uint32_t offset;
+	uint32_t level[UI_LED_SOFT_PWM_PORTS_MAX];
+};
+
+/* What a schedule is built from. */
+struct ui_led_soft_pwm_layout {
+	const struct ui_led_soft_pwm_channel *channels;
+	const uint8_t *duty;
+	uint8_t num_channels;
+	/* Active low pins per port, their raw level is inverted. */
+	const uint32_t *active_low;
+	uint8_t num_ports;
+	uint32_t period_ticks;
+};
+
+/**
+ * @brief Build the events of one PWM period.
+ *
+ * Event 0 lights all channels with a non-zero duty cycle at the start of
+ * the period, every further event darkens the channels of one duty cycle,
+ * in rising order. Channels at full duty are never darkened.
+ *
+ * @param layout The channels, their duty cycles and the ports.
+ * @param event Room for num_channels + 1 events.
+ * @return uint8_t Number of events, 1 if the levels stay all period.
+ */
+uint8_t ui_led_soft_pwm_schedule_build(const struct ui_led_soft_pwm_layout *layout,
+				       struct ui_led_soft_pwm_event *event);
+
+#endif /* UI_LED_SOFT_PWM_SCHEDULE_H__ */
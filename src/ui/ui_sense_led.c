@@ -9,6 +9,9 @@
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/gpio.h>
 
+#include "ui_sense_led.h"
+#include "ui_led_soft_pwm.h"
+
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(ui_sense_led, CONFIG_UI_LOG_LEVEL);
 
@@ -19,10 +22,48 @@ static const struct gpio_dt_spec green_led =
 static const struct gpio_dt_spec blue_led =
 	GPIO_DT_SPEC_GET(DT_NODELABEL(sense_blue_led), gpios);
 
+/* Software PWM channels and colour of red, green and blue. */
+static int soft_pwm_channel[3];
+static uint8_t color[3] = { UINT8_MAX, UINT8_MAX, UINT8_MAX };
+static bool state;
+
+static int soft_pwm_update(void)
+{
+	int ret;
+
+	for (size_t i = 0; i < ARRAY_SIZE(soft_pwm_channel); i++) {
+		ret = ui_led_soft_pwm_set(soft_pwm_channel[i], color[i] * state);
+		if (ret) {
+			LOG_ERR("Set soft PWM channel %d failed (%d)", i, ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+int ui_sense_led_set_color(uint8_t red, uint8_t green, uint8_t blue)
+{
+	if (!IS_ENABLED(CONFIG_UI_LED_SOFT_PWM)) {
+		return -ENOTSUP;
+	}
+
+	color[0] = red;
+	color[1] = green;
+	color[2] = blue;
+
+	return soft_pwm_update();
+}
+
 int ui_sense_led_on_off(bool new_state)
 {
 	int ret;
 
+	if (IS_ENABLED(CONFIG_UI_LED_SOFT_PWM)) {
+		state = new_state;
+		return soft_pwm_update();
+	}
+
 	ret = gpio_pin_set_dt(&red_led, (int)new_state);
 	if (ret) {
 		LOG_ERR("Set red pin failed (%d)", ret);
@@ -51,6 +92,26 @@ int ui_sense_led_init(void)
 		return -ENODEV;
 	}
 
+	if (IS_ENABLED(CONFIG_UI_LED_SOFT_PWM)) {
+		const struct gpio_dt_spec *pins[] = { &red_led, &green_led, &blue_led };
+
+		ret = ui_led_soft_pwm_init();
+		if (ret) {
+			return ret;
+		}
+
+		for (size_t i = 0; i < ARRAY_SIZE(pins); i++) {
+			ret = ui_led_soft_pwm_add(pins[i]);
+			if (ret < 0) {
+				LOG_ERR("Add sense LED %d to soft PWM failed (%d)", i, ret);
+				return ret;
+			}
+			soft_pwm_channel[i] = ret;
+		}
+
+		return 0;
+	}
+
 	ret = gpio_pin_configure_dt(&red_led, GPIO_OUTPUT_INACTIVE);
 	if (ret) {
 		LOG_ERR("Configure red pin failed (%d)", ret);
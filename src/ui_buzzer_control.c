@@ -6,121 +6,243 @@
 
 #include <zephyr/kernel.h>
 #include <stdio.h>
+#include <string.h>
 #include "ui_buzzer.h"
 #include "ui_buzzer_control.h"
+#include "ui_melody.h"
+#include "ui_layers.h"
+#include "perf_stats.h"
+#include "trace.h"
+#include "stream.h"
 
-K_MSGQ_DEFINE(ui_buzzer_control_msgq, sizeof(ui_buzzer_control_message), 5, 4);
-
-#define UI_BUZZER_CONTROL_WORK_Q_STACK_SIZE 512
-#define UI_BUZZER_CONTROL_WORK_Q_PRIORITY      K_LOWEST_APPLICATION_THREAD_PRIO
-K_THREAD_STACK_DEFINE(ui_buzzer_control_work_q_stack, UI_BUZZER_CONTROL_WORK_Q_STACK_SIZE);
-static struct k_work_q ui_buzzer_control_work_q;
-
-static struct k_work_delayable buzzer_open_dwork;
-static struct k_work_delayable buzzer_close_dwork;
-static struct k_work_delayable buzzer_set_color_dwork;
-static struct k_work_delayable buzzer_interval_dwork;
+/* Given by producers whenever a mailbox has been written. */
+K_SEM_DEFINE(ui_buzzer_control_sem, 0, 1);
 
 /******* user ui effect thread *******/
 #define UI_BUZZER_CONTROL_THREAD_STACK_SIZE 512
 #define UI_BUZZER_CONTROL_THREAD_PRIORITY      K_LOWEST_APPLICATION_THREAD_PRIO - 1
 
-static int16_t total_lift_span_cnt = 0;
-static ui_buzzer_control_message message;
+/* Not a note of ui_buzzer_set_note, the tone frequency is played instead. */
+#define BUZZER_NO_NOTE (UI_BUZZER_NOTE_REST - 1)
+
+/* Effects of the layers, their timing is kept by ui_layers. */
+struct buzzer_layer {
+    struct ui_buzzer_control_tone   tone;
+    struct ui_buzzer_control_effect effect;
+    /* Interpreter state of UI_BUZZER_CONTROL_TYPE_MELODY. */
+    struct ui_melody_player player;
+    struct ui_melody_note note;
+    int64_t note_end;
+    uint32_t melody_length;
+    /* Own copy of a melody given by value, the producer may reuse its buffer. */
+    struct ui_melody melody;
+    uint8_t code[UI_BUZZER_CONTROL_MELODY_SIZE];
+};
+
+PERF_STATS_QUEUE_DEFINE(ui_buzzer_control_mailbox);
+
+static void buzzer_update(struct ui_layers *l, int index, const void *msg,
+                          uint32_t replaced, int64_t now);
+static int64_t buzzer_render(struct ui_layers *l, int index, int64_t now);
+
+/* Mailbox slots, two per layer, and the copy the control thread takes. */
+static ui_buzzer_control_message messages[UI_BUZZER_CONTROL_LAYER_NUM][2];
+static ui_buzzer_control_message taken;
+
+static struct ui_layers buzzer_layers = {
+    .messages = messages,
+    .message_size = sizeof(ui_buzzer_control_message),
+    .scratch = &taken,
+    .update = buzzer_update,
+    .render = buzzer_render,
+};
 
-static void buzzer_open_dwork_fn(struct k_work *work)
+/* Serialises producers of the same layer, the consumer never takes it. */
+static struct k_spinlock post_lock[UI_BUZZER_CONTROL_LAYER_NUM];
+
+/* Layer effects and output state are only touched by the control thread. */
+static struct buzzer_layer layers[UI_BUZZER_CONTROL_LAYER_NUM];
+
+BUILD_ASSERT(UI_BUZZER_CONTROL_LAYER_NUM == UI_LAYERS_NUM);
+BUILD_ASSERT(UI_MELODY_NOTE_REST == UI_BUZZER_NOTE_REST);
+
+static struct ui_buzzer_control_tone played_tone;
+static uint8_t played_note = BUZZER_NO_NOTE;
+static bool played_on;
+static bool played_valid;
+
+/**
+ * @brief Drive the buzzer, writing only what changed.
+ *
+ * @param note Note of a melody, BUZZER_NO_NOTE to play tone.frequency.
+ */
+static void buzzer_output(struct ui_buzzer_control_tone tone, uint8_t note, bool on)
 {
-    //printk("buzzer_open_dwork_fn\n");
-    ui_buzzer_on_off(true);   
+    if (note != BUZZER_NO_NOTE) {
+        if (!played_valid || (note != played_note)) {
+            ui_buzzer_set_note(note);
+        }
+    } else if (!played_valid || (played_note != BUZZER_NO_NOTE) ||
+               (tone.frequency != played_tone.frequency)) {
+        ui_buzzer_set_frequency(tone.frequency);
+    }
+    played_note = note;
+
+    if (!played_valid || (tone.intensity != played_tone.intensity)) {
+        ui_buzzer_set_intensity(tone.intensity);
+    }
+    played_tone = tone;
+
+    if (!played_valid || (on != played_on)) {
+        ui_buzzer_on_off(on);
+        played_on = on;
+    }
+
+    played_valid = true;
+
+    if (stream_channel_enabled(STREAM_CHANNEL_BUZZER)) {
+        uint8_t record[5] = { tone.frequency & 0xff, (tone.frequency >> 8) & 0xff,
+                              note, tone.intensity, on };
+
+        (void)stream_write(STREAM_CHANNEL_BUZZER, record, sizeof(record));
+    }
 }
 
-static void buzzer_close_dwork_fn(struct k_work *work)
+/**
+ * @brief Advance the melody of a layer to the note playing now.
+ *
+ * Notes that ended while the layer was masked are skipped, so the melody
+ * continues where it would have been. A melody restarts when it runs out,
+ * the layer expiry ends it.
+ *
+ * @param[out] to_edge Time in ms until the next note, UI_LAYERS_NEVER if never.
+ * @return uint8_t The note, UI_BUZZER_NOTE_REST for a rest.
+ */
+static uint8_t buzzer_melody_step(struct buzzer_layer *layer, int64_t now,
+                                   int64_t *to_edge)
 {
-    //printk("buzzer_close_dwork_fn\n");
-    ui_buzzer_on_off(false); 
+    /* A pass that adds no time would never move note_end. */
+    if (layer->melody_length == 0) {
+        *to_edge = UI_LAYERS_NEVER;
+        return UI_BUZZER_NOTE_REST;
+    }
+
+    if (now - layer->note_end > layer->melody_length) {
+        layer->note_end += ((now - layer->note_end) / layer->melody_length) *
+                           layer->melody_length;
+    }
+
+    while (now >= layer->note_end) {
+        if (ui_melody_player_next(&layer->player, &layer->note)) {
+            ui_melody_player_start(&layer->player, layer->tone.melody);
+            if (ui_melody_player_next(&layer->player, &layer->note)) {
+                *to_edge = UI_LAYERS_NEVER;
+                return UI_BUZZER_NOTE_REST;
+            }
+        }
+        layer->note_end += layer->note.duration;
+    }
+
+    *to_edge = layer->note_end - now;
+
+    return layer->note.note;
 }
 
-static void buzzer_set_color_dwork_fn(struct k_work *work)
+static void buzzer_post(uint8_t layer, const ui_buzzer_control_message *msg)
 {
-    //printk("buzzer_set_color_dwork_fn\n");
-	ui_buzzer_set_frequency(message.tone.frequency);
-	ui_buzzer_set_intensity(message.tone.intensity); 
+    k_spinlock_key_t key = k_spin_lock(&post_lock[layer]);
+
+    ui_layers_post(&buzzer_layers, layer, msg);
+    perf_stats_queue_posted(&ui_buzzer_control_mailbox);
+
+    k_spin_unlock(&post_lock[layer], key);
+
+    k_sem_give(&ui_buzzer_control_sem);
 }
 
-static void buzzer_interval_dwork_fn(struct k_work *work)
+static void buzzer_update(struct ui_layers *l, int index, const void *msg_in,
+                          uint32_t replaced, int64_t now)
 {
-    //printk("buzzer_interval_dwork_fn\n");
-    uint32_t duty_value;
-    k_timeout_t delay_value;
-   
-    k_work_schedule_for_queue(&ui_buzzer_control_work_q, &buzzer_set_color_dwork, K_NO_WAIT);
-    k_work_schedule_for_queue(&ui_buzzer_control_work_q, &buzzer_open_dwork, K_NO_WAIT);
-
-    if(message.effect.interval > 5) {
-        duty_value = (uint32_t)message.effect.interval * message.effect.duty;
-        duty_value = duty_value / 100;
-        delay_value = K_SECONDS(duty_value);
-    }
-    else {
-        duty_value = (uint32_t)message.effect.interval * 1000 * message.effect.duty;
-        duty_value = duty_value / 100;
-        delay_value = K_MSEC(duty_value);       
-    }
-
-    k_work_schedule_for_queue(&ui_buzzer_control_work_q, &buzzer_close_dwork, delay_value);
-
-    if(message.effect.duration > 0) {
-        total_lift_span_cnt = total_lift_span_cnt - message.effect.interval;
-        if(total_lift_span_cnt > 0) {
-            k_work_schedule_for_queue(&ui_buzzer_control_work_q, &buzzer_interval_dwork, 
-                                      K_SECONDS(message.effect.interval));
-        }
-        else {
-            total_lift_span_cnt = 0;
+    const ui_buzzer_control_message *msg = msg_in;
+    struct buzzer_layer *layer = &layers[index];
+
+    perf_stats_queue_taken(&ui_buzzer_control_mailbox, replaced);
+    TRACE(TRACE_BUZZER_LAYER, index, msg->clear);
+
+    if (msg->clear) {
+        l->layer[index].active = false;
+        return;
+    }
+
+    layer->tone = msg->tone;
+    layer->effect = msg->effect;
+    if (msg->code_len > 0) {
+        memcpy(layer->code, msg->code, msg->code_len);
+        layer->melody.name = "copy";
+        layer->melody.code = layer->code;
+        layer->melody.len = msg->code_len;
+        layer->tone.melody = &layer->melody;
+    }
+    ui_layers_start(&l->layer[index], now, (uint32_t)msg->effect.duration * MSEC_PER_SEC);
+
+    if (msg->effect.type == UI_BUZZER_CONTROL_TYPE_MELODY) {
+        ui_melody_player_start(&layer->player, layer->tone.melody);
+        layer->note_end = now;
+        layer->melody_length = ui_melody_length_ms(layer->tone.melody);
+        if (msg->effect.duration == 0) {
+            l->layer[index].expiry = now + layer->melody_length;
         }
     }
-    else {
-        k_work_schedule_for_queue(&ui_buzzer_control_work_q, &buzzer_interval_dwork, 
-                                  K_SECONDS(message.effect.interval));
-    }    
+}
+
+static int64_t buzzer_render(struct ui_layers *l, int index, int64_t now)
+{
+    struct buzzer_layer *top;
+    uint8_t note = BUZZER_NO_NOTE;
+    int64_t to_edge = UI_LAYERS_NEVER;
+    bool on = true;
+
+    if (index < 0) {
+        buzzer_output(played_tone, played_note, false);
+        return UI_LAYERS_NEVER;
+    }
+
+    top = &layers[index];
+    if (top->effect.type == UI_BUZZER_CONTROL_TYPE_BLINKY) {
+        on = ui_layers_blinky_phase(top->effect.interval, top->effect.duty,
+                                    now - l->layer[index].start, &to_edge);
+    } else if (top->effect.type == UI_BUZZER_CONTROL_TYPE_MELODY) {
+        /* Notes only retune the running PWM, there is no gap between them. */
+        note = buzzer_melody_step(top, now, &to_edge);
+    }
+
+    buzzer_output(top->tone, note, on);
+
+    return (to_edge == UI_LAYERS_NEVER) ? UI_LAYERS_NEVER : (now + to_edge);
 }
 
 static void ui_buzzer_control_task(void)
 {
-    struct k_work_sync sync;
+    int64_t next_edge = UI_LAYERS_NEVER;
+    int64_t now;
+    k_timeout_t wait;
 
     printk("ui_buzzer_control_task initial\n");
-    k_work_queue_init(&ui_buzzer_control_work_q);
-    k_work_queue_start(&ui_buzzer_control_work_q, ui_buzzer_control_work_q_stack,
-                        K_THREAD_STACK_SIZEOF(ui_buzzer_control_work_q_stack), 
-                        UI_BUZZER_CONTROL_WORK_Q_PRIORITY,
-                        NULL);
-
-    k_work_init_delayable(&buzzer_open_dwork, buzzer_open_dwork_fn);
-    k_work_init_delayable(&buzzer_close_dwork, buzzer_close_dwork_fn);
-    k_work_init_delayable(&buzzer_set_color_dwork, buzzer_set_color_dwork_fn);
-    k_work_init_delayable(&buzzer_interval_dwork, buzzer_interval_dwork_fn);
-
-	for (;;) {                                   
-        k_msgq_get(&ui_buzzer_control_msgq, &message, K_FOREVER);
-        printk("ui_buzzer_control_task get a message from msgq\n");
-        k_work_cancel_delayable_sync(&buzzer_close_dwork, &sync);
-        k_work_cancel_delayable_sync(&buzzer_interval_dwork, &sync);
-
-        if(message.effect.type == UI_BUZZER_CONTROL_TYPE_CONTINUE){
-            printk("message.effect.type == UI_BUZZER_CONTROL_TYPE_CONTINUE\n");
-            k_work_schedule_for_queue(&ui_buzzer_control_work_q, &buzzer_set_color_dwork, K_NO_WAIT);
-            k_work_schedule_for_queue(&ui_buzzer_control_work_q, &buzzer_open_dwork, K_NO_WAIT);
-            if(message.effect.duration > 0) {
-                k_work_schedule_for_queue(&ui_buzzer_control_work_q, &buzzer_close_dwork,
-                                        K_SECONDS(message.effect.duration));
-            }
+
+	for (;;) {
+        if (next_edge == UI_LAYERS_NEVER) {
+            wait = K_FOREVER;
+        } else {
+            wait = K_MSEC(MAX(next_edge - k_uptime_get(), 0));
         }
-        else {
-            printk("message.effect.type == UI_BUZZER_CONTROL_TYPE_BLINKY\n");
-            total_lift_span_cnt = message.effect.duration;
-            k_work_schedule_for_queue(&ui_buzzer_control_work_q, &buzzer_interval_dwork, K_NO_WAIT);
-        }       
+
+        (void)k_sem_take(&ui_buzzer_control_sem, wait);
+        TRACE(TRACE_BUZZER_WAKE, 0, 0);
+
+        now = k_uptime_get();
+        next_edge = ui_layers_step(&buzzer_layers, now);
+        TRACE(TRACE_BUZZER_RENDER, 0,
+              (next_edge == UI_LAYERS_NEVER) ? UINT32_MAX : (uint32_t)(next_edge - now));
 	}
 }
 
@@ -134,20 +256,103 @@ K_THREAD_DEFINE(ui_buzzer_control_thread,
 
 
 /**
- * @brief set the buzzer effect 
+ * @brief set the buzzer effect of one output layer
  *
  * @return int 0 if successful, negative error code if not.
  */
-int ui_buzzer_control_set(struct ui_buzzer_control_tone tone_in, struct ui_buzzer_control_effect effect_in)
+int ui_buzzer_control_layer_set(uint8_t layer, struct ui_buzzer_control_tone tone_in,
+                                struct ui_buzzer_control_effect effect_in)
+{
+    ui_buzzer_control_message message = {
+        .tone = tone_in,
+        .effect = effect_in,
+        .clear = false,
+    };
+
+    if (layer >= UI_BUZZER_CONTROL_LAYER_NUM) {
+        return -EINVAL;
+    }
+
+    if ((effect_in.type == UI_BUZZER_CONTROL_TYPE_MELODY) && (tone_in.melody == NULL)) {
+        return -EINVAL;
+    }
+
+    TRACE(TRACE_BUZZER_SET, layer, message.clear);
+    buzzer_post(layer, &message);
+
+    return 0;
+}
+
+/**
+ * @brief play melody bytecode on one output layer
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_buzzer_control_layer_play(uint8_t layer, const uint8_t *code, size_t len,
+                                 struct ui_buzzer_control_tone tone_in,
+                                 struct ui_buzzer_control_effect effect_in)
+{
+    ui_buzzer_control_message message = {
+        .tone = tone_in,
+        .effect = effect_in,
+        .clear = false,
+    };
+    struct ui_melody melody = {
+        .code = code,
+        .len = len,
+    };
+
+    if (layer >= UI_BUZZER_CONTROL_LAYER_NUM) {
+        return -EINVAL;
+    }
+
+    if ((len < UI_MELODY_HEADER_SIZE) || (len > sizeof(message.code))) {
+        return -EINVAL;
+    }
+
+    /* The control thread would spin on notes of 0 ms. */
+    if (ui_melody_validate(&melody)) {
+        return -EINVAL;
+    }
+
+    message.effect.type = UI_BUZZER_CONTROL_TYPE_MELODY;
+    message.tone.melody = NULL;
+    message.code_len = len;
+    memcpy(message.code, code, len);
+
+    TRACE(TRACE_BUZZER_SET, layer, message.clear);
+    buzzer_post(layer, &message);
+
+    return 0;
+}
+
+/**
+ * @brief release an output layer
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_buzzer_control_layer_clear(uint8_t layer)
 {
-    printk("ui_buzzer_control_set\n");
-    int ret;
-    ui_buzzer_control_message message;
+    ui_buzzer_control_message message = {
+        .clear = true,
+    };
+
+    if (layer >= UI_BUZZER_CONTROL_LAYER_NUM) {
+        return -EINVAL;
+    }
 
-    message.tone = tone_in;
-    message.effect = effect_in;
+    TRACE(TRACE_BUZZER_SET, layer, message.clear);
+    buzzer_post(layer, &message);
 
-    ret = k_msgq_put(&ui_buzzer_control_msgq, &message, K_NO_WAIT);
+    return 0;
+}
 
-    return ret;
+/**
+ * @brief set the buzzer effect 
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_buzzer_control_set(struct ui_buzzer_control_tone tone_in, struct ui_buzzer_control_effect effect_in)
+{
+    return ui_buzzer_control_layer_set(UI_BUZZER_CONTROL_LAYER_BASE, tone_in, effect_in);
 }
@@ -14,8 +14,19 @@ extern "C" {
 
 #define UI_BUZZER_CONTROL_TYPE_CONTINUE      0
 #define UI_BUZZER_CONTROL_TYPE_BLINKY   1
+#define UI_BUZZER_CONTROL_TYPE_MELODY   2
 
+/* Output layers, a higher layer masks every layer below it while active. */
+#define UI_BUZZER_CONTROL_LAYER_BASE    0
+#define UI_BUZZER_CONTROL_LAYER_APP     1
+#define UI_BUZZER_CONTROL_LAYER_SHELL   2
+#define UI_BUZZER_CONTROL_LAYER_ALERT   3
+#define UI_BUZZER_CONTROL_LAYER_NUM     4
 
+/* Largest melody bytecode ui_buzzer_control_layer_play can take. */
+#define UI_BUZZER_CONTROL_MELODY_SIZE   128
+
+struct ui_melody;
 /** @brief A structure used to set the RBG LED color. */
 struct ui_buzzer_control_tone {
 	/* buzzer frequency value range 0~FREQUENCY_MAX. */
@@ -23,6 +34,9 @@ struct ui_buzzer_control_tone {
 
 	/* buzzer intensity range 0~INTENSITY_MAX. */
 	uint8_t intensity;
+
+	/* melody of UI_BUZZER_CONTROL_TYPE_MELODY, frequency is not used then. */
+	const struct ui_melody *melody;
 };
 
 struct ui_buzzer_control_effect {
@@ -35,22 +49,67 @@ struct ui_buzzer_control_effect {
 	/* blinky interval value Range: 0~255 Unit:second*/
 	uint8_t interval;
 
-	/* effect duration value range 0~255. 0=forever Unit:second*/
+	/* effect duration value range 0~255. 0=forever Unit:second
+	 * A melody repeats for the duration, 0 plays it once.
+	 */
 	uint8_t duration;
 };
 
 typedef struct {
     struct ui_buzzer_control_tone   tone;
     struct ui_buzzer_control_effect effect;
+    /* Release the layer instead of setting a new effect. */
+    bool clear;
+    /* Bytecode of a melody given by value, tone.melody is not used then. */
+    uint16_t code_len;
+    uint8_t code[UI_BUZZER_CONTROL_MELODY_SIZE];
 }__attribute__((aligned(4))) ui_buzzer_control_message;
 
 /**
- * @brief set the buzzer effect 
+ * @brief set the buzzer effect on the base layer
  *
  * @return int 0 if successful, negative error code if not.
  */
 int ui_buzzer_control_set(struct ui_buzzer_control_tone tone_in, struct ui_buzzer_control_effect effect_in);
 
+/**
+ * @brief set the buzzer effect of one output layer
+ *
+ * The effect is played while no higher layer is active. A layer with a
+ * non-zero duration releases itself when the duration runs out and the
+ * layer below continues at the phase it would have had if it had never
+ * been masked. Can be called from any context and never blocks, a newer
+ * effect replaces one the control thread has not picked up yet.
+ *
+ * @param layer UI_BUZZER_CONTROL_LAYER_* owned by the caller.
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_buzzer_control_layer_set(uint8_t layer, struct ui_buzzer_control_tone tone_in,
+                                struct ui_buzzer_control_effect effect_in);
+
+/**
+ * @brief play melody bytecode on one output layer
+ *
+ * As ui_buzzer_control_layer_set with UI_BUZZER_CONTROL_TYPE_MELODY, but the
+ * bytecode is copied into the message, so the caller may reuse its buffer
+ * as soon as this returns. For melodies compiled at run time.
+ *
+ * @param code Bytecode as written by ui_melody_compile.
+ * @param len Length of code, at most UI_BUZZER_CONTROL_MELODY_SIZE.
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_buzzer_control_layer_play(uint8_t layer, const uint8_t *code, size_t len,
+                                 struct ui_buzzer_control_tone tone_in,
+                                 struct ui_buzzer_control_effect effect_in);
+
+/**
+ * @brief release an output layer so the layers below it become audible
+ *
+ * @param layer UI_BUZZER_CONTROL_LAYER_* owned by the caller.
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_buzzer_control_layer_clear(uint8_t layer);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+
+#include "ui_layers.h"
+
+#define MSEC_PER_S 1000
+
+static void *slot_get(struct ui_layers *layers, int index, uint32_t slot)
+{
+	return (uint8_t *)layers->messages + (((index * 2) + slot) * layers->message_size);
+}
+
+void ui_layers_post(struct ui_layers *layers, int index, const void *msg)
+{
+	struct ui_mailbox *mb = &layers->mailbox[index];
+	uint32_t slot = !__atomic_load_n(&mb->latest, __ATOMIC_ACQUIRE);
+
+	__atomic_fetch_add(&mb->seq[slot], 1, __ATOMIC_SEQ_CST);
+	memcpy(slot_get(layers, index, slot), msg, layers->message_size);
+	mb->stamp[slot] = ++mb->posted;
+	__atomic_fetch_add(&mb->seq[slot], 1, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&mb->latest, slot, __ATOMIC_RELEASE);
+}
+
+bool ui_layers_take(struct ui_layers *layers, int index, void *out, uint32_t *replaced)
+{
+	struct ui_mailbox *mb = &layers->mailbox[index];
+	uint32_t *seen = &layers->seen[index];
+	uint32_t slot;
+	uint32_t seq;
+	uint32_t stamp;
+
+	for (;;) {
+		slot = __atomic_load_n(&mb->latest, __ATOMIC_ACQUIRE);
+		seq = __atomic_load_n(&mb->seq[slot], __ATOMIC_SEQ_CST);
+		if (seq & 1) {
+			continue;
+		}
+
+		stamp = mb->stamp[slot];
+		memcpy(out, slot_get(layers, index, slot), layers->message_size);
+
+		if (__atomic_load_n(&mb->seq[slot], __ATOMIC_SEQ_CST) == seq) {
+			break;
+		}
+	}
+
+	if (stamp == *seen) {
+		return false;
+	}
+
+	/* Messages in between were replaced before they were read. */
+	*replaced = stamp - *seen - 1;
+	*seen = stamp;
+
+	return true;
+}
+
+void ui_layers_start(struct ui_layer *layer, int64_t now, uint32_t duration)
+{
+	layer->start = now;
+	layer->expiry = (duration > 0) ? (now + duration) : UI_LAYERS_NEVER;
+	layer->active = true;
+}
+
+int64_t ui_layers_step(struct ui_layers *layers, int64_t now)
+{
+	struct ui_layer *top = NULL;
+	uint32_t replaced;
+	int64_t edge;
+	int i;
+
+	for (i = 0; i < UI_LAYERS_NUM; i++) {
+		if (ui_layers_take(layers, i, layers->scratch, &replaced)) {
+			layers->update(layers, i, layers->scratch, replaced, now);
+		}
+	}
+
+	for (i = UI_LAYERS_NUM - 1; i >= 0; i--) {
+		if (!layers->layer[i].active) {
+			continue;
+		}
+		if (now >= layers->layer[i].expiry) {
+			layers->layer[i].active = false;
+			continue;
+		}
+		top = &layers->layer[i];
+		break;
+	}
+
+	edge = layers->render(layers, i, now);
+	if (top == NULL) {
+		return UI_LAYERS_NEVER;
+	}
+
+	return (edge < top->expiry) ? edge : top->expiry;
+}
+
+bool ui_layers_blinky_phase(uint8_t interval, uint8_t duty, int64_t elapsed,
+			    int64_t *to_edge)
+{
+	uint32_t period = (uint32_t)interval * MSEC_PER_S;
+	uint32_t on_time = period * duty / 100;
+	uint32_t phase;
+
+	if ((period == 0) || (on_time == 0)) {
+		*to_edge = UI_LAYERS_NEVER;
+		return (period == 0);
+	}
+
+	phase = (uint32_t)(elapsed % period);
+	if (phase < on_time) {
+		*to_edge = on_time - phase;
+		return true;
+	}
+
+	*to_edge = period - phase;
+
+	return false;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef UI_LAYERS_H__
+#define UI_LAYERS_H__
+
+/* Plain C without Zephyr headers, so scripts/ui_layers_check.c can build it on the host. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Output layers of the rgb and buzzer control engines, see their headers. */
+#define UI_LAYERS_NUM   4
+
+#define UI_LAYERS_NEVER INT64_MAX
+
+/** @brief Timing of one output layer, all times are uptime in ms. */
+struct ui_layer {
+	/* The effect was received, the blinky phase counts from it. */
+	int64_t start;
+	/* The layer releases itself, UI_LAYERS_NEVER for no duration. */
+	int64_t expiry;
+	bool active;
+};
+
+/**
+ * @brief Latest-wins mailbox of one layer.
+ *
+ * A producer writes the slot that is not published and then flips latest,
+ * so it never waits for the consumer and a newer message simply replaces
+ * an older one that has not been read yet. The slots are the messages of
+ * struct ui_layers, the mailbox only keeps their sequence counts.
+ */
+struct ui_mailbox {
+	/* Odd while a producer writes the slot. */
+	uint32_t seq[2];
+	/* Number of messages posted to the mailbox up to the one in the slot. */
+	uint32_t stamp[2];
+	uint32_t latest;
+	uint32_t posted;
+};
+
+struct ui_layers;
+
+/**
+ * @brief Apply a message taken from the mailbox of a layer.
+ *
+ * @param replaced Messages posted before it that were never taken.
+ */
+typedef void (*ui_layers_update_t)(struct ui_layers *layers, int index, const void *msg,
+				   uint32_t replaced, int64_t now);
+
+/**
+ * @brief Drive the output for the highest active layer.
+ *
+ * @param index The layer, -1 if none is active and the output is off.
+ * @return int64_t Uptime in ms of the next change of the effect, UI_LAYERS_NEVER if none.
+ */
+typedef int64_t (*ui_layers_render_t)(struct ui_layers *layers, int index, int64_t now);
+
+/** @brief Layers and mailboxes of one output engine. */
+struct ui_layers {
+	/* Two message slots per layer, message_size bytes each. */
+	void *messages;
+	size_t message_size;
+	/* Where ui_layers_step() copies a message to, message_size bytes. */
+	void *scratch;
+	ui_layers_update_t update;
+	ui_layers_render_t render;
+
+	struct ui_mailbox mailbox[UI_LAYERS_NUM];
+	/* Only touched by the consumer. */
+	struct ui_layer layer[UI_LAYERS_NUM];
+	uint32_t seen[UI_LAYERS_NUM];
+};
+
+/**
+ * @brief Post a message to the mailbox of a layer, from any context.
+ *
+ * Producers of the same layer must be serialised by the caller, the
+ * consumer never waits for them.
+ */
+void ui_layers_post(struct ui_layers *layers, int index, const void *msg);
+
+/**
+ * @brief Take a consistent copy of the newest message of a layer.
+ *
+ * The copy is retried if a producer rewrote the slot while it was copied,
+ * which needs two posts during the copy.
+ *
+ * @param[out] replaced Messages posted before it that were never taken.
+ * @return bool true if out holds a message not taken before.
+ */
+bool ui_layers_take(struct ui_layers *layers, int index, void *out, uint32_t *replaced);
+
+/**
+ * @brief Start an effect on a layer.
+ *
+ * @param duration Time in ms until the layer releases itself, 0 for never.
+ */
+void ui_layers_start(struct ui_layer *layer, int64_t now, uint32_t duration);
+
+/**
+ * @brief Take the new messages, then render the highest active layer.
+ *
+ * Expired layers are released on the way down, so a lower layer takes over
+ * without anyone re-sending it.
+ *
+ * @return int64_t Uptime in ms of the next output change, UI_LAYERS_NEVER if none.
+ */
+int64_t ui_layers_step(struct ui_layers *layers, int64_t now);
+
+/**
+ * @brief Get the blinky state of an effect.
+ *
+ * The state is a pure function of the time since the effect started, so a
+ * layer that was masked for a while continues at its correct phase.
+ *
+ * @param interval Blinky period in s, 0 for always on.
+ * @param duty Share of the period that is on, in percent.
+ * @param elapsed Time in ms since the effect started.
+ * @param[out] to_edge Time in ms until the state changes, UI_LAYERS_NEVER if never.
+ * @return bool true if the output is on.
+ */
+bool ui_layers_blinky_phase(uint8_t interval, uint8_t duty, int64_t elapsed,
+			    int64_t *to_edge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UI_LAYERS_H__ */
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "ui_melody.h"
+
+#define RTTTL_DEFAULT_DURATION  2   /* quarter note */
+#define RTTTL_DEFAULT_OCTAVE    6
+#define RTTTL_DEFAULT_BPM       63
+#define RTTTL_BPM_MAX           900
+
+/* Whole note length in ms for a tempo given in quarter notes per minute. */
+#define WHOLE_MS(bpm) ((4U * 60U * 1000U) / (bpm))
+
+/* Semitone of the RTTTL note letters a..h, h is the german name of b. */
+static const int8_t letter_pitch[] = {
+	9, 11, 0, 2, 4, 5, 7, 11,
+};
+
+static int duration_exponent(unsigned long value)
+{
+	for (int exp = 0; exp <= UI_MELODY_DURATION_MAX; exp++) {
+		if (value == (1UL << exp)) {
+			return exp;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static const char *skip_space(const char *p)
+{
+	while (isspace((unsigned char)*p)) {
+		p++;
+	}
+
+	return p;
+}
+
+static int parse_defaults(const char **pp, uint8_t *duration, uint8_t *octave,
+			  uint32_t *bpm)
+{
+	const char *p = *pp;
+	unsigned long value;
+	char *end;
+	int exp;
+
+	for (p = skip_space(p); *p != ':'; p = skip_space(p)) {
+		char key = tolower((unsigned char)*p);
+
+		if ((key == '\0') || (p[1] != '=')) {
+			return -EINVAL;
+		}
+
+		value = strtoul(p + 2, &end, 10);
+		if (end == p + 2) {
+			return -EINVAL;
+		}
+
+		switch (key) {
+		case 'd':
+			exp = duration_exponent(value);
+			if (exp < 0) {
+				return exp;
+			}
+			*duration = exp;
+			break;
+		case 'o':
+			if (value > UI_MELODY_OCTAVE_MAX) {
+				return -EINVAL;
+			}
+			*octave = value;
+			break;
+		case 'b':
+			if ((value == 0) || (value > RTTTL_BPM_MAX) ||
+			    (WHOLE_MS(value) > UINT16_MAX)) {
+				return -EINVAL;
+			}
+			*bpm = value;
+			break;
+		default:
+			return -EINVAL;
+		}
+
+		p = skip_space(end);
+		if (*p == ',') {
+			p++;
+		}
+	}
+
+	*pp = p + 1;
+
+	return 0;
+}
+
+int ui_melody_compile(const char *rtttl, uint8_t *buf, size_t size)
+{
+	uint8_t def_duration = RTTTL_DEFAULT_DURATION;
+	uint8_t def_octave = RTTTL_DEFAULT_OCTAVE;
+	uint32_t bpm = RTTTL_DEFAULT_BPM;
+	uint8_t cur_octave = UINT8_MAX;
+	size_t len = UI_MELODY_HEADER_SIZE;
+	const char *p;
+	int err;
+
+	p = strchr(rtttl, ':');
+	if ((p == NULL) || (size < UI_MELODY_HEADER_SIZE)) {
+		return -EINVAL;
+	}
+
+	p++;
+	err = parse_defaults(&p, &def_duration, &def_octave, &bpm);
+	if (err) {
+		return err;
+	}
+
+	/* Little endian, as sys_put_le16. */
+	buf[0] = WHOLE_MS(bpm) & 0xFF;
+	buf[1] = WHOLE_MS(bpm) >> 8;
+
+	for (p = skip_space(p); *p != '\0'; p = skip_space(p)) {
+		uint8_t duration = def_duration;
+		uint8_t octave = def_octave;
+		bool dotted = false;
+		int pitch;
+		char letter;
+		char *end;
+
+		if (isdigit((unsigned char)*p)) {
+			err = duration_exponent(strtoul(p, &end, 10));
+			if (err < 0) {
+				return err;
+			}
+			duration = err;
+			p = end;
+		}
+
+		letter = tolower((unsigned char)*p++);
+		if (letter == 'p') {
+			pitch = UI_MELODY_OP_REST;
+		} else if ((letter >= 'a') && (letter <= 'h')) {
+			pitch = letter_pitch[letter - 'a'];
+		} else {
+			return -EINVAL;
+		}
+
+		if ((*p == '#') && (pitch != UI_MELODY_OP_REST)) {
+			pitch++;
+			p++;
+		}
+		if (*p == '.') {
+			dotted = true;
+			p++;
+		}
+		if (isdigit((unsigned char)*p)) {
+			octave = *p++ - '0';
+		}
+		if (*p == '.') {
+			dotted = true;
+			p++;
+		}
+
+		/* B# is the C of the next octave. */
+		if ((letter != 'p') && (pitch == 12)) {
+			pitch = 0;
+			octave++;
+		}
+		if (octave > UI_MELODY_OCTAVE_MAX) {
+			return -EINVAL;
+		}
+
+		p = skip_space(p);
+		if (*p == ',') {
+			p++;
+		} else if (*p != '\0') {
+			return -EINVAL;
+		}
+
+		if ((pitch != UI_MELODY_OP_REST) && (octave != cur_octave)) {
+			if (len >= size) {
+				return -ENOMEM;
+			}
+			buf[len++] = (octave << 5) | UI_MELODY_OP_OCTAVE;
+			cur_octave = octave;
+		}
+
+		if (len >= size) {
+			return -ENOMEM;
+		}
+		buf[len++] = (duration << 5) | (dotted << 4) | pitch;
+	}
+
+	return len;
+}
+
+int ui_melody_validate(const struct ui_melody *melody)
+{
+	if ((melody->len < UI_MELODY_HEADER_SIZE) ||
+	    ((melody->code[0] | melody->code[1]) == 0)) {
+		return -EINVAL;
+	}
+
+	for (size_t i = UI_MELODY_HEADER_SIZE; i < melody->len; i++) {
+		uint8_t op = melody->code[i] & 0x0F;
+
+		if (op > UI_MELODY_OP_OCTAVE) {
+			return -EINVAL;
+		}
+		if ((op != UI_MELODY_OP_OCTAVE) &&
+		    ((melody->code[i] >> 5) > UI_MELODY_DURATION_MAX)) {
+			return -EINVAL;
+		}
+	}
+
+	return (ui_melody_length_ms(melody) > 0) ? 0 : -EINVAL;
+}
+
+const struct ui_melody *ui_melody_find(const char *name)
+{
+	for (size_t i = 0; i < ui_melody_builtin_count; i++) {
+		if (strcmp(ui_melody_builtin[i].name, name) == 0) {
+			return &ui_melody_builtin[i];
+		}
+	}
+
+	return NULL;
+}
+
+void ui_melody_player_start(struct ui_melody_player *player,
+			    const struct ui_melody *melody)
+{
+	player->pc = melody->code + UI_MELODY_HEADER_SIZE;
+	player->end = melody->code + melody->len;
+	player->whole = melody->code[0] | (melody->code[1] << 8);
+	player->octave = RTTTL_DEFAULT_OCTAVE;
+}
+
+int ui_melody_player_next(struct ui_melody_player *player,
+			  struct ui_melody_note *note)
+{
+	while (player->pc < player->end) {
+		uint8_t op = *player->pc++;
+		uint8_t arg = op >> 5;
+
+		if ((op & 0x0F) == UI_MELODY_OP_OCTAVE) {
+			player->octave = arg;
+			continue;
+		}
+
+		note->duration = player->whole >> arg;
+		if (op & (1U << 4)) {
+			note->duration += note->duration >> 1;
+		}
+
+		if ((op & 0x0F) == UI_MELODY_OP_REST) {
+			note->note = UI_MELODY_NOTE_REST;
+		} else {
+			note->note = player->octave * 12 + (op & 0x0F);
+		}
+
+		return 0;
+	}
+
+	return -ENODATA;
+}
+
+uint32_t ui_melody_length_ms(const struct ui_melody *melody)
+{
+	struct ui_melody_player player;
+	struct ui_melody_note note;
+	uint32_t length = 0;
+
+	ui_melody_player_start(&player, melody);
+	while (ui_melody_player_next(&player, &note) == 0) {
+		length += note.duration;
+	}
+
+	return length;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef UI_MELODY_H__
+#define UI_MELODY_H__
+
+/* Plain C without Zephyr headers, so scripts/ui_melody_check.c can build it on the host. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Melody bytecode
+ *
+ * Two header bytes hold the length of a whole note in ms (little endian),
+ * followed by one byte per instruction:
+ *
+ *   bit 7..5  duration, the note lasts whole >> duration ms
+ *   bit 4     dotted, the note lasts half as long again
+ *   bit 3..0  UI_MELODY_OP_*, or C..B (0..11) in the current octave
+ *
+ * UI_MELODY_OP_OCTAVE takes the new octave from bit 7..5 instead.
+ * scripts/rtttl_compile.py emits the same bytecode at build time.
+ */
+#define UI_MELODY_HEADER_SIZE   2
+#define UI_MELODY_OP_REST       12
+#define UI_MELODY_OP_OCTAVE     13
+
+#define UI_MELODY_OCTAVE_MAX    7
+#define UI_MELODY_DURATION_MAX  5
+
+/* A pause, the same as UI_BUZZER_NOTE_REST. */
+#define UI_MELODY_NOTE_REST     UINT8_MAX
+
+/** @brief A compiled melody. */
+struct ui_melody {
+	/* Name of the melody, the RTTTL title. */
+	const char *name;
+
+	/* Bytecode including the header. */
+	const uint8_t *code;
+
+	/* Length of the bytecode in bytes. */
+	uint16_t len;
+};
+
+/** @brief One note produced by the interpreter. */
+struct ui_melody_note {
+	/* Note index as taken by ui_buzzer_set_note, UI_MELODY_NOTE_REST for a pause. */
+	uint8_t note;
+
+	/* Length of the note in ms. */
+	uint16_t duration;
+};
+
+/** @brief Interpreter state of one playing melody. */
+struct ui_melody_player {
+	const uint8_t *pc;
+	const uint8_t *end;
+	uint16_t whole;
+	uint8_t octave;
+};
+
+/* Melodies compiled from melodies/ at build time, stored in flash. */
+extern const struct ui_melody ui_melody_builtin[];
+extern const size_t ui_melody_builtin_count;
+
+/**
+ * @brief Compile an RTTTL string into melody bytecode.
+ *
+ * @param rtttl String of the form "name:d=4,o=5,b=120:8c6,e,p,4g#.".
+ * @param[out] buf Buffer the bytecode is written to.
+ * @param size Size of buf.
+ * @return int Length of the bytecode if successful, negative error code if not.
+ */
+int ui_melody_compile(const char *rtttl, uint8_t *buf, size_t size);
+
+/**
+ * @brief Check bytecode that was not made by ui_melody_compile.
+ *
+ * The player takes any bytecode, but a whole note of 0 ms, a duration
+ * above UI_MELODY_DURATION_MAX or an unknown note can make every note
+ * last 0 ms or play outside the buzzer range.
+ *
+ * @return int 0 if the melody plays for some time, -EINVAL if not.
+ */
+int ui_melody_validate(const struct ui_melody *melody);
+
+/**
+ * @brief Look up a built-in melody by name.
+ *
+ * @return const struct ui_melody* The melody, NULL if there is none.
+ */
+const struct ui_melody *ui_melody_find(const char *name);
+
+/**
+ * @brief Get the time a melody takes to play once.
+ *
+ * @return uint32_t Length in ms.
+ */
+uint32_t ui_melody_length_ms(const struct ui_melody *melody);
+
+/**
+ * @brief Point the interpreter at the first note of a melody.
+ */
+void ui_melody_player_start(struct ui_melody_player *player,
+			    const struct ui_melody *melody);
+
+/**
+ * @brief Run the interpreter up to the next note.
+ *
+ * @param[out] note The next note.
+ * @return int 0 if successful, -ENODATA at the end of the melody.
+ */
+int ui_melody_player_next(struct ui_melody_player *player,
+			  struct ui_melody_note *note);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UI_MELODY_H__ */
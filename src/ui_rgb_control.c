@@ -8,124 +8,175 @@
 #include <stdio.h>
 #include "ui_led.h"
 #include "ui_rgb_control.h"
+#include "ui_layers.h"
+#include "perf_stats.h"
+#include "trace.h"
+#include "stream.h"
 
-K_MSGQ_DEFINE(ui_rgb_control_msgq, sizeof(ui_rgb_control_message), 5, 4);
-
-#define UI_RGB_CONTROL_WORK_Q_STACK_SIZE 512
-#define UI_RGB_CONTROL_WORK_Q_PRIORITY      K_LOWEST_APPLICATION_THREAD_PRIO
-K_THREAD_STACK_DEFINE(ui_rgb_control_work_q_stack, UI_RGB_CONTROL_WORK_Q_STACK_SIZE);
-static struct k_work_q ui_rgb_control_work_q;
-
-static struct k_work_delayable rgb_open_dwork;
-static struct k_work_delayable rgb_close_dwork;
-static struct k_work_delayable rgb_set_color_dwork;
-static struct k_work_delayable rgb_interval_dwork;
+/* Given by producers whenever a mailbox has been written. */
+K_SEM_DEFINE(ui_rgb_control_sem, 0, 1);
 
 /******* user ui effect thread *******/
 #define UI_RGB_CONTROL_THREAD_STACK_SIZE 512
 #define UI_RGB_CONTROL_THREAD_PRIORITY      K_LOWEST_APPLICATION_THREAD_PRIO - 1
 
-static int16_t total_lift_span_cnt = 0;
-static ui_rgb_control_message message;
+/* Effects of the layers, their timing is kept by ui_layers. */
+struct rgb_layer {
+    struct ui_rgb_control_color  color;
+    struct ui_rgb_control_effect effect;
+};
+
+PERF_STATS_QUEUE_DEFINE(ui_rgb_control_mailbox);
+
+static void rgb_update(struct ui_layers *l, int index, const void *msg,
+                       uint32_t replaced, int64_t now);
+static int64_t rgb_render(struct ui_layers *l, int index, int64_t now);
+
+/* Mailbox slots, two per layer, and the copy the control thread takes. */
+static ui_rgb_control_message messages[UI_RGB_CONTROL_LAYER_NUM][2];
+static ui_rgb_control_message taken;
+
+static struct ui_layers rgb_layers = {
+    .messages = messages,
+    .message_size = sizeof(ui_rgb_control_message),
+    .scratch = &taken,
+    .update = rgb_update,
+    .render = rgb_render,
+};
+
+/* Serialises producers of the same layer, the consumer never takes it. */
+static struct k_spinlock post_lock[UI_RGB_CONTROL_LAYER_NUM];
+
+/* Layer effects and output state are only touched by the control thread. */
+static struct rgb_layer layers[UI_RGB_CONTROL_LAYER_NUM];
 
-static void rgb_open_dwork_fn(struct k_work *work)
+BUILD_ASSERT(UI_RGB_CONTROL_LAYER_NUM == UI_LAYERS_NUM);
+
+static struct ui_rgb_control_color shown_color;
+static bool shown_on;
+static bool shown_valid;
+
+/* GPIO LEDs are dimmed by the software PWM if CONFIG_UI_LED_SOFT_PWM is set. */
+static void rgb_led_set_intensity(uint8_t led, uint8_t intensity)
 {
-    //printk("rgb_open_dwork_fn\n");
-    ui_led_pwm_on_off(0, true); 
-	ui_led_pwm_on_off(1, true);
-	ui_led_pwm_on_off(2, true);    
+    if (IS_ENABLED(CONFIG_UI_LED_USE_GPIO)) {
+        (void)ui_led_gpio_set_intensity(led, intensity);
+    } else {
+        (void)ui_led_pwm_set_intensity(led, intensity);
+    }
 }
 
-static void rgb_close_dwork_fn(struct k_work *work)
+static void rgb_led_on_off(uint8_t led, bool on)
 {
-    //printk("rgb_close_dwork_fn\n");
-    ui_led_pwm_on_off(0, false); 
-	ui_led_pwm_on_off(1, false);
-	ui_led_pwm_on_off(2, false);    
+    if (IS_ENABLED(CONFIG_UI_LED_USE_GPIO)) {
+        (void)ui_led_gpio_on_off(led, on);
+    } else {
+        (void)ui_led_pwm_on_off(led, on);
+    }
 }
 
-static void rgb_set_color_dwork_fn(struct k_work *work)
+static void rgb_output(struct ui_rgb_control_color color, bool on)
 {
-    //printk("rgb_set_color_dwork_fn\n");
-	ui_led_pwm_set_intensity(0, message.color.red);     /*Red*/
-	ui_led_pwm_set_intensity(1, message.color.green);   /*Green*/
-	ui_led_pwm_set_intensity(2, message.color.blue);    /*Blue*/	
+    if (!shown_valid ||
+        (color.red != shown_color.red) ||
+        (color.green != shown_color.green) ||
+        (color.blue != shown_color.blue)) {
+        rgb_led_set_intensity(0, color.red);     /*Red*/
+        rgb_led_set_intensity(1, color.green);   /*Green*/
+        rgb_led_set_intensity(2, color.blue);    /*Blue*/
+        shown_color = color;
+    }
+
+    if (!shown_valid || (on != shown_on)) {
+        rgb_led_on_off(0, on);
+        rgb_led_on_off(1, on);
+        rgb_led_on_off(2, on);
+        shown_on = on;
+    }
+
+    shown_valid = true;
+
+    if (stream_channel_enabled(STREAM_CHANNEL_RGB)) {
+        uint8_t record[4] = { color.red, color.green, color.blue, on };
+
+        (void)stream_write(STREAM_CHANNEL_RGB, record, sizeof(record));
+    }
 }
 
-static void rgb_interval_dwork_fn(struct k_work *work)
+static void rgb_post(uint8_t layer, const ui_rgb_control_message *msg)
 {
-    //printk("rgb_interval_dwork_fn\n");
-    uint32_t duty_value;
-    k_timeout_t delay_value;
-   
-    k_work_schedule_for_queue(&ui_rgb_control_work_q, &rgb_set_color_dwork, K_NO_WAIT);
-    k_work_schedule_for_queue(&ui_rgb_control_work_q, &rgb_open_dwork, K_NO_WAIT);
-
-    if(message.effect.interval > 5) {
-        duty_value = (uint32_t)message.effect.interval * message.effect.duty;
-        duty_value = duty_value / 100;
-        delay_value = K_SECONDS(duty_value);
-    }
-    else {
-        duty_value = (uint32_t)message.effect.interval * 1000 * message.effect.duty;
-        duty_value = duty_value / 100;
-        delay_value = K_MSEC(duty_value);       
+    k_spinlock_key_t key = k_spin_lock(&post_lock[layer]);
+
+    ui_layers_post(&rgb_layers, layer, msg);
+    perf_stats_queue_posted(&ui_rgb_control_mailbox);
+
+    k_spin_unlock(&post_lock[layer], key);
+
+    k_sem_give(&ui_rgb_control_sem);
+}
+
+static void rgb_update(struct ui_layers *l, int index, const void *msg_in,
+                       uint32_t replaced, int64_t now)
+{
+    const ui_rgb_control_message *msg = msg_in;
+
+    perf_stats_queue_taken(&ui_rgb_control_mailbox, replaced);
+    TRACE(TRACE_RGB_LAYER, index, msg->clear);
+
+    if (msg->clear) {
+        l->layer[index].active = false;
+        return;
     }
 
-    k_work_schedule_for_queue(&ui_rgb_control_work_q, &rgb_close_dwork, delay_value);
+    layers[index].color = msg->color;
+    layers[index].effect = msg->effect;
+    ui_layers_start(&l->layer[index], now, (uint32_t)msg->effect.duration * MSEC_PER_SEC);
+}
 
-    if(message.effect.duration > 0) {
-        total_lift_span_cnt = total_lift_span_cnt - message.effect.interval;
-        if(total_lift_span_cnt > 0) {
-            k_work_schedule_for_queue(&ui_rgb_control_work_q, &rgb_interval_dwork, 
-                                      K_SECONDS(message.effect.interval));
-        }
-        else {
-            total_lift_span_cnt = 0;
-        }
+static int64_t rgb_render(struct ui_layers *l, int index, int64_t now)
+{
+    const struct rgb_layer *top;
+    int64_t to_edge = UI_LAYERS_NEVER;
+    bool on = true;
+
+    if (index < 0) {
+        rgb_output(shown_color, false);
+        return UI_LAYERS_NEVER;
+    }
+
+    top = &layers[index];
+    if (top->effect.type == UI_RGB_CONTROL_TYPE_BLINKY) {
+        on = ui_layers_blinky_phase(top->effect.interval, top->effect.duty,
+                                    now - l->layer[index].start, &to_edge);
     }
-    else {
-        k_work_schedule_for_queue(&ui_rgb_control_work_q, &rgb_interval_dwork, 
-                                  K_SECONDS(message.effect.interval));
-    }    
+
+    rgb_output(top->color, on);
+
+    return (to_edge == UI_LAYERS_NEVER) ? UI_LAYERS_NEVER : (now + to_edge);
 }
 
 static void ui_rgb_control_task(void)
 {
-    struct k_work_sync sync;
+    int64_t next_edge = UI_LAYERS_NEVER;
+    int64_t now;
+    k_timeout_t wait;
 
     printk("ui_rgb_control_task initial\n");
-    k_work_queue_init(&ui_rgb_control_work_q);
-    k_work_queue_start(&ui_rgb_control_work_q, ui_rgb_control_work_q_stack,
-                        K_THREAD_STACK_SIZEOF(ui_rgb_control_work_q_stack), 
-                        UI_RGB_CONTROL_WORK_Q_PRIORITY,
-                        NULL);
-
-    k_work_init_delayable(&rgb_open_dwork, rgb_open_dwork_fn);
-    k_work_init_delayable(&rgb_close_dwork, rgb_close_dwork_fn);
-    k_work_init_delayable(&rgb_set_color_dwork, rgb_set_color_dwork_fn);
-    k_work_init_delayable(&rgb_interval_dwork, rgb_interval_dwork_fn);
-
-	for (;;) {                                   
-        k_msgq_get(&ui_rgb_control_msgq, &message, K_FOREVER);
-        printk("ui_rgb_control_task get a message from msgq\n");
-        k_work_cancel_delayable_sync(&rgb_close_dwork, &sync);
-        k_work_cancel_delayable_sync(&rgb_interval_dwork, &sync);
-
-        if(message.effect.type == UI_RGB_CONTROL_TYPE_CONTINUE){
-            printk("message.effect.type == UI_RGB_CONTROL_TYPE_CONTINUE\n");
-            k_work_schedule_for_queue(&ui_rgb_control_work_q, &rgb_set_color_dwork, K_NO_WAIT);
-            k_work_schedule_for_queue(&ui_rgb_control_work_q, &rgb_open_dwork, K_NO_WAIT);
-            if(message.effect.duration > 0) {
-                k_work_schedule_for_queue(&ui_rgb_control_work_q, &rgb_close_dwork,
-                                        K_SECONDS(message.effect.duration));
-            }
+
+	for (;;) {
+        if (next_edge == UI_LAYERS_NEVER) {
+            wait = K_FOREVER;
+        } else {
+            wait = K_MSEC(MAX(next_edge - k_uptime_get(), 0));
         }
-        else {
-            printk("message.effect.type == UI_RGB_CONTROL_TYPE_BLINKY\n");
-            total_lift_span_cnt = message.effect.duration;
-            k_work_schedule_for_queue(&ui_rgb_control_work_q, &rgb_interval_dwork, K_NO_WAIT);
-        }          
+
+        (void)k_sem_take(&ui_rgb_control_sem, wait);
+        TRACE(TRACE_RGB_WAKE, 0, 0);
+
+        now = k_uptime_get();
+        next_edge = ui_layers_step(&rgb_layers, now);
+        TRACE(TRACE_RGB_RENDER, 0,
+              (next_edge == UI_LAYERS_NEVER) ? UINT32_MAX : (uint32_t)(next_edge - now));
 	}
 }
 
@@ -139,20 +190,56 @@ K_THREAD_DEFINE(ui_rgb_control_thread,
 
 
 /**
- * @brief set the RBG LED effect 
+ * @brief set the RBG LED effect of one output layer
  *
  * @return int 0 if successful, negative error code if not.
  */
-int ui_rgb_control_set(struct ui_rgb_control_color color_in, struct ui_rgb_control_effect effect_in)
+int ui_rgb_control_layer_set(uint8_t layer, struct ui_rgb_control_color color_in,
+                             struct ui_rgb_control_effect effect_in)
 {
-    printk("user_ui_effect_rgb_set\n");
-    int ret;
-    ui_rgb_control_message message;
+    ui_rgb_control_message message = {
+        .color = color_in,
+        .effect = effect_in,
+        .clear = false,
+    };
+
+    if (layer >= UI_RGB_CONTROL_LAYER_NUM) {
+        return -EINVAL;
+    }
 
-    message.color = color_in;
-    message.effect = effect_in;
+    TRACE(TRACE_RGB_SET, layer, message.clear);
+    rgb_post(layer, &message);
 
-    ret = k_msgq_put(&ui_rgb_control_msgq, &message, K_NO_WAIT);
+    return 0;
+}
 
-    return ret;
+/**
+ * @brief release an output layer
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_rgb_control_layer_clear(uint8_t layer)
+{
+    ui_rgb_control_message message = {
+        .clear = true,
+    };
+
+    if (layer >= UI_RGB_CONTROL_LAYER_NUM) {
+        return -EINVAL;
+    }
+
+    TRACE(TRACE_RGB_SET, layer, message.clear);
+    rgb_post(layer, &message);
+
+    return 0;
+}
+
+/**
+ * @brief set the RBG LED effect 
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_rgb_control_set(struct ui_rgb_control_color color_in, struct ui_rgb_control_effect effect_in)
+{
+    return ui_rgb_control_layer_set(UI_RGB_CONTROL_LAYER_BASE, color_in, effect_in);
 }
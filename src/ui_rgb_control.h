@@ -15,6 +15,12 @@ extern "C" {
 #define UI_RGB_CONTROL_TYPE_CONTINUE      0
 #define UI_RGB_CONTROL_TYPE_BLINKY        1
 
+/* Output layers, a higher layer masks every layer below it while active. */
+#define UI_RGB_CONTROL_LAYER_BASE         0
+#define UI_RGB_CONTROL_LAYER_APP          1
+#define UI_RGB_CONTROL_LAYER_SHELL        2
+#define UI_RGB_CONTROL_LAYER_ALERT        3
+#define UI_RGB_CONTROL_LAYER_NUM          4
 
 /** @brief A structure used to set the RBG LED color. */
 struct ui_rgb_control_color {
@@ -45,15 +51,40 @@ struct ui_rgb_control_effect {
 typedef struct {
     struct ui_rgb_control_color  color;
     struct ui_rgb_control_effect effect;
+    /* Release the layer instead of setting a new effect. */
+    bool clear;
 }__attribute__((aligned(4))) ui_rgb_control_message;
 
 /**
- * @brief set the RBG LED effect 
+ * @brief set the RBG LED effect on the base layer
  *
  * @return int 0 if successful, negative error code if not.
  */
 int ui_rgb_control_set(struct ui_rgb_control_color color, struct ui_rgb_control_effect effect);
 
+/**
+ * @brief set the RBG LED effect of one output layer
+ *
+ * The effect is shown while no higher layer is active. A layer with a
+ * non-zero duration releases itself when the duration runs out and the
+ * layer below continues at the phase it would have had if it had never
+ * been masked. Can be called from any context and never blocks, a newer
+ * effect replaces one the control thread has not picked up yet.
+ *
+ * @param layer UI_RGB_CONTROL_LAYER_* owned by the caller.
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_rgb_control_layer_set(uint8_t layer, struct ui_rgb_control_color color,
+                             struct ui_rgb_control_effect effect);
+
+/**
+ * @brief release an output layer so the layers below it become visible
+ *
+ * @param layer UI_RGB_CONTROL_LAYER_* owned by the caller.
+ * @return int 0 if successful, negative error code if not.
+ */
+int ui_rgb_control_layer_clear(uint8_t layer);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,482 @@
+/*
+ * Copyright (c) 2020 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/random/rand32.h>
+#include <zephyr/sys/byteorder.h>
+#if defined(CONFIG_HWINFO)
+#include <zephyr/drivers/hwinfo.h>
+#endif
+
+#include "uplink.h"
+#include "uplink_transport.h"
+#include "uplink_slot.h"
+#include "bench.h"
+#include "perf_stats.h"
+#include "trace.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(uplink, CONFIG_UDP_LOG_LEVEL);
+
+#define UPLINK_PERIOD_MS (CONFIG_UDP_DATA_UPLOAD_FREQUENCY_SECONDS * MSEC_PER_SEC)
+#define UPLINK_HEARTBEAT_MS (CONFIG_UDP_HEARTBEAT_FLOOR_SECONDS * MSEC_PER_SEC)
+
+/*
+ * The transmission runs on its own queue, a send may (re)connect, and the
+ * DTLS handshake takes round trips to the server the system work queue
+ * must not wait for.
+ */
+#define UPLINK_WORK_Q_STACK_SIZE 2048
+#define UPLINK_WORK_Q_PRIORITY 5
+K_THREAD_STACK_DEFINE(uplink_work_q_stack, UPLINK_WORK_Q_STACK_SIZE);
+static struct k_work_q uplink_work_q;
+
+BUILD_ASSERT(CONFIG_UDP_DATA_UPLOAD_SIZE_BYTES <= UPLINK_RECORD_DATA_MAX,
+	     "Heartbeat payload does not fit in one record");
+
+#if defined(CONFIG_UDP_TRANSPORT_TCP)
+static const struct uplink_transport *const transport = &uplink_transport_tcp;
+#else
+static const struct uplink_transport *const transport = &uplink_transport_udp;
+#endif
+PERF_WORK_DEFINE(server_transmission_work);
+
+/* Records waiting for the next datagram, and the urgent event behind it. */
+static uint8_t pending[CONFIG_UDP_UPLINK_QUEUE_SIZE];
+static size_t pending_len;
+static bool urgent;
+static int64_t urgent_origin;
+static struct k_spinlock pending_lock;
+
+static atomic_t period_ms = ATOMIC_INIT(UPLINK_PERIOD_MS);
+static atomic_t report_on_change = ATOMIC_INIT(IS_ENABLED(CONFIG_UDP_REPORT_ON_CHANGE));
+static atomic_t heartbeat_ms = ATOMIC_INIT(UPLINK_HEARTBEAT_MS);
+static int64_t last_sent;
+static int64_t last_periodic;
+static int64_t next_periodic;
+static uint16_t seq;
+static bool started;
+
+/* The send is offset ms into the period that began at last_periodic, drawn for offset_period. */
+static struct uplink_slot slot = {
+	.width = CONFIG_UDP_UPLINK_SLOT_WIDTH_MS,
+	.jitter = CONFIG_UDP_UPLINK_SLOT_JITTER_MS,
+};
+static bool slot_identified;
+static struct k_spinlock slot_lock;
+static uint32_t offset;
+static uint32_t offset_period;
+
+static uplink_collector_t collectors[UPLINK_COLLECTORS_MAX];
+static size_t num_collectors;
+
+static uplink_schedule_handler_t schedule_handlers[UPLINK_SCHEDULE_SUBSCRIBERS_MAX];
+static size_t num_schedule_handlers;
+
+static struct uplink_latency latency;
+static struct k_spinlock latency_lock;
+static atomic_t coalesced;
+
+/* Periodic datagrams sent and skipped for lack of changes. */
+static atomic_t periodic_sent;
+static atomic_t periodic_suppressed;
+
+static size_t record_put(uint8_t *buf, uint8_t type, const void *data, size_t len)
+{
+	buf[0] = type;
+	buf[1] = (uint8_t)len;
+	memcpy(&buf[UPLINK_RECORD_HEADER_SIZE], data, len);
+
+	return UPLINK_RECORD_HEADER_SIZE + len;
+}
+
+static int pending_put(uint8_t type, const void *data, size_t len)
+{
+	if ((len > UPLINK_RECORD_DATA_MAX) || ((data == NULL) && (len > 0))) {
+		return -EINVAL;
+	}
+
+	if ((pending_len + UPLINK_RECORD_HEADER_SIZE + len) > sizeof(pending)) {
+		return -ENOMEM;
+	}
+
+	pending_len += record_put(&pending[pending_len], type, data, len);
+
+	return 0;
+}
+
+static void latency_record(int64_t origin)
+{
+	uint32_t ms = (uint32_t)CLAMP(k_uptime_get() - origin, 0, UINT32_MAX);
+	size_t bucket = (ms < 2) ? 0 : (31 - __builtin_clz(ms));
+	k_spinlock_key_t key = k_spin_lock(&latency_lock);
+
+	latency.bucket[MIN(bucket, UPLINK_LATENCY_BUCKETS - 1)]++;
+	latency.count++;
+	latency.max_ms = MAX(latency.max_ms, ms);
+
+	k_spin_unlock(&latency_lock, key);
+}
+
+/**
+ * @brief Start a datagram, the pending records go after it.
+ *
+ * @return size_t Length of the header and the heartbeat record if any.
+ */
+static size_t datagram_begin(uint8_t *buf, uint8_t flags, uint16_t seq_num, bool heartbeat)
+{
+	static const char payload[CONFIG_UDP_DATA_UPLOAD_SIZE_BYTES] = {"hello from thingy\0"};
+	size_t len = UPLINK_HEADER_SIZE;
+
+	buf[0] = UPLINK_VERSION;
+	buf[1] = flags;
+	sys_put_le16(seq_num, &buf[2]);
+
+	if (heartbeat) {
+		len += record_put(&buf[len], UPLINK_RECORD_HEARTBEAT,
+				  payload, sizeof(payload));
+
+		if (IS_ENABLED(CONFIG_PERF_STATS_UPLINK)) {
+			uint8_t stats[PERF_STATS_RECORD_SIZE];
+
+			perf_stats_record(stats);
+			len += record_put(&buf[len], UPLINK_RECORD_STATS,
+					  stats, sizeof(stats));
+		}
+	}
+
+	return len;
+}
+
+static uint32_t slot_offset(uint32_t period)
+{
+	k_spinlock_key_t key = k_spin_lock(&slot_lock);
+	uint32_t ms = uplink_slot_offset(&slot, period, sys_rand32_get());
+
+	k_spin_unlock(&slot_lock, key);
+
+	return ms;
+}
+
+static void server_transmission_work_fn(struct k_work *work)
+{
+	static uint8_t datagram[UPLINK_DATAGRAM_SIZE_MAX];
+	static int64_t announced = INT64_MIN;
+	int64_t now = k_uptime_get();
+	int64_t origin = 0;
+	bool was_urgent;
+	bool periodic;
+	bool heartbeat = false;
+	uint32_t period = atomic_get(&period_ms);
+	k_spinlock_key_t key;
+	size_t len = 0;
+
+	/* The slots depend on the period, the phase moves with it. */
+	if (period != offset_period) {
+		offset = slot_offset(period);
+		offset_period = period;
+	}
+
+	/* A shorter period takes effect right away, a longer one after the next datagram. */
+	next_periodic = MIN(next_periodic, last_periodic + period + offset);
+	periodic = (now >= next_periodic);
+	if (periodic) {
+		/* Periods start on the same grid, the device keeps its slot. */
+		last_periodic = now - offset;
+		offset = slot_offset(period);
+		next_periodic = last_periodic + period + offset;
+
+		/*
+		 * Reporting on change, a period without new records sends
+		 * nothing and the radio stays asleep, until the heartbeat
+		 * floor has passed since the last datagram.
+		 */
+		heartbeat = !atomic_get(&report_on_change) ||
+			    ((now - last_sent) >= atomic_get(&heartbeat_ms));
+
+		for (size_t i = 0; i < num_collectors; i++) {
+			collectors[i](heartbeat);
+		}
+	}
+
+	key = k_spin_lock(&pending_lock);
+	was_urgent = urgent;
+	origin = urgent_origin;
+	urgent = false;
+	/* Queued records wait for the slot, unless something urgent goes now. */
+	if (periodic || was_urgent) {
+		len = datagram_begin(datagram, was_urgent ? UPLINK_FLAG_URGENT : 0, seq,
+				     heartbeat);
+		memcpy(&datagram[len], pending, pending_len);
+		len += pending_len;
+		pending_len = 0;
+	}
+	k_spin_unlock(&pending_lock, key);
+
+	if (periodic) {
+		atomic_inc((len > UPLINK_HEADER_SIZE) ? &periodic_sent : &periodic_suppressed);
+	}
+
+	if (len > UPLINK_HEADER_SIZE) {
+		seq++;
+		last_sent = now;
+
+		if (was_urgent) {
+			latency_record(origin);
+		}
+
+		TRACE(TRACE_UPLINK_SEND, len, datagram[1]);
+		(void)transport->send(datagram, len, was_urgent);
+	}
+
+	if (next_periodic != announced) {
+		announced = next_periodic;
+		for (size_t i = 0; i < num_schedule_handlers; i++) {
+			schedule_handlers[i](next_periodic);
+		}
+	}
+
+	perf_work_schedule_for_queue(&uplink_work_q, &server_transmission_work,
+				     K_MSEC(MAX(next_periodic - k_uptime_get(), 0)));
+}
+
+int uplink_queue(uint8_t type, const void *data, size_t len)
+{
+	k_spinlock_key_t key = k_spin_lock(&pending_lock);
+	int err;
+
+	err = pending_put(type, data, len);
+
+	k_spin_unlock(&pending_lock, key);
+
+	return err;
+}
+
+int uplink_send_urgent(uint8_t type, const void *data, size_t len, int64_t origin)
+{
+	k_spinlock_key_t key = k_spin_lock(&pending_lock);
+	int err;
+
+	err = pending_put(type, data, len);
+	if (err == 0) {
+		if (urgent) {
+			atomic_inc(&coalesced);
+		} else {
+			urgent = true;
+			urgent_origin = origin;
+		}
+	}
+
+	k_spin_unlock(&pending_lock, key);
+
+	/* Send whatever is queued even if this record did not fit. */
+	if (started && (err != -EINVAL)) {
+		perf_work_reschedule_for_queue(&uplink_work_q, &server_transmission_work,
+					       K_NO_WAIT);
+	}
+
+	return err;
+}
+
+int uplink_burst(uint32_t count, size_t size, uint32_t *elapsed_ms)
+{
+	static uint8_t buf[UPLINK_DATAGRAM_SIZE_MAX];
+	static const uint8_t filler[UPLINK_RECORD_DATA_MAX];
+	int64_t start = k_uptime_get();
+	size_t len;
+	int err = 0;
+
+	if ((size < UPLINK_HEADER_SIZE) || (size > sizeof(buf))) {
+		return -EINVAL;
+	}
+
+	/* Sent from the calling thread, the transport serializes it with the uplink work. */
+	for (uint32_t i = 0; (i < count) && (err == 0); i++) {
+		len = datagram_begin(buf, UPLINK_FLAG_BURST, (uint16_t)i, false);
+		while ((size - len) >= UPLINK_RECORD_HEADER_SIZE) {
+			len += record_put(&buf[len], UPLINK_RECORD_HEARTBEAT, filler,
+					  MIN(size - len - UPLINK_RECORD_HEADER_SIZE,
+					      sizeof(filler)));
+		}
+		err = transport->send(buf, len, i == (count - 1));
+	}
+
+	*elapsed_ms = (uint32_t)(k_uptime_get() - start);
+
+	return err;
+}
+
+#if defined(CONFIG_BENCH)
+static void bench_datagram_build(void)
+{
+	static uint8_t buf[UPLINK_DATAGRAM_SIZE_MAX];
+	static const uint8_t button[2] = { 1, 0 };
+	size_t len;
+
+	len = datagram_begin(buf, UPLINK_FLAG_URGENT, 0, true);
+	(void)record_put(&buf[len], UPLINK_RECORD_BUTTON, button, sizeof(button));
+}
+
+BENCH_DEFINE(udp_payload_build, NULL, bench_datagram_build, NULL);
+#endif
+
+void uplink_latency_get(struct uplink_latency *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&latency_lock);
+
+	*out = latency;
+	out->coalesced = atomic_get(&coalesced);
+
+	k_spin_unlock(&latency_lock, key);
+}
+
+void uplink_transport_stats_get(struct uplink_transport_stats *out)
+{
+	transport->stats_get(out);
+}
+
+const char *uplink_transport_name(void)
+{
+	return transport->name;
+}
+
+void uplink_report_on_change_set(bool on, uint32_t heartbeat)
+{
+	atomic_set(&heartbeat_ms, heartbeat);
+	atomic_set(&report_on_change, on);
+}
+
+void uplink_report_get(struct uplink_report *out)
+{
+	out->on_change = atomic_get(&report_on_change);
+	out->heartbeat_ms = atomic_get(&heartbeat_ms);
+	out->sent = atomic_get(&periodic_sent);
+	out->suppressed = atomic_get(&periodic_suppressed);
+}
+
+int uplink_collector_add(uplink_collector_t collector)
+{
+	if (num_collectors >= ARRAY_SIZE(collectors)) {
+		return -ENOMEM;
+	}
+
+	collectors[num_collectors++] = collector;
+
+	return 0;
+}
+
+int uplink_schedule_subscribe(uplink_schedule_handler_t handler)
+{
+	if (num_schedule_handlers >= ARRAY_SIZE(schedule_handlers)) {
+		return -ENOMEM;
+	}
+
+	schedule_handlers[num_schedule_handlers++] = handler;
+
+	return 0;
+}
+
+void uplink_device_id_set(const void *id, size_t len)
+{
+	k_spinlock_key_t key = k_spin_lock(&slot_lock);
+
+	slot.hash = uplink_slot_hash(id, len);
+	slot_identified = true;
+
+	k_spin_unlock(&slot_lock, key);
+}
+
+void uplink_slot_set(uint32_t width, uint32_t jitter)
+{
+	k_spinlock_key_t key = k_spin_lock(&slot_lock);
+
+	slot.width = width;
+	slot.jitter = jitter;
+
+	k_spin_unlock(&slot_lock, key);
+}
+
+void uplink_slot_get(struct uplink_slot_info *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&slot_lock);
+
+	out->width = slot.width;
+	out->jitter = slot.jitter;
+	out->phase = uplink_slot_phase(&slot, atomic_get(&period_ms));
+	out->identified = slot_identified;
+
+	k_spin_unlock(&slot_lock, key);
+}
+
+void uplink_period_set(uint32_t period)
+{
+	atomic_set(&period_ms, period);
+	if (started) {
+		perf_work_reschedule_for_queue(&uplink_work_q, &server_transmission_work,
+					       K_NO_WAIT);
+	}
+}
+
+void uplink_start(void)
+{
+	if (!slot_identified) {
+#if defined(CONFIG_HWINFO)
+		uint8_t id[16];
+		ssize_t len = hwinfo_get_device_id(id, sizeof(id));
+
+		if (len > 0) {
+			uplink_device_id_set(id, len);
+		}
+#endif
+		if (!slot_identified) {
+			LOG_WRN("No device identity, the upload slot is random");
+			slot.hash = sys_rand32_get();
+		}
+	}
+
+	started = true;
+	last_periodic = k_uptime_get();
+	last_sent = last_periodic;
+	offset_period = atomic_get(&period_ms);
+	offset = slot_offset(offset_period);
+	/* Not right at boot, a fleet powered up together would send all at once. */
+	next_periodic = last_periodic + offset;
+	perf_work_schedule_for_queue(&uplink_work_q, &server_transmission_work, K_NO_WAIT);
+}
+
+int uplink_init(void)
+{
+	struct sockaddr_in server = {
+		.sin_family = AF_INET,
+		.sin_port = htons(CONFIG_UDP_SERVER_PORT),
+	};
+	struct k_work_queue_config uplink_work_q_config = {
+		.name = "uplink_work_q",
+	};
+	int err;
+
+	k_work_queue_init(&uplink_work_q);
+	k_work_queue_start(&uplink_work_q, uplink_work_q_stack,
+			   K_THREAD_STACK_SIZEOF(uplink_work_q_stack), UPLINK_WORK_Q_PRIORITY,
+			   &uplink_work_q_config);
+
+	perf_work_init(&server_transmission_work, server_transmission_work_fn);
+
+	err = inet_pton(AF_INET, CONFIG_UDP_SERVER_ADDRESS_STATIC, &server.sin_addr);
+	if (err != 1) {
+		printk("Not able to initialize UDP server connection\n");
+		return -EINVAL;
+	}
+
+	err = transport->connect(&server);
+	if (err) {
+		printk("Not able to connect to UDP server\n");
+		return err;
+	}
+
+	return 0;
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef UPLINK_H__
+#define UPLINK_H__
+
+#include <zephyr/kernel.h>
+
+#include "perf_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Datagram format
+ *
+ * A 4 byte header, version, flags and a little endian sequence number,
+ * followed by the queued records. Each record is a type byte, a length byte
+ * and up to UPLINK_RECORD_DATA_MAX bytes of data.
+ */
+#define UPLINK_VERSION          1
+#define UPLINK_HEADER_SIZE      4
+#define UPLINK_RECORD_HEADER_SIZE 2
+#define UPLINK_RECORD_DATA_MAX  UINT8_MAX
+
+/* The header, the heartbeat and stats records, and all queued records. */
+#define UPLINK_DATAGRAM_SIZE_MAX (UPLINK_HEADER_SIZE + UPLINK_RECORD_HEADER_SIZE + \
+				  CONFIG_UDP_DATA_UPLOAD_SIZE_BYTES + \
+				  UPLINK_RECORD_HEADER_SIZE + PERF_STATS_RECORD_SIZE + \
+				  CONFIG_UDP_UPLINK_QUEUE_SIZE)
+
+/* The datagram was sent early because of an urgent record. */
+#define UPLINK_FLAG_URGENT      BIT(0)
+/* Filler sent by uplink_burst(), with a sequence number of its own. */
+#define UPLINK_FLAG_BURST       BIT(1)
+
+/* Record types */
+#define UPLINK_RECORD_HEARTBEAT 1
+#define UPLINK_RECORD_BUTTON    2
+#define UPLINK_RECORD_STATS     3
+/* Vibration spectrum, see vibration.h. */
+#define UPLINK_RECORD_SPECTRUM  4
+/* Sensor channel window summary, see sensor_agg.h. */
+#define UPLINK_RECORD_SUMMARY   5
+/* Geofence enter, exit or dwell, see geofence_mgr.h. */
+#define UPLINK_RECORD_GEOFENCE  6
+
+/* Power of two latency buckets, bucket i counts [2^i, 2^(i+1)) ms, 0 also counts 0 ms. */
+#define UPLINK_LATENCY_BUCKETS  14
+
+/** @brief Latency from an urgent event to send(). */
+struct uplink_latency {
+	uint32_t bucket[UPLINK_LATENCY_BUCKETS];
+	uint32_t count;
+	uint32_t max_ms;
+
+	/* Urgent records that shared a datagram with an earlier one. */
+	uint32_t coalesced;
+};
+
+/** @brief Counters of the socket to the server. */
+struct uplink_transport_stats {
+	/* Sockets set up, with CONFIG_UDP_DTLS each one is a handshake. */
+	uint32_t connects;
+	uint32_t connect_ms_last;
+	uint32_t connect_ms_max;
+	uint32_t sends;
+	uint32_t send_errors;
+	/* Socket writes and the bytes they took, fewer writes than sends when coalesced. */
+	uint32_t writes;
+	uint32_t bytes;
+	/* Datagrams that did not fit the TCP backlog, and the bytes waiting in it. */
+	uint32_t dropped;
+	uint32_t backlog;
+	/* The server took the DTLS Connection ID. */
+	bool cid;
+};
+
+/**
+ * @brief Connect to the server over the transport chosen in Kconfig.
+ *
+ * With CONFIG_UDP_DTLS this runs the handshake. A connection that fails
+ * is set up again by the transport.
+ *
+ * @return int 0 if successful, negative error code if not.
+ */
+int uplink_init(void);
+
+/**
+ * @brief Start the periodic transmission.
+ *
+ * The first datagram goes out in the slot of the device, see
+ * uplink_device_id_set(), within one period.
+ */
+void uplink_start(void);
+
+/** @brief Upload slot settings, times in ms. */
+struct uplink_slot_info {
+	uint32_t width;
+	uint32_t jitter;
+	/* Start of the slot of the device in the current period. */
+	uint32_t phase;
+	/* The slot comes from the device identity rather than at random. */
+	bool identified;
+};
+
+/**
+ * @brief Set the identity the slot of the device is derived from, e.g. the IMEI.
+ *
+ * Call before uplink_start(). Without it the slot comes from the hardware
+ * ID with CONFIG_HWINFO, or at random.
+ */
+void uplink_device_id_set(const void *id, size_t len);
+
+/**
+ * @brief Change the upload slots, e.g. as told by the server.
+ *
+ * Takes effect from the next periodic datagram.
+ *
+ * @param width Slot width in ms, 0 to send at the start of every period.
+ * @param jitter Largest random delay within the slot in ms.
+ */
+void uplink_slot_set(uint32_t width, uint32_t jitter);
+
+/**
+ * @brief Get the upload slot settings.
+ *
+ * @param[out] info Settings and the phase of the device.
+ */
+void uplink_slot_get(struct uplink_slot_info *info);
+
+/* Most functions uplink_collector_add() takes. */
+#define UPLINK_COLLECTORS_MAX   4
+
+/**
+ * @brief Queue records for a periodic datagram.
+ *
+ * @param all The datagram goes out regardless, e.g. for the heartbeat, so
+ *            report everything and not only what changed.
+ */
+typedef void (*uplink_collector_t)(bool all);
+
+/* Most functions uplink_schedule_subscribe() takes. */
+#define UPLINK_SCHEDULE_SUBSCRIBERS_MAX 2
+
+/**
+ * @brief Told the uptime in ms of the next periodic datagram.
+ */
+typedef void (*uplink_schedule_handler_t)(int64_t next);
+
+/** @brief Report on change settings and counters. */
+struct uplink_report {
+	bool on_change;
+	uint32_t heartbeat_ms;
+	/* Periodic datagrams sent, and skipped since nothing changed. */
+	uint32_t sent;
+	uint32_t suppressed;
+};
+
+/**
+ * @brief Register a function called right before every periodic datagram.
+ *
+ * It queues its records with uplink_queue(), so windows can close exactly
+ * at the upload interval. Called from the uplink work item. With report on
+ * change, a period in which no collector queues anything sends nothing.
+ *
+ * @return int 0 if successful, -ENOMEM if there are too many collectors.
+ */
+int uplink_collector_add(uplink_collector_t collector);
+
+/**
+ * @brief Register a function told whenever the next periodic datagram is planned.
+ *
+ * So work can be done just in time for it. Called from the uplink work
+ * item, after every datagram and whenever the period changes.
+ *
+ * @return int 0 if successful, -ENOMEM if there are too many subscribers.
+ */
+int uplink_schedule_subscribe(uplink_schedule_handler_t handler);
+
+/**
+ * @brief Set up report on change.
+ *
+ * @param on Skip periodic datagrams without new records, the heartbeat
+ *           record is then only sent as the floor below.
+ * @param heartbeat Longest time in ms without a datagram.
+ */
+void uplink_report_on_change_set(bool on, uint32_t heartbeat);
+
+/**
+ * @brief Get the report on change settings and counters.
+ *
+ * @param[out] report Settings and counters.
+ */
+void uplink_report_get(struct uplink_report *report);
+
+/**
+ * @brief Change the period of the transmission.
+ *
+ * A shorter period applies at once, counted from the last periodic
+ * datagram.
+ *
+ * @param period Period in ms.
+ */
+void uplink_period_set(uint32_t period);
+
+/**
+ * @brief Queue a record for the next datagram.
+ *
+ * @param type UPLINK_RECORD_* type.
+ * @param data Record data.
+ * @param len Length of data, at most UPLINK_RECORD_DATA_MAX.
+ * @return int 0 if successful, negative error code if not.
+ */
+int uplink_queue(uint8_t type, const void *data, size_t len);
+
+/**
+ * @brief Queue a record and send it without waiting for the period.
+ *
+ * Urgent records that arrive before the datagram goes out share it, and
+ * all records queued so far are carried along.
+ *
+ * @param type UPLINK_RECORD_* type.
+ * @param data Record data.
+ * @param len Length of data, at most UPLINK_RECORD_DATA_MAX.
+ * @param origin Uptime in ms of the event behind the record, the latency
+ *               histogram is measured from it.
+ * @return int 0 if successful, negative error code if not.
+ */
+int uplink_send_urgent(uint8_t type, const void *data, size_t len, int64_t origin);
+
+/**
+ * @brief Get the urgent latency histogram.
+ *
+ * @param[out] latency The histogram.
+ */
+void uplink_latency_get(struct uplink_latency *latency);
+
+/**
+ * @brief Get the counters of the socket to the server.
+ *
+ * @param[out] stats Counters.
+ */
+void uplink_transport_stats_get(struct uplink_transport_stats *stats);
+
+/**
+ * @brief Get the name of the transport, e.g. "UDP" or "TCP".
+ */
+const char *uplink_transport_name(void);
+
+/**
+ * @brief Send datagrams of filler records back to back, for benchmarking.
+ *
+ * They carry UPLINK_FLAG_BURST. The last one is sent as urgent, so a
+ * transport that coalesces writes pushes everything out.
+ *
+ * @param count Number of datagrams.
+ * @param size Size of each datagram, at most UPLINK_DATAGRAM_SIZE_MAX.
+ * @param[out] elapsed_ms Time it took to hand them to the transport.
+ * @return int 0 if successful, negative error code of the first failure.
+ */
+int uplink_burst(uint32_t count, size_t size, uint32_t *elapsed_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UPLINK_H__ */
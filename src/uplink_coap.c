@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/random/rand32.h>
+#include <string.h>
+
+#include "uplink.h"
+#include "uplink_coap.h"
+#include "perf_stats.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(uplink_coap, CONFIG_UDP_LOG_LEVEL);
+
+#define UPLINK_COAP_THREAD_STACK_SIZE 1024
+#define UPLINK_COAP_THREAD_PRIORITY   K_LOWEST_APPLICATION_THREAD_PRIO
+
+#define TOKEN_LEN  4
+#define BLOCK_SIZE CONFIG_UDP_COAP_BLOCK_SIZE
+#define BLOCK_SZX  (__builtin_ctz(BLOCK_SIZE) - 4)
+
+/* Header, token, Uri-Path, Content-Format, Block2, Block1 and the payload marker. */
+#define MESSAGE_OVERHEAD_MAX (4 + TOKEN_LEN + 3 + sizeof(CONFIG_UDP_COAP_PATH) + 2 + 4 + 4 + 1)
+#define MESSAGE_SIZE_MAX     (MESSAGE_OVERHEAD_MAX + BLOCK_SIZE)
+
+/* ACK_RANDOM_FACTOR of RFC 7252 is 1.5, in percent. */
+#define ACK_RANDOM_PERCENT 50
+
+/* Block option value, the block number, the more flag and the size exponent. */
+#define BLOCK_OPTION(_num, _more) (((_num) << 4) | ((_more) ? BIT(3) : 0) | BLOCK_SZX)
+
+BUILD_ASSERT(IS_POWER_OF_TWO(BLOCK_SIZE) && (BLOCK_SIZE >= 16) && (BLOCK_SIZE <= 1024),
+	     "CoAP blocks are powers of two of 16 to 1024 bytes");
+BUILD_ASSERT((UPLINK_DATAGRAM_SIZE_MAX / BLOCK_SIZE) < BIT(20),
+	     "Block numbers take at most 20 bits");
+
+/* The confirmable exchange, which may take several messages. */
+struct exchange {
+	bool active;
+	/* Acknowledged empty, the response comes separately. */
+	bool separate;
+	uint8_t token[TOKEN_LEN];
+	uint8_t data[UPLINK_DATAGRAM_SIZE_MAX];
+	size_t len;
+	/* Request block to send, and response block to fetch once sent. */
+	uint32_t block1;
+	uint32_t block2;
+	/* The message in flight, kept for retransmission. */
+	uint8_t msg[MESSAGE_SIZE_MAX];
+	uint16_t msg_len;
+	uint16_t id;
+	uint8_t retries;
+	uint32_t timeout_ms;
+};
+
+PERF_WORK_DEFINE(retransmit_work);
+
+/* Guards the socket, the exchange, the caches and the counters. */
+static K_MUTEX_DEFINE(coap_lock);
+static K_SEM_DEFINE(socket_ready, 0, 1);
+
+static int sock = -1;
+static struct exchange exchange;
+
+/* IDs of messages received, and tokens of NON requests sent, newest last. */
+static uint16_t seen_ids[CONFIG_UDP_COAP_DEDUP_SIZE];
+static size_t seen_next;
+static size_t seen_num;
+static uint8_t non_tokens[CONFIG_UDP_COAP_DEDUP_SIZE][TOKEN_LEN];
+static size_t non_tokens_next;
+
+static struct uplink_coap_stats stats;
+
+static bool seen(uint16_t id)
+{
+	for (size_t i = 0; i < seen_num; i++) {
+		if (seen_ids[i] == id) {
+			return true;
+		}
+	}
+
+	seen_ids[seen_next] = id;
+	seen_next = (seen_next + 1) % ARRAY_SIZE(seen_ids);
+	seen_num = MIN(seen_num + 1, ARRAY_SIZE(seen_ids));
+
+	return false;
+}
+
+static bool non_token_known(const uint8_t *token)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(non_tokens); i++) {
+		if (memcmp(non_tokens[i], token, TOKEN_LEN) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void token_new(uint8_t *token)
+{
+	uint8_t *random = coap_next_token();
+
+	memcpy(token, random, TOKEN_LEN);
+}
+
+/**
+ * @brief Build a POST of block num of data, or of all of it if it fits one block.
+ *
+ * @param block2 Response block to ask for, then without payload, or -1.
+ * @return int Length of the message, negative error code if it does not fit.
+ */
+static int request_build(uint8_t *buf, uint8_t type, const uint8_t *token, uint16_t id,
+			 const uint8_t *data, size_t len, uint32_t num, int64_t block2)
+{
+	struct coap_packet pkt;
+	size_t offset = 0;
+	size_t chunk = len;
+	int err;
+
+	if (len > BLOCK_SIZE) {
+		offset = num * BLOCK_SIZE;
+		chunk = MIN(BLOCK_SIZE, len - offset);
+	}
+
+	err = coap_packet_init(&pkt, buf, MESSAGE_SIZE_MAX, COAP_VERSION_1, type, TOKEN_LEN,
+			       token, COAP_METHOD_POST, id);
+	if (err == 0) {
+		err = coap_packet_append_option(&pkt, COAP_OPTION_URI_PATH,
+						(const uint8_t *)CONFIG_UDP_COAP_PATH,
+						strlen(CONFIG_UDP_COAP_PATH));
+	}
+	if (err == 0) {
+		err = coap_append_option_int(&pkt, COAP_OPTION_CONTENT_FORMAT,
+					     COAP_CONTENT_FORMAT_APP_OCTET_STREAM);
+	}
+	if ((err == 0) && (block2 >= 0)) {
+		err = coap_append_option_int(&pkt, COAP_OPTION_BLOCK2,
+					     BLOCK_OPTION((uint32_t)block2, false));
+	}
+	if ((err == 0) && (len > BLOCK_SIZE)) {
+		err = coap_append_option_int(&pkt, COAP_OPTION_BLOCK1,
+					     BLOCK_OPTION(num, (offset + chunk) < len));
+	}
+	if ((err == 0) && (block2 < 0)) {
+		stats.header_bytes += pkt.offset + 1;
+		stats.payload_bytes += chunk;
+		err = coap_packet_append_payload_marker(&pkt);
+		if (err == 0) {
+			err = coap_packet_append_payload(&pkt, &data[offset], chunk);
+		}
+	} else if (err == 0) {
+		stats.header_bytes += pkt.offset;
+	}
+
+	return (err == 0) ? (int)pkt.offset : err;
+}
+
+static void exchange_transmit(void)
+{
+	if (send(sock, exchange.msg, exchange.msg_len, 0) < 0) {
+		LOG_WRN("Failed to send CoAP message, %d", errno);
+	}
+
+	perf_work_reschedule(&retransmit_work, K_MSEC(exchange.timeout_ms));
+}
+
+/* Send the next message of the exchange, the blocks of the request, then of the response. */
+static void exchange_next(void)
+{
+	bool fetching = (exchange.block2 > 0);
+	int len;
+
+	exchange.id = coap_next_id();
+	len = request_build(exchange.msg, COAP_TYPE_CON, exchange.token, exchange.id,
+			    exchange.data, exchange.len, exchange.block1,
+			    fetching ? (int64_t)exchange.block2 : -1);
+	if (len < 0) {
+		LOG_ERR("CoAP request does not fit, %d", len);
+		exchange.active = false;
+		return;
+	}
+
+	exchange.msg_len = len;
+	exchange.separate = false;
+	exchange.retries = 0;
+	exchange.timeout_ms = CONFIG_UDP_COAP_ACK_TIMEOUT_MS +
+			      ((CONFIG_UDP_COAP_ACK_TIMEOUT_MS * ACK_RANDOM_PERCENT / 100) *
+			       (sys_rand32_get() % 1000) / 1000);
+	exchange_transmit();
+}
+
+static void retransmit_work_fn(struct k_work *work)
+{
+	k_mutex_lock(&coap_lock, K_FOREVER);
+
+	if (!exchange.active || (sock < 0)) {
+		/* Nothing to do. */
+	} else if (exchange.separate || (exchange.retries >= CONFIG_UDP_COAP_MAX_RETRANSMIT)) {
+		LOG_WRN("CoAP exchange timed out");
+		stats.timeouts++;
+		exchange.active = false;
+	} else {
+		exchange.retries++;
+		exchange.timeout_ms *= 2;
+		stats.retransmissions++;
+		exchange_transmit();
+	}
+
+	k_mutex_unlock(&coap_lock);
+}
+
+static void empty_send(uint8_t type, uint16_t id)
+{
+	uint8_t buf[4];
+	struct coap_packet pkt;
+
+	if (coap_packet_init(&pkt, buf, sizeof(buf), COAP_VERSION_1, type, 0, NULL,
+			     COAP_CODE_EMPTY, id) == 0) {
+		(void)send(sock, buf, pkt.offset, 0);
+	}
+}
+
+static void response_handle(const struct coap_packet *pkt)
+{
+	uint8_t code = coap_header_get_code(pkt);
+	uint16_t payload_len = 0;
+	int block;
+
+	stats.responses++;
+	(void)coap_packet_get_payload(pkt, &payload_len);
+
+	if ((code >> 5) != 2) {
+		LOG_WRN("CoAP request failed, %u.%02u", code >> 5, code & 0x1f);
+		stats.errors++;
+		exchange.active = false;
+		return;
+	}
+
+	if ((code == COAP_RESPONSE_CODE_CONTINUE) &&
+	    (((exchange.block1 + 1) * BLOCK_SIZE) < exchange.len)) {
+		exchange.block1++;
+		stats.block1++;
+		exchange_next();
+		return;
+	}
+
+	block = coap_get_option_int(pkt, COAP_OPTION_BLOCK2);
+	if ((block >= 0) && (block & BIT(3))) {
+		exchange.block2 = (block >> 4) + 1;
+		stats.block2++;
+		exchange_next();
+		return;
+	}
+
+	LOG_DBG("CoAP exchange done, %u.%02u, %u bytes", code >> 5, code & 0x1f, payload_len);
+	exchange.active = false;
+	(void)perf_work_cancel(&retransmit_work);
+}
+
+static void received(const uint8_t *buf, size_t len)
+{
+	struct coap_packet pkt;
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t type;
+	uint16_t id;
+	bool ours;
+
+	if (coap_packet_parse(&pkt, (uint8_t *)buf, len, NULL, 0) != 0) {
+		return;
+	}
+
+	type = coap_header_get_type(&pkt);
+	id = coap_header_get_id(&pkt);
+
+	/* A retransmission of something handled already, only the ACK is repeated. */
+	if (seen(id)) {
+		stats.duplicates++;
+		if (type == COAP_TYPE_CON) {
+			empty_send(COAP_TYPE_ACK, id);
+		}
+		return;
+	}
+
+	if ((type == COAP_TYPE_ACK) || (type == COAP_TYPE_RESET)) {
+		if (!exchange.active || (id != exchange.id)) {
+			return;
+		}
+		if (type == COAP_TYPE_RESET) {
+			stats.errors++;
+			exchange.active = false;
+			(void)perf_work_cancel(&retransmit_work);
+			return;
+		}
+		if (coap_header_get_code(&pkt) == COAP_CODE_EMPTY) {
+			/* Wait for the separate response as long as retransmitting would have taken. */
+			exchange.separate = true;
+			perf_work_reschedule(&retransmit_work,
+					     K_MSEC(exchange.timeout_ms <<
+						    (CONFIG_UDP_COAP_MAX_RETRANSMIT - exchange.retries)));
+			return;
+		}
+		response_handle(&pkt);
+		return;
+	}
+
+	/* A separate response, or the response to a NON request. */
+	ours = (coap_header_get_token(&pkt, token) == TOKEN_LEN) &&
+	       ((exchange.active && (memcmp(token, exchange.token, TOKEN_LEN) == 0)) ||
+		non_token_known(token));
+	if (!ours) {
+		if (type == COAP_TYPE_CON) {
+			empty_send(COAP_TYPE_RESET, id);
+		}
+		return;
+	}
+
+	if (type == COAP_TYPE_CON) {
+		empty_send(COAP_TYPE_ACK, id);
+	}
+
+	if (exchange.active && (memcmp(token, exchange.token, TOKEN_LEN) == 0)) {
+		response_handle(&pkt);
+	} else {
+		stats.responses++;
+	}
+}
+
+int uplink_coap_send(const uint8_t *data, size_t len, bool confirmable)
+{
+	static uint8_t msg[MESSAGE_SIZE_MAX];
+	uint8_t token[TOKEN_LEN];
+	uint32_t blocks = DIV_ROUND_UP(len, BLOCK_SIZE);
+	int err = 0;
+
+	if (len > sizeof(exchange.data)) {
+		return -EMSGSIZE;
+	}
+
+	k_mutex_lock(&coap_lock, K_FOREVER);
+
+	if (sock < 0) {
+		err = -ENOTCONN;
+		goto out;
+	}
+
+	/* One confirmable exchange at a time, NSTART of RFC 7252 is 1. */
+	if (confirmable && exchange.active) {
+		stats.con_busy++;
+		confirmable = false;
+	}
+
+	if (confirmable) {
+		exchange.active = true;
+		token_new(exchange.token);
+		memcpy(exchange.data, data, len);
+		exchange.len = len;
+		exchange.block1 = 0;
+		exchange.block2 = 0;
+		stats.con++;
+		exchange_next();
+		goto out;
+	}
+
+	/* Without acknowledgements the blocks of a NON request all go at once. */
+	token_new(token);
+	memcpy(non_tokens[non_tokens_next], token, TOKEN_LEN);
+	non_tokens_next = (non_tokens_next + 1) % ARRAY_SIZE(non_tokens);
+	stats.non++;
+
+	for (uint32_t num = 0; (num < blocks) && (err == 0); num++) {
+		int msg_len = request_build(msg, COAP_TYPE_NON, token, coap_next_id(),
+					    data, len, num, -1);
+
+		if (msg_len < 0) {
+			err = msg_len;
+		} else if (send(sock, msg, msg_len, 0) < 0) {
+			err = -errno;
+		}
+		stats.block1 += (num > 0);
+	}
+
+out:
+	k_mutex_unlock(&coap_lock);
+
+	return err;
+}
+
+void uplink_coap_socket_set(int fd)
+{
+	k_mutex_lock(&coap_lock, K_FOREVER);
+
+	sock = fd;
+	if (fd < 0) {
+		exchange.active = false;
+		(void)perf_work_cancel(&retransmit_work);
+	}
+
+	k_mutex_unlock(&coap_lock);
+
+	if (fd >= 0) {
+		k_sem_give(&socket_ready);
+	}
+}
+
+void uplink_coap_stats_get(struct uplink_coap_stats *out)
+{
+	k_mutex_lock(&coap_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&coap_lock);
+}
+
+/* Receives until the socket is closed, then waits for the next one. */
+static void uplink_coap_thread_fn(void)
+{
+	static uint8_t buf[MESSAGE_SIZE_MAX];
+	ssize_t len;
+	int fd;
+
+	for (;;) {
+		(void)k_sem_take(&socket_ready, K_FOREVER);
+
+		k_mutex_lock(&coap_lock, K_FOREVER);
+		fd = sock;
+		k_mutex_unlock(&coap_lock);
+
+		while (fd >= 0) {
+			len = recv(fd, buf, sizeof(buf), 0);
+			if ((len < 0) && (errno != EAGAIN) && (errno != EINTR)) {
+				break;
+			}
+
+			k_mutex_lock(&coap_lock, K_FOREVER);
+			if ((len > 0) && (fd == sock)) {
+				received(buf, len);
+			}
+			fd = (fd == sock) ? fd : -1;
+			k_mutex_unlock(&coap_lock);
+		}
+	}
+}
+
+static int uplink_coap_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	perf_work_init(&retransmit_work, retransmit_work_fn);
+
+	return 0;
+}
+
+SYS_INIT(uplink_coap_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+K_THREAD_DEFINE(uplink_coap_thread, UPLINK_COAP_THREAD_STACK_SIZE,
+		uplink_coap_thread_fn, NULL, NULL, NULL,
+		UPLINK_COAP_THREAD_PRIORITY, 0, 0);
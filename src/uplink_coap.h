@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef UPLINK_COAP_H__
+#define UPLINK_COAP_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * CoAP transport of the uplink
+ *
+ * Every datagram is the payload of a POST to CONFIG_UDP_COAP_PATH, in the
+ * datagram format of uplink.h. Periodic ones are sent non-confirmable,
+ * urgent ones confirmable, one exchange at a time. Payloads above
+ * CONFIG_UDP_COAP_BLOCK_SIZE go block-wise (Block1), and block-wise
+ * responses are fetched to the end (Block2).
+ */
+
+/** @brief Counters of the CoAP transport. */
+struct uplink_coap_stats {
+	uint32_t non;
+	uint32_t con;
+	/* Urgent datagrams sent NON while a CON exchange was still open. */
+	uint32_t con_busy;
+	uint32_t retransmissions;
+	/* CON exchanges given up after CONFIG_UDP_COAP_MAX_RETRANSMIT. */
+	uint32_t timeouts;
+	/* Request blocks beyond the first, and response blocks fetched. */
+	uint32_t block1;
+	uint32_t block2;
+	uint32_t responses;
+	/* Error responses and resets. */
+	uint32_t errors;
+	/* Messages dropped by the message ID cache. */
+	uint32_t duplicates;
+	/* Bytes of CoAP headers and options sent, and of payload. */
+	uint32_t header_bytes;
+	uint32_t payload_bytes;
+};
+
+/**
+ * @brief Set the socket to the server, or -1 before it is closed.
+ *
+ * Closing drops an open exchange.
+ *
+ * @param fd Connected UDP or DTLS socket.
+ */
+void uplink_coap_socket_set(int fd);
+
+/**
+ * @brief Send a datagram.
+ *
+ * @param data Datagram.
+ * @param len Length of data, at most UPLINK_DATAGRAM_SIZE_MAX.
+ * @param confirmable Send it as CON and retransmit until acknowledged.
+ * @return int 0 if successful, negative error code if not.
+ */
+int uplink_coap_send(const uint8_t *data, size_t len, bool confirmable);
+
+/**
+ * @brief Get the counters.
+ *
+ * @param[out] stats Counters.
+ */
+void uplink_coap_stats_get(struct uplink_coap_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UPLINK_COAP_H__ */
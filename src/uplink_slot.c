@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include "uplink_slot.h"
+
+/* 32 bit FNV-1a. */
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME        16777619u
+
+uint32_t uplink_slot_hash(const void *id, size_t len)
+{
+	const uint8_t *p = id;
+	uint32_t hash = FNV_OFFSET_BASIS;
+
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ p[i]) * FNV_PRIME;
+	}
+
+	/*
+	 * Serial numbers differ in the last digits, which FNV-1a leaves in the
+	 * low bits mostly. Mix them up before taking the hash modulo the slots.
+	 */
+	hash ^= hash >> 16;
+	hash *= 0x7feb352du;
+	hash ^= hash >> 15;
+
+	return hash;
+}
+
+uint32_t uplink_slot_phase(const struct uplink_slot *slot, uint32_t period)
+{
+	uint32_t slots;
+
+	if ((slot->width == 0) || (slot->width >= period)) {
+		return 0;
+	}
+
+	slots = period / slot->width;
+
+	return (slot->hash % slots) * slot->width;
+}
+
+uint32_t uplink_slot_offset(const struct uplink_slot *slot, uint32_t period, uint32_t rand)
+{
+	uint32_t offset = uplink_slot_phase(slot, period);
+
+	if (period == 0) {
+		return 0;
+	}
+
+	if (slot->jitter > 0) {
+		offset += rand % slot->jitter;
+	}
+
+	/* A jitter wider than the slot must not push the send into the next period. */
+	return (offset < period) ? offset : (period - 1);
+}
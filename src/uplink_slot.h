@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef UPLINK_SLOT_H__
+#define UPLINK_SLOT_H__
+
+/* Plain C without Zephyr headers, so scripts/uplink_slot_sim.c can build it on the host. */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Where in the upload period a device sends, all times in ms.
+ *
+ * The period is cut into slots of width ms and the device takes the one
+ * picked by the hash of its identity, so the same device always sends at
+ * the same phase and a fleet that powers up together spreads over the
+ * period. The jitter adds a random delay within the slot on every send.
+ */
+struct uplink_slot {
+	/* Hash of the device identity, see uplink_slot_hash(). */
+	uint32_t hash;
+	/* Slot width, 0 for no slots. */
+	uint32_t width;
+	uint32_t jitter;
+};
+
+/**
+ * @brief Hash a device identity, such as the IMEI, to pick its slot.
+ */
+uint32_t uplink_slot_hash(const void *id, size_t len);
+
+/**
+ * @brief Get the phase of the device in a period, without the jitter.
+ *
+ * @return uint32_t Start of the slot of the device, 0 with no slots.
+ */
+uint32_t uplink_slot_phase(const struct uplink_slot *slot, uint32_t period);
+
+/**
+ * @brief Get the delay from the start of a period to the send.
+ *
+ * @param rand Random number for the jitter, new for every period.
+ * @return uint32_t The phase and the jitter, less than the period.
+ */
+uint32_t uplink_slot_offset(const struct uplink_slot *slot, uint32_t period, uint32_t rand);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UPLINK_SLOT_H__ */
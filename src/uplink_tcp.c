@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/posix/fcntl.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+#include "uplink_transport.h"
+#include "perf_stats.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(uplink_tcp, CONFIG_UDP_LOG_LEVEL);
+
+/*
+ * Stream format
+ *
+ * Each datagram is preceded by its length, little endian 16 bits. The
+ * datagrams wait in the backlog until CONFIG_UDP_TCP_COALESCE_MS has passed,
+ * an urgent one comes or CONFIG_UDP_TCP_COALESCE_SIZE bytes are waiting,
+ * and then go out in as few writes as the socket takes. While the server
+ * is not reachable they keep waiting, and the backlog is drained in bulk
+ * once it is back.
+ */
+#define FRAME_HEADER_SIZE 2
+
+#define RECONNECT_MIN_MS 1000
+
+/* Time to the next try when the send window is full. */
+#define WINDOW_RETRY_MS 100
+
+/* Time to the next look at a connect in progress, and how long it may take. */
+#define CONNECT_POLL_MS 100
+#define CONNECT_TIMEOUT_MS (30 * MSEC_PER_SEC)
+#define RECONNECT_MAX_MS (CONFIG_UDP_TCP_RECONNECT_MAX_SECONDS * MSEC_PER_SEC)
+
+BUILD_ASSERT(UPLINK_DATAGRAM_SIZE_MAX <= UINT16_MAX, "Datagram lengths take 16 bits");
+BUILD_ASSERT(CONFIG_UDP_TCP_BACKLOG_SIZE >= (FRAME_HEADER_SIZE + UPLINK_DATAGRAM_SIZE_MAX),
+	     "The backlog must take a datagram");
+
+PERF_WORK_DEFINE(flush_work);
+
+/* Guards the socket, the backlog and the counters. */
+static K_MUTEX_DEFINE(tcp_lock);
+
+static int client_fd = -1;
+static struct sockaddr_in host_addr;
+static struct uplink_transport_stats stats;
+
+/* Frames not yet fully written, the first head_sent bytes of them are. */
+static uint8_t backlog[CONFIG_UDP_TCP_BACKLOG_SIZE];
+static size_t backlog_len;
+static size_t head_sent;
+
+static int64_t reconnect_at;
+static uint32_t reconnect_ms = RECONNECT_MIN_MS;
+
+/* The socket is connecting since connect_start, nothing is sent until it is up. */
+static bool connecting;
+static int64_t connect_start;
+
+static void tcp_disconnect(void)
+{
+	(void)close(client_fd);
+	client_fd = -1;
+	connecting = false;
+
+	/* The server drops the torn frame, it goes again whole on the next connection. */
+	head_sent = 0;
+
+	reconnect_at = k_uptime_get() + reconnect_ms;
+	reconnect_ms = MIN(reconnect_ms * 2, RECONNECT_MAX_MS);
+}
+
+static void tcp_connected(void)
+{
+	uint32_t ms = (uint32_t)(k_uptime_get() - connect_start);
+
+	connecting = false;
+	stats.connects++;
+	stats.connect_ms_last = ms;
+	stats.connect_ms_max = MAX(stats.connect_ms_max, ms);
+	reconnect_ms = RECONNECT_MIN_MS;
+}
+
+/*
+ * The connect does not block, the work queue and tcp_lock are not held for
+ * the round trip to the server. tcp_connect_poll() looks at it again from
+ * flush_work until it is up, failed or timed out.
+ */
+static int tcp_reconnect(void)
+{
+	int err;
+
+	connect_start = k_uptime_get();
+
+	client_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (client_fd < 0) {
+		LOG_ERR("Failed to create TCP socket: %d", errno);
+		err = -errno;
+		goto error;
+	}
+
+#if defined(TCP_NODELAY)
+	{
+		/* Coalescing is done here, where it knows what is urgent. */
+		int nodelay = 1;
+
+		(void)setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+	}
+#endif
+
+	if (fcntl(client_fd, F_SETFL, O_NONBLOCK) < 0) {
+		LOG_ERR("Failed to make the TCP socket non-blocking: %d", errno);
+		err = -errno;
+		goto error;
+	}
+
+	err = connect(client_fd, (struct sockaddr *)&host_addr, sizeof(host_addr));
+	if ((err < 0) && (errno == EINPROGRESS)) {
+		connecting = true;
+		perf_work_reschedule(&flush_work, K_MSEC(CONNECT_POLL_MS));
+		return -EINPROGRESS;
+	}
+	if (err < 0) {
+		LOG_WRN("TCP connect failed: %d", errno);
+		err = -errno;
+		goto error;
+	}
+
+	tcp_connected();
+
+	return 0;
+
+error:
+	tcp_disconnect();
+
+	return err;
+}
+
+static void tcp_connect_poll(void)
+{
+	struct pollfd fds = {
+		.fd = client_fd,
+		.events = POLLOUT,
+	};
+	socklen_t len = sizeof(int);
+	int err = 0;
+
+	if (poll(&fds, 1, 0) == 0) {
+		if ((k_uptime_get() - connect_start) < CONNECT_TIMEOUT_MS) {
+			perf_work_reschedule(&flush_work, K_MSEC(CONNECT_POLL_MS));
+			return;
+		}
+		err = ETIMEDOUT;
+	} else if (getsockopt(client_fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
+		err = errno;
+	}
+
+	if (err != 0) {
+		LOG_WRN("TCP connect failed: %d", err);
+		tcp_disconnect();
+		return;
+	}
+
+	tcp_connected();
+}
+
+/* Drop the frames written whole, keeping the one in flight. */
+static void backlog_consume(size_t sent)
+{
+	size_t done = 0;
+
+	head_sent += sent;
+	while ((backlog_len - done) >= FRAME_HEADER_SIZE) {
+		size_t frame = FRAME_HEADER_SIZE + sys_get_le16(&backlog[done]);
+
+		if ((head_sent - done) < frame) {
+			break;
+		}
+		done += frame;
+	}
+
+	memmove(backlog, &backlog[done], backlog_len - done);
+	backlog_len -= done;
+	head_sent -= done;
+}
+
+/* Write out as much of the backlog as the send window takes, without waiting. */
+static void tcp_flush(void)
+{
+	ssize_t sent;
+
+	if ((client_fd < 0) && (k_uptime_get() >= reconnect_at)) {
+		(void)tcp_reconnect();
+	} else if (connecting) {
+		tcp_connect_poll();
+	}
+
+	while ((client_fd >= 0) && !connecting && (head_sent < backlog_len)) {
+		sent = send(client_fd, &backlog[head_sent], backlog_len - head_sent, MSG_DONTWAIT);
+		if (sent < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				perf_work_reschedule(&flush_work, K_MSEC(WINDOW_RETRY_MS));
+				return;
+			}
+			LOG_WRN("TCP send failed: %d", errno);
+			stats.send_errors++;
+			tcp_disconnect();
+			break;
+		}
+
+		stats.writes++;
+		stats.bytes += sent;
+		backlog_consume(sent);
+	}
+
+	stats.backlog = backlog_len;
+
+	/* Retry while the server is away, the backlog drains when it is back. */
+	if ((client_fd < 0) && (backlog_len > 0)) {
+		perf_work_reschedule(&flush_work,
+				     K_MSEC(MAX(reconnect_at - k_uptime_get(), 0)));
+	}
+}
+
+static void flush_work_fn(struct k_work *work)
+{
+	k_mutex_lock(&tcp_lock, K_FOREVER);
+	tcp_flush();
+	k_mutex_unlock(&tcp_lock);
+}
+
+static int tcp_connect(const struct sockaddr_in *server)
+{
+	k_mutex_lock(&tcp_lock, K_FOREVER);
+
+	host_addr = *server;
+
+	/* A server that is not up yet is retried when there is something to send. */
+	(void)tcp_reconnect();
+
+	k_mutex_unlock(&tcp_lock);
+
+	return 0;
+}
+
+static int tcp_send(const uint8_t *data, size_t len, bool urgent)
+{
+	int err = 0;
+
+	k_mutex_lock(&tcp_lock, K_FOREVER);
+
+	stats.sends++;
+
+	if ((backlog_len + FRAME_HEADER_SIZE + len) > sizeof(backlog)) {
+		/* Make what room the send window takes, a backlog that stays full drops the newest. */
+		tcp_flush();
+	}
+
+	if ((backlog_len + FRAME_HEADER_SIZE + len) > sizeof(backlog)) {
+		stats.dropped++;
+		err = -ENOMEM;
+	} else {
+		sys_put_le16(len, &backlog[backlog_len]);
+		memcpy(&backlog[backlog_len + FRAME_HEADER_SIZE], data, len);
+		backlog_len += FRAME_HEADER_SIZE + len;
+		stats.backlog = backlog_len;
+	}
+
+	if (urgent || (backlog_len >= CONFIG_UDP_TCP_COALESCE_SIZE)) {
+		tcp_flush();
+	} else if (backlog_len > 0) {
+		/* Held back for the datagrams that come right after it. */
+		perf_work_schedule(&flush_work, K_MSEC(CONFIG_UDP_TCP_COALESCE_MS));
+	}
+
+	k_mutex_unlock(&tcp_lock);
+
+	return err;
+}
+
+static void tcp_stats_get(struct uplink_transport_stats *out)
+{
+	k_mutex_lock(&tcp_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&tcp_lock);
+}
+
+const struct uplink_transport uplink_transport_tcp = {
+	.name = "TCP",
+	.connect = tcp_connect,
+	.send = tcp_send,
+	.stats_get = tcp_stats_get,
+};
+
+static int uplink_tcp_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	perf_work_init(&flush_work, flush_work_fn);
+
+	return 0;
+}
+
+SYS_INIT(uplink_tcp_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef UPLINK_TRANSPORT_H__
+#define UPLINK_TRANSPORT_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+
+#include "uplink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A way of getting the datagrams to the server.
+ *
+ * The functions may be called from any thread, a backend serializes them
+ * itself. Reconnecting after a failure is up to the backend.
+ */
+struct uplink_transport {
+	const char *name;
+
+	/**
+	 * @brief Connect to the server, which is kept for reconnecting.
+	 *
+	 * @return int 0 if successful, negative error code if not.
+	 */
+	int (*connect)(const struct sockaddr_in *server);
+
+	/**
+	 * @brief Send a datagram, in the format of uplink.h.
+	 *
+	 * @param urgent It carries urgent records, do not hold it back.
+	 * @return int 0 if sent or queued, negative error code if not.
+	 */
+	int (*send)(const uint8_t *data, size_t len, bool urgent);
+
+	/** @brief Get the counters. */
+	void (*stats_get)(struct uplink_transport_stats *stats);
+};
+
+/* One datagram per UDP or DTLS datagram, or per CoAP request. */
+extern const struct uplink_transport uplink_transport_udp;
+
+/* Length prefixed datagrams on a TCP stream, see uplink_tcp.c. */
+extern const struct uplink_transport uplink_transport_tcp;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UPLINK_TRANSPORT_H__ */
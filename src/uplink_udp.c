@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#if defined(CONFIG_UDP_DTLS)
+#include <zephyr/net/tls_credentials.h>
+#include <string.h>
+#endif
+
+#include "uplink_transport.h"
+#include "uplink_coap.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(uplink_udp, CONFIG_UDP_LOG_LEVEL);
+
+#define UDP_IP_HEADER_SIZE 28
+
+/* Guards the socket and the counters. */
+static K_MUTEX_DEFINE(udp_lock);
+
+static int client_fd = -1;
+static struct sockaddr_in host_addr;
+static struct uplink_transport_stats stats;
+
+static void server_disconnect(void)
+{
+#if defined(CONFIG_UDP_COAP)
+	uplink_coap_socket_set(-1);
+#endif
+	(void)close(client_fd);
+	client_fd = -1;
+}
+
+#if defined(CONFIG_UDP_DTLS)
+/* The Connection ID was asked for in the handshake of the current socket. */
+static bool cid_requested;
+
+/*
+ * Where credentials are stored by Zephyr, e.g. on qemu_x86, the PSK is
+ * added from Kconfig. The nRF91 modem keeps its own, provisioned under
+ * the security tag beforehand.
+ */
+static int dtls_credentials_add(void)
+{
+#if defined(CONFIG_TLS_CREDENTIALS)
+	static uint8_t psk[(sizeof(CONFIG_UDP_DTLS_PSK) - 1) / 2];
+	int err;
+
+	if (hex2bin(CONFIG_UDP_DTLS_PSK, strlen(CONFIG_UDP_DTLS_PSK), psk, sizeof(psk)) !=
+	    sizeof(psk)) {
+		return -EINVAL;
+	}
+
+	err = tls_credential_add(CONFIG_UDP_DTLS_SEC_TAG, TLS_CREDENTIAL_PSK, psk, sizeof(psk));
+	if ((err == 0) || (err == -EEXIST)) {
+		err = tls_credential_add(CONFIG_UDP_DTLS_SEC_TAG, TLS_CREDENTIAL_PSK_ID,
+					 CONFIG_UDP_DTLS_PSK_IDENTITY,
+					 strlen(CONFIG_UDP_DTLS_PSK_IDENTITY));
+	}
+
+	return (err == -EEXIST) ? 0 : err;
+#else
+	return 0;
+#endif
+}
+
+static int dtls_setup(int fd)
+{
+	static const sec_tag_t sec_tags[] = { CONFIG_UDP_DTLS_SEC_TAG };
+	int verify = TLS_PEER_VERIFY_REQUIRED;
+	int err;
+
+	err = setsockopt(fd, SOL_TLS, TLS_SEC_TAG_LIST, sec_tags, sizeof(sec_tags));
+	if (err == 0) {
+		err = setsockopt(fd, SOL_TLS, TLS_PEER_VERIFY, &verify, sizeof(verify));
+	}
+	if ((err == 0) && (sizeof(CONFIG_UDP_DTLS_HOSTNAME) > 1)) {
+		err = setsockopt(fd, SOL_TLS, TLS_HOSTNAME, CONFIG_UDP_DTLS_HOSTNAME,
+				 sizeof(CONFIG_UDP_DTLS_HOSTNAME) - 1);
+	}
+	if (err) {
+		printk("Failed to set up DTLS: %d\n", errno);
+		return -errno;
+	}
+
+#if defined(TLS_SESSION_CACHE)
+	/* A new handshake after the socket failed resumes the session. */
+	{
+		int cache = TLS_SESSION_CACHE_ENABLED;
+
+		if (setsockopt(fd, SOL_TLS, TLS_SESSION_CACHE, &cache, sizeof(cache))) {
+			LOG_WRN("No DTLS session cache (%d)", errno);
+		}
+	}
+#endif
+
+	cid_requested = false;
+#if defined(CONFIG_UDP_DTLS_CID) && defined(TLS_DTLS_CID)
+	/*
+	 * With a Connection ID the server finds the session by it and not
+	 * by address, so it survives NAT rebinding while the modem is in PSM.
+	 */
+	{
+		int cid = TLS_DTLS_CID_SUPPORTED;
+
+		if (setsockopt(fd, SOL_TLS, TLS_DTLS_CID, &cid, sizeof(cid))) {
+			LOG_WRN("No DTLS Connection ID (%d)", errno);
+		} else {
+			cid_requested = true;
+		}
+	}
+#elif defined(CONFIG_UDP_DTLS_CID)
+	{
+		/* Nothing changes on the next connect, once is enough. */
+		static bool warned;
+
+		if (!warned) {
+			LOG_WRN("No DTLS Connection ID, the socket API has no TLS_DTLS_CID");
+			warned = true;
+		}
+	}
+#endif
+
+	return 0;
+}
+
+/* Whether the server took the Connection ID, once the handshake is done. */
+static bool dtls_cid_active(int fd)
+{
+#if defined(TLS_DTLS_CID_STATUS)
+	int status = TLS_DTLS_CID_STATUS_DISABLED;
+	socklen_t len = sizeof(status);
+
+	if (cid_requested &&
+	    (getsockopt(fd, SOL_TLS, TLS_DTLS_CID_STATUS, &status, &len) == 0)) {
+		return status != TLS_DTLS_CID_STATUS_DISABLED;
+	}
+#endif
+	return false;
+}
+#endif
+
+static int server_connect(void)
+{
+	int64_t start;
+	uint32_t handshake_ms;
+	int err;
+
+#if defined(CONFIG_UDP_DTLS)
+	client_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_DTLS_1_2);
+#else
+	client_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#endif
+	if (client_fd < 0) {
+		printk("Failed to create UDP socket: %d\n", errno);
+		err = -errno;
+		goto error;
+	}
+
+#if defined(CONFIG_UDP_DTLS)
+	err = dtls_setup(client_fd);
+	if (err) {
+		goto error;
+	}
+#endif
+
+	/* For DTLS, connect() runs the handshake, blocking the uplink work queue. */
+	start = k_uptime_get();
+	err = connect(client_fd, (struct sockaddr *)&host_addr, sizeof(host_addr));
+	if (err < 0) {
+		printk("Connect failed : %d\n", errno);
+		goto error;
+	}
+	handshake_ms = (uint32_t)(k_uptime_get() - start);
+
+	stats.connects++;
+	stats.connect_ms_last = handshake_ms;
+	stats.connect_ms_max = MAX(stats.connect_ms_max, handshake_ms);
+#if defined(CONFIG_UDP_DTLS)
+	stats.cid = dtls_cid_active(client_fd);
+#endif
+#if defined(CONFIG_UDP_COAP)
+	uplink_coap_socket_set(client_fd);
+#endif
+
+	return 0;
+
+error:
+	server_disconnect();
+
+	return err;
+}
+
+
+static int udp_connect(const struct sockaddr_in *server)
+{
+	int err = 0;
+
+	k_mutex_lock(&udp_lock, K_FOREVER);
+
+	host_addr = *server;
+#if defined(CONFIG_UDP_DTLS)
+	err = dtls_credentials_add();
+#endif
+	if (err == 0) {
+		err = server_connect();
+	}
+
+	k_mutex_unlock(&udp_lock);
+
+	return err;
+}
+
+static int udp_send(const uint8_t *data, size_t len, bool urgent)
+{
+	int err;
+
+	k_mutex_lock(&udp_lock, K_FOREVER);
+
+	/* A socket that failed is set up again, for DTLS that is a new handshake. */
+	if (client_fd < 0) {
+		(void)server_connect();
+	}
+
+	LOG_DBG("Transmitting UDP/IP payload of %zu bytes to %s:%d",
+		len + UDP_IP_HEADER_SIZE, CONFIG_UDP_SERVER_ADDRESS_STATIC,
+		CONFIG_UDP_SERVER_PORT);
+
+#if defined(CONFIG_UDP_COAP)
+	/* Urgent records are the critical ones, they are confirmed. */
+	err = uplink_coap_send(data, len, urgent);
+#else
+	err = (send(client_fd, data, len, 0) < 0) ? -errno : 0;
+#endif
+	stats.sends++;
+	stats.writes++;
+	if (err < 0) {
+		LOG_WRN("Failed to transmit UDP packet, %d", err);
+		stats.send_errors++;
+		if (IS_ENABLED(CONFIG_UDP_DTLS) && (client_fd >= 0)) {
+			server_disconnect();
+		}
+	} else {
+		stats.bytes += len;
+	}
+
+	k_mutex_unlock(&udp_lock);
+
+	return err;
+}
+
+static void udp_stats_get(struct uplink_transport_stats *out)
+{
+	k_mutex_lock(&udp_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&udp_lock);
+}
+
+const struct uplink_transport uplink_transport_udp = {
+	.name = IS_ENABLED(CONFIG_UDP_COAP) ? "CoAP" : (IS_ENABLED(CONFIG_UDP_DTLS) ? "DTLS" : "UDP"),
+	.connect = udp_connect,
+	.send = udp_send,
+	.stats_get = udp_stats_get,
+};
@@ -6,11 +6,53 @@
 
 #include <zephyr/kernel.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <zephyr/shell/shell.h>
 
 #include "ui_rgb_control.h"
 #include "ui_buzzer_control.h"
 #include "ui_buzzer.h"
+#include "ui_melody.h"
+#include "ui_input.h"
+#include "uplink.h"
+#include "perf_stats.h"
+#include "shell_args.h"
+#if defined(CONFIG_BENCH)
+#include "bench.h"
+#endif
+#if defined(CONFIG_UI_LED_SOFT_PWM)
+#include "ui_led_soft_pwm.h"
+#endif
+#if defined(CONFIG_TRACEPOINT)
+#include "trace.h"
+#endif
+#if defined(CONFIG_STREAM)
+#include "stream.h"
+#endif
+#if defined(CONFIG_SENSOR_MGR)
+#include "sensor_mgr.h"
+#endif
+#if defined(CONFIG_SENSOR_AGG)
+#include "sensor_agg.h"
+#include "cycles.h"
+#endif
+#if defined(CONFIG_SAMPLE_COORD)
+#include "sample_coord.h"
+#endif
+#if defined(CONFIG_MOTION)
+#include "motion.h"
+#endif
+#if defined(CONFIG_VIBRATION)
+#include "vibration.h"
+#endif
+#if defined(CONFIG_GEOFENCE)
+#include "geofence_mgr.h"
+#include "cycles.h"
+#endif
+#if defined(CONFIG_UDP_COAP)
+#include "uplink_coap.h"
+#endif
 #include "user_shell_cmd.h"
 
 static int cmd_gnss(const struct shell *shell, size_t argc,
@@ -35,213 +77,1158 @@ static int cmd_fftt(const struct shell *shell, size_t argc,
 	return 0;
 }
 
-static int cmd_rgb(const struct shell *shell, size_t argc,
-                           char **argv)
+/* Arguments of the commands that drive the UI engines. */
+struct rgb_args {
+	struct ui_rgb_control_color color;
+	struct ui_rgb_control_effect effect;
+};
+
+struct buzzer_args {
+	struct ui_buzzer_control_tone tone;
+	struct ui_buzzer_control_effect effect;
+};
+
+struct buzzer_play_args {
+	uint8_t intensity;
+	uint8_t duration;
+};
+
+struct batch_args {
+	uint32_t repeat;
+	uint32_t gap_ms;
+};
+
+static const struct shell_arg rgb_schema[] = {
+	SHELL_ARG(struct rgb_args, color.red, "red", 0, 255),
+	SHELL_ARG(struct rgb_args, color.green, "green", 0, 255),
+	SHELL_ARG(struct rgb_args, color.blue, "blue", 0, 255),
+	SHELL_ARG_OPT(struct rgb_args, effect.type, "type",
+		      UI_RGB_CONTROL_TYPE_CONTINUE, UI_RGB_CONTROL_TYPE_BLINKY,
+		      UI_RGB_CONTROL_TYPE_CONTINUE),
+	SHELL_ARG_OPT(struct rgb_args, effect.duration, "duration", 0, 255, 0),
+	SHELL_ARG_OPT(struct rgb_args, effect.interval, "interval", 0, 255, 1),
+	SHELL_ARG_OPT(struct rgb_args, effect.duty, "duty", 0, 99, 50),
+};
+
+static const struct shell_arg buzzer_schema[] = {
+	SHELL_ARG(struct buzzer_args, tone.frequency, "frequency", 0, CMD_BUZZER_ARG_FREQUENCY_MAX),
+	SHELL_ARG_OPT(struct buzzer_args, tone.intensity, "intensity", 0,
+		      CMD_BUZZER_ARG_INTENSITY_MAX, CMD_BUZZER_ARG_INTENSITY_MAX),
+	SHELL_ARG_OPT(struct buzzer_args, effect.type, "type",
+		      UI_BUZZER_CONTROL_TYPE_CONTINUE, UI_BUZZER_CONTROL_TYPE_BLINKY,
+		      UI_BUZZER_CONTROL_TYPE_CONTINUE),
+	SHELL_ARG_OPT(struct buzzer_args, effect.duration, "duration", 0, 255, 0),
+	SHELL_ARG_OPT(struct buzzer_args, effect.interval, "interval", 0, 255, 1),
+	SHELL_ARG_OPT(struct buzzer_args, effect.duty, "duty", 0, 99, 50),
+};
+
+static const struct shell_arg buzzer_play_schema[] = {
+	SHELL_ARG_OPT(struct buzzer_play_args, intensity, "intensity", 0,
+		      CMD_BUZZER_ARG_INTENSITY_MAX, CMD_BUZZER_ARG_INTENSITY_MAX),
+	SHELL_ARG_OPT(struct buzzer_play_args, duration, "duration", 0, 255, 0),
+};
+
+static const struct shell_arg batch_schema[] = {
+	SHELL_ARG_OPT(struct batch_args, repeat, "repeat", 1, UINT16_MAX, 1),
+	SHELL_ARG_OPT(struct batch_args, gap_ms, "gap", 0, 60000, 0),
+};
+
+static int rgb_apply(const void *args)
+{
+	const struct rgb_args *rgb = args;
+
+	return ui_rgb_control_layer_set(UI_RGB_CONTROL_LAYER_SHELL, rgb->color, rgb->effect);
+}
+
+static int buzzer_apply(const void *args)
+{
+	const struct buzzer_args *buzzer = args;
+
+	return ui_buzzer_control_layer_set(UI_BUZZER_CONTROL_LAYER_SHELL, buzzer->tone,
+					   buzzer->effect);
+}
+
+static int release_apply(const void *args)
 {
-	int cnt;
 	int ret;
-	struct ui_rgb_control_color rgb_color;
-	struct ui_rgb_control_effect rgb_effect;
-	uint32_t arg_val;
-	uint16_t arg_flag = 0;
-	uint8_t arg_opt_flag = 2;
 
-	for (cnt = 0; cnt < argc; cnt++) {
-			switch(cnt)
-			{
-				case CMD_RGB_ARG_RED:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= 255)) {
-						rgb_color.red = arg_val;
-					}
-					else {
-						arg_flag = cnt;
-					}					
-					break;
-				case CMD_RGB_ARG_GREEN:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= 255)) {
-						rgb_color.green = arg_val;
-					}
-					else {
-						arg_flag = cnt; 
-					}	
-					break;
-				case CMD_RGB_ARG_BLUE:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= 255)) {
-						rgb_color.blue = arg_val;
-					}
-					else {
-						arg_flag = cnt; 
-					}	
-					break;
-				case CMD_RGB_ARG_TYPE:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= 1)) {
-						rgb_effect.type = arg_val;
-					}
-					else {
-						arg_flag = cnt; 
-					}					
-					break;
-				case CMD_RGB_ARG_DURATION:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= 255)) {
-						rgb_effect.duration = arg_val;
-					}
-					else {
-						arg_flag = cnt; 
-					}					
-					break;				
-				case CMD_RGB_ARG_INTERVAL:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= 255)) {
-						rgb_effect.interval = arg_val;
-						arg_opt_flag = arg_opt_flag - 1;
-					}
-					else {
-						arg_flag = cnt; 
-					}				
-					break;
-				case CMD_RGB_ARG_DUTYCYCLE:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val < 100)) {
-						rgb_effect.duty = arg_val;
-						arg_opt_flag = arg_opt_flag - 1;
-					}
-					else {
-						arg_flag = cnt; 
-					}					
-					break;															
-				default:
-					break;															
-			}
+	ret = ui_rgb_control_layer_clear(UI_RGB_CONTROL_LAYER_SHELL);
+	if(ret == 0) {
+		ret = ui_buzzer_control_layer_clear(UI_BUZZER_CONTROL_LAYER_SHELL);
 	}
 
-	if(rgb_effect.type == UI_RGB_CONTROL_TYPE_BLINKY) {
-		if(arg_opt_flag != 0) {
-			arg_flag = 1001;
+	return ret;
+}
+
+/* A command that can be run from the shell and from a batch line. */
+struct ui_cmd {
+	const char *name;
+	const struct shell_arg *schema;
+	size_t num;
+	int (*apply)(const void *args);
+};
+
+static const struct ui_cmd ui_cmds[] = {
+	{ "rgb", rgb_schema, ARRAY_SIZE(rgb_schema), rgb_apply },
+	{ "buzzer", buzzer_schema, ARRAY_SIZE(buzzer_schema), buzzer_apply },
+	{ "release", NULL, 0, release_apply },
+};
+
+/* Large enough for the arguments of every command in ui_cmds, the largest
+ * member comes first so that { 0 } clears all of it.
+ */
+union ui_cmd_args {
+	struct buzzer_args buzzer;
+	struct rgb_args rgb;
+};
+
+static const struct ui_cmd *ui_cmd_find(const char *name)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(ui_cmds); i++) {
+		if(strcmp(ui_cmds[i].name, name) == 0) {
+			return &ui_cmds[i];
 		}
 	}
-	if(arg_flag == 0) {
-		ret = ui_rgb_control_set(rgb_color,rgb_effect);
-		if(ret) {
-			shell_print(shell, "cmd_rgb excute fail due to ui_rgb_control_set retrun: %d", ret);
-		}
-		else {
-			shell_print(shell, "cmd_rgb excute success");
-		}	
+
+	return NULL;
+}
+
+static int ui_cmd_run(const struct shell *shell, const char *name, size_t argc, char **argv)
+{
+	const struct ui_cmd *cmd = ui_cmd_find(name);
+	union ui_cmd_args args = { 0 };
+	const char *bad = "";
+	int ret;
+
+	ret = shell_args_parse(cmd->schema, cmd->num, argc - 1, &argv[1], &args, &bad);
+	if(ret) {
+		shell_print(shell, "cmd_%s excute fail due to wrong arg : %s", name, bad);
+		return 0;
+	}
+
+	ret = cmd->apply(&args);
+	if(ret) {
+		shell_print(shell, "cmd_%s excute fail: %d", name, ret);
 	}
 	else {
-		shell_print(shell, "cmd_rgb excute fail due to wrong arg : %d", arg_flag);
+		shell_print(shell, "cmd_%s excute success", name);
 	}
 
 	return 0;
 }
 
+static int cmd_rgb(const struct shell *shell, size_t argc, char **argv)
+{
+	return ui_cmd_run(shell, "rgb", argc, argv);
+}
 
 static int cmd_buzzer(const struct shell *shell, size_t argc, char **argv)
 {
-	int cnt;
+	return ui_cmd_run(shell, "buzzer", argc, argv);
+}
+
+static int cmd_buzzer_play(const struct shell *shell, size_t argc, char **argv)
+{
+	/* RTTTL is compiled here, the buzzer control takes a copy of the code. */
+	uint8_t code[UI_BUZZER_CONTROL_MELODY_SIZE];
+	struct ui_buzzer_control_tone buzzer_tone = { 0 };
+	struct ui_buzzer_control_effect buzzer_effect = {
+		.type = UI_BUZZER_CONTROL_TYPE_MELODY,
+	};
+	struct buzzer_play_args args;
+	const struct ui_melody *melody;
+	const char *bad = "";
 	int ret;
-	struct ui_buzzer_control_tone buzzer_tone;
-	struct ui_buzzer_control_effect buzzer_effect;
-	uint32_t arg_val;
-	uint16_t arg_flag = 0;
-	uint8_t arg_opt_flag = 2;
 
-	for (cnt = 0; cnt < argc; cnt++) {
-			switch(cnt)
-			{
-				case CMD_BUZZER_ARG_FREQUENCY:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= CMD_BUZZER_ARG_FREQUENCY_MAX)) {
-						buzzer_tone.frequency = arg_val;
-					}
-					else {
-						arg_flag = cnt;
-					}					
-					break;
-				case CMD_BUZZER_ARG_INTENSITY:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= CMD_BUZZER_ARG_INTENSITY_MAX)) {
-						buzzer_tone.intensity = arg_val;
-					}
-					else {
-						arg_flag = cnt; 
-					}	
-					break;
-
-				case CMD_BUZZER_ARG_TYPE:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= 1)) {
-						buzzer_effect.type = arg_val;
-					}
-					else {
-						arg_flag = cnt; 
-					}					
-					break;
-				case CMD_BUZZER_ARG_DURATION:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= 255)) {
-						buzzer_effect.duration = arg_val;
-					}
-					else {
-						arg_flag = cnt; 
-					}					
-					break;				
-				case CMD_BUZZER_ARG_INTERVAL:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val <= 255)) {
-						buzzer_effect.interval = arg_val;
-						arg_opt_flag = arg_opt_flag - 1;
-					}
-					else {
-						arg_flag = cnt; 
-					}				
-					break;
-				case CMD_BUZZER_ARG_DUTYCYCLE:
-					arg_val = strtol(argv[cnt], NULL, 10);
-					if((arg_val >= 0) && (arg_val < 100)) {
-						buzzer_effect.duty = arg_val;
-						arg_opt_flag = arg_opt_flag - 1;
+	ret = shell_args_parse(buzzer_play_schema, ARRAY_SIZE(buzzer_play_schema),
+			       argc - 2, &argv[2], &args, &bad);
+	if(ret) {
+		shell_print(shell, "cmd_buzzer_play excute fail due to wrong arg : %s", bad);
+		return 0;
+	}
+	buzzer_tone.intensity = args.intensity;
+	buzzer_effect.duration = args.duration;
+
+	melody = ui_melody_find(argv[1]);
+	if(melody != NULL) {
+		buzzer_tone.melody = melody;
+		ret = ui_buzzer_control_layer_set(UI_BUZZER_CONTROL_LAYER_SHELL, buzzer_tone,
+						  buzzer_effect);
+	}
+	else {
+		ret = ui_melody_compile(argv[1], code, sizeof(code));
+		if(ret < 0) {
+			shell_print(shell, "cmd_buzzer_play excute fail, not a melody name or RTTTL: %d", ret);
+			for (size_t i = 0; i < ui_melody_builtin_count; i++) {
+				shell_print(shell, "  %s", ui_melody_builtin[i].name);
+			}
+			return 0;
+		}
+		shell_print(shell, "cmd_buzzer_play compiled %d RTTTL chars into %d bytes",
+			    (int)strlen(argv[1]), ret);
+		ret = ui_buzzer_control_layer_play(UI_BUZZER_CONTROL_LAYER_SHELL, code, ret,
+						   buzzer_tone, buzzer_effect);
+	}
+
+	if(ret) {
+		shell_print(shell, "cmd_buzzer_play excute fail due to ui_buzzer_control retrun: %d", ret);
+	}
+	else {
+		shell_print(shell, "cmd_buzzer_play excute success");
+	}
+
+	return 0;
+}
+
+static int cmd_release(const struct shell *shell, size_t argc, char **argv)
+{
+	return ui_cmd_run(shell, "release", argc, argv);
+}
+
+/*
+ * Whether an argument is a name=value option of schema. A quoted batch
+ * argument may hold a whole command with its own name=value words, it
+ * is only an option if it is one word naming an option of schema.
+ */
+static bool option_word(const struct shell_arg *schema, size_t num, const char *word)
+{
+	const char *value = strchr(word, '=');
+
+	if((value == NULL) || (strpbrk(word, " ;") != NULL)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < num; i++) {
+		if((strncmp(schema[i].name, word, value - word) == 0) &&
+		   (schema[i].name[value - word] == '\0')) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Split the batch arguments into words in place. Commands are separated by
+ * ';', which may stick to a word, and a quoted argument may hold several
+ * words and commands. A NULL word ends every command.
+ */
+static int batch_split(size_t argc, char **argv, char **words, size_t max)
+{
+	size_t num = 0;
+
+	for (size_t i = 0; i < argc; i++) {
+		char *p = argv[i];
+
+		while (*p != '\0') {
+			if((*p == ' ') || (*p == ';')) {
+				if((*p == ';') && (num > 0) && (words[num - 1] != NULL)) {
+					if(num == max) {
+						return -E2BIG;
 					}
-					else {
-						arg_flag = cnt; 
-					}					
-					break;															
-				default:
-					break;															
+					words[num++] = NULL;
+				}
+				*p++ = '\0';
+				continue;
 			}
+
+			if(num == max) {
+				return -E2BIG;
+			}
+			words[num++] = p;
+			while ((*p != '\0') && (*p != ' ') && (*p != ';')) {
+				p++;
+			}
+		}
 	}
-	
-	if(buzzer_effect.type == UI_BUZZER_CONTROL_TYPE_BLINKY) {
-		if(arg_opt_flag != 0) {
-			arg_flag = 1001;
+
+	if((num > 0) && (words[num - 1] != NULL)) {
+		if(num == max) {
+			return -E2BIG;
 		}
+		words[num++] = NULL;
 	}
-	if(arg_flag == 0) {
-		ret = ui_buzzer_control_set(buzzer_tone, buzzer_effect);
+
+	return num;
+}
+
+/*
+ * Run the commands of words, which batch_split() has terminated. With
+ * apply false the arguments are only checked.
+ */
+static int batch_run(const struct shell *shell, char **words, size_t num, bool apply,
+		     uint32_t gap_ms, uint32_t *failed)
+{
+	size_t start = 0;
+
+	while (start < num) {
+		const struct ui_cmd *cmd = ui_cmd_find(words[start]);
+		union ui_cmd_args args = { 0 };
+		const char *bad = "";
+		size_t argc = 0;
+		int ret;
+
+		while (words[start + 1 + argc] != NULL) {
+			argc++;
+		}
+
+		if(cmd == NULL) {
+			shell_print(shell, "cmd_batch unknown command : %s", words[start]);
+			return -EINVAL;
+		}
+
+		ret = shell_args_parse(cmd->schema, cmd->num, argc, &words[start + 1], &args, &bad);
 		if(ret) {
-			shell_print(shell, "cmd_buzzer excute fail due to ui_buzzer_control_set retrun: %d", ret);
+			shell_print(shell, "cmd_batch %s wrong arg : %s", cmd->name, bad);
+			return ret;
+		}
+
+		if(apply) {
+			if(cmd->apply(&args)) {
+				(*failed)++;
+			}
+			if(gap_ms) {
+				k_sleep(K_MSEC(gap_ms));
+			}
+		}
+
+		start += argc + 2;
+	}
+
+	return 0;
+}
+
+static int cmd_batch(const struct shell *shell, size_t argc, char **argv)
+{
+	char *words[CMD_BATCH_WORDS_MAX];
+	struct batch_args args;
+	uint32_t failed = 0;
+	size_t options = 0;
+	int64_t start;
+	int num;
+	int ret;
+
+	/* Leading name=value arguments are batch options, the commands follow. */
+	while ((1 + options < argc) &&
+	       option_word(batch_schema, ARRAY_SIZE(batch_schema), argv[1 + options])) {
+		options++;
+	}
+
+	ret = shell_args_parse(batch_schema, ARRAY_SIZE(batch_schema), options, &argv[1],
+			       &args, NULL);
+	if(ret) {
+		shell_print(shell, "cmd_batch excute fail due to wrong option");
+		return 0;
+	}
+
+	num = batch_split(argc - 1 - options, &argv[1 + options], words, ARRAY_SIZE(words));
+	if(num <= 0) {
+		shell_print(shell, "cmd_batch excute fail, no commands or more than %d words",
+			    CMD_BATCH_WORDS_MAX);
+		return 0;
+	}
+
+	/* Check the whole line first, so a malformed one changes nothing. */
+	ret = batch_run(shell, words, num, false, 0, NULL);
+	if(ret) {
+		return 0;
+	}
+
+	start = k_uptime_get();
+	for (uint32_t i = 0; i < args.repeat; i++) {
+		(void)batch_run(shell, words, num, true, args.gap_ms, &failed);
+	}
+
+	shell_print(shell, "cmd_batch ran %u times in %lld ms, %u commands failed",
+		    args.repeat, k_uptime_get() - start, failed);
+
+	return 0;
+}
+
+#if defined(CONFIG_UI_INPUT)
+static int cmd_input(const struct shell *shell, size_t argc, char **argv)
+{
+	struct ui_input_latency latency;
+
+	ui_input_latency_get(&latency);
+
+	shell_print(shell, "gestures: %u, dropped edges: %u", latency.count, latency.dropped);
+	shell_print(shell, "latency last %u us, max %u us", latency.last_us, latency.max_us);
+
+	return 0;
+}
+#endif
+
+static int cmd_uplink(const struct shell *shell, size_t argc, char **argv)
+{
+	struct uplink_latency latency;
+	struct uplink_report report;
+	struct uplink_slot_info slot;
+	struct uplink_transport_stats transport;
+#if defined(CONFIG_UDP_COAP)
+	struct uplink_coap_stats coap;
+#endif
+
+	uplink_latency_get(&latency);
+
+	shell_print(shell, "urgent sends: %u, coalesced: %u, max %u ms",
+		    latency.count, latency.coalesced, latency.max_ms);
+	for (size_t i = 0; i < UPLINK_LATENCY_BUCKETS; i++) {
+		if (latency.bucket[i] == 0) {
+			continue;
 		}
-		else {
-			shell_print(shell, "cmd_buzzer excute success");
-		}	
+		shell_print(shell, "  %6u - %6u ms: %u", (i == 0) ? 0U : (uint32_t)BIT(i),
+			    (uint32_t)BIT(i + 1) - 1, latency.bucket[i]);
+	}
+
+	uplink_report_get(&report);
+	shell_print(shell, "report on change %s, heartbeat %u s", report.on_change ? "on" : "off",
+		    report.heartbeat_ms / MSEC_PER_SEC);
+	shell_print(shell, "periodic sent: %u, suppressed: %u, %u%% suppressed", report.sent,
+		    report.suppressed, (report.sent + report.suppressed) ?
+		    (uint32_t)(((uint64_t)report.suppressed * 100) / (report.sent + report.suppressed)) :
+		    0U);
+
+	uplink_slot_get(&slot);
+	shell_print(shell, "slot width %u ms, jitter %u ms, phase %u ms%s", slot.width,
+		    slot.jitter, slot.phase, slot.identified ? "" : " (random)");
+
+	uplink_transport_stats_get(&transport);
+	shell_print(shell, "%s connects: %u, last %u ms, max %u ms%s",
+		    uplink_transport_name(), transport.connects,
+		    transport.connect_ms_last, transport.connect_ms_max,
+		    transport.cid ? ", connection ID" : "");
+	shell_print(shell, "datagrams sent: %u, failed: %u, dropped: %u", transport.sends,
+		    transport.send_errors, transport.dropped);
+	shell_print(shell, "writes: %u, bytes: %u, backlog: %u bytes", transport.writes,
+		    transport.bytes, transport.backlog);
+
+#if defined(CONFIG_UDP_COAP)
+	uplink_coap_stats_get(&coap);
+	shell_print(shell, "CoAP NON: %u, CON: %u, CON busy: %u, retransmitted: %u, timed out: %u",
+		    coap.non, coap.con, coap.con_busy, coap.retransmissions, coap.timeouts);
+	shell_print(shell, "blocks sent: %u, fetched: %u, responses: %u, errors: %u, duplicates: %u",
+		    coap.block1, coap.block2, coap.responses, coap.errors, coap.duplicates);
+	shell_print(shell, "header bytes: %u, payload bytes: %u", coap.header_bytes,
+		    coap.payload_bytes);
+#endif
+
+	return 0;
+}
+
+struct uplink_burst_args {
+	uint32_t count;
+	uint32_t size;
+};
+
+static const struct shell_arg uplink_burst_schema[] = {
+	SHELL_ARG(struct uplink_burst_args, count, "count", 1, CMD_UPLINK_BURST_COUNT_MAX),
+	SHELL_ARG(struct uplink_burst_args, size, "size", UPLINK_HEADER_SIZE,
+		  UPLINK_DATAGRAM_SIZE_MAX),
+};
+
+static int cmd_uplink_burst(const struct shell *shell, size_t argc, char **argv)
+{
+	struct uplink_transport_stats before;
+	struct uplink_transport_stats after;
+	struct uplink_burst_args args;
+	uint32_t elapsed_ms;
+	const char *bad = "";
+	int err;
+
+	err = shell_args_parse(uplink_burst_schema, ARRAY_SIZE(uplink_burst_schema),
+			       argc - 1, &argv[1], &args, &bad);
+	if(err) {
+		shell_print(shell, "cmd_uplink_burst excute fail due to wrong arg : %s", bad);
+		return 0;
+	}
+
+	uplink_transport_stats_get(&before);
+	err = uplink_burst(args.count, args.size, &elapsed_ms);
+	uplink_transport_stats_get(&after);
+
+	shell_print(shell, "%u datagrams of %u bytes over %s in %u ms%s", args.count, args.size,
+		    uplink_transport_name(), elapsed_ms, err ? ", failed" : "");
+	shell_print(shell, "%u writes, %u bytes, %u dropped, %u bytes waiting",
+		    after.writes - before.writes, after.bytes - before.bytes,
+		    after.dropped - before.dropped, after.backlog);
+	if(elapsed_ms > 0) {
+		shell_print(shell, "%llu datagrams/s, %llu bytes/s",
+			    (unsigned long long)args.count * MSEC_PER_SEC / elapsed_ms,
+			    (unsigned long long)(after.bytes - before.bytes) * MSEC_PER_SEC /
+			    elapsed_ms);
+	}
+
+	return 0;
+}
+
+struct uplink_report_args {
+	uint8_t on;
+	uint32_t heartbeat;
+};
+
+static const struct shell_arg uplink_report_schema[] = {
+	SHELL_ARG(struct uplink_report_args, on, "on", 0, 1),
+	/* The default 0 is out of range, it keeps the heartbeat as it is. */
+	SHELL_ARG_OPT(struct uplink_report_args, heartbeat, "heartbeat", 1,
+		      UINT32_MAX / MSEC_PER_SEC, 0),
+};
+
+static int cmd_uplink_report(const struct shell *shell, size_t argc, char **argv)
+{
+	struct uplink_report report;
+	struct uplink_report_args args;
+	const char *bad = "";
+	int ret;
+
+	ret = shell_args_parse(uplink_report_schema, ARRAY_SIZE(uplink_report_schema),
+			       argc - 1, &argv[1], &args, &bad);
+	if(ret) {
+		shell_print(shell, "cmd_uplink_report excute fail due to wrong arg : %s", bad);
+		return 0;
+	}
+
+	if(args.heartbeat == 0) {
+		uplink_report_get(&report);
+		args.heartbeat = report.heartbeat_ms / MSEC_PER_SEC;
+	}
+
+	uplink_report_on_change_set(args.on, args.heartbeat * MSEC_PER_SEC);
+
+	return 0;
+}
+
+struct uplink_slot_args {
+	uint32_t width;
+	uint32_t jitter;
+};
+
+static const struct shell_arg uplink_slot_schema[] = {
+	SHELL_ARG(struct uplink_slot_args, width, "width", 0, CMD_UPLINK_SLOT_MS_MAX),
+	SHELL_ARG(struct uplink_slot_args, jitter, "jitter", 0, CMD_UPLINK_SLOT_MS_MAX),
+};
+
+static int cmd_uplink_slot(const struct shell *shell, size_t argc, char **argv)
+{
+	struct uplink_slot_args args;
+	const char *bad = "";
+	int ret;
+
+	ret = shell_args_parse(uplink_slot_schema, ARRAY_SIZE(uplink_slot_schema),
+			       argc - 1, &argv[1], &args, &bad);
+	if(ret) {
+		shell_print(shell, "cmd_uplink_slot excute fail due to wrong arg : %s", bad);
+		return 0;
+	}
+
+	uplink_slot_set(args.width, args.jitter);
+
+	return 0;
+}
+
+static int cmd_stats(const struct shell *shell, size_t argc, char **argv)
+{
+	static struct perf_work_offender worst[CONFIG_PERF_STATS_WORK_WORST];
+	size_t worst_num;
+	int num;
+
+#if defined(CONFIG_PERF_STATS_THREADS)
+	static struct perf_stats_thread threads[CONFIG_PERF_STATS_THREADS_MAX];
+
+	num = perf_stats_threads_get(threads, ARRAY_SIZE(threads));
+	shell_print(shell, "%-24s %6s %6s %6s", "thread", "cpu%", "stack", "unused");
+	for (int i = 0; i < num; i++) {
+		shell_print(shell, "%-24s %4u.%u %6u %6u",
+			    threads[i].name ? threads[i].name : "?",
+			    threads[i].cpu_permille / 10, threads[i].cpu_permille % 10,
+			    threads[i].stack_size, threads[i].stack_unused);
+	}
+#else
+	num = 0;
+	shell_print(shell, "thread statistics need CONFIG_PERF_STATS_THREADS");
+#endif
+
+	shell_print(shell, "%-24s %8s %8s %8s %8s", "queue", "posted", "taken", "dropped", "depth");
+	STRUCT_SECTION_FOREACH(perf_stats_queue, queue) {
+		atomic_val_t posted = atomic_get(&queue->posted);
+		atomic_val_t taken = atomic_get(&queue->taken);
+		atomic_val_t dropped = atomic_get(&queue->dropped);
+
+		shell_print(shell, "%-24s %8u %8u %8u %8d", queue->name, (uint32_t)posted,
+			    (uint32_t)taken, (uint32_t)dropped,
+			    (int)MAX(posted - taken - dropped, 0));
+	}
+
+	shell_print(shell, "%-24s %8s %8s %8s %5s  latency histogram (64 us << i)",
+		    "work", "runs", "max us", "exec us", "over");
+	STRUCT_SECTION_FOREACH(perf_work, work) {
+		char hist[PERF_STATS_LATENCY_BUCKETS * 6 + 1];
+		size_t len = 0;
+
+		for (size_t i = 0; i < PERF_STATS_LATENCY_BUCKETS; i++) {
+			if (work->latency[i] && (len < sizeof(hist))) {
+				len += snprintf(&hist[len], sizeof(hist) - len, " %u:%u",
+						(uint32_t)i, work->latency[i]);
+			}
+		}
+		hist[MIN(len, sizeof(hist) - 1)] = '\0';
+
+		shell_print(shell, "%-24s %8u %8u %8u %5u %s", work->name, work->runs,
+			    work->latency_max_us, work->exec_max_us, work->overruns, hist);
+	}
+
+	worst_num = perf_work_worst_get(worst, ARRAY_SIZE(worst));
+	shell_print(shell, "longest work runs, budget %u ms", CONFIG_PERF_STATS_WORK_BUDGET_MS);
+	for (size_t i = 0; i < worst_num; i++) {
+		shell_print(shell, "  %-24s %10u us at %lld ms, handler %p", worst[i].work->name,
+			    worst[i].exec_us, worst[i].at_ms, worst[i].work->handler);
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_BENCH)
+static void bench_print(const struct shell *shell, const struct bench *bench, bool csv)
+{
+	struct bench_result result;
+
+	bench_run(bench, &result);
+
+	if(csv) {
+		shell_print(shell, "%s,%u,%u,%u,%u", bench->name, result.min,
+			    result.median, result.max, result.repetitions);
 	}
 	else {
-		shell_print(shell, "cmd_buzzer excute fail due to wrong arg : %d", arg_flag);
+		shell_print(shell, "%-28s %8u %8u %8u", bench->name, result.min,
+			    result.median, result.max);
+	}
+}
+
+static int bench_cmd_run(const struct shell *shell, const char *name, bool csv)
+{
+	const struct bench *bench = NULL;
+
+	if(name != NULL) {
+		bench = bench_find(name);
+		if(bench == NULL) {
+			shell_print(shell, "no benchmark named %s", name);
+			return -ENOENT;
+		}
+	}
+
+	if(csv) {
+		shell_print(shell, "name,min,median,max,repetitions");
+	}
+	else {
+		shell_print(shell, "%-28s %8s %8s %8s", "cycles", "min", "median", "max");
+	}
+
+	if(bench != NULL) {
+		bench_print(shell, bench, csv);
+		return 0;
+	}
+
+	BENCH_FOREACH(b) {
+		bench_print(shell, b, csv);
+	}
+
+	return 0;
+}
+
+static int cmd_bench(const struct shell *shell, size_t argc, char **argv)
+{
+	return bench_cmd_run(shell, (argc > 1) ? argv[1] : NULL, false);
+}
+
+static int cmd_bench_csv(const struct shell *shell, size_t argc, char **argv)
+{
+	return bench_cmd_run(shell, (argc > 1) ? argv[1] : NULL, true);
+}
+#endif
+
+#if defined(CONFIG_UI_LED_SOFT_PWM)
+static int cmd_softpwm(const struct shell *shell, size_t argc, char **argv)
+{
+	shell_print(shell, "soft PWM ISR max %u cycles",
+		    ui_led_soft_pwm_isr_cycles_max());
+	return 0;
+}
+#endif
+
+#if defined(CONFIG_SENSOR_MGR)
+static int cmd_sensors(const struct shell *shell, size_t argc, char **argv)
+{
+	struct sensor_mgr_stats stats;
+	struct sensor_mgr_sample sample;
+	uint32_t elapsed_ms;
+#if defined(CONFIG_SENSOR_AGG)
+	struct sensor_agg_stats agg;
+	struct sensor_agg_deadband deadband;
+#endif
+#if defined(CONFIG_SAMPLE_COORD)
+	struct sample_coord_stats coord;
+#endif
+
+	sensor_mgr_stats_get(&stats);
+	elapsed_ms = MAX((uint32_t)(k_uptime_get() - stats.since), 1U);
+
+	shell_print(shell, "%-10s %6s %8s %8s %8s", "sensor", "ready", "period", "fetches", "errors");
+	for (size_t i = 0; i < SENSOR_MGR_SENSOR_NUM; i++) {
+		shell_print(shell, "%-10s %6s %8u %8u %8u", stats.sensor[i].name,
+			    stats.sensor[i].ready ? "yes" : "no", stats.sensor[i].period_ms,
+			    stats.sensor[i].fetches, stats.sensor[i].errors);
+	}
+
+	shell_print(shell, "%u samples in %u ms, %u.%02u/s, %u overwritten", stats.samples,
+		    elapsed_ms, (uint32_t)(((uint64_t)stats.samples * 1000) / elapsed_ms),
+		    (uint32_t)((((uint64_t)stats.samples * 100000) / elapsed_ms) % 100),
+		    stats.overwritten);
+	if(stats.rounds) {
+		shell_print(shell, "%u rounds, %u us avg, %u us max, %u us CPU avg", stats.rounds,
+			    (uint32_t)(stats.round_us_total / stats.rounds), stats.round_us_max,
+			    (uint32_t)(stats.cpu_us_total / stats.rounds));
+	}
+
+	for (size_t ch = 0; ch < SENSOR_MGR_CHANNEL_NUM; ch++) {
+		char values[SENSOR_MGR_VALUES_MAX * 14 + 1];
+		size_t len = 0;
+
+		if(sensor_mgr_latest(ch, &sample)) {
+			continue;
+		}
+		values[0] = '\0';
+		for (size_t i = 0; i < sensor_mgr_channel_values(ch); i++) {
+			int32_t v = sample.value[i];
+
+			len += snprintf(&values[len], sizeof(values) - len, " %s%d.%03d",
+					(v < 0) ? "-" : "", abs(v / 1000), abs(v % 1000));
+		}
+		shell_print(shell, "  %-12s%s at %lld ms", sensor_mgr_channel_name(ch), values,
+			    sample.timestamp);
+	}
+
+#if defined(CONFIG_SENSOR_AGG)
+	sensor_agg_stats_get(&agg);
+	shell_print(shell, "aggregated %u samples, %u cycles each at %u Hz", agg.samples,
+		    agg.samples ? (uint32_t)(agg.cycles / agg.samples) : 0U, cycles_per_sec());
+	shell_print(shell, "%u summaries, %u lost, %llu bytes for %llu bytes of samples",
+		    agg.records, agg.lost, agg.record_bytes, agg.raw_bytes);
+	shell_print(shell, "%u summaries suppressed within the deadband", agg.suppressed);
+	for (size_t ch = 0; ch < SENSOR_MGR_CHANNEL_NUM; ch++) {
+		if(sensor_agg_deadband_get(ch, &deadband) == 0) {
+			shell_print(shell, "  %-12s deadband %u.%03u, %u permille",
+				    sensor_mgr_channel_name(ch), deadband.abs / 1000,
+				    deadband.abs % 1000, deadband.rel);
+		}
+	}
+#endif
+
+#if defined(CONFIG_SAMPLE_COORD)
+	sample_coord_stats_get(&coord);
+	shell_print(shell, "just in time: %u fetches, %u on modem wakeups",
+		    coord.planned + coord.shared, coord.shared);
+	if(coord.sends) {
+		shell_print(shell, "data age at send: %u ms last, %u ms avg, %u ms max",
+			    coord.age_ms_last, (uint32_t)(coord.age_ms_total / coord.sends),
+			    coord.age_ms_max);
+	}
+#endif
+
+	return 0;
+}
+
+struct sensors_period_args {
+	uint32_t period;
+};
+
+static const struct shell_arg sensors_period_schema[] = {
+	SHELL_ARG(struct sensors_period_args, period, "period", 0, CMD_SENSORS_PERIOD_MS_MAX),
+};
+
+static int cmd_sensors_period(const struct shell *shell, size_t argc, char **argv)
+{
+	struct sensor_mgr_stats stats;
+	struct sensors_period_args args;
+	const char *bad = "";
+	int ret;
+
+	ret = shell_args_parse(sensors_period_schema, ARRAY_SIZE(sensors_period_schema),
+			       argc - 2, &argv[2], &args, &bad);
+	if(ret) {
+		shell_print(shell, "cmd_sensors_period excute fail due to wrong arg : %s", bad);
+		return 0;
+	}
+
+	sensor_mgr_stats_get(&stats);
+	for (size_t i = 0; i < SENSOR_MGR_SENSOR_NUM; i++) {
+		if(strcmp(argv[1], stats.sensor[i].name) == 0) {
+			ret = sensor_mgr_period_set(i, args.period);
+			if(ret) {
+				shell_print(shell, "cmd_sensors_period excute fail: %d", ret);
+			}
+			return 0;
+		}
+	}
+
+	shell_print(shell, "cmd_sensors_period excute fail due to wrong arg : %s", argv[1]);
+
+	return 0;
+}
+
+static int cmd_sensors_reset(const struct shell *shell, size_t argc, char **argv)
+{
+	sensor_mgr_stats_reset();
+	return 0;
+}
+
+#if defined(CONFIG_SENSOR_AGG)
+struct sensors_deadband_args {
+	uint32_t abs;
+	uint32_t rel;
+};
+
+static const struct shell_arg sensors_deadband_schema[] = {
+	SHELL_ARG(struct sensors_deadband_args, abs, "abs", 0, INT32_MAX),
+	SHELL_ARG_OPT(struct sensors_deadband_args, rel, "rel", 0, CMD_SENSORS_DEADBAND_REL_MAX, 0),
+};
+
+static int cmd_sensors_deadband(const struct shell *shell, size_t argc, char **argv)
+{
+	struct sensor_agg_deadband deadband;
+	struct sensors_deadband_args args;
+	const char *bad = "";
+	int ret;
+
+	ret = shell_args_parse(sensors_deadband_schema, ARRAY_SIZE(sensors_deadband_schema),
+			       argc - 2, &argv[2], &args, &bad);
+	if(ret) {
+		shell_print(shell, "cmd_sensors_deadband excute fail due to wrong arg : %s", bad);
+		return 0;
+	}
+	deadband.abs = args.abs;
+	deadband.rel = args.rel;
+
+	for (size_t ch = 0; ch < SENSOR_MGR_CHANNEL_NUM; ch++) {
+		if(strcmp(argv[1], sensor_mgr_channel_name(ch)) == 0) {
+			sensor_agg_deadband_set(ch, &deadband);
+			return 0;
+		}
+	}
+
+	shell_print(shell, "cmd_sensors_deadband excute fail due to wrong arg : %s", argv[1]);
+
+	return 0;
+}
+#endif
+#endif
+
+#if defined(CONFIG_MOTION)
+static int cmd_motion(const struct shell *shell, size_t argc, char **argv)
+{
+	struct motion_stats stats;
+	uint32_t elapsed_ms;
+
+	motion_stats_get(&stats);
+	elapsed_ms = MAX((uint32_t)(k_uptime_get() - stats.since), 1U);
+
+	shell_print(shell, "%s, %u changes, %u mg jerk",
+		    (stats.state == MOTION_MOVING) ? "moving" : "still", stats.state_changes,
+		    stats.jerk_mg);
+	shell_print(shell, "%u samples, %u overruns in %u ms", stats.samples, stats.overruns,
+		    elapsed_ms);
+	shell_print(shell, "%u wakeups, %u/min, %u/min polled per sample", stats.wakeups,
+		    (uint32_t)(((uint64_t)stats.wakeups * 60000) / elapsed_ms),
+		    (uint32_t)(((uint64_t)stats.polled_wakeups * 60000) / elapsed_ms));
+
+	return 0;
+}
+#endif
+
+#if defined(CONFIG_VIBRATION)
+static int cmd_vibration(const struct shell *shell, size_t argc, char **argv)
+{
+	struct vibration_stats stats;
+
+	vibration_stats_get(&stats);
+
+	shell_print(shell, "%u blocks of %u, %u us last, %u us max, %u restarts", stats.blocks,
+		    CONFIG_VIBRATION_FFT_SIZE, stats.block_us_last, stats.block_us_max,
+		    stats.restarts);
+	shell_print(shell, "%u records, %u lost", stats.records, stats.lost);
+	if(stats.records == 0) {
+		return 0;
+	}
+
+	for (size_t b = 0; b < CONFIG_VIBRATION_BANDS; b++) {
+		shell_print(shell, "  band %u: %u.%u mg rms", b, stats.last.band_rms[b] / 10,
+			    stats.last.band_rms[b] % 10);
+	}
+	for (size_t i = 0; i < stats.last.peaks; i++) {
+		uint32_t centi_hz = (stats.last.peak_bin[i] * CONFIG_MOTION_ODR_HZ * 100) /
+				    CONFIG_VIBRATION_FFT_SIZE;
+
+		shell_print(shell, "  peak %u.%02u Hz: %u.%u mg", centi_hz / 100, centi_hz % 100,
+			    stats.last.peak_amplitude[i] / 10, stats.last.peak_amplitude[i] % 10);
+	}
+
+	return 0;
+}
+#endif
+
+#if defined(CONFIG_GEOFENCE)
+static int cmd_geofence(const struct shell *shell, size_t argc, char **argv)
+{
+	struct geofence_mgr_stats stats;
+
+	geofence_mgr_stats_get(&stats);
+
+	shell_print(shell, "%u fences, inside %u", stats.fences, stats.inside);
+	shell_print(shell, "%u fixes, lookup %u cycles last, %u avg, %u max at %u Hz", stats.fixes,
+		    stats.lookup_cycles_last,
+		    stats.fixes ? (uint32_t)(stats.lookup_cycles_total / stats.fixes) : 0U,
+		    stats.lookup_cycles_max, cycles_per_sec());
+	shell_print(shell, "%u enters, %u exits, %u dwells, %u lost", stats.enters, stats.exits,
+		    stats.dwells, stats.lost);
+
+	return 0;
+}
+
+static int cmd_geofence_check(const struct shell *shell, size_t argc, char **argv)
+{
+	uint16_t ids[CONFIG_GEOFENCE_INSIDE_MAX];
+	double deg[2];
+	char *end;
+	size_t num;
+
+	for (size_t i = 0; i < 2; i++) {
+		deg[i] = strtod(argv[i + 1], &end);
+		/* Written so that NaN is out of range too. */
+		if((end == argv[i + 1]) || (*end != '\0') ||
+		   !((deg[i] >= ((i == 0) ? -90.0 : -180.0)) &&
+		     (deg[i] <= ((i == 0) ? 90.0 : 180.0)))) {
+			shell_print(shell, "cmd_geofence_check excute fail due to wrong arg : %s",
+				    argv[i + 1]);
+			return 0;
+		}
+	}
+
+	num = geofence_mgr_check((int32_t)(deg[0] * 10000000.0), (int32_t)(deg[1] * 10000000.0),
+				 ids, ARRAY_SIZE(ids));
+	shell_print(shell, "inside %u fences", num);
+	for (size_t i = 0; i < num; i++) {
+		shell_print(shell, "  %u", ids[i]);
+	}
+
+	return 0;
+}
+#endif
+
+#if defined(CONFIG_STREAM)
+struct stream_args {
+	uint32_t rate;
+	uint32_t size;
+};
+
+static const struct shell_arg stream_schema[] = {
+	SHELL_ARG_OPT(struct stream_args, rate, "rate", 1, 10000, 100),
+	SHELL_ARG_OPT(struct stream_args, size, "size", 4, STREAM_DATA_MAX, 16),
+};
+
+/* Indexed by enum stream_channel. */
+static const char *const stream_channel_names[STREAM_CHANNEL_NUM] = {
+	"rgb", "buzzer", "input", "load", "sensor",
+};
+
+static int cmd_stream(const struct shell *shell, size_t argc, char **argv)
+{
+	struct stream_stats stats;
+	struct stream_args args;
+	uint32_t channels = 0;
+	size_t options = 0;
+	int ret;
+
+	/* Leading name=value arguments are options, the channels follow. */
+	while ((1 + options < argc) &&
+	       option_word(stream_schema, ARRAY_SIZE(stream_schema), argv[1 + options])) {
+		options++;
+	}
+
+	ret = shell_args_parse(stream_schema, ARRAY_SIZE(stream_schema), options, &argv[1],
+			       &args, NULL);
+	if(ret) {
+		shell_print(shell, "cmd_stream excute fail due to wrong option");
+		return 0;
+	}
+
+	for (size_t i = 1 + options; i < argc; i++) {
+		size_t ch;
+
+		for (ch = 0; ch < STREAM_CHANNEL_NUM; ch++) {
+			if(strcmp(argv[i], stream_channel_names[ch]) == 0) {
+				break;
+			}
+		}
+		if(ch == STREAM_CHANNEL_NUM) {
+			shell_print(shell, "cmd_stream excute fail due to wrong channel : %s", argv[i]);
+			return 0;
+		}
+		channels |= BIT(ch);
+	}
+
+	if(channels == 0) {
+		stream_stats_get(&stats);
+		shell_print(shell, "last stream: %u records, %u dropped, %u bytes in %u ms",
+			    stats.records, stats.dropped, stats.bytes, stats.elapsed_ms);
+		return 0;
+	}
+
+	shell_print(shell, "streaming, send any byte to stop");
+	ret = stream_start(shell, channels, args.rate, args.size);
+	if(ret) {
+		shell_print(shell, "cmd_stream excute fail: %d", ret);
 	}
 
 	return 0;
 }
+#endif
+
+#if defined(CONFIG_TRACEPOINT)
+/* One record per line, the 16 record bytes in hex as scripts/trace_decode.py reads them. */
+static void trace_print(const struct trace_record *record, void *user_data)
+{
+	const struct shell *shell = user_data;
+	const uint8_t *bytes = (const uint8_t *)record;
+	char line[2 * sizeof(*record) + 1];
+
+	for (size_t i = 0; i < sizeof(*record); i++) {
+		snprintf(&line[2 * i], 3, "%02x", bytes[i]);
+	}
+
+	shell_print(shell, "T:%s", line);
+}
+
+static int cmd_trace(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t lost;
+
+	shell_print(shell, "T:rate %u", trace_timestamp_rate());
+	lost = trace_foreach(trace_print, (void *)shell);
+	shell_print(shell, "T:lost %u", lost);
+
+	return 0;
+}
+
+static int cmd_trace_clear(const struct shell *shell, size_t argc, char **argv)
+{
+	trace_clear();
+	return 0;
+}
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_buzzer,
+		SHELL_CMD_ARG(play, NULL,
+			      "play a melody: <name|rtttl> [intensity] [duration, 0=once]",
+			      cmd_buzzer_play, 2, 2),
+		SHELL_SUBCMD_SET_END
+);
+
+#if defined(CONFIG_BENCH)
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_bench,
+		SHELL_CMD_ARG(csv, NULL,
+			      "run microbenchmarks, print CSV: [name]",
+			      cmd_bench_csv, 1, 1),
+		SHELL_SUBCMD_SET_END
+);
+#endif
+
+#if defined(CONFIG_SENSOR_MGR)
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_sensors,
+		SHELL_CMD_ARG(period, NULL, "set a sampling period: <sensor> <ms, 0=off>",
+			      cmd_sensors_period, 3, 0),
+		SHELL_CMD(reset, NULL, "restart the sampling counters", cmd_sensors_reset),
+#if defined(CONFIG_SENSOR_AGG)
+		SHELL_CMD_ARG(deadband, NULL,
+			      "report a channel on change: <channel> <thousandths> [permille]",
+			      cmd_sensors_deadband, 3, 1),
+#endif
+		SHELL_SUBCMD_SET_END
+);
+#endif
+
+#if defined(CONFIG_GEOFENCE)
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_geofence,
+		SHELL_CMD_ARG(check, NULL, "list the fences containing <lat> <lon> in degrees",
+			      cmd_geofence_check, 3, 0),
+		SHELL_SUBCMD_SET_END
+);
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_uplink,
+		SHELL_CMD_ARG(report, NULL, "report on change: <0|1> [heartbeat s]",
+			      cmd_uplink_report, 2, 1),
+		SHELL_CMD_ARG(slot, NULL, "upload slots: <width ms> <jitter ms>",
+			      cmd_uplink_slot, 3, 0),
+		SHELL_CMD_ARG(burst, NULL, "send filler datagrams back to back: <count> <bytes>",
+			      cmd_uplink_burst, 3, 0),
+		SHELL_SUBCMD_SET_END
+);
+
+#if defined(CONFIG_TRACEPOINT)
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_trace,
+		SHELL_CMD(clear, NULL, "forget the recorded trace points", cmd_trace_clear),
+		SHELL_SUBCMD_SET_END
+);
+#endif
 
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_thingy,
         SHELL_CMD(gnss, NULL, "Start gnss test", cmd_gnss),
         SHELL_CMD(fftt, NULL, "Start first fix time test.", cmd_fftt),
-		SHELL_CMD_ARG(rgb, NULL, "rgb led control", cmd_rgb, 6, 2),
-		SHELL_CMD_ARG(buzzer, NULL, "buzzer control", cmd_buzzer, 5, 2),
+		SHELL_CMD_ARG(rgb, NULL,
+			      "rgb led control: red green blue [type] [duration] [interval] [duty], "
+			      "or name=value", cmd_rgb, 1, 7),
+		SHELL_CMD_ARG(buzzer, &sub_buzzer,
+			      "buzzer control: frequency [intensity] [type] [duration] [interval] "
+			      "[duty], or name=value", cmd_buzzer, 1, 6),
+		SHELL_CMD(release, NULL, "give rgb and buzzer back to the lower layers", cmd_release),
+		SHELL_CMD_ARG(batch, NULL,
+			      "run rgb, buzzer and release commands separated by ';': "
+			      "[repeat=n] [gap=ms] <command; ...>", cmd_batch, 2, SHELL_OPT_ARG_MAXIMUM),
+		SHELL_CMD(stats, NULL, "show thread, queue and work statistics", cmd_stats),
+		SHELL_CMD(uplink, &sub_uplink,
+			  "show urgent uplink latency histogram, report on change and slots", cmd_uplink),
+#if defined(CONFIG_BENCH)
+		SHELL_CMD_ARG(bench, &sub_bench, "run microbenchmarks [name]", cmd_bench, 1, 1),
+#endif
+#if defined(CONFIG_TRACEPOINT)
+		SHELL_CMD(trace, &sub_trace, "dump the trace point ring", cmd_trace),
+#endif
+#if defined(CONFIG_SENSOR_MGR)
+		SHELL_CMD(sensors, &sub_sensors, "show sensor sampling and the latest samples",
+			  cmd_sensors),
+#endif
+#if defined(CONFIG_MOTION)
+		SHELL_CMD(motion, NULL, "show the motion state and accelerometer wakeups",
+			  cmd_motion),
+#endif
+#if defined(CONFIG_VIBRATION)
+		SHELL_CMD(vibration, NULL, "show the vibration spectrum analysis", cmd_vibration),
+#endif
+#if defined(CONFIG_GEOFENCE)
+		SHELL_CMD(geofence, &sub_geofence, "show geofence lookups and events",
+			  cmd_geofence),
+#endif
+#if defined(CONFIG_STREAM)
+		SHELL_CMD_ARG(stream, NULL,
+			      "stream binary records: [rate=hz] [size=bytes] "
+			      "<rgb|buzzer|input|load|sensor>...",
+			      cmd_stream, 1, SHELL_OPT_ARG_MAXIMUM),
+#endif
+#if defined(CONFIG_UI_INPUT)
+		SHELL_CMD(input, NULL, "show button gesture statistics", cmd_input),
+#endif
+#if defined(CONFIG_UI_LED_SOFT_PWM)
+		SHELL_CMD(softpwm, NULL, "show the soft PWM interrupt cost", cmd_softpwm),
+#endif
         SHELL_SUBCMD_SET_END
 );
 /* Creating root (level 0) command "demo" without a handler */
@@ -7,25 +7,21 @@
 extern "C" {
 #endif
 
-#define CMD_RGB_ARG_RED        1
-#define CMD_RGB_ARG_GREEN      2
-#define CMD_RGB_ARG_BLUE       3
-#define CMD_RGB_ARG_TYPE       4
-#define CMD_RGB_ARG_DURATION   5
-#define CMD_RGB_ARG_INTERVAL   6
-#define CMD_RGB_ARG_DUTYCYCLE  7
-
-
-#define CMD_BUZZER_ARG_FREQUENCY  1
-#define CMD_BUZZER_ARG_INTENSITY  2
-#define CMD_BUZZER_ARG_TYPE       3
-#define CMD_BUZZER_ARG_DURATION   4
-#define CMD_BUZZER_ARG_INTERVAL   5
-#define CMD_BUZZER_ARG_DUTYCYCLE  6
-
 #define CMD_BUZZER_ARG_FREQUENCY_MAX 10000
 #define CMD_BUZZER_ARG_INTENSITY_MAX 100
 
+/* One day. */
+#define CMD_SENSORS_PERIOD_MS_MAX    86400000
+/* Permille of the last reported value. */
+#define CMD_SENSORS_DEADBAND_REL_MAX 1000
+
+#define CMD_UPLINK_BURST_COUNT_MAX   100000
+/* One hour, a send is never pushed past the end of its period anyway. */
+#define CMD_UPLINK_SLOT_MS_MAX       3600000
+
+/* Words of all commands of a batch line, the ';' included. */
+#define CMD_BATCH_WORDS_MAX          48
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+#include "vibration.h"
+#include "spectrum.h"
+#include "uplink.h"
+#include "cycles.h"
+#include "isqrt.h"
+#if defined(CONFIG_BENCH)
+#include "bench.h"
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(vibration, CONFIG_UDP_LOG_LEVEL);
+
+#define BLOCK_SIZE CONFIG_VIBRATION_FFT_SIZE
+#define BINS       ((BLOCK_SIZE / 2) + 1)
+
+BUILD_ASSERT(((BLOCK_SIZE & (BLOCK_SIZE - 1)) == 0) && (BLOCK_SIZE <= SPECTRUM_SIZE_MAX),
+	     "FFT size must be a power of two up to SPECTRUM_SIZE_MAX");
+BUILD_ASSERT(CONFIG_VIBRATION_BANDS <= (BLOCK_SIZE / 2), "More bands than bins");
+BUILD_ASSERT(VIBRATION_RECORD_SIZE <= UPLINK_RECORD_DATA_MAX, "Record does not fit");
+
+/* mg are scaled up into Q15, at +-2 g this just fits. */
+#define INPUT_SHIFT 4
+
+/* Samples of the block being filled, per axis. */
+static int16_t block[3][BLOCK_SIZE];
+static size_t fill;
+
+/* Transform buffer, the complex output takes the place of the input. */
+static int16_t work[BLOCK_SIZE] __aligned(4);
+
+/* Power per bin summed over the axes and the blocks so far. */
+static uint64_t power[BINS];
+static uint32_t averaged;
+
+static struct vibration_stats stats;
+static struct k_spinlock stats_lock;
+
+static void axis_transform(const int16_t *x)
+{
+	int32_t sum = 0;
+	int32_t mean;
+
+	/* Gravity would leak into the low bins, take the mean off first. */
+	for (size_t i = 0; i < BLOCK_SIZE; i++) {
+		sum += x[i];
+	}
+	mean = sum / BLOCK_SIZE;
+
+	for (size_t i = 0; i < BLOCK_SIZE; i++) {
+		work[i] = (int16_t)CLAMP((x[i] - mean) * (1 << INPUT_SHIFT), INT16_MIN, INT16_MAX);
+	}
+
+	spectrum_window_q15(work, BLOCK_SIZE);
+	(void)spectrum_rfft_q15(work, BLOCK_SIZE);
+	spectrum_power_add(work, BLOCK_SIZE, power);
+}
+
+/*
+ * With the Hann window a sine of amplitude A mg comes out of the transform
+ * as A * 4, and a band holds 3/16 of the mean square times 16^2, see
+ * spectrum_rfft_q15() for the scaling.
+ */
+static void summarise(struct vibration_summary *summary)
+{
+	uint64_t energy[CONFIG_VIBRATION_BANDS];
+	struct spectrum_peak peaks[CONFIG_VIBRATION_PEAKS];
+
+	for (size_t k = 0; k < BINS; k++) {
+		power[k] /= averaged;
+	}
+
+	spectrum_bands(power, BLOCK_SIZE, energy, CONFIG_VIBRATION_BANDS);
+	for (size_t b = 0; b < CONFIG_VIBRATION_BANDS; b++) {
+		summary->band_rms[b] = MIN(isqrt64((energy[b] * 25) / 12), UINT16_MAX);
+	}
+
+	summary->peaks = spectrum_peaks(power, BLOCK_SIZE, peaks, CONFIG_VIBRATION_PEAKS);
+	for (size_t i = 0; i < summary->peaks; i++) {
+		summary->peak_bin[i] = peaks[i].bin;
+		summary->peak_amplitude[i] = MIN(isqrt64((peaks[i].power * 25) / 4), UINT16_MAX);
+	}
+}
+
+static void record_send(const struct vibration_summary *summary)
+{
+	uint8_t record[VIBRATION_RECORD_SIZE];
+	size_t len = 0;
+	int err;
+
+	sys_put_le16(CONFIG_MOTION_ODR_HZ, &record[len]);
+	len += 2;
+	record[len++] = (uint8_t)(find_msb_set(BLOCK_SIZE) - 1);
+	record[len++] = (uint8_t)averaged;
+	record[len++] = CONFIG_VIBRATION_BANDS;
+	record[len++] = summary->peaks;
+	for (size_t b = 0; b < CONFIG_VIBRATION_BANDS; b++) {
+		sys_put_le16(summary->band_rms[b], &record[len]);
+		len += 2;
+	}
+	for (size_t i = 0; i < summary->peaks; i++) {
+		sys_put_le16(summary->peak_bin[i], &record[len]);
+		sys_put_le16(summary->peak_amplitude[i], &record[len + 2]);
+		len += 4;
+	}
+
+	err = uplink_queue(UPLINK_RECORD_SPECTRUM, record, len);
+	if (err) {
+		LOG_WRN("Queueing the spectrum failed (%d)", err);
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.records++;
+	if (err) {
+		stats.lost++;
+	}
+	stats.last = *summary;
+	k_spin_unlock(&stats_lock, key);
+}
+
+static void block_process(void)
+{
+	uint32_t start = cycles_get();
+	uint32_t us;
+
+	for (size_t a = 0; a < 3; a++) {
+		axis_transform(block[a]);
+	}
+	averaged++;
+
+	us = (uint32_t)(((uint64_t)(cycles_get() - start) * USEC_PER_SEC) / cycles_per_sec());
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.blocks++;
+	stats.block_us_last = us;
+	stats.block_us_max = MAX(stats.block_us_max, us);
+	k_spin_unlock(&stats_lock, key);
+
+	if (averaged >= CONFIG_VIBRATION_AVERAGE) {
+		struct vibration_summary summary = { 0 };
+
+		summarise(&summary);
+		record_send(&summary);
+		memset(power, 0, sizeof(power));
+		averaged = 0;
+	}
+}
+
+void vibration_feed(const int16_t set[3])
+{
+	for (size_t a = 0; a < 3; a++) {
+		block[a][fill] = set[a];
+	}
+
+	if (++fill == BLOCK_SIZE) {
+		fill = 0;
+		block_process();
+	}
+}
+
+void vibration_restart(void)
+{
+	if (fill == 0) {
+		return;
+	}
+
+	fill = 0;
+
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.restarts++;
+	k_spin_unlock(&stats_lock, key);
+}
+
+void vibration_stats_get(struct vibration_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+	k_spin_unlock(&stats_lock, key);
+}
+
+#if defined(CONFIG_BENCH)
+static int16_t bench_buf[SPECTRUM_SIZE_MAX] __aligned(4);
+
+static void bench_spectrum_setup(void)
+{
+	/* Any data will do, the timing hardly depends on it. */
+	for (size_t i = 0; i < ARRAY_SIZE(bench_buf); i++) {
+		bench_buf[i] = (int16_t)((i * 1031) & 0x3fff) - 0x2000;
+	}
+}
+
+static void bench_spectrum_256_run(void)
+{
+	spectrum_window_q15(bench_buf, 256);
+	(void)spectrum_rfft_q15(bench_buf, 256);
+}
+
+static void bench_spectrum_512_run(void)
+{
+	spectrum_window_q15(bench_buf, 512);
+	(void)spectrum_rfft_q15(bench_buf, 512);
+}
+
+BENCH_DEFINE(spectrum_256, bench_spectrum_setup, bench_spectrum_256_run, NULL);
+BENCH_DEFINE(spectrum_512, bench_spectrum_setup, bench_spectrum_512_run, NULL);
+#endif
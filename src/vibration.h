@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+#ifndef VIBRATION_H__
+#define VIBRATION_H__
+
+#include <zephyr/kernel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Uplink record
+ *
+ * Little endian: output data rate in Hz (u16), log2 of the FFT size (u8),
+ * blocks averaged (u8), number of bands (u8), number of peaks (u8), the RMS
+ * acceleration of each band in 0.1 mg (u16), then per peak its bin (u16)
+ * and amplitude in 0.1 mg (u16), strongest first. Bin k is at
+ * k * rate / size Hz, the bands split bins 1 to size / 2 evenly. The power
+ * of the x, y and z axes is summed, so it does not depend on orientation.
+ */
+#define VIBRATION_RECORD_SIZE (6 + (CONFIG_VIBRATION_BANDS * 2) + (CONFIG_VIBRATION_PEAKS * 4))
+
+/** @brief Vibration signature of the averaged blocks. */
+struct vibration_summary {
+	uint16_t band_rms[CONFIG_VIBRATION_BANDS];
+	uint16_t peak_bin[CONFIG_VIBRATION_PEAKS];
+	uint16_t peak_amplitude[CONFIG_VIBRATION_PEAKS];
+	uint8_t peaks;
+};
+
+/** @brief Counters of the analysis. */
+struct vibration_stats {
+	uint32_t blocks;
+	uint32_t records;
+	/* Records the uplink queue had no room for. */
+	uint32_t lost;
+	/* Partial blocks dropped when the accelerometer went to sleep. */
+	uint32_t restarts;
+	/* Time to transform the three axes of a block. */
+	uint32_t block_us_last;
+	uint32_t block_us_max;
+	struct vibration_summary last;
+};
+
+/**
+ * @brief Add an x, y, z sample set in mg.
+ *
+ * A full block is transformed and its power added, every
+ * CONFIG_VIBRATION_AVERAGE blocks a record is queued for the uplink.
+ * Called from the motion thread.
+ */
+void vibration_feed(const int16_t set[3]);
+
+/**
+ * @brief Drop the partial block, the samples are no longer evenly spaced.
+ */
+void vibration_restart(void);
+
+/**
+ * @brief Get the counters and the last summary.
+ *
+ * @param[out] stats Counters.
+ */
+void vibration_stats_get(struct vibration_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VIBRATION_H__ */